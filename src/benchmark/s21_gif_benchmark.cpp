@@ -0,0 +1,205 @@
+/**
+ * @file s21_gif_benchmark.cpp
+ * @brief Throughput of the palette mapping and LZW encoders of the bundled
+ * gif.h.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "../view/include/gif.h"
+
+namespace {
+
+constexpr int kWidth = 640;    ///< Width of the frames.
+constexpr int kHeight = 480;   ///< Height of the frames.
+constexpr int kFrames = 30;    ///< Number of frames.
+
+/**
+ * @brief Frame prepared for LZW compression, as GifWriteFrame() passes it.
+ */
+struct QuantizedFrame {
+  std::vector<uint8_t> source;  ///< RGBA pixels as rendered.
+  std::vector<uint8_t> pixels;  ///< RGBA pixels, palette index in alpha.
+  GifPalette palette;           ///< Palette of the frame.
+};
+
+/**
+ * @brief Draws a frame of a rotating wireframe, like a screencast of the
+ * viewer: background, edge and vertex colors plus blended edge pixels.
+ * @param frame Number of the frame.
+ * @return RGBA pixels.
+ */
+std::vector<uint8_t> DrawFrame(int frame) {
+  std::vector<uint8_t> image(kWidth * kHeight * 4);
+  for (int y = 0; y < kHeight; ++y) {
+    for (int x = 0; x < kWidth; ++x) {
+      uint8_t *pixel = &image[(y * kWidth + x) * 4];
+      pixel[0] = 20;
+      pixel[1] = 20;
+      pixel[2] = 40;
+      pixel[3] = 255;
+      for (int edge = 0; edge < 12; ++edge) {
+        double angle = frame * 0.05 + edge * 0.52;
+        double distance = std::fabs((x - kWidth / 2) * std::cos(angle) +
+                                    (y - kHeight / 2) * std::sin(angle) -
+                                    80 * std::sin(edge + frame * 0.1));
+        if (distance < 2) {
+          uint8_t shade = distance < 1 ? 255 : 140;
+          pixel[0] = pixel[1] = shade;
+          pixel[2] = shade / 2 + 40;
+        }
+      }
+      if ((x + frame * 3) % 97 < 3 && (y + frame * 2) % 71 < 3) {
+        pixel[0] = 255;
+        pixel[1] = pixel[2] = 0;
+      }
+    }
+  }
+  return image;
+}
+
+/**
+ * @brief Draws and quantizes the frames once for all benchmarks.
+ * @return Frames with unchanged pixels set to the transparent index.
+ */
+const std::vector<QuantizedFrame> &RecordedFrames() {
+  static const std::vector<QuantizedFrame> frames = [] {
+    std::vector<QuantizedFrame> result(kFrames);
+    for (int i = 0; i < kFrames; ++i) {
+      QuantizedFrame &frame = result[i];
+      frame.source = DrawFrame(i);
+      const uint8_t *last = i > 0 ? result[i - 1].source.data() : nullptr;
+      frame.pixels.resize(frame.source.size());
+      GifMakePalette(last, frame.source.data(), kWidth, kHeight, 8, false,
+                     &frame.palette);
+      GifThresholdImage(last, frame.source.data(), frame.pixels.data(),
+                        kWidth, kHeight, &frame.palette);
+    }
+    return result;
+  }();
+  return frames;
+}
+
+using LzwWriter = void (*)(FILE *, uint8_t *, uint32_t, uint32_t, uint32_t,
+                           uint32_t, uint32_t, GifPalette *);
+
+/**
+ * @brief Compresses a frame into memory.
+ * @param writer Encoder to use.
+ * @param frame Frame to compress.
+ * @return Image block bytes.
+ */
+std::vector<char> Compress(LzwWriter writer, QuantizedFrame frame) {
+  char *data = nullptr;
+  size_t size = 0;
+  FILE *stream = open_memstream(&data, &size);
+  writer(stream, frame.pixels.data(), 0, 0, kWidth, kHeight, 10,
+         &frame.palette);
+  std::fclose(stream);
+  std::vector<char> bytes(data, data + size);
+  std::free(data);
+  return bytes;
+}
+
+/**
+ * @brief Compresses every recorded frame per iteration.
+ * @param state Benchmark state.
+ * @param writer Encoder to measure.
+ */
+void CompressFrames(benchmark::State &state, LzwWriter writer) {
+  std::vector<QuantizedFrame> frames = RecordedFrames();
+  for (const QuantizedFrame &frame : frames) {
+    if (Compress(writer, frame) != Compress(GifWriteLzwImage, frame)) {
+      state.SkipWithError("Output differs from GifWriteLzwImage");
+      return;
+    }
+  }
+  FILE *sink = std::fopen("/dev/null", "wb");
+  for (auto _ : state) {
+    for (QuantizedFrame &frame : frames) {
+      writer(sink, frame.pixels.data(), 0, 0, kWidth, kHeight, 10,
+             &frame.palette);
+    }
+  }
+  std::fclose(sink);
+  state.SetItemsProcessed(state.iterations() * kFrames);
+  state.SetBytesProcessed(state.iterations() * kFrames * kWidth * kHeight);
+  state.counters["frames/s"] = benchmark::Counter(
+      state.iterations() * kFrames, benchmark::Counter::kIsRate);
+}
+
+void BM_LzwBitwise(benchmark::State &state) {
+  CompressFrames(state, GifWriteLzwImage);
+}
+BENCHMARK(BM_LzwBitwise)->Unit(benchmark::kMillisecond);
+
+void BM_LzwFast(benchmark::State &state) {
+  CompressFrames(state, GifWriteLzwImageFast);
+}
+BENCHMARK(BM_LzwFast)->Unit(benchmark::kMillisecond);
+
+/**
+ * @brief Maps every recorded frame to its palette per iteration.
+ * @param state Benchmark state.
+ * @param dither Whether to use Floyd-Steinberg dithering.
+ * @param useLut Whether palette lookups go through GifPaletteLut.
+ */
+void QuantizeFrames(benchmark::State &state, bool dither, bool useLut) {
+  std::vector<QuantizedFrame> frames = RecordedFrames();
+  std::vector<uint8_t> output(kWidth * kHeight * 4);
+  GifPaletteLut lut;
+  for (auto _ : state) {
+    for (int i = 0; i < kFrames; ++i) {
+      QuantizedFrame &frame = frames[i];
+      const uint8_t *last = i > 0 ? frames[i - 1].source.data() : nullptr;
+      if (useLut) {
+        GifPaletteLutReset(&lut);
+        if (dither) {
+          GifDitherImageLut(last, frame.source.data(), output.data(), kWidth,
+                            kHeight, &frame.palette, &lut);
+        } else {
+          GifThresholdImageLut(last, frame.source.data(), output.data(),
+                               kWidth, kHeight, &frame.palette, &lut);
+        }
+      } else if (dither) {
+        GifDitherImage(last, frame.source.data(), output.data(), kWidth,
+                       kHeight, &frame.palette);
+      } else {
+        GifThresholdImage(last, frame.source.data(), output.data(), kWidth,
+                          kHeight, &frame.palette);
+      }
+      benchmark::DoNotOptimize(output.data());
+    }
+  }
+  state.counters["frames/s"] = benchmark::Counter(
+      state.iterations() * kFrames, benchmark::Counter::kIsRate);
+}
+
+void BM_ThresholdKdTree(benchmark::State &state) {
+  QuantizeFrames(state, false, false);
+}
+BENCHMARK(BM_ThresholdKdTree)->Unit(benchmark::kMillisecond);
+
+void BM_ThresholdLut(benchmark::State &state) {
+  QuantizeFrames(state, false, true);
+}
+BENCHMARK(BM_ThresholdLut)->Unit(benchmark::kMillisecond);
+
+void BM_DitherKdTree(benchmark::State &state) {
+  QuantizeFrames(state, true, false);
+}
+BENCHMARK(BM_DitherKdTree)->Unit(benchmark::kMillisecond);
+
+void BM_DitherLut(benchmark::State &state) {
+  QuantizeFrames(state, true, true);
+}
+BENCHMARK(BM_DitherLut)->Unit(benchmark::kMillisecond);
+
+}  // namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,318 @@
+/**
+ * @file s21_mesh_generator.cpp
+ * @brief Deterministic generator of synthetic .obj models implementation.
+ */
+
+#include "s21_mesh_generator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <numeric>
+#include <stdexcept>
+#include <vector>
+
+namespace s21 {
+
+namespace {
+
+constexpr double kPi = 3.14159265358979323846;
+
+/**
+ * @brief Arrangement of the faces on the vertex grid.
+ */
+struct Layout {
+  std::size_t columns;       ///< Grid cells per row.
+  std::size_t rows;          ///< Rows of grid cells.
+  std::size_t cellsPerFace;  ///< Cells covered by a face, 0 for two
+                             ///< triangles per cell.
+  std::size_t facesPerRow;   ///< Faces in a row of cells.
+};
+
+/**
+ * @brief Chooses a nearly square grid holding the requested number of faces.
+ * @param options Parameters of the model.
+ * @return Arrangement of the faces.
+ */
+Layout MakeLayout(const MeshOptions &options) {
+  if (options.polygonSize < 3 || options.faces == 0) {
+    throw std::invalid_argument("wrong mesh options");
+  }
+  Layout layout;
+  std::size_t cells;
+  if (options.polygonSize == 3) {
+    layout.cellsPerFace = 0;
+    cells = (options.faces + 1) / 2;
+  } else {
+    // The top row of a face has cellsPerFace + 1 vertices, the bottom row
+    // as many for even polygons and one fewer for odd ones.
+    layout.cellsPerFace = (options.polygonSize - 1) / 2;
+    cells = options.faces * layout.cellsPerFace;
+  }
+  std::size_t step = std::max<std::size_t>(layout.cellsPerFace, 1);
+  std::size_t side =
+      static_cast<std::size_t>(std::ceil(std::sqrt(static_cast<double>(cells))));
+  layout.columns = (side + step - 1) / step * step;
+  layout.rows = (cells + layout.columns - 1) / layout.columns;
+  layout.facesPerRow = layout.cellsPerFace == 0
+                           ? layout.columns * 2
+                           : layout.columns / layout.cellsPerFace;
+  return layout;
+}
+
+/**
+ * @brief Calculates the sizes of a model without generating it.
+ * @param options Parameters of the model.
+ * @param layout Arrangement of the faces.
+ * @return Sizes, except the size of the file.
+ */
+MeshInfo CountMesh(const MeshOptions &options, const Layout &layout) {
+  MeshInfo info;
+  info.vertices = (layout.columns + 1) * (layout.rows + 1);
+  info.faces = layout.facesPerRow * layout.rows;
+  info.edges = info.faces * options.polygonSize;
+  info.bytes = 0;
+  return info;
+}
+
+/**
+ * @brief Hashes a seed and an index into a number in [-1, 1).
+ * @param seed Seed of the noise.
+ * @param index Index of the value.
+ * @return Noise value, equal on every platform.
+ */
+double Noise(std::uint32_t seed, std::uint64_t index) {
+  std::uint64_t x = index * 0x9E3779B97F4A7C15ull + seed;
+  x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+  x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+  x ^= x >> 31;
+  return static_cast<double>(x >> 11) / static_cast<double>(1ull << 52) - 1.0;
+}
+
+/**
+ * @brief Buffered writer counting the written bytes.
+ */
+class MeshWriter {
+ public:
+  explicit MeshWriter(const std::string &filename)
+      : file(std::fopen(filename.c_str(), "wb")), bytes(0) {
+    if (!file) {
+      throw std::runtime_error("can't create " + filename);
+    }
+    buffer.reserve(kBufferSize + 256);
+  }
+
+  ~MeshWriter() {
+    if (file) {
+      std::fclose(file);
+    }
+  }
+
+  /**
+   * @brief Appends formatted text.
+   * @param format printf format.
+   */
+  template <typename... Args>
+  void Print(const char *format, Args... args) {
+    char line[256];
+    int size = std::snprintf(line, sizeof(line), format, args...);
+    buffer.insert(buffer.end(), line, line + size);
+    if (buffer.size() >= kBufferSize) {
+      Flush();
+    }
+  }
+
+  /**
+   * @brief Writes the buffered text and closes the file.
+   * @return Number of written bytes.
+   */
+  std::size_t Close() {
+    Flush();
+    bool failed = std::fclose(file) != 0;
+    file = nullptr;
+    if (failed) {
+      throw std::runtime_error("can't write the mesh");
+    }
+    return bytes;
+  }
+
+ private:
+  static constexpr std::size_t kBufferSize = 1 << 20;
+
+  void Flush() {
+    if (std::fwrite(buffer.data(), 1, buffer.size(), file) != buffer.size()) {
+      throw std::runtime_error("can't write the mesh");
+    }
+    bytes += buffer.size();
+    buffer.clear();
+  }
+
+  std::FILE *file;
+  std::vector<char> buffer;
+  std::size_t bytes;
+};
+
+/**
+ * @brief Writes a reference to a vertex in the face format.
+ * @param writer Output.
+ * @param format Face format.
+ * @param index 1-based index of the vertex, texture and normal indices are
+ * the same.
+ */
+void PrintIndex(MeshWriter &writer, FaceFormat format, std::size_t index) {
+  unsigned long long i = index;
+  switch (format) {
+    case FaceFormat::Vertex:
+      writer.Print(" %llu", i);
+      break;
+    case FaceFormat::VertexTexture:
+      writer.Print(" %llu/%llu", i, i);
+      break;
+    case FaceFormat::VertexNormal:
+      writer.Print(" %llu//%llu", i, i);
+      break;
+    case FaceFormat::VertexTextureNormal:
+      writer.Print(" %llu/%llu/%llu", i, i, i);
+      break;
+  }
+}
+
+}  // namespace
+
+MeshInfo WriteMesh(const std::string &filename, const MeshOptions &options) {
+  Layout layout = MakeLayout(options);
+  MeshInfo info = CountMesh(options, layout);
+  MeshWriter writer(filename);
+  std::size_t width = layout.columns + 1;
+  std::size_t height = layout.rows + 1;
+  bool textures = options.faceFormat == FaceFormat::VertexTexture ||
+                  options.faceFormat == FaceFormat::VertexTextureNormal;
+  bool normals = options.faceFormat == FaceFormat::VertexNormal ||
+                 options.faceFormat == FaceFormat::VertexTextureNormal;
+  for (int pass = 0; pass < 3; ++pass) {
+    if ((pass == 1 && !textures) || (pass == 2 && !normals)) {
+      continue;
+    }
+    for (std::size_t r = 0; r < height; ++r) {
+      for (std::size_t c = 0; c < width; ++c) {
+        double u = static_cast<double>(c) / layout.columns;
+        double v = static_cast<double>(r) / layout.rows;
+        if (pass == 1) {
+          writer.Print("vt %.5f %.5f\n", u, v);
+          continue;
+        }
+        double x, y, z, nx = 0.0, ny = 0.0, nz = 1.0;
+        if (options.shape == MeshShape::Grid) {
+          x = 2.0 * u - 1.0;
+          y = 2.0 * v - 1.0;
+          z = 0.05 * std::sin(8.0 * kPi * u) * std::cos(8.0 * kPi * v);
+        } else {
+          double theta = 2.0 * kPi * u, phi = kPi * v;
+          nx = std::sin(phi) * std::cos(theta);
+          ny = std::cos(phi);
+          nz = std::sin(phi) * std::sin(theta);
+          double radius = 1.0;
+          if (options.shape == MeshShape::NoisyScan) {
+            radius += 0.02 * Noise(options.seed, r * width + c);
+          }
+          x = radius * nx;
+          y = radius * ny;
+          z = radius * nz;
+        }
+        if (pass == 0) {
+          writer.Print("v %.6f %.6f %.6f\n", x, y, z);
+        } else {
+          writer.Print("vn %.4f %.4f %.4f\n", nx, ny, nz);
+        }
+      }
+    }
+  }
+  // A scan lists its faces in a scattered order, without holding them in
+  // memory: rows are visited with a stride coprime to their number.
+  std::size_t stride = 1;
+  if (options.shape == MeshShape::NoisyScan && layout.rows > 2) {
+    stride = layout.rows / 2 + 1;
+    while (std::gcd(stride, layout.rows) != 1) {
+      stride++;
+    }
+  }
+  for (std::size_t i = 0; i < layout.rows; ++i) {
+    std::size_t r = i * stride % layout.rows;
+    std::size_t top = r * width + 1, bottom = (r + 1) * width + 1;
+    for (std::size_t f = 0; f < layout.facesPerRow; ++f) {
+      writer.Print("f");
+      if (layout.cellsPerFace == 0) {
+        std::size_t c = f / 2;
+        if (f % 2 == 0) {
+          PrintIndex(writer, options.faceFormat, top + c);
+          PrintIndex(writer, options.faceFormat, bottom + c);
+          PrintIndex(writer, options.faceFormat, top + c + 1);
+        } else {
+          PrintIndex(writer, options.faceFormat, top + c + 1);
+          PrintIndex(writer, options.faceFormat, bottom + c);
+          PrintIndex(writer, options.faceFormat, bottom + c + 1);
+        }
+      } else {
+        std::size_t first = f * layout.cellsPerFace;
+        std::size_t last = first + layout.cellsPerFace;
+        for (std::size_t c = first; c <= last; ++c) {
+          PrintIndex(writer, options.faceFormat, top + c);
+        }
+        std::size_t bottomLast = options.polygonSize % 2 == 0 ? last : last - 1;
+        for (std::size_t c = bottomLast + 1; c-- > first;) {
+          PrintIndex(writer, options.faceFormat, bottom + c);
+        }
+      }
+      writer.Print("\n");
+    }
+  }
+  info.bytes = writer.Close();
+  return info;
+}
+
+std::string CachedMesh(const MeshOptions &options, MeshInfo *info) {
+  char name[128];
+  std::snprintf(name, sizeof(name), "s21_mesh_%s_%s_%d_%llu_%u.obj",
+                ShapeName(options.shape), FaceFormatName(options.faceFormat),
+                options.polygonSize,
+                static_cast<unsigned long long>(options.faces), options.seed);
+  std::filesystem::path path = std::filesystem::temp_directory_path() / name;
+  if (std::filesystem::exists(path)) {
+    *info = CountMesh(options, MakeLayout(options));
+    info->bytes = std::filesystem::file_size(path);
+  } else {
+    // An interrupted run leaves only the temporary file behind.
+    std::filesystem::path partial = path;
+    partial += ".part";
+    *info = WriteMesh(partial.string(), options);
+    std::filesystem::rename(partial, path);
+  }
+  return path.string();
+}
+
+const char *ShapeName(MeshShape shape) {
+  switch (shape) {
+    case MeshShape::Grid:
+      return "grid";
+    case MeshShape::Sphere:
+      return "sphere";
+    default:
+      return "scan";
+  }
+}
+
+const char *FaceFormatName(FaceFormat format) {
+  switch (format) {
+    case FaceFormat::Vertex:
+      return "v";
+    case FaceFormat::VertexTexture:
+      return "vt";
+    case FaceFormat::VertexNormal:
+      return "vn";
+    default:
+      return "vtn";
+  }
+}
+
+}  // namespace s21
@@ -0,0 +1,93 @@
+/**
+ * @file s21_mesh_generator.h
+ * @brief Deterministic generator of synthetic .obj models header file.
+ */
+
+#ifndef S21_MESH_GENERATOR_H
+#define S21_MESH_GENERATOR_H
+
+#include <cstdint>
+#include <string>
+
+namespace s21 {
+
+/**
+ * @brief Surface of a generated model.
+ */
+enum class MeshShape {
+  Grid,      ///< Wavy plane.
+  Sphere,    ///< UV sphere.
+  NoisyScan  ///< Sphere with jittered vertices and shuffled faces, like a
+             ///< 3D scan.
+};
+
+/**
+ * @brief Format of the vertex references of face lines.
+ */
+enum class FaceFormat {
+  Vertex,                ///< "f 1 2 3".
+  VertexTexture,         ///< "f 1/1 2/2 3/3".
+  VertexNormal,          ///< "f 1//1 2//2 3//3".
+  VertexTextureNormal    ///< "f 1/1/1 2/2/2 3/3/3".
+};
+
+/**
+ * @brief Parameters of a generated model.
+ */
+struct MeshOptions {
+  MeshShape shape;         ///< Surface of the model.
+  std::size_t faces;       ///< Requested number of faces, the model has at
+                           ///< least that many.
+  int polygonSize;         ///< Number of vertices per face, at least 3.
+  FaceFormat faceFormat;   ///< Format of the face lines.
+  std::uint32_t seed;      ///< Seed of the noise, equal seeds give equal
+                           ///< files.
+};
+
+/**
+ * @brief Sizes of a generated model.
+ */
+struct MeshInfo {
+  std::size_t vertices;  ///< Number of vertices.
+  std::size_t faces;     ///< Number of faces.
+  std::size_t edges;     ///< Number of face edges, shared ones counted twice.
+  std::size_t bytes;     ///< Size of the file.
+};
+
+/**
+ * @brief Writes a model into an .obj file.
+ * Vertices form a grid on the surface, every face covers a strip of grid
+ * cells along one row.
+ * @param filename Name of the output file.
+ * @param options Parameters of the model.
+ * @return Sizes of the written model.
+ */
+MeshInfo WriteMesh(const std::string &filename, const MeshOptions &options);
+
+/**
+ * @brief Writes a model into the temporary directory unless a file with the
+ * same parameters is already there.
+ * @param options Parameters of the model.
+ * @param info Receives the sizes of the model.
+ * @return Name of the file.
+ */
+std::string CachedMesh(const MeshOptions &options, MeshInfo *info);
+
+/**
+ * @brief Gets a short name of a shape for benchmark names and filenames.
+ * @param shape Shape of a model.
+ * @return Name of the shape.
+ */
+const char *ShapeName(MeshShape shape);
+
+/**
+ * @brief Gets a short name of a face format for benchmark names and
+ * filenames.
+ * @param format Face format.
+ * @return Name of the format.
+ */
+const char *FaceFormatName(FaceFormat format);
+
+}  // namespace s21
+
+#endif  // S21_MESH_GENERATOR_H
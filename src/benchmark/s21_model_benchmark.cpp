@@ -0,0 +1,293 @@
+/**
+ * @file s21_model_benchmark.cpp
+ * @brief Throughput and peak memory of loading and transforming models of
+ * 1K to 50M faces.
+ *
+ * Models are generated by s21_mesh_generator.h into the temporary directory
+ * and reused by later runs. Sizes above S21_BENCH_MAX_FACES (1M by default)
+ * are skipped, a 50M-face model takes a few GB on disk and in memory.
+ */
+
+#include <benchmark/benchmark.h>
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "../model/s21_model_facade.h"
+#include "s21_mesh_generator.h"
+
+namespace {
+
+using s21::FaceFormat;
+using s21::MeshInfo;
+using s21::MeshOptions;
+using s21::MeshShape;
+
+constexpr std::size_t kFaceCounts[] = {1000,    10000,    100000,
+                                       1000000, 10000000, 50000000};
+constexpr std::uint32_t kSeed = 21;  ///< Seed of every generated model.
+
+/**
+ * @brief Resets the peak resident memory of the process to the current one.
+ * Only Linux supports it, elsewhere the peak of the whole run is reported.
+ */
+void ResetPeakMemory() {
+  std::ofstream clearRefs("/proc/self/clear_refs");
+  clearRefs << "5";
+}
+
+/**
+ * @brief Gets the peak resident memory since the last ResetPeakMemory().
+ * @return Peak memory in megabytes.
+ */
+double PeakMemoryMB() {
+  std::ifstream status("/proc/self/status");
+  std::string line;
+  while (std::getline(status, line)) {
+    if (line.compare(0, 6, "VmHWM:") == 0) {
+      return std::stod(line.substr(6)) / 1024.0;
+    }
+  }
+  rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+  return usage.ru_maxrss / (1024.0 * 1024.0);
+#else
+  return usage.ru_maxrss / 1024.0;
+#endif
+}
+
+/**
+ * @brief Adds the rate and memory counters shared by all benchmarks.
+ * @param state Benchmark state.
+ * @param items Name of the processed items.
+ * @param count Items processed per iteration.
+ */
+void SetCounters(benchmark::State &state, const char *items,
+                 std::size_t count) {
+  state.counters[std::string(items) + "/s"] = benchmark::Counter(
+      static_cast<double>(state.iterations() * count),
+      benchmark::Counter::kIsRate);
+  state.counters["peak_MB"] = PeakMemoryMB();
+}
+
+void ParseFile(benchmark::State &state, MeshOptions options) {
+  MeshInfo info;
+  std::string filename = s21::CachedMesh(options, &info);
+  s21::ObjLoader &loader = s21::ObjLoader::Instance();
+  ResetPeakMemory();
+  for (auto _ : state) {
+    loader.ParseFile(filename);
+  }
+  state.SetBytesProcessed(state.iterations() * info.bytes);
+  state.counters["faces"] = static_cast<double>(info.faces);
+  SetCounters(state, "faces", info.faces);
+}
+
+void SamplePreview(benchmark::State &state, MeshOptions options) {
+  MeshInfo info;
+  std::string filename = s21::CachedMesh(options, &info);
+  s21::PreviewSampler sampler;
+  std::size_t points = 0;
+  ResetPeakMemory();
+  for (auto _ : state) {
+    // Only the sampled slices are read, the page cache is warm after the
+    // first iteration like for ParseFile.
+    points = sampler.Sample(filename).points.size() / 3;
+  }
+  state.counters["points"] = static_cast<double>(points);
+  state.counters["sampled_%"] = 100.0 * points / info.vertices;
+  SetCounters(state, "points", points);
+}
+
+void CreateBuffers(benchmark::State &state, MeshOptions options) {
+  MeshInfo info;
+  s21::ObjLoader::Instance().ParseFile(s21::CachedMesh(options, &info));
+  s21::Model model;
+  ResetPeakMemory();
+  for (auto _ : state) {
+    model.CreateBuffers();
+    benchmark::DoNotOptimize(model.GetVertices().data());
+  }
+  SetCounters(state, "vertices", info.vertices);
+}
+
+void CountUniqueEdges(benchmark::State &state, MeshOptions options) {
+  MeshInfo info;
+  s21::ObjLoader &loader = s21::ObjLoader::Instance();
+  loader.ParseFile(s21::CachedMesh(options, &info));
+  const std::vector<GLuint> &lines = loader.GetFaces();
+  ResetPeakMemory();
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        s21::ObjLoader::CountUniqueEdges(lines.data(), lines.size()));
+  }
+  state.counters["unique"] = loader.GetUniqueEdgesCount();
+  SetCounters(state, "edges", lines.size() / 2);
+}
+
+/**
+ * @brief Gets the normalized vertices of a generated model, scanned models
+ * stand for point clouds.
+ * @param options Parameters of the model.
+ * @param info Receives the sizes of the model.
+ * @return Vertex coordinates, three per vertex.
+ */
+std::vector<GLfloat> NormalizedPoints(MeshOptions options, MeshInfo *info) {
+  s21::ObjLoader::Instance().ParseFile(s21::CachedMesh(options, info));
+  s21::Model model;
+  model.CreateBuffers();
+  return model.GetVertices();
+}
+
+void BuildOctree(benchmark::State &state, MeshOptions options) {
+  MeshInfo info;
+  std::vector<GLfloat> points = NormalizedPoints(options, &info);
+  s21::PointOctree octree;
+  ResetPeakMemory();
+  for (auto _ : state) {
+    // Later iterations start from the order of the previous build.
+    octree.Build(points.data(), points.size());
+  }
+  state.counters["nodes"] = static_cast<double>(octree.GetNodes().size());
+  SetCounters(state, "points", info.vertices);
+}
+
+void SelectPoints(benchmark::State &state, MeshOptions options) {
+  MeshInfo info;
+  std::vector<GLfloat> points = NormalizedPoints(options, &info);
+  s21::PointOctree octree;
+  octree.Build(points.data(), points.size());
+  glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 0.0f, 3.0f),
+                               glm::vec3(0.0f, 0.0f, 0.0f),
+                               glm::vec3(0.0f, 1.0f, 0.0f));
+  glm::mat4 projection =
+      glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.75f, 100.0f);
+  s21::PointSelection selection;
+  ResetPeakMemory();
+  for (auto _ : state) {
+    octree.Select(view, projection, 1080, 4 << 20, selection);
+    benchmark::DoNotOptimize(selection.points);
+  }
+  state.counters["selected"] = static_cast<double>(selection.points);
+  state.counters["ranges"] = static_cast<double>(selection.firsts.size());
+  SetCounters(state, "calls", 1);
+}
+
+void InteractModel(benchmark::State &state, MeshOptions options,
+                   s21::TransformationStrategy method) {
+  MeshInfo info;
+  s21::ModelFacade facade;
+  facade.LoadFile(s21::CachedMesh(options, &info));
+  s21::InputData data = {0.0f,  0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f,
+                         s21::Frustum, 1920, 1080};
+  ResetPeakMemory();
+  for (auto _ : state) {
+    data.xRotationAngle = data.xRotationAngle >= 359.0f
+                              ? 0.0f
+                              : data.xRotationAngle + 1.0f;
+    data.scale = data.scale > 1.0f ? 0.99f : 1.01f;
+    data.xMoveOffset = -data.xMoveOffset + 0.01f;
+    benchmark::DoNotOptimize(facade.InteractModel(data, method));
+  }
+  SetCounters(state, "calls", 1);
+}
+
+/**
+ * @brief Gets the largest model size to benchmark.
+ * @return Value of S21_BENCH_MAX_FACES, 1M if it isn't set.
+ */
+std::size_t MaxFaces() {
+  const char *value = std::getenv("S21_BENCH_MAX_FACES");
+  return value ? std::strtoull(value, nullptr, 10) : 1000000;
+}
+
+/**
+ * @brief Builds the name of a benchmark from the model parameters.
+ * @param function Benchmarked function.
+ * @param options Parameters of the model.
+ * @return Name like "ParseFile/sphere/v/3/1000".
+ */
+std::string Name(const char *function, const MeshOptions &options) {
+  return std::string(function) + "/" + s21::ShapeName(options.shape) + "/" +
+         s21::FaceFormatName(options.faceFormat) + "/" +
+         std::to_string(options.polygonSize) + "/" +
+         std::to_string(options.faces);
+}
+
+void RegisterBenchmarks() {
+  std::size_t maxFaces = MaxFaces();
+  // Every shape at every size.
+  for (MeshShape shape :
+       {MeshShape::Grid, MeshShape::Sphere, MeshShape::NoisyScan}) {
+    for (std::size_t faces : kFaceCounts) {
+      if (faces > maxFaces) {
+        continue;
+      }
+      MeshOptions options = {shape, faces, 3, FaceFormat::Vertex, kSeed};
+      benchmark::RegisterBenchmark(Name("ParseFile", options).c_str(),
+                                   ParseFile, options)
+          ->Unit(benchmark::kMillisecond);
+      if (shape != MeshShape::NoisyScan) {
+        continue;
+      }
+      benchmark::RegisterBenchmark(Name("SamplePreview", options).c_str(),
+                                   SamplePreview, options)
+          ->Unit(benchmark::kMillisecond);
+      benchmark::RegisterBenchmark(Name("CreateBuffers", options).c_str(),
+                                   CreateBuffers, options)
+          ->Unit(benchmark::kMillisecond);
+      benchmark::RegisterBenchmark(Name("CountUniqueEdges", options).c_str(),
+                                   CountUniqueEdges, options)
+          ->Unit(benchmark::kMillisecond);
+      benchmark::RegisterBenchmark(Name("BuildOctree", options).c_str(),
+                                   BuildOctree, options)
+          ->Unit(benchmark::kMillisecond);
+      benchmark::RegisterBenchmark(Name("SelectPoints", options).c_str(),
+                                   SelectPoints, options)
+          ->Unit(benchmark::kMillisecond);
+    }
+  }
+  // Face formats and polygon sizes at a fixed size.
+  std::size_t faces = std::min<std::size_t>(100000, maxFaces);
+  for (FaceFormat format :
+       {FaceFormat::VertexTexture, FaceFormat::VertexNormal,
+        FaceFormat::VertexTextureNormal}) {
+    MeshOptions options = {MeshShape::Sphere, faces, 3, format, kSeed};
+    benchmark::RegisterBenchmark(Name("ParseFile", options).c_str(), ParseFile,
+                                 options)
+        ->Unit(benchmark::kMillisecond);
+  }
+  for (int polygonSize : {4, 6, 8}) {
+    MeshOptions options = {MeshShape::Grid, faces, polygonSize,
+                           FaceFormat::Vertex, kSeed};
+    benchmark::RegisterBenchmark(Name("ParseFile", options).c_str(), ParseFile,
+                                 options)
+        ->Unit(benchmark::kMillisecond);
+  }
+  MeshOptions options = {MeshShape::NoisyScan, faces, 3, FaceFormat::Vertex,
+                         kSeed};
+  benchmark::RegisterBenchmark(Name("InteractRotate", options).c_str(),
+                               InteractModel, options, s21::Rotate);
+  benchmark::RegisterBenchmark(Name("InteractScale", options).c_str(),
+                               InteractModel, options, s21::Scale);
+  benchmark::RegisterBenchmark(Name("InteractMove", options).c_str(),
+                               InteractModel, options, s21::Move);
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  benchmark::Initialize(&argc, argv);
+  if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+    return 1;
+  }
+  RegisterBenchmarks();
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+  return 0;
+}
@@ -0,0 +1,348 @@
+/**
+ * @file s21_render_benchmark.cpp
+ * @brief Headless frame times of the renderer across model sizes and render
+ * styles.
+ *
+ * The Renderer used by the widget draws synthetic scans into its offscreen
+ * framebuffer along a fixed camera path. Every configuration changes one
+ * style of the baseline, so its cost can be read off directly. Software GL
+ * (llvmpipe) is forced unless --hardware is given, which makes runs
+ * comparable between machines without a GPU. Frame times include the GPU
+ * work, every frame is finished before the clock stops.
+ *
+ * The report also compares building the shader program from source with
+ * loading its cached binary, the part of the time to the first frame the
+ * ShaderCache saves. A driver with its own shader cache (Mesa) makes the
+ * compiled run faster than a first start would be.
+ */
+
+#include <QCommandLineParser>
+#include <QFile>
+#include <QGuiApplication>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <QOpenGLFunctions>
+#include <QOpenGLFunctions_4_1_Core>
+#include <QOpenGLShaderProgram>
+#include <QTemporaryDir>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "../controller/s21_controller.h"
+#include "../view/s21_renderer.h"
+#include "s21_mesh_generator.h"
+
+namespace {
+
+constexpr std::size_t kFaceCounts[] = {10000, 100000, 1000000};
+constexpr std::uint32_t kSeed = 21;  ///< Seed of every generated model.
+constexpr double kPi = 3.14159265358979323846;
+
+/**
+ * @brief Render styles benchmarked on every model.
+ */
+struct RenderConfig {
+  const char *name;                     ///< Name in the report.
+  float linesThickness;                 ///< Width of the edges.
+  int linesStyle;                       ///< 0 solid, 1 dashed.
+  int verticesStyle;                    ///< 0 none, 1 square, 2 round.
+  s21::ProjectionType projectionType;  ///< Projection of the camera.
+};
+
+constexpr RenderConfig kConfigs[] = {
+    {"baseline", 0.001f, 0, 0, s21::Orthogonal},
+    {"thick_lines", 0.005f, 0, 0, s21::Orthogonal},
+    {"dashed_lines", 0.001f, 1, 0, s21::Orthogonal},
+    {"square_vertices", 0.001f, 0, 1, s21::Orthogonal},
+    {"round_vertices", 0.001f, 0, 2, s21::Orthogonal},
+    {"frustum", 0.001f, 0, 0, s21::Frustum},
+};
+
+/**
+ * @brief Frame time statistics of one run.
+ */
+struct RunResult {
+  double mean;  ///< Mean frame time in ms.
+  double p50;   ///< Median frame time in ms.
+  double p95;   ///< 95th percentile in ms.
+  double p99;   ///< 99th percentile in ms.
+  double max;   ///< Slowest frame in ms.
+};
+
+/**
+ * @brief Gets a percentile by the nearest rank, like FrameProfiler does.
+ * @param sorted Frame times sorted ascending, not empty.
+ * @param percentile Percentile in [0, 1].
+ * @return Frame time in ms.
+ */
+double Percentile(const std::vector<double> &sorted, double percentile) {
+  return sorted[static_cast<std::size_t>(percentile * (sorted.size() - 1) +
+                                         0.5)];
+}
+
+/**
+ * @brief Renders a frame of the published state and waits for the GPU.
+ * @param renderer Renderer owned by this thread.
+ * @param functions GL functions of the render context.
+ */
+void RenderFrame(s21::Renderer &renderer, QOpenGLFunctions *functions) {
+  renderer.RequestFrame();
+  // Render() is queued to the renderer's thread, which is this one.
+  QCoreApplication::processEvents();
+  functions->glFinish();
+}
+
+/**
+ * @brief Publishes a state to the renderer.
+ * @param renderer Renderer.
+ * @param state State to render.
+ */
+void PublishState(s21::Renderer &renderer, const s21::RenderState &state) {
+  renderer.GetStates().WriteBuffer() = state;
+  renderer.GetStates().Publish();
+}
+
+/**
+ * @brief Loads a model the way the widget does and uploads its buffers.
+ * @param renderer Renderer.
+ * @param controller Controller of the renderer.
+ * @param functions GL functions of the render context.
+ * @param filename Name of the .obj file.
+ * @param state State receiving the new model generation.
+ */
+void LoadModel(s21::Renderer &renderer, s21::Controller &controller,
+               QOpenGLFunctions *functions, const std::string &filename,
+               s21::RenderState &state) {
+  {
+    std::lock_guard<std::mutex> lock(renderer.GetModelMutex());
+    controller.ParseObjFile(filename);
+    state.scale = 1.0f;
+    state.modelGeneration++;
+    state.mappedModel = false;
+    PublishState(renderer, state);
+  }
+  // Buffers are uploaded in chunks, one per frame.
+  do {
+    RenderFrame(renderer, functions);
+  } while (renderer.GetUploadStats().uploadedBytes <
+           renderer.GetUploadStats().totalBytes);
+}
+
+/**
+ * @brief Renders frames along the camera path.
+ * @param renderer Renderer.
+ * @param functions GL functions of the render context.
+ * @param state Base state, its camera is changed.
+ * @param frames Number of measured frames.
+ * @return Frame time statistics.
+ */
+RunResult Run(s21::Renderer &renderer, QOpenGLFunctions *functions,
+              s21::RenderState state, int frames) {
+  std::vector<double> times;
+  times.reserve(frames);
+  // A few frames settle the shaders and the framebuffers first.
+  for (int i = -5; i < frames; ++i) {
+    // A full turn around Y, nodding around X and zooming in and out.
+    double phase = 2.0 * kPi * std::max(i, 0) / frames;
+    state.yRot = std::max(i, 0) * 360 / frames;
+    state.xRot = static_cast<int>(30.0 * std::sin(phase));
+    state.scale = static_cast<float>(1.0 + 0.25 * std::sin(2.0 * phase));
+    auto start = std::chrono::steady_clock::now();
+    PublishState(renderer, state);
+    RenderFrame(renderer, functions);
+    if (i >= 0) {
+      times.push_back(std::chrono::duration<double, std::milli>(
+                          std::chrono::steady_clock::now() - start)
+                          .count());
+    }
+  }
+  std::sort(times.begin(), times.end());
+  RunResult result;
+  double total = 0.0;
+  for (double time : times) {
+    total += time;
+  }
+  result.mean = total / times.size();
+  result.p50 = Percentile(times, 0.50);
+  result.p95 = Percentile(times, 0.95);
+  result.p99 = Percentile(times, 0.99);
+  result.max = times.back();
+  return result;
+}
+
+/**
+ * @brief Gets the largest model size to benchmark.
+ * @return Value of S21_BENCH_MAX_FACES, 1M if it isn't set.
+ */
+std::size_t MaxFaces() {
+  const char *value = std::getenv("S21_BENCH_MAX_FACES");
+  return value ? std::strtoull(value, nullptr, 10) : 1000000;
+}
+
+/**
+ * @brief Gets a GL string of the current context.
+ * @param functions GL functions.
+ * @param name GL_RENDERER or GL_VERSION.
+ * @return Value of the string.
+ */
+QString GlString(QOpenGLFunctions *functions, GLenum name) {
+  return QString::fromLatin1(
+      reinterpret_cast<const char *>(functions->glGetString(name)));
+}
+
+/**
+ * @brief Builds the shader program of the renderer without and then with
+ * its binary in an empty cache.
+ * @return Build times and whether the second build hit the cache, empty if
+ * the context has no 4.1 core functions.
+ */
+QJsonObject MeasureShaderCache() {
+  QJsonObject result;
+  QOpenGLFunctions_4_1_Core functions;
+  QTemporaryDir directory;
+  if (!functions.initializeOpenGLFunctions() || !directory.isValid()) {
+    return result;
+  }
+  s21::ShaderCache cache(directory.path());
+  bool hit = false;
+  for (const char *run : {"compileMs", "cachedMs"}) {
+    QOpenGLShaderProgram program;
+    hit = cache.Link(
+        program, functions,
+        {{QOpenGLShader::Vertex, ":/shaders/transform_shader.vert"},
+         {QOpenGLShader::Geometry, ":/shaders/geometry_shader.glsl"},
+         {QOpenGLShader::Fragment, ":/shaders/color_shader.frag"}});
+    result[run] = cache.GetLastLinkMs();
+    std::printf("shaders %-9s %9.2f ms\n", run, cache.GetLastLinkMs());
+  }
+  result["cacheHit"] = hit;
+  return result;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  bool hardware = false;
+  for (int i = 1; i < argc; ++i) {
+    hardware = hardware || std::string(argv[i]) == "--hardware";
+  }
+  // Both have to be set before the platform plugin and the GL driver load.
+  if (std::getenv("QT_QPA_PLATFORM") == nullptr) {
+    qputenv("QT_QPA_PLATFORM", "offscreen");
+  }
+  if (!hardware) {
+    qputenv("LIBGL_ALWAYS_SOFTWARE", "1");
+  }
+  QGuiApplication application(argc, argv);
+  QCommandLineParser parser;
+  parser.setApplicationDescription("Headless render benchmark");
+  parser.addHelpOption();
+  QCommandLineOption framesOption("frames", "Measured frames per run.", "n",
+                                  "300");
+  QCommandLineOption widthOption("width", "Frame width.", "pixels", "1280");
+  QCommandLineOption heightOption("height", "Frame height.", "pixels", "720");
+  QCommandLineOption outputOption("output", "JSON report.", "file",
+                                  "render_benchmark.json");
+  QCommandLineOption hardwareOption("hardware", "Use the GPU driver.");
+  parser.addOptions({framesOption, widthOption, heightOption, outputOption,
+                     hardwareOption});
+  parser.process(application);
+  int frames = std::max(parser.value(framesOption).toInt(), 1);
+
+  QOpenGLContext context;
+  QOffscreenSurface surface;
+  surface.setFormat(context.format());
+  surface.create();
+  if (!context.create() || !context.makeCurrent(&surface)) {
+    std::fprintf(stderr, "can't create an OpenGL context\n");
+    return 1;
+  }
+  QOpenGLFunctions *functions = context.functions();
+  s21::ModelFacade model;
+  s21::Controller controller(model);
+  s21::Renderer renderer(controller);
+  renderer.Initialize(&context, &surface);
+
+  s21::RenderState state{};
+  state.width = parser.value(widthOption).toInt();
+  state.height = parser.value(heightOption).toInt();
+  state.scale = 1.0f;
+  state.verticesThikness = 0.01f;
+  state.modelColor = {1.0f, 1.0f, 1.0f};
+  state.verticesColor = {1.0f, 1.0f, 1.0f};
+  state.backgroundColor = {0.0f, 0.0f, 0.0f};
+
+  QJsonArray runs;
+  std::printf("%-9s %-16s %9s %9s %9s %9s %8s %12s\n", "faces", "config",
+              "p50 ms", "p95 ms", "p99 ms", "max ms", "fps", "edges/s");
+  for (std::size_t faces : kFaceCounts) {
+    if (faces > MaxFaces()) {
+      continue;
+    }
+    s21::MeshInfo info;
+    s21::MeshOptions options = {s21::MeshShape::NoisyScan, faces, 3,
+                                s21::FaceFormat::Vertex, kSeed};
+    LoadModel(renderer, controller, functions, s21::CachedMesh(options, &info),
+              state);
+    int edges = controller.GetUnqueEdgesCount();
+    for (const RenderConfig &config : kConfigs) {
+      s21::RenderState runState = state;
+      runState.linesThickness = config.linesThickness;
+      runState.linesStyle = config.linesStyle;
+      runState.verticesStyle = config.verticesStyle;
+      runState.projectionType = config.projectionType;
+      RunResult result = Run(renderer, functions, runState, frames);
+      double fps = 1000.0 / result.mean;
+      std::printf("%-9zu %-16s %9.2f %9.2f %9.2f %9.2f %8.1f %12.0f\n",
+                  info.faces, config.name, result.p50, result.p95, result.p99,
+                  result.max, fps, edges * fps);
+      QJsonObject run;
+      run["faces"] = static_cast<qint64>(info.faces);
+      run["vertices"] = static_cast<qint64>(info.vertices);
+      run["edges"] = edges;
+      run["config"] = config.name;
+      run["lineWidth"] = config.linesThickness;
+      run["lineStyle"] = config.linesStyle;
+      run["vertexStyle"] = config.verticesStyle;
+      run["projection"] =
+          config.projectionType == s21::Orthogonal ? "ortho" : "frustum";
+      run["meanMs"] = result.mean;
+      run["p50Ms"] = result.p50;
+      run["p95Ms"] = result.p95;
+      run["p99Ms"] = result.p99;
+      run["maxMs"] = result.max;
+      run["fps"] = fps;
+      run["edgesPerSecond"] = edges * fps;
+      runs.append(run);
+    }
+  }
+
+  QJsonObject report;
+  report["renderer"] = GlString(functions, GL_RENDERER);
+  report["version"] = GlString(functions, GL_VERSION);
+  report["width"] = state.width;
+  report["height"] = state.height;
+  report["frames"] = frames;
+  report["runs"] = runs;
+  QJsonObject shaders = MeasureShaderCache();
+  report["shaders"] = shaders;
+  renderer.Cleanup();
+
+  QFile file(parser.value(outputOption));
+  if (!file.open(QIODevice::WriteOnly) ||
+      file.write(QJsonDocument(report).toJson()) < 0) {
+    std::fprintf(stderr, "can't write %s\n",
+                 qPrintable(parser.value(outputOption)));
+    return 1;
+  }
+  return 0;
+}
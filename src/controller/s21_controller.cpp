@@ -11,6 +11,36 @@ void s21::Controller::ParseObjFile(const std::string &fileName) {
   facade.LoadFile(fileName);
 }
 
+void s21::Controller::ParseObjFileInto(const std::string &fileName,
+                                       const BufferAllocator &allocator) {
+  facade.LoadFileInto(fileName, allocator);
+}
+
+void s21::Controller::ParseObjFileOutOfCore(const std::string &fileName,
+                                            const std::string &storeFile,
+                                            size_t ramBudget) {
+  facade.LoadOutOfCore(fileName, storeFile, ramBudget);
+}
+
+bool s21::Controller::ReparseObjFile() { return facade.ReparseFile(); }
+
+s21::ModelUpdate s21::Controller::UpdateModelBuffers(bool appended) {
+  return facade.UpdateBuffers(appended);
+}
+
+s21::PreviewCloud s21::Controller::SampleObjFile(
+    const std::string &fileName) const {
+  return facade.SamplePreview(fileName);
+}
+
+void s21::Controller::SetLoadProgress(LoadProgress progress) {
+  facade.SetLoadProgress(std::move(progress));
+}
+
+std::pair<size_t, size_t> s21::Controller::GetBuffersSize() const {
+  return facade.GetBuffersSize();
+}
+
 std::pair<const std::vector<GLfloat> &, const std::vector<GLuint> &>
 s21::Controller::GetBuffersData() const {
   return facade.GetBuffersData();
@@ -21,6 +51,37 @@ s21::ViewerData s21::Controller::InteractModel(TransformationStrategy strategy,
   return facade.InteractModel(data, strategy);
 }
 
+bool s21::Controller::IsPointCloud() const { return facade.IsPointCloud(); }
+
+void s21::Controller::SelectPoints(const ViewerData &view, int height,
+                                   size_t budget,
+                                   PointSelection &selection) const {
+  facade.SelectPoints(view, height, budget, selection);
+}
+
+bool s21::Controller::IsOutOfCore() const { return facade.IsOutOfCore(); }
+
+void s21::Controller::SelectChunks(
+    const ViewerData &view, int height,
+    std::vector<std::pair<GLfloat, size_t>> &visible) const {
+  facade.SelectChunks(view, height, visible);
+}
+
+const s21::ChunkStore *s21::Controller::GetChunkStore() const {
+  return facade.GetChunkStore();
+}
+
+s21::ChunkCache *s21::Controller::GetChunkCache() const {
+  return facade.GetChunkCache();
+}
+
 int s21::Controller::GetUnqueEdgesCount() const {
   return facade.GetUnqueEdgesCount();
 }
+
+s21::MemoryUsage s21::Controller::GetMemoryUsage(
+    MemorySubsystem subsystem) const {
+  return facade.GetMemoryUsage(subsystem);
+}
+
+std::size_t s21::Controller::GetPeakRss() const { return facade.GetPeakRss(); }
@@ -22,6 +22,51 @@ class Controller {
    **/
   void ParseObjFile(const std::string& fileName);
 
+  /**
+   * @brief Uploads an .obj file straight into caller-provided buffers.
+   * @param fileName Name of .obj file.
+   * @param allocator Callback providing memory for vertices and indices.
+   **/
+  void ParseObjFileInto(const std::string& fileName,
+                        const BufferAllocator& allocator);
+
+  /**
+   * @brief Opens an .obj file too large for memory from its chunk store,
+   * building the store on the first open.
+   * @param fileName Name of .obj file.
+   * @param storeFile Name of the chunk store of the file.
+   * @param ramBudget Largest number of bytes of chunks kept in memory.
+   **/
+  void ParseObjFileOutOfCore(const std::string& fileName,
+                             const std::string& storeFile, size_t ramBudget);
+
+  /**
+   * @brief Parses the loaded .obj file again after it changed on disk.
+   * @return true if only appended lines were parsed.
+   **/
+  bool ReparseObjFile();
+
+  /**
+   * @brief Takes the reparsed file into the model, keeping its transformations.
+   * @param appended Result of ReparseObjFile().
+   * @return Ranges of the model buffers that changed.
+   **/
+  ModelUpdate UpdateModelBuffers(bool appended);
+
+  /**
+   * @brief Samples vertices of an .obj file for a preview.
+   * @param fileName Name of .obj file.
+   * @return Sampled vertices, empty if the file can't be read.
+   **/
+  PreviewCloud SampleObjFile(const std::string& fileName) const;
+
+  /**
+   * @brief Sets the callback receiving the bounds of the parsed vertices
+   * while a file is uploaded.
+   * @param progress Progress callback, empty to disable reports.
+   **/
+  void SetLoadProgress(LoadProgress progress);
+
   /**
    * @brief Gets buffers data of loaded model.
    * @return Pair of vectors with vertices and indices.
@@ -29,6 +74,12 @@ class Controller {
   std::pair<const std::vector<GLfloat>&, const std::vector<GLuint>&>
   GetBuffersData() const;
 
+  /**
+   * @brief Gets sizes of loaded model buffers.
+   * @return Pair of vertex coordinates count and indices count.
+   **/
+  std::pair<size_t, size_t> GetBuffersSize() const;
+
   /**
    * @brief Main method of model interaction.
    * @param strategy Strategy of model interaction.
@@ -38,12 +89,69 @@ class Controller {
    **/
   ViewerData InteractModel(TransformationStrategy strategy, InputData data);
 
+  /**
+   * @brief Checks whether the loaded model is a point cloud without faces.
+   * @return true if the model has no faces.
+   **/
+  bool IsPointCloud() const;
+
+  /**
+   * @brief Chooses the points of a point cloud drawn in a frame.
+   * @param view Matrices of the frame.
+   * @param height Height of the viewport in pixels.
+   * @param budget Largest number of points to select.
+   * @param selection Receives the ranges of vertices to draw.
+   **/
+  void SelectPoints(const ViewerData& view, int height, size_t budget,
+                    PointSelection& selection) const;
+
+  /**
+   * @brief Checks whether the loaded model is drawn from a chunk store.
+   * @return true if the model was opened out of core.
+   **/
+  bool IsOutOfCore() const;
+
+  /**
+   * @brief Finds the chunks of an out-of-core model inside the view.
+   * @param view Matrices of the frame.
+   * @param height Height of the viewport in pixels.
+   * @param visible Receives the radii and the indices of the chunks, the
+   *largest on screen first.
+   **/
+  void SelectChunks(const ViewerData& view, int height,
+                    std::vector<std::pair<GLfloat, size_t>>& visible) const;
+
+  /**
+   * @brief Gets the chunks of an out-of-core model.
+   * @return Pointer to the store, nullptr for a model in memory.
+   **/
+  const ChunkStore* GetChunkStore() const;
+
+  /**
+   * @brief Gets the chunks of an out-of-core model kept in memory.
+   * @return Pointer to the cache, nullptr for a model in memory.
+   **/
+  ChunkCache* GetChunkCache() const;
+
   /**
    * @brief Gets number of unique edges.
    * @return Number of unique edges.
    **/
   int GetUnqueEdgesCount() const;
 
+  /**
+   * @brief Gets the memory held by a subsystem.
+   * @param subsystem Holder of the buffers.
+   * @return Current and peak bytes.
+   **/
+  MemoryUsage GetMemoryUsage(MemorySubsystem subsystem) const;
+
+  /**
+   * @brief Gets the peak resident memory of the process.
+   * @return Peak resident memory in bytes.
+   **/
+  std::size_t GetPeakRss() const;
+
  private:
   ModelFacade& facade;  ///< Reference to the facade through which interaction
                         ///< with the model occurs.
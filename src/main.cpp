@@ -1,14 +1,28 @@
 #include <QApplication>
+#include <cstdlib>
 #include "model/s21_model_facade.h"
 #include "controller/s21_controller.h"
+#include "model/s21_startup_timer.h"
+#include "model/s21_tracer.h"
 #include "view/s21_mainwindow.h"
 
 int main(int argc, char *argv[]){
+    s21::StartupTimer::Instance().Mark(s21::MainEntered);
+    if (const char* traceFile = std::getenv("S21_TRACE_FILE")) {
+        const char* countersFile = std::getenv("S21_TRACE_COUNTERS");
+        s21::Tracer::Instance().Start(traceFile,
+                                      countersFile ? countersFile : "");
+        s21::Tracer::Instance().SetThreadName("GUI");
+    }
     QApplication a(argc, argv);
     s21::ModelFacade model;
     s21::Controller controller(model);
     s21::OGLWidget openGlWidget(controller);
     s21::MainWindow w(openGlWidget);
     w.show();
-    return a.exec();
+    int result = a.exec();
+    if (s21::Tracer::Instance().IsEnabled()) {
+        s21::Tracer::Instance().Stop();
+    }
+    return result;
 }
@@ -0,0 +1,75 @@
+/**
+ * @file s21_allocation_tracker.cpp
+ * @brief Per-scope heap allocation counter implementation.
+ */
+
+#include "s21_allocation_tracker.h"
+
+#include <cstdlib>
+#include <new>
+
+namespace s21 {
+
+namespace {
+
+/**
+ * @brief Innermost scope of the thread. A plain pointer needs no
+ * initialization, so operator new can use it on any thread at any time.
+ */
+thread_local AllocationScope* currentScope = nullptr;
+
+}  // namespace
+
+AllocationScope::AllocationScope() : parent(currentScope), counts{0, 0} {
+  currentScope = this;
+}
+
+AllocationScope::~AllocationScope() { currentScope = parent; }
+
+AllocationCounts AllocationScope::GetCounts() const { return counts; }
+
+bool AllocationScope::IsTrackingEnabled() {
+#ifdef S21_TRACK_ALLOCATIONS
+  return true;
+#else
+  return false;
+#endif
+}
+
+void AllocationScope::Record(std::size_t bytes) {
+  for (AllocationScope* scope = currentScope; scope != nullptr;
+       scope = scope->parent) {
+    scope->counts.allocations++;
+    scope->counts.bytes += bytes;
+  }
+}
+
+}  // namespace s21
+
+#ifdef S21_TRACK_ALLOCATIONS
+
+// Replacements of the global allocation functions. The nothrow and array
+// forms of the standard library call these, aligned forms are not counted.
+void* operator new(std::size_t size) {
+  s21::AllocationScope::Record(size);
+  if (void* pointer = std::malloc(size != 0 ? size : 1)) {
+    return pointer;
+  }
+  throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) { return operator new(size); }
+
+void operator delete(void* pointer) noexcept { std::free(pointer); }
+
+void operator delete[](void* pointer) noexcept { std::free(pointer); }
+
+void operator delete(void* pointer, std::size_t) noexcept {
+  std::free(pointer);
+}
+
+void operator delete[](void* pointer, std::size_t) noexcept {
+  std::free(pointer);
+}
+
+#endif  // S21_TRACK_ALLOCATIONS
@@ -0,0 +1,60 @@
+/**
+ * @file s21_allocation_tracker.h
+ * @brief Per-scope heap allocation counter header file.
+ */
+
+#ifndef S21_ALLOCATION_TRACKER_H
+#define S21_ALLOCATION_TRACKER_H
+
+#include <cstddef>
+
+namespace s21 {
+
+/**
+ * @brief Number and size of heap allocations.
+ */
+struct AllocationCounts {
+  std::size_t allocations;  ///< Calls of operator new.
+  std::size_t bytes;        ///< Bytes requested by those calls.
+};
+
+/**
+ * @brief Counts the heap allocations made by the calling thread while the
+ * scope is alive, including the ones of nested scopes.
+ * Counting needs the replacements of operator new compiled in with
+ * S21_TRACK_ALLOCATIONS, otherwise every scope counts zero at no cost.
+ */
+class AllocationScope {
+ public:
+  AllocationScope();   ///< Starts counting on the calling thread.
+  ~AllocationScope();  ///< Stops counting.
+  AllocationScope(const AllocationScope& other) = delete;
+  AllocationScope& operator=(const AllocationScope& other) = delete;
+
+  /**
+   * @brief Gets the allocations made so far.
+   * @return Number and size of the allocations.
+   */
+  AllocationCounts GetCounts() const;
+
+  /**
+   * @brief Checks whether allocations are counted.
+   * @return true if the program was built with S21_TRACK_ALLOCATIONS.
+   */
+  static bool IsTrackingEnabled();
+
+  /**
+   * @brief Adds an allocation to every scope of the calling thread, called
+   * by operator new.
+   * @param bytes Size of the allocation.
+   */
+  static void Record(std::size_t bytes);
+
+ private:
+  AllocationScope* parent;  ///< Enclosing scope of the same thread.
+  AllocationCounts counts;  ///< Allocations made inside the scope.
+};
+
+}  // namespace s21
+
+#endif  // S21_ALLOCATION_TRACKER_H
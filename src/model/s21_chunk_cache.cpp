@@ -0,0 +1,150 @@
+/**
+ * @file s21_chunk_cache.cpp
+ * @brief Working set of out-of-core chunks in memory implementation.
+ */
+
+#include "s21_chunk_cache.h"
+
+namespace s21 {
+
+ChunkCache::ChunkCache(const ChunkStore& chunkStore, size_t ramBudget)
+    : store(chunkStore),
+      budget(ramBudget),
+      resident(new std::atomic<bool>[chunkStore.GetChunks().size()]),
+      requestStamps(chunkStore.GetChunks().size(), 0),
+      requestStamp(0),
+      servedStamp(0),
+      residentBytes(0),
+      residentCount(0),
+      stopping(false) {
+  for (size_t i = 0; i < requestStamps.size(); ++i) {
+    resident[i].store(false);
+  }
+  worker = std::thread([this] { Run(); });
+}
+
+ChunkCache::~ChunkCache() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  changed.notify_all();
+  worker.join();
+  for (size_t i = 0; i < requestStamps.size(); ++i) {
+    if (resident[i].load()) {
+      store.Advise(i, false);
+    }
+  }
+  MemoryStats::Instance().Set(ModelChunks, 0);
+}
+
+void ChunkCache::Request(const std::vector<size_t>& chunks) {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    ++requestStamp;
+    requested.assign(chunks.begin(), chunks.end());
+    for (size_t chunk : chunks) {
+      requestStamps[chunk] = requestStamp;
+    }
+  }
+  changed.notify_all();
+}
+
+bool ChunkCache::IsResident(size_t chunk) const {
+  return resident[chunk].load(std::memory_order_acquire);
+}
+
+void ChunkCache::SetReadyCallback(std::function<void()> callback) {
+  std::lock_guard<std::mutex> lock(mutex);
+  ready = std::move(callback);
+}
+
+void ChunkCache::WaitIdle() {
+  std::unique_lock<std::mutex> lock(mutex);
+  changed.wait(lock, [this] { return servedStamp == requestStamp; });
+}
+
+size_t ChunkCache::GetResidentBytes() const { return residentBytes.load(); }
+
+size_t ChunkCache::GetResidentCount() const { return residentCount.load(); }
+
+size_t ChunkCache::GetBudget() const { return budget; }
+
+void ChunkCache::Run() {
+  Tracer::Instance().SetThreadName("Chunk cache");
+  std::unique_lock<std::mutex> lock(mutex);
+  while (true) {
+    changed.wait(lock,
+                 [this] { return stopping || servedStamp != requestStamp; });
+    if (stopping) {
+      return;
+    }
+    std::uint64_t stamp = requestStamp;
+    working.assign(requested.begin(), requested.end());
+    for (size_t chunk : working) {
+      // A newer request may want other chunks first.
+      if (stopping || requestStamp != stamp) {
+        break;
+      }
+      size_t bytes = store.GetChunkBytes(chunk);
+      if (resident[chunk].load() || bytes > budget) {
+        continue;
+      }
+      bool fits = true;
+      while (fits && residentBytes.load() + bytes > budget) {
+        fits = EvictOldest();
+      }
+      if (!fits) {
+        // The budget is full of chunks the view needs more.
+        break;
+      }
+      lock.unlock();
+      PageIn(chunk);
+      lock.lock();
+      resident[chunk].store(true, std::memory_order_release);
+      residentBytes += bytes;
+      ++residentCount;
+      MemoryStats::Instance().Set(ModelChunks, residentBytes.load());
+      if (ready) {
+        ready();
+      }
+    }
+    if (requestStamp == stamp) {
+      servedStamp = stamp;
+      changed.notify_all();
+    }
+  }
+}
+
+bool ChunkCache::EvictOldest() {
+  size_t oldest = requestStamps.size();
+  for (size_t i = 0; i < requestStamps.size(); ++i) {
+    if (resident[i].load() && requestStamps[i] != requestStamp &&
+        (oldest == requestStamps.size() ||
+         requestStamps[i] < requestStamps[oldest])) {
+      oldest = i;
+    }
+  }
+  if (oldest == requestStamps.size()) {
+    return false;
+  }
+  resident[oldest].store(false, std::memory_order_release);
+  store.Advise(oldest, false);
+  residentBytes -= store.GetChunkBytes(oldest);
+  --residentCount;
+  MemoryStats::Instance().Set(ModelChunks, residentBytes.load());
+  return true;
+}
+
+void ChunkCache::PageIn(size_t chunk) const {
+  store.Advise(chunk, true);
+  const volatile char* data =
+      reinterpret_cast<const volatile char*>(store.GetChunkData(chunk));
+  size_t bytes = store.GetChunkBytes(chunk);
+  // Reading a byte of every page waits for the read ahead to finish.
+  for (size_t offset = 0; offset < bytes; offset += ChunkStore::kPageBytes) {
+    static_cast<void>(data[offset]);
+  }
+}
+
+}  // namespace s21
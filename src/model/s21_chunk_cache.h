@@ -0,0 +1,126 @@
+/**
+ * @file s21_chunk_cache.h
+ * @brief Working set of out-of-core chunks in memory header file.
+ */
+
+#ifndef S21_CHUNK_CACHE_H
+#define S21_CHUNK_CACHE_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "s21_chunk_store.h"
+
+namespace s21 {
+
+/**
+ * @brief Keeps the chunks of a ChunkStore the view needs in memory, within a
+ * budget. A worker thread reads requested chunks ahead and touches their
+ * pages, so drawing never waits for the disk, and drops the pages of the
+ * least recently requested chunks when the budget is full.
+ */
+class ChunkCache {
+ public:
+  /**
+   * @brief Starts the worker thread.
+   * @param chunkStore Open store, must outlive the cache.
+   * @param ramBudget Largest number of bytes of chunks kept in memory.
+   */
+  ChunkCache(const ChunkStore& chunkStore, size_t ramBudget);
+  ChunkCache(const ChunkCache& other) = delete;  ///< Disable copying.
+  ChunkCache& operator=(const ChunkCache& other) =
+      delete;     ///< Disable copy assignment.
+  ~ChunkCache();  ///< Stops the worker thread.
+
+  /**
+   * @brief Replaces the chunks the worker reads, the first ones first.
+   * Chunks left out of the request become the first to be dropped. Doesn't
+   * allocate once the request vector has grown.
+   * @param chunks Indices of the needed chunks.
+   */
+  void Request(const std::vector<size_t>& chunks);
+
+  /**
+   * @brief Checks whether a chunk is in memory. Can be called from any thread.
+   * @param chunk Index of the chunk.
+   * @return true if its data can be read without waiting for the disk.
+   */
+  bool IsResident(size_t chunk) const;
+
+  /**
+   * @brief Sets the callback called on the worker thread after a chunk was
+   * read, e.g. to draw it.
+   * @param callback Callback, may be empty.
+   */
+  void SetReadyCallback(std::function<void()> callback);
+
+  /**
+   * @brief Waits until the worker is done with the last request.
+   */
+  void WaitIdle();
+
+  /**
+   * @brief Gets the size of the chunks in memory.
+   * @return Bytes of the resident chunks.
+   */
+  size_t GetResidentBytes() const;
+
+  /**
+   * @brief Gets the number of chunks in memory.
+   * @return Number of resident chunks.
+   */
+  size_t GetResidentCount() const;
+
+  /**
+   * @brief Gets the budget of the cache.
+   * @return Largest number of bytes of chunks kept in memory.
+   */
+  size_t GetBudget() const;
+
+ private:
+  /**
+   * @brief Worker loop, reads the requested chunks until the cache stops.
+   */
+  void Run();
+
+  /**
+   * @brief Drops the least recently requested chunk that isn't requested now.
+   * Must be called with the mutex held.
+   * @return false if every resident chunk is requested.
+   */
+  bool EvictOldest();
+
+  /**
+   * @brief Reads a chunk into memory. Called without the mutex held.
+   * @param chunk Index of the chunk.
+   */
+  void PageIn(size_t chunk) const;
+
+  const ChunkStore& store;  ///< Store the chunks are read from.
+  size_t budget;            ///< Largest size of the resident chunks.
+  std::unique_ptr<std::atomic<bool>[]> resident;  ///< Whether every chunk is
+                                                  ///< in memory.
+  std::vector<std::uint64_t> requestStamps;  ///< Request that last asked for
+                                             ///< every chunk.
+  std::vector<size_t> requested;  ///< Chunks of the last request, in order.
+  std::vector<size_t> working;    ///< Copy of the request read by the worker.
+  std::uint64_t requestStamp;     ///< Number of the last request.
+  std::uint64_t servedStamp;      ///< Request the worker has finished.
+  std::atomic<size_t> residentBytes;  ///< Size of the resident chunks.
+  std::atomic<size_t> residentCount;  ///< Number of the resident chunks.
+  std::function<void()> ready;        ///< Called after a chunk was read.
+  mutable std::mutex mutex;           ///< Guards the request and the stamps.
+  std::condition_variable changed;    ///< Wakes the worker and the waiters.
+  bool stopping;                      ///< Whether the worker should stop.
+  std::thread worker;                 ///< Reads the requested chunks.
+};
+
+}  // namespace s21
+
+#endif  // S21_CHUNK_CACHE_H
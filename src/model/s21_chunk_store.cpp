@@ -0,0 +1,663 @@
+/**
+ * @file s21_chunk_store.cpp
+ * @brief Disk-backed spatial chunks of out-of-core models implementation.
+ */
+
+#include "s21_chunk_store.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <charconv>
+#include <filesystem>
+
+#include "s21_point_octree.h"
+
+namespace s21 {
+
+namespace {
+
+/**
+ * @brief First bytes of a store file, changed with the format.
+ */
+constexpr char kStoreMagic[8] = {'S', '2', '1', 'C', 'H', 'N', 'K', '1'};
+
+/**
+ * @brief Header of a store file, followed by the chunk table.
+ */
+struct StoreHeader {
+  char magic[8];                ///< kStoreMagic.
+  std::uint64_t sourceSize;     ///< Size of the .obj file.
+  std::int64_t sourceTime;      ///< Modification time of the .obj file.
+  std::uint64_t verticesCount;  ///< Vertices of the .obj file.
+  std::uint64_t edgesCount;     ///< Edges of the faces.
+  std::uint32_t primitive;      ///< ChunkPrimitive of all chunks.
+  std::uint32_t chunksCount;    ///< Number of entries of the chunk table.
+};
+
+/**
+ * @brief Primitives of one cell spilled to disk while the store is built.
+ */
+struct Segment {
+  size_t cell;           ///< Cell of the grid.
+  std::uint64_t offset;  ///< Offset in the segments file.
+  std::uint64_t count;   ///< Number of primitives.
+};
+
+/**
+ * @brief File mapped read-only, unmapped when destroyed.
+ */
+class MappedFile {
+ public:
+  /**
+   * @brief Maps a whole file.
+   * @param filename Name of the file.
+   */
+  explicit MappedFile(const std::string& filename)
+      : data(nullptr), size(0) {
+    int descriptor = open(filename.c_str(), O_RDONLY);
+    if (descriptor < 0) {
+      return;
+    }
+    struct stat status;
+    if (fstat(descriptor, &status) == 0 && status.st_size > 0) {
+      void* mapped = mmap(nullptr, static_cast<size_t>(status.st_size),
+                          PROT_READ, MAP_SHARED, descriptor, 0);
+      if (mapped != MAP_FAILED) {
+        data = static_cast<const char*>(mapped);
+        size = static_cast<size_t>(status.st_size);
+      }
+    }
+    // The mapping keeps the file open.
+    close(descriptor);
+  }
+  MappedFile(const MappedFile& other) = delete;
+  MappedFile& operator=(const MappedFile& other) = delete;
+  ~MappedFile() { Release(); }
+
+  /**
+   * @brief Hands the mapping over to the caller, who unmaps it.
+   */
+  void Detach() {
+    data = nullptr;
+    size = 0;
+  }
+
+  /**
+   * @brief Unmaps the file.
+   */
+  void Release() {
+    if (data != nullptr) {
+      munmap(const_cast<char*>(data), size);
+    }
+    Detach();
+  }
+
+  const char* data;  ///< Mapped bytes, nullptr if the file couldn't be mapped.
+  size_t size;       ///< Size of the file.
+};
+
+/**
+ * @brief Removes temporary files of a build, whether it succeeded or not.
+ */
+struct TemporaryFiles {
+  std::vector<std::string> names;  ///< Files to remove.
+
+  ~TemporaryFiles() {
+    std::error_code error;
+    for (const std::string& name : names) {
+      std::filesystem::remove(name, error);
+    }
+  }
+};
+
+/**
+ * @brief Calls a handler with every line of a file, reading it in blocks of
+ * ChunkStore::kBlockBytes. The buffer is null-terminated after the line.
+ * @param filename Name of the file.
+ * @param handler Receives the buffer and the start and the end of a line.
+ */
+template <typename Handler>
+void ForEachLine(const std::string& filename, Handler handler) {
+  std::ifstream file(filename, std::ios::binary | std::ios::ate);
+  if (!file.is_open()) {
+    throw std::logic_error("file doesn't exist");
+  }
+  // Small files aren't given a whole block.
+  size_t blockBytes = std::min(static_cast<size_t>(file.tellg()) + 1,
+                               ChunkStore::kBlockBytes);
+  file.seekg(0);
+  std::string buffer;
+  ScopedMemory bufferMemory(LoaderFile, blockBytes);
+  size_t kept = 0;
+  bool end = false;
+  while (!end) {
+    buffer.resize(kept + blockBytes + 1);
+    file.read(buffer.data() + kept, blockBytes);
+    size_t size = kept + static_cast<size_t>(file.gcount());
+    end = !file;
+    buffer[size] = '\0';
+    size_t lineStart = 0;
+    while (lineStart < size) {
+      size_t lineEnd = buffer.find('\n', lineStart);
+      if (lineEnd == std::string::npos || lineEnd >= size) {
+        if (!end) {
+          break;
+        }
+        lineEnd = size;
+      }
+      char saved = buffer[lineEnd];
+      buffer[lineEnd] = '\0';
+      handler(buffer, lineStart, lineEnd);
+      buffer[lineEnd] = saved;
+      lineStart = lineEnd + 1;
+    }
+    // A line longer than a block keeps growing the buffer.
+    kept = lineStart < size ? size - lineStart : 0;
+    buffer.erase(0, size - kept);
+  }
+}
+
+/**
+ * @brief Finds the end of the first token of a line, like ObjLoader.
+ * @param line Buffer holding the line.
+ * @param lineStart Start of the line.
+ * @param lineEnd End of the line.
+ * @return Size of the first token.
+ */
+size_t FirstTokenSize(const std::string& line, size_t lineStart,
+                      size_t lineEnd) {
+  return std::min(line.find(' ', lineStart), lineEnd) - lineStart;
+}
+
+/**
+ * @brief Parses the coordinates of a "v" line.
+ * @param line Buffer holding the line, null-terminated after it.
+ * @param lineStart Start of the line.
+ * @param lineEnd End of the line.
+ * @param vertex Receives three coordinates.
+ */
+void ParseVertex(const std::string& line, size_t lineStart, size_t lineEnd,
+                 GLfloat* vertex) {
+  const char* position = line.c_str() + lineStart + 1;
+  for (int i = 0; i < 3; ++i) {
+    char* end = nullptr;
+    vertex[i] = std::strtof(position, &end);
+    if (end == position || end > line.c_str() + lineEnd) {
+      throw std::invalid_argument("wrong data");
+    }
+    position = end;
+  }
+}
+
+/**
+ * @brief Calls a handler with every index token of an "f" line, tokenized
+ * like ObjLoader::ParseFace().
+ * @param line Buffer holding the line.
+ * @param lineStart Start of the line.
+ * @param lineEnd End of the line.
+ * @param handler Receives the start and the end of the vertex index.
+ */
+template <typename Handler>
+void ForEachFaceToken(const std::string& line, size_t lineStart,
+                      size_t lineEnd, Handler handler) {
+  for (size_t tokenStart = lineStart + 2; tokenStart < lineEnd;) {
+    size_t tokenEnd = std::min(line.find(' ', tokenStart), lineEnd);
+    size_t indexEnd = std::min(line.find('/', tokenStart), tokenEnd);
+    if (indexEnd == tokenEnd && tokenEnd > tokenStart &&
+        line[tokenEnd - 1] == '\r') {
+      --indexEnd;
+    }
+    bool skipped = tokenEnd == tokenStart ||
+                   (tokenEnd - tokenStart == 1 &&
+                    (line[tokenStart] == '\r' || line[tokenStart] == 'f'));
+    if (!skipped) {
+      handler(tokenStart, indexEnd);
+    }
+    tokenStart = tokenEnd + 1;
+  }
+}
+
+/**
+ * @brief Rounds an offset up to the alignment of chunk data.
+ * @param offset Offset in bytes.
+ * @return Offset of the next page.
+ */
+std::uint64_t AlignToPage(std::uint64_t offset) {
+  return (offset + ChunkStore::kPageBytes - 1) / ChunkStore::kPageBytes *
+         ChunkStore::kPageBytes;
+}
+
+}  // namespace
+
+ChunkStore::ChunkStore()
+    : mapping(nullptr),
+      mappingSize(0),
+      primitive(ChunkPrimitive::Lines),
+      verticesCount(0),
+      edgesCount(0),
+      built(false) {}
+
+ChunkStore::~ChunkStore() { Close(); }
+
+void ChunkStore::Open(const std::string& filename,
+                      const std::string& storeFile,
+                      const LoadProgress& progress, size_t chunkBytes) {
+  S21_TRACE_SCOPE("ChunkStore::Open");
+  Close();
+  std::error_code error;
+  std::uint64_t sourceSize = std::filesystem::file_size(filename, error);
+  if (error) {
+    throw std::logic_error("file doesn't exist");
+  }
+  std::int64_t sourceTime = static_cast<std::int64_t>(
+      std::filesystem::last_write_time(filename, error)
+          .time_since_epoch()
+          .count());
+  built = false;
+  if (Map(storeFile, sourceSize, sourceTime)) {
+    return;
+  }
+  Build(filename, storeFile, sourceSize, sourceTime, progress, chunkBytes);
+  built = true;
+  if (!Map(storeFile, sourceSize, sourceTime)) {
+    throw std::runtime_error("can't map the chunk store");
+  }
+}
+
+void ChunkStore::Close() {
+  if (mapping != nullptr) {
+    munmap(const_cast<char*>(mapping), mappingSize);
+  }
+  mapping = nullptr;
+  mappingSize = 0;
+  verticesCount = edgesCount = 0;
+  chunks.clear();
+}
+
+bool ChunkStore::IsOpen() const { return mapping != nullptr; }
+
+bool ChunkStore::WasBuilt() const { return built; }
+
+ChunkPrimitive ChunkStore::GetPrimitive() const { return primitive; }
+
+size_t ChunkStore::GetPrimitiveFloats() const {
+  return primitive == ChunkPrimitive::Lines ? 6 : 3;
+}
+
+const std::vector<ChunkInfo>& ChunkStore::GetChunks() const { return chunks; }
+
+const GLfloat* ChunkStore::GetChunkData(size_t index) const {
+  return reinterpret_cast<const GLfloat*>(mapping + chunks[index].offset);
+}
+
+size_t ChunkStore::GetChunkBytes(size_t index) const {
+  return chunks[index].primitives * GetPrimitiveFloats() * sizeof(GLfloat);
+}
+
+std::uint64_t ChunkStore::GetVerticesCount() const { return verticesCount; }
+
+std::uint64_t ChunkStore::GetEdgesCount() const { return edgesCount; }
+
+void ChunkStore::SelectChunks(
+    const glm::mat4& modelView, const glm::mat4& projection, int height,
+    std::vector<std::pair<GLfloat, size_t>>& visible) const {
+  visible.clear();
+  for (size_t i = 0; i < chunks.size(); ++i) {
+    const BoundingBox& box = chunks[i].box;
+    Vertex center = box.GetCenter();
+    glm::vec3 halfSize((box.maximum.X - box.minimum.X) / 2.0f,
+                       (box.maximum.Y - box.minimum.Y) / 2.0f,
+                       (box.maximum.Z - box.minimum.Z) / 2.0f);
+    GLfloat radius =
+        ScreenRadius(glm::vec3(center.X, center.Y, center.Z),
+                     glm::length(halfSize), modelView, projection, height);
+    if (radius >= 0.0f) {
+      visible.emplace_back(radius, i);
+    }
+  }
+  std::sort(visible.begin(), visible.end(),
+            [](const std::pair<GLfloat, size_t>& a,
+               const std::pair<GLfloat, size_t>& b) {
+              return a.first > b.first;
+            });
+}
+
+void ChunkStore::Advise(size_t index, bool needed) const {
+  static const std::uintptr_t pageSize =
+      static_cast<std::uintptr_t>(sysconf(_SC_PAGESIZE));
+  std::uintptr_t begin =
+      reinterpret_cast<std::uintptr_t>(mapping + chunks[index].offset);
+  std::uintptr_t end = begin + GetChunkBytes(index);
+  // Chunks are aligned to kPageBytes, larger pages may hold two chunks.
+  begin &= ~(pageSize - 1);
+  madvise(reinterpret_cast<void*>(begin), end - begin,
+          needed ? MADV_WILLNEED : MADV_DONTNEED);
+}
+
+bool ChunkStore::Map(const std::string& storeFile, std::uint64_t sourceSize,
+                     std::int64_t sourceTime) {
+  MappedFile file(storeFile);
+  if (file.data == nullptr || file.size < sizeof(StoreHeader)) {
+    return false;
+  }
+  StoreHeader header;
+  std::memcpy(&header, file.data, sizeof(header));
+  size_t tableEnd =
+      sizeof(StoreHeader) + size_t(header.chunksCount) * sizeof(ChunkInfo);
+  if (std::memcmp(header.magic, kStoreMagic, sizeof(kStoreMagic)) != 0 ||
+      header.sourceSize != sourceSize || header.sourceTime != sourceTime ||
+      header.primitive > static_cast<std::uint32_t>(ChunkPrimitive::Points) ||
+      tableEnd > file.size) {
+    return false;
+  }
+  primitive = static_cast<ChunkPrimitive>(header.primitive);
+  chunks.resize(header.chunksCount);
+  std::memcpy(chunks.data(), file.data + sizeof(StoreHeader),
+              chunks.size() * sizeof(ChunkInfo));
+  for (const ChunkInfo& chunk : chunks) {
+    // A store cut short by a full disk is built again.
+    if (chunk.offset + chunk.primitives * GetPrimitiveFloats() *
+                           sizeof(GLfloat) >
+        file.size) {
+      chunks.clear();
+      return false;
+    }
+  }
+  verticesCount = header.verticesCount;
+  edgesCount = header.edgesCount;
+  mapping = file.data;
+  mappingSize = file.size;
+  file.Detach();
+  return true;
+}
+
+void ChunkStore::Build(const std::string& filename,
+                       const std::string& storeFile, std::uint64_t sourceSize,
+                       std::int64_t sourceTime, const LoadProgress& progress,
+                       size_t chunkBytes) {
+  S21_TRACE_SCOPE("ChunkStore::Build");
+  TemporaryFiles temporary{{storeFile + ".vertices", storeFile + ".segments",
+                            storeFile + ".tmp"}};
+  const std::string& verticesFile = temporary.names[0];
+  const std::string& segmentsFile = temporary.names[1];
+  const std::string& outputFile = temporary.names[2];
+
+  // Vertices are spilled to disk, faces refer to them by index.
+  BoundingBox sourceBox;
+  std::uint64_t vertices = 0;
+  std::uint64_t edges = 0;
+  {
+    S21_TRACE_SCOPE("Spill vertices");
+    std::ofstream spill(verticesFile, std::ios::binary | std::ios::trunc);
+    std::vector<GLfloat> pending;
+    pending.reserve(ObjLoader::kProgressVertices * 3);
+    BoundingBox parsed;
+    auto flush = [&] {
+      parsed.Extend(pending.data(), pending.size());
+      spill.write(reinterpret_cast<const char*>(pending.data()),
+                  pending.size() * sizeof(GLfloat));
+      pending.clear();
+      if (progress) {
+        progress(parsed);
+      }
+    };
+    ForEachLine(filename, [&](const std::string& line, size_t lineStart,
+                              size_t lineEnd) {
+      size_t tokenSize = FirstTokenSize(line, lineStart, lineEnd);
+      if (tokenSize == 1 && line[lineStart] == 'v') {
+        GLfloat vertex[3];
+        ParseVertex(line, lineStart, lineEnd, vertex);
+        pending.insert(pending.end(), vertex, vertex + 3);
+        ++vertices;
+        if (pending.size() == pending.capacity()) {
+          flush();
+        }
+      } else if (tokenSize == 1 && line[lineStart] == 'f') {
+        // Every index of a face starts one of its edges.
+        ForEachFaceToken(line, lineStart, lineEnd,
+                         [&](size_t, size_t) { ++edges; });
+      }
+    });
+    flush();
+    sourceBox = parsed;
+    if (!spill) {
+      throw std::runtime_error("can't write the chunk store");
+    }
+  }
+  // Vertices without faces are a point cloud, faces need vertices.
+  if (vertices == 0 && edges == 0) {
+    throw std::out_of_range("empty file");
+  } else if (vertices == 0) {
+    throw std::invalid_argument("wrong data");
+  }
+
+  ChunkPrimitive primitive =
+      edges > 0 ? ChunkPrimitive::Lines : ChunkPrimitive::Points;
+  size_t primitiveFloats = primitive == ChunkPrimitive::Lines ? 6 : 3;
+  size_t primitiveBytes = primitiveFloats * sizeof(GLfloat);
+  std::uint64_t totalPrimitives =
+      primitive == ChunkPrimitive::Lines ? edges : vertices;
+  std::uint64_t cellsWanted =
+      totalPrimitives * primitiveBytes / std::max<size_t>(chunkBytes, 1) + 1;
+  size_t side = 1;
+  while (side < kMaxGridSide && side * side * side < cellsWanted) {
+    ++side;
+  }
+
+  Vertex center = sourceBox.GetCenter();
+  GLfloat scale = sourceBox.GetScaleFactor();
+  Vertex low{(sourceBox.minimum.X - center.X) * scale,
+             (sourceBox.minimum.Y - center.Y) * scale,
+             (sourceBox.minimum.Z - center.Z) * scale};
+  Vertex extent{(sourceBox.maximum.X - sourceBox.minimum.X) * scale,
+                (sourceBox.maximum.Y - sourceBox.minimum.Y) * scale,
+                (sourceBox.maximum.Z - sourceBox.minimum.Z) * scale};
+  auto axisCell = [side](GLfloat value, GLfloat start, GLfloat size) {
+    if (size <= 0.0f) {
+      return size_t(0);
+    }
+    GLfloat cell = (value - start) / size * static_cast<GLfloat>(side);
+    return std::min(static_cast<size_t>(std::max(cell, 0.0f)), side - 1);
+  };
+  auto cellOf = [&](const GLfloat* point) {
+    return (axisCell(point[2], low.Z, extent.Z) * side +
+            axisCell(point[1], low.Y, extent.Y)) *
+               side +
+           axisCell(point[0], low.X, extent.X);
+  };
+
+  // Primitives are binned by cell, full cell buffers are spilled as segments.
+  std::vector<Segment> segments;
+  {
+    S21_TRACE_SCOPE("Bin primitives");
+    MappedFile spilled(verticesFile);
+    if (spilled.data == nullptr) {
+      throw std::runtime_error("can't map the chunk store");
+    }
+    const GLfloat* source = reinterpret_cast<const GLfloat*>(spilled.data);
+    std::ofstream spill(segmentsFile, std::ios::binary | std::ios::trunc);
+    std::vector<std::vector<GLfloat>> cells(side * side * side);
+    size_t cellFloats = kCellBufferBytes / sizeof(GLfloat) / primitiveFloats *
+                        primitiveFloats;
+    ScopedMemory cellsMemory(LoaderFile, cells.size() * kCellBufferBytes);
+    std::uint64_t spilledBytes = 0;
+    auto flushCell = [&](size_t cell) {
+      std::vector<GLfloat>& buffer = cells[cell];
+      if (buffer.empty()) {
+        return;
+      }
+      segments.push_back({cell, spilledBytes, buffer.size() / primitiveFloats});
+      spill.write(reinterpret_cast<const char*>(buffer.data()),
+                  buffer.size() * sizeof(GLfloat));
+      spilledBytes += buffer.size() * sizeof(GLfloat);
+      buffer.clear();
+    };
+    auto normalize = [&](std::uint64_t index, GLfloat* output) {
+      const GLfloat* vertex = source + index * 3;
+      output[0] = (vertex[0] - center.X) * scale;
+      output[1] = (vertex[1] - center.Y) * scale;
+      output[2] = (vertex[2] - center.Z) * scale;
+    };
+    auto addPrimitive = [&](const GLfloat* primitiveData, const GLfloat* key) {
+      size_t cell = cellOf(key);
+      std::vector<GLfloat>& buffer = cells[cell];
+      if (buffer.capacity() < cellFloats) {
+        buffer.reserve(cellFloats);
+      }
+      buffer.insert(buffer.end(), primitiveData,
+                    primitiveData + primitiveFloats);
+      if (buffer.size() + primitiveFloats > cellFloats) {
+        flushCell(cell);
+      }
+    };
+    if (primitive == ChunkPrimitive::Points) {
+      for (std::uint64_t i = 0; i < vertices; ++i) {
+        GLfloat point[3];
+        normalize(i, point);
+        addPrimitive(point, point);
+      }
+    } else {
+      std::uint64_t declared = 0;
+      std::vector<std::uint64_t> face;
+      ForEachLine(filename, [&](const std::string& line, size_t lineStart,
+                                size_t lineEnd) {
+        size_t tokenSize = FirstTokenSize(line, lineStart, lineEnd);
+        if (tokenSize == 1 && line[lineStart] == 'v') {
+          ++declared;
+          return;
+        } else if (tokenSize != 1 || line[lineStart] != 'f') {
+          return;
+        }
+        face.clear();
+        ForEachFaceToken(
+            line, lineStart, lineEnd, [&](size_t indexStart, size_t indexEnd) {
+              std::uint64_t index = 0;
+              const char* first = line.data() + indexStart;
+              const char* last = line.data() + indexEnd;
+              std::from_chars_result parsed =
+                  std::from_chars(first, last, index);
+              // Faces may only reference vertices declared above them.
+              if (parsed.ec != std::errc() || parsed.ptr != last ||
+                  index == 0 || index > declared) {
+                throw std::invalid_argument("wrong data");
+              }
+              face.push_back(index - 1);
+            });
+        if (face.empty()) {
+          throw std::invalid_argument("wrong data");
+        }
+        for (size_t i = 0; i < face.size(); ++i) {
+          GLfloat edge[6];
+          normalize(face[i], edge);
+          normalize(face[(i + 1) % face.size()], edge + 3);
+          GLfloat middle[3] = {(edge[0] + edge[3]) / 2.0f,
+                               (edge[1] + edge[4]) / 2.0f,
+                               (edge[2] + edge[5]) / 2.0f};
+          addPrimitive(edge, middle);
+        }
+      });
+    }
+    for (size_t cell = 0; cell < cells.size(); ++cell) {
+      flushCell(cell);
+    }
+    if (!spill) {
+      throw std::runtime_error("can't write the chunk store");
+    }
+  }
+
+  // Cells become chunks, dense cells are split into several chunks.
+  S21_TRACE_SCOPE("Write chunks");
+  std::stable_sort(
+      segments.begin(), segments.end(),
+      [](const Segment& a, const Segment& b) { return a.cell < b.cell; });
+  std::uint64_t maxPrimitives =
+      std::max<std::uint64_t>(chunkBytes / primitiveBytes, 1);
+  std::vector<ChunkInfo> table;
+  for (size_t first = 0; first < segments.size();) {
+    size_t last = first;
+    std::uint64_t cellPrimitives = 0;
+    while (last < segments.size() &&
+           segments[last].cell == segments[first].cell) {
+      cellPrimitives += segments[last++].count;
+    }
+    std::uint64_t pieces = (cellPrimitives + maxPrimitives - 1) / maxPrimitives;
+    std::uint64_t piecePrimitives = (cellPrimitives + pieces - 1) / pieces;
+    for (std::uint64_t written = 0; written < cellPrimitives;
+         written += piecePrimitives) {
+      table.push_back({BoundingBox{}, 0,
+                       std::min(piecePrimitives, cellPrimitives - written)});
+    }
+    first = last;
+  }
+  std::uint64_t offset =
+      AlignToPage(sizeof(StoreHeader) + table.size() * sizeof(ChunkInfo));
+  for (ChunkInfo& chunk : table) {
+    chunk.offset = offset;
+    offset = AlignToPage(offset + chunk.primitives * primitiveBytes);
+  }
+
+  MappedFile spilled(segmentsFile);
+  if (spilled.data == nullptr) {
+    throw std::runtime_error("can't map the chunk store");
+  }
+  std::ofstream output(outputFile, std::ios::binary | std::ios::trunc);
+  static const char padding[kPageBytes] = {};
+  std::uint64_t position = 0;
+  auto writeAt = [&](std::uint64_t target, const char* data, size_t size) {
+    while (position < target) {
+      size_t gap = static_cast<size_t>(
+          std::min<std::uint64_t>(target - position, kPageBytes));
+      output.write(padding, gap);
+      position += gap;
+    }
+    output.write(data, size);
+    position += size;
+  };
+  // Header and table are written last, once the boxes are known.
+  writeAt(table.empty() ? 0 : table.front().offset, nullptr, 0);
+  size_t segment = 0;
+  std::uint64_t segmentUsed = 0;
+  for (ChunkInfo& chunk : table) {
+    writeAt(chunk.offset, nullptr, 0);
+    for (std::uint64_t left = chunk.primitives; left > 0;) {
+      if (segmentUsed == segments[segment].count) {
+        ++segment;
+        segmentUsed = 0;
+      }
+      std::uint64_t taken =
+          std::min(left, segments[segment].count - segmentUsed);
+      const char* data = spilled.data + segments[segment].offset +
+                         segmentUsed * primitiveBytes;
+      chunk.box.Extend(reinterpret_cast<const GLfloat*>(data),
+                       taken * primitiveFloats);
+      writeAt(position, data, taken * primitiveBytes);
+      segmentUsed += taken;
+      left -= taken;
+    }
+  }
+  StoreHeader header{};
+  std::memcpy(header.magic, kStoreMagic, sizeof(kStoreMagic));
+  header.sourceSize = sourceSize;
+  header.sourceTime = sourceTime;
+  header.verticesCount = vertices;
+  header.edgesCount = edges;
+  header.primitive = static_cast<std::uint32_t>(primitive);
+  header.chunksCount = static_cast<std::uint32_t>(table.size());
+  output.seekp(0);
+  output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  output.write(reinterpret_cast<const char*>(table.data()),
+               table.size() * sizeof(ChunkInfo));
+  output.close();
+  spilled.Release();
+  if (!output) {
+    throw std::runtime_error("can't write the chunk store");
+  }
+  // A store interrupted while it is written is never mistaken for a whole
+  // one.
+  std::filesystem::rename(outputFile, storeFile);
+}
+
+}  // namespace s21
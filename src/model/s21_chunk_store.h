@@ -0,0 +1,194 @@
+/**
+ * @file s21_chunk_store.h
+ * @brief Disk-backed spatial chunks of out-of-core models header file.
+ */
+
+#ifndef S21_CHUNK_STORE_H
+#define S21_CHUNK_STORE_H
+
+#include <GL/gl.h>
+
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "s21_obj_loader.h"
+
+namespace s21 {
+
+/**
+ * @brief Primitives the chunks of a store are drawn as.
+ */
+enum class ChunkPrimitive : std::uint32_t {
+  Lines,  ///< Pairs of vertices, one pair per edge of a face.
+  Points  ///< Single vertices of a model without faces.
+};
+
+/**
+ * @brief Location and bounds of a chunk in the store file.
+ */
+struct ChunkInfo {
+  BoundingBox box;           ///< Bounds of the normalized vertices.
+  std::uint64_t offset;      ///< Offset of the data from the file start.
+  std::uint64_t primitives;  ///< Number of lines or points.
+};
+
+/**
+ * @brief Model too large for memory, split into chunks by a uniform grid and
+ * kept in a file next to the .obj file's other caches.
+ * The store is built once by streaming the .obj file, vertices are
+ * normalized and every edge is written as its two vertices into the chunk of
+ * its midpoint, so a chunk is drawn with glDrawArrays() alone. Later opens of
+ * the unchanged file map the store right away. The file is mapped read-only,
+ * chunks are paged in and out by the kernel, see ChunkCache.
+ */
+class ChunkStore {
+ public:
+  static constexpr size_t kMaxGridSide = 16;  ///< Cells along an axis, the
+                                              ///< grid has at most 4096.
+  static constexpr size_t kChunkBytes =
+      16 << 20;  ///< Largest chunk, denser cells are split.
+  static constexpr size_t kBlockBytes =
+      64 << 20;  ///< Size of the blocks the .obj file is read in.
+  static constexpr size_t kCellBufferBytes =
+      64 << 10;  ///< Primitives of a cell buffered before they are spilled.
+  static constexpr size_t kPageBytes = 4096;  ///< Alignment of chunk data.
+
+  ChunkStore();                                      ///< Constructor.
+  ChunkStore(const ChunkStore& other) = delete;      ///< Disable copying.
+  ChunkStore& operator=(const ChunkStore& other) =
+      delete;      ///< Disable copy assignment.
+  ~ChunkStore();  ///< Unmaps the store.
+
+  /**
+   * @brief Opens the store of an .obj file, building it first if it is
+   * missing or the file changed since it was built.
+   * @param filename Name of the .obj file.
+   * @param storeFile Name of the store file, its directory must exist.
+   * @param progress Receives the bounds of the vertices read while the store
+   * is built, may be empty.
+   * @param chunkBytes Largest chunk of a newly built store.
+   */
+  void Open(const std::string& filename, const std::string& storeFile,
+            const LoadProgress& progress = nullptr,
+            size_t chunkBytes = kChunkBytes);
+
+  /**
+   * @brief Unmaps the store.
+   */
+  void Close();
+
+  /**
+   * @brief Checks whether a store is mapped.
+   * @return true after a successful Open().
+   */
+  bool IsOpen() const;
+
+  /**
+   * @brief Checks whether the last Open() had to build the store.
+   * @return true if the .obj file was parsed.
+   */
+  bool WasBuilt() const;
+
+  /**
+   * @brief Gets the primitive of all chunks.
+   * @return Lines for a model with faces, points otherwise.
+   */
+  ChunkPrimitive GetPrimitive() const;
+
+  /**
+   * @brief Gets the number of coordinates of one primitive.
+   * @return 6 for lines, 3 for points.
+   */
+  size_t GetPrimitiveFloats() const;
+
+  /**
+   * @brief Gets the chunks of the store.
+   * @return Constant reference to the chunk table.
+   */
+  const std::vector<ChunkInfo>& GetChunks() const;
+
+  /**
+   * @brief Gets the mapped data of a chunk, which may not be in memory yet.
+   * @param index Index of the chunk.
+   * @return Normalized coordinates of the chunk's primitives.
+   */
+  const GLfloat* GetChunkData(size_t index) const;
+
+  /**
+   * @brief Gets the size of a chunk's data.
+   * @param index Index of the chunk.
+   * @return Size in bytes.
+   */
+  size_t GetChunkBytes(size_t index) const;
+
+  /**
+   * @brief Gets the number of vertices of the .obj file.
+   * @return Number of vertices.
+   */
+  std::uint64_t GetVerticesCount() const;
+
+  /**
+   * @brief Gets the number of edges of the faces, an edge shared by two
+   * faces is counted twice.
+   * @return Number of edges.
+   */
+  std::uint64_t GetEdgesCount() const;
+
+  /**
+   * @brief Finds the chunks inside the view.
+   * @param modelView Model and view matrices multiplied together.
+   * @param projection Projection matrix.
+   * @param height Height of the viewport in pixels.
+   * @param visible Receives the radii of the chunks in pixels and their
+   * indices, the largest on screen first. Kept by the caller between frames.
+   */
+  void SelectChunks(const glm::mat4& modelView, const glm::mat4& projection,
+                    int height,
+                    std::vector<std::pair<GLfloat, size_t>>& visible) const;
+
+  /**
+   * @brief Tells the kernel whether a chunk is going to be read.
+   * @param index Index of the chunk.
+   * @param needed true to start reading it ahead, false to drop its pages.
+   */
+  void Advise(size_t index, bool needed) const;
+
+ private:
+  /**
+   * @brief Maps the store file if it was built from the current .obj file.
+   * @param storeFile Name of the store file.
+   * @param sourceSize Size of the .obj file.
+   * @param sourceTime Modification time of the .obj file.
+   * @return true if the store was mapped.
+   */
+  bool Map(const std::string& storeFile, std::uint64_t sourceSize,
+           std::int64_t sourceTime);
+
+  /**
+   * @brief Builds the store file from the .obj file.
+   * @param filename Name of the .obj file.
+   * @param storeFile Name of the store file.
+   * @param sourceSize Size of the .obj file.
+   * @param sourceTime Modification time of the .obj file.
+   * @param progress Receiver of the bounds of the read vertices.
+   * @param chunkBytes Largest chunk.
+   */
+  static void Build(const std::string& filename, const std::string& storeFile,
+                    std::uint64_t sourceSize, std::int64_t sourceTime,
+                    const LoadProgress& progress, size_t chunkBytes);
+
+  const char* mapping;            ///< Mapped store file, nullptr if closed.
+  size_t mappingSize;             ///< Size of the mapped file.
+  ChunkPrimitive primitive;       ///< Primitive of all chunks.
+  std::uint64_t verticesCount;    ///< Vertices of the .obj file.
+  std::uint64_t edgesCount;       ///< Edges of the faces.
+  std::vector<ChunkInfo> chunks;  ///< Chunk table.
+  bool built;                     ///< Whether the last Open() built the store.
+};
+
+}  // namespace s21
+
+#endif  // S21_CHUNK_STORE_H
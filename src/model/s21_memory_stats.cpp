@@ -0,0 +1,115 @@
+/**
+ * @file s21_memory_stats.cpp
+ * @brief Per-subsystem memory accounting implementation.
+ */
+
+#include "s21_memory_stats.h"
+
+#include <sys/resource.h>
+
+#include <fstream>
+#include <string>
+
+namespace s21 {
+
+MemoryStats::MemoryStats() {
+  for (std::size_t i = 0; i < MemorySubsystemsCount; ++i) {
+    current[i].store(0);
+    peak[i].store(0);
+  }
+}
+
+MemoryStats& MemoryStats::Instance() {
+  static MemoryStats memoryStatsInstance;
+  return memoryStatsInstance;
+}
+
+void MemoryStats::Set(MemorySubsystem subsystem, std::size_t bytes) {
+  current[subsystem].store(bytes, std::memory_order_relaxed);
+  UpdatePeak(subsystem, bytes);
+}
+
+void MemoryStats::Add(MemorySubsystem subsystem, std::size_t bytes) {
+  UpdatePeak(subsystem, current[subsystem].fetch_add(
+                            bytes, std::memory_order_relaxed) +
+                            bytes);
+}
+
+void MemoryStats::Remove(MemorySubsystem subsystem, std::size_t bytes) {
+  current[subsystem].fetch_sub(bytes, std::memory_order_relaxed);
+}
+
+MemoryUsage MemoryStats::Get(MemorySubsystem subsystem) const {
+  return {current[subsystem].load(std::memory_order_relaxed),
+          peak[subsystem].load(std::memory_order_relaxed)};
+}
+
+void MemoryStats::ResetPeaks() {
+  for (std::size_t i = 0; i < MemorySubsystemsCount; ++i) {
+    peak[i].store(current[i].load(std::memory_order_relaxed),
+                  std::memory_order_relaxed);
+  }
+}
+
+const char* MemoryStats::GetName(MemorySubsystem subsystem) {
+  switch (subsystem) {
+    case LoaderFile:
+      return "loader file";
+    case LoaderVertices:
+      return "loader vertices";
+    case LoaderFaces:
+      return "loader faces";
+    case LoaderEdges:
+      return "loader edges";
+    case ModelVertices:
+      return "model vertices";
+    case ModelIndices:
+      return "model indices";
+    case ModelChunks:
+      return "model chunks";
+    case GpuBuffers:
+      return "GPU buffers";
+    case CaptureFrames:
+      return "capture frames";
+    default:
+      return "unknown";
+  }
+}
+
+std::size_t MemoryStats::GetPeakRss() {
+  std::ifstream status("/proc/self/status");
+  std::string line;
+  while (std::getline(status, line)) {
+    if (line.compare(0, 6, "VmHWM:") == 0) {
+      return std::stoull(line.substr(6)) * 1024;
+    }
+  }
+  rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0) {
+    return 0;
+  }
+#ifdef __APPLE__
+  return usage.ru_maxrss;
+#else
+  return usage.ru_maxrss * std::size_t(1024);
+#endif
+}
+
+void MemoryStats::UpdatePeak(MemorySubsystem subsystem, std::size_t bytes) {
+  std::size_t previous = peak[subsystem].load(std::memory_order_relaxed);
+  while (previous < bytes &&
+         !peak[subsystem].compare_exchange_weak(previous, bytes,
+                                                std::memory_order_relaxed)) {
+  }
+}
+
+ScopedMemory::ScopedMemory(MemorySubsystem subsystem, std::size_t bytes)
+    : scopeSubsystem(subsystem), scopeBytes(bytes) {
+  MemoryStats::Instance().Add(scopeSubsystem, scopeBytes);
+}
+
+ScopedMemory::~ScopedMemory() {
+  MemoryStats::Instance().Remove(scopeSubsystem, scopeBytes);
+}
+
+}  // namespace s21
@@ -0,0 +1,144 @@
+/**
+ * @file s21_memory_stats.h
+ * @brief Per-subsystem memory accounting header file.
+ */
+
+#ifndef S21_MEMORY_STATS_H
+#define S21_MEMORY_STATS_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+namespace s21 {
+
+/**
+ * @brief Holders of large buffers, accounted separately.
+ */
+enum MemorySubsystem {
+  LoaderFile,      ///< Content of the .obj file while it is parsed.
+  LoaderVertices,  ///< Vertex coordinates held by the loader.
+  LoaderFaces,     ///< Line indices held by the loader.
+  LoaderEdges,     ///< Sorted edges while unique edges are counted.
+  ModelVertices,   ///< Normalized copy of the vertices held by the model.
+  ModelIndices,    ///< Copy of the indices held by the model.
+  ModelChunks,     ///< Chunks of an out-of-core model paged into memory.
+  GpuBuffers,      ///< Vertex and element buffers on the GPU.
+  CaptureFrames,   ///< Readback images of screenshots and screencasts.
+  MemorySubsystemsCount  ///< Number of subsystems.
+};
+
+/**
+ * @brief Current and highest number of bytes held by a subsystem.
+ */
+struct MemoryUsage {
+  std::size_t current;  ///< Bytes held now.
+  std::size_t peak;     ///< Most bytes held since the last ResetPeaks().
+};
+
+/**
+ * @brief Byte counters of the subsystems, updated by the owners of the
+ * buffers whenever they grow or shrink. Counters can be updated and read
+ * from any thread.
+ */
+class MemoryStats {
+ public:
+  MemoryStats(const MemoryStats& other) = delete;  ///< Disable copying.
+  MemoryStats(MemoryStats&& other) = delete;       ///< Disable moving.
+  MemoryStats& operator=(const MemoryStats& other) =
+      delete;  ///< Disable copy assignment.
+  MemoryStats& operator=(MemoryStats&& other) =
+      delete;                ///< Disable move assignment.
+  ~MemoryStats() = default;  ///< Default destructor.
+
+  /**
+   * @brief Gets the instance of the MemoryStats class (singleton).
+   * @return Reference to the MemoryStats instance.
+   */
+  static MemoryStats& Instance();
+
+  /**
+   * @brief Sets the bytes held by a subsystem.
+   * @param subsystem Holder of the buffers.
+   * @param bytes Size of its buffers.
+   */
+  void Set(MemorySubsystem subsystem, std::size_t bytes);
+
+  /**
+   * @brief Adds bytes to a subsystem, for holders of several buffers.
+   * @param subsystem Holder of the buffers.
+   * @param bytes Size of the allocated buffer.
+   */
+  void Add(MemorySubsystem subsystem, std::size_t bytes);
+
+  /**
+   * @brief Removes bytes added by Add().
+   * @param subsystem Holder of the buffers.
+   * @param bytes Size of the freed buffer.
+   */
+  void Remove(MemorySubsystem subsystem, std::size_t bytes);
+
+  /**
+   * @brief Gets the bytes held by a subsystem.
+   * @param subsystem Holder of the buffers.
+   * @return Current and peak bytes.
+   */
+  MemoryUsage Get(MemorySubsystem subsystem) const;
+
+  /**
+   * @brief Sets the peaks of all subsystems to their current bytes.
+   */
+  void ResetPeaks();
+
+  /**
+   * @brief Gets the name of a subsystem for the UI and reports.
+   * @param subsystem Holder of the buffers.
+   * @return Name of the subsystem.
+   */
+  static const char* GetName(MemorySubsystem subsystem);
+
+  /**
+   * @brief Gets the peak resident memory of the process.
+   * @return Peak resident memory in bytes, 0 if it can't be read.
+   */
+  static std::size_t GetPeakRss();
+
+ private:
+  MemoryStats();  ///< Constructor of the MemoryStats class.
+
+  /**
+   * @brief Raises the peak of a subsystem to a new value.
+   * @param subsystem Holder of the buffers.
+   * @param bytes Current bytes of the subsystem.
+   */
+  void UpdatePeak(MemorySubsystem subsystem, std::size_t bytes);
+
+  std::array<std::atomic<std::size_t>, MemorySubsystemsCount>
+      current;  ///< Bytes held by every subsystem.
+  std::array<std::atomic<std::size_t>, MemorySubsystemsCount>
+      peak;  ///< Peak bytes of every subsystem.
+};
+
+/**
+ * @brief Accounts a temporary buffer for the lifetime of the scope.
+ */
+class ScopedMemory {
+ public:
+  /**
+   * @brief Adds the bytes to the subsystem.
+   * @param subsystem Holder of the buffer.
+   * @param bytes Size of the buffer.
+   */
+  ScopedMemory(MemorySubsystem subsystem, std::size_t bytes);
+  ScopedMemory(const ScopedMemory& other) = delete;
+  ScopedMemory& operator=(const ScopedMemory& other) = delete;
+  ~ScopedMemory();  ///< Removes the bytes from the subsystem.
+
+ private:
+  MemorySubsystem scopeSubsystem;  ///< Holder of the buffer.
+  std::size_t scopeBytes;          ///< Size of the buffer.
+};
+
+}  // namespace s21
+
+#endif  // S21_MEMORY_STATS_H
@@ -7,7 +7,59 @@
 
 namespace s21 {
 
-Model::Model() {
+namespace {
+
+/**
+ * @brief Unchanged runs shorter than this number of elements are uploaded
+ * together with the changes around them, a glBufferSubData call costs more
+ * than a few kilobytes of copying.
+ */
+constexpr size_t kRangeMergeGap = 1024;
+
+/**
+ * @brief Finds the elements that differ between two versions of a buffer.
+ * @param before Old buffer.
+ * @param after New buffer.
+ * @return Ranges of changed and added elements in order.
+ */
+template <typename T>
+std::vector<BufferRange> ChangedRanges(const std::vector<T> &before,
+                                       const std::vector<T> &after) {
+  std::vector<BufferRange> ranges;
+  size_t common = std::min(before.size(), after.size());
+  size_t i = 0;
+  while (i < common) {
+    if (before[i] == after[i]) {
+      ++i;
+      continue;
+    }
+    size_t start = i;
+    size_t end = ++i;
+    for (; i < common && i - end < kRangeMergeGap; ++i) {
+      if (before[i] != after[i]) {
+        end = i + 1;
+      }
+    }
+    ranges.push_back({start, end - start});
+  }
+  if (after.size() > common) {
+    if (!ranges.empty() &&
+        common - (ranges.back().offset + ranges.back().size) <
+            kRangeMergeGap) {
+      ranges.back().size = after.size() - ranges.back().offset;
+    } else {
+      ranges.push_back({common, after.size() - common});
+    }
+  }
+  return ranges;
+}
+
+}  // namespace
+
+Model::Model()
+    : externalBuffers({nullptr, 0, nullptr, 0}),
+      normalizationCenter({0, 0, 0}),
+      normalizationScale(1.0f) {
   ResetToDefault();
 
   glm::vec3 cameraPos = glm::vec3(0.0f, 0.0f, 3.0f);
@@ -20,10 +72,89 @@ Model::Model() {
 }
 
 void Model::CreateBuffers() {
+  S21_TRACE_SCOPE("Model::CreateBuffers");
   ObjLoader &objLoaderInstance = ObjLoader::Instance();
 
+  externalBuffers = {nullptr, 0, nullptr, 0};
+  SetNormalization();
   vertices = NormalizeVertices(objLoaderInstance.GetVertices());
+  S21_TRACE_SCOPE("Copy indices");
   indices = objLoaderInstance.GetFaces();
+  BuildOctree(vertices.data(), vertices.size());
+  ReportMemory();
+}
+
+void Model::AdoptBuffers() {
+  S21_TRACE_SCOPE("Model::AdoptBuffers");
+  vertices.clear();
+  indices.clear();
+  externalBuffers = ObjLoader::Instance().GetBuffers();
+  SetNormalization();
+  NormalizeVertices(externalBuffers.vertices, externalBuffers.verticesSize);
+  BuildOctree(externalBuffers.vertices, externalBuffers.verticesSize);
+  ReportMemory();
+}
+
+void Model::ClearBuffers() {
+  std::vector<GLfloat>().swap(vertices);
+  std::vector<GLuint>().swap(indices);
+  externalBuffers = {nullptr, 0, nullptr, 0};
+  octree.Clear();
+  ReportMemory();
+}
+
+ModelUpdate Model::UpdateBuffers(bool appended) {
+  S21_TRACE_SCOPE("Model::UpdateBuffers");
+  ObjLoader &objLoaderInstance = ObjLoader::Instance();
+  const std::vector<GLfloat> &newVertices = objLoaderInstance.GetVertices();
+  const std::vector<GLuint> &newIndices = objLoaderInstance.GetFaces();
+  ModelUpdate update{{}, {}, externalBuffers.vertices != nullptr};
+  externalBuffers = {nullptr, 0, nullptr, 0};
+  if (newIndices.empty()) {
+    // Any change may reorder the points of a cloud, all of them are new.
+    vertices = NormalizeVertices(newVertices);
+    indices.clear();
+    BuildOctree(vertices.data(), vertices.size());
+    update.vertexRanges.push_back({0, vertices.size()});
+    update.reallocated = true;
+  } else if (appended && !update.reallocated && octree.GetNodes().empty() &&
+             newVertices.size() >= vertices.size() &&
+             newIndices.size() >= indices.size()) {
+    // The loaded part of the file is unchanged, only the tail is new.
+    size_t oldVertices = vertices.size();
+    size_t oldIndices = indices.size();
+    vertices.insert(vertices.end(), newVertices.begin() + oldVertices,
+                    newVertices.end());
+    NormalizeVertices(vertices.data() + oldVertices,
+                      vertices.size() - oldVertices);
+    indices.insert(indices.end(), newIndices.begin() + oldIndices,
+                   newIndices.end());
+    if (vertices.size() > oldVertices) {
+      update.vertexRanges.push_back(
+          {oldVertices, vertices.size() - oldVertices});
+    }
+    if (indices.size() > oldIndices) {
+      update.indexRanges.push_back({oldIndices, indices.size() - oldIndices});
+    }
+  } else {
+    std::vector<GLfloat> normalizedVertices = NormalizeVertices(newVertices);
+    update.vertexRanges = ChangedRanges(vertices, normalizedVertices);
+    vertices.swap(normalizedVertices);
+    update.indexRanges = ChangedRanges(indices, newIndices);
+    indices = newIndices;
+  }
+  if (!newIndices.empty()) {
+    octree.Clear();
+  }
+  ReportMemory();
+  return update;
+}
+
+void Model::ReportMemory() const {
+  MemoryStats::Instance().Set(ModelVertices,
+                              vertices.capacity() * sizeof(GLfloat));
+  MemoryStats::Instance().Set(ModelIndices,
+                              indices.capacity() * sizeof(GLuint));
 }
 
 void Model::ResetToDefault() {
@@ -32,24 +163,56 @@ void Model::ResetToDefault() {
 
 std::vector<GLfloat> Model::NormalizeVertices(
     const std::vector<GLfloat> &vertices) {
-  std::vector<GLfloat> result;
-  ObjLoader &objLoaderInstance = ObjLoader::Instance();
+  std::vector<GLfloat> result(vertices);
+  NormalizeVertices(result.data(), result.size());
+  return result;
+}
+
+void Model::SetNormalization() {
+  normalizationCenter = ObjLoader::Instance().GetCenters();
+  normalizationScale = ObjLoader::Instance().GetScaleFactor();
+}
 
-  for (size_t i = 0; i < vertices.size(); i += 3) {
-    result.push_back((vertices[i] - objLoaderInstance.GetCenters().X) *
-                     objLoaderInstance.GetScaleFactor());
-    result.push_back((vertices[(i + 1)] - objLoaderInstance.GetCenters().Y) *
-                     objLoaderInstance.GetScaleFactor());
-    result.push_back((vertices[(i + 2)] - objLoaderInstance.GetCenters().Z) *
-                     objLoaderInstance.GetScaleFactor());
+void Model::NormalizeVertices(GLfloat *data, size_t size) {
+  S21_TRACE_SCOPE("NormalizeVertices");
+  const Vertex &center = normalizationCenter;
+  GLfloat scaleFactor = normalizationScale;
+
+  for (size_t i = 0; i + 2 < size; i += 3) {
+    data[i] = (data[i] - center.X) * scaleFactor;
+    data[i + 1] = (data[i + 1] - center.Y) * scaleFactor;
+    data[i + 2] = (data[i + 2] - center.Z) * scaleFactor;
+  }
+}
+
+void Model::BuildOctree(GLfloat *data, size_t size) {
+  if (GetIndicesSize() == 0) {
+    octree.Build(data, size);
+  } else {
+    octree.Clear();
   }
-  return result;
 }
 
 const std::vector<GLfloat> &Model::GetVertices() const { return vertices; }
 
 const std::vector<GLuint> &Model::GetIndices() const { return indices; }
 
+size_t Model::GetVerticesSize() const {
+  return externalBuffers.vertices ? externalBuffers.verticesSize
+                                  : vertices.size();
+}
+
+size_t Model::GetIndicesSize() const {
+  return externalBuffers.indices ? externalBuffers.indicesSize
+                                 : indices.size();
+}
+
+bool Model::IsPointCloud() const {
+  return GetVerticesSize() > 0 && GetIndicesSize() == 0;
+}
+
+const PointOctree &Model::GetOctree() const { return octree; }
+
 TransformationMatrices &Model::GetTransformMatrices() { return transform; }
 
 VPmatrices Model::GetVP() const { return {viewMatrix, projectionMatrix}; }
@@ -70,4 +233,20 @@ void Model::SetProjection(ProjectionType type, int width, int height) {
   }
 }
 
+glm::mat4 Model::GetTileMatrix(int left, int top, int tileWidth,
+                               int tileHeight, int width, int height) {
+  float scaleX = static_cast<float>(width) / tileWidth;
+  float scaleY = static_cast<float>(height) / tileHeight;
+  // Center of the tile in normalized device coordinates, y points up.
+  float centerX = (2.0f * left + tileWidth) / width - 1.0f;
+  float centerY = 1.0f - (2.0f * top + tileHeight) / height;
+  glm::mat4 tile(1.0f);
+  tile[0][0] = scaleX;
+  tile[1][1] = scaleY;
+  // Translation is multiplied by w, so it also holds for perspective.
+  tile[3][0] = -centerX * scaleX;
+  tile[3][1] = -centerY * scaleY;
+  return tile;
+}
+
 }  // namespace s21
@@ -11,6 +11,7 @@
 #include <string>
 
 #include "s21_obj_loader.h"
+#include "s21_point_octree.h"
 
 namespace s21 {
 
@@ -31,6 +32,24 @@ struct TransformationMatrices {
   glm::mat4 translateMatrix;  ///< Translation matrix.
 };
 
+/**
+ * @brief Range of buffer elements.
+ */
+struct BufferRange {
+  size_t offset;  ///< First element of the range.
+  size_t size;    ///< Number of elements.
+};
+
+/**
+ * @brief Parts of the model buffers changed by Model::UpdateBuffers().
+ */
+struct ModelUpdate {
+  std::vector<BufferRange> vertexRanges;  ///< Changed vertex coordinates.
+  std::vector<BufferRange> indexRanges;   ///< Changed indices.
+  bool reallocated;  ///< Whether the model moved out of external buffers, so
+                     ///< nothing of the old buffers can be kept.
+};
+
 /**
  * @brief Enumeration for defining projection types.
  */
@@ -59,6 +78,31 @@ class Model {
    */
   const std::vector<GLuint>& GetIndices() const;
 
+  /**
+   * @brief Gets the number of vertex coordinates, including external buffers.
+   * @return Number of vertex coordinates.
+   */
+  size_t GetVerticesSize() const;
+
+  /**
+   * @brief Gets the number of indices, including external buffers.
+   * @return Number of indices.
+   */
+  size_t GetIndicesSize() const;
+
+  /**
+   * @brief Checks whether the model has vertices and no faces.
+   * @return true if the model is drawn as a point cloud.
+   */
+  bool IsPointCloud() const;
+
+  /**
+   * @brief Gets the level of detail octree of a point cloud, the vertices are
+   * kept in its order.
+   * @return Constant reference to the octree, empty unless IsPointCloud().
+   */
+  const PointOctree& GetOctree() const;
+
   /**
    * @brief Gets the transformation matrices.
    * @return Reference to the transformation matrices.
@@ -80,11 +124,48 @@ class Model {
    */
   void SetProjection(ProjectionType type, int width, int height);
 
+  /**
+   * @brief Calculates the matrix narrowing a projection to one tile of an
+   * image, so the tile fills the whole viewport.
+   * @param left Left edge of the tile in pixels.
+   * @param top Top edge of the tile in pixels, rows go from top to bottom.
+   * @param tileWidth Width of the tile in pixels.
+   * @param tileHeight Height of the tile in pixels.
+   * @param width Width of the whole image in pixels.
+   * @param height Height of the whole image in pixels.
+   * @return Matrix applied in clip space, after the projection matrix.
+   */
+  static glm::mat4 GetTileMatrix(int left, int top, int tileWidth,
+                                 int tileHeight, int width, int height);
+
   /**
    * @brief Creates buffers for the model.
    */
   void CreateBuffers();
 
+  /**
+   * @brief Uses the external buffers the loader has parsed into.
+   * Vertices are normalized in place, GetVertices() and GetIndices() stay
+   * empty.
+   */
+  void AdoptBuffers();
+
+  /**
+   * @brief Frees the vertices and indices, for a model that is read from a
+   * ChunkStore instead.
+   */
+  void ClearBuffers();
+
+  /**
+   * @brief Takes the model the loader has parsed again, keeping the
+   * transformations and the normalization of the loaded model, so unchanged
+   * vertices keep their coordinates.
+   * @param appended true if the loader only parsed appended lines, then only
+   * the new tail is copied instead of comparing the whole model.
+   * @return Ranges of the vertices and indices that changed.
+   */
+  ModelUpdate UpdateBuffers(bool appended);
+
   /**
    * @brief Resets the model transformations to default values.
    */
@@ -96,6 +177,15 @@ class Model {
   glm::mat4 viewMatrix;           ///< View transformation matrix.
   glm::mat4 projectionMatrix;     ///< Projection transformation matrix.
   TransformationMatrices transform;  ///< Transformation matrices for the model.
+  BufferView externalBuffers;  ///< Buffers owned by the caller of the loader.
+  Vertex normalizationCenter;  ///< Center subtracted from loaded vertices.
+  GLfloat normalizationScale;  ///< Scale applied to loaded vertices.
+  PointOctree octree;          ///< Levels of detail of a point cloud.
+
+  /**
+   * @brief Reports the memory of the vertices and indices vectors.
+   */
+  void ReportMemory() const;
 
   /**
    * @brief Normalizes the given vertices.
@@ -103,6 +193,27 @@ class Model {
    * @return Vector of normalized vertices.
    */
   std::vector<GLfloat> NormalizeVertices(const std::vector<GLfloat>& vertices);
+
+  /**
+   * @brief Takes the center and the scale of the parsed model for the
+   * following normalizations.
+   */
+  void SetNormalization();
+
+  /**
+   * @brief Normalizes vertices in place.
+   * @param data Vertex coordinates.
+   * @param size Number of vertex coordinates.
+   */
+  void NormalizeVertices(GLfloat* data, size_t size);
+
+  /**
+   * @brief Builds the octree over the vertices of a point cloud, reordering
+   * them, or clears it for a model with faces.
+   * @param data Normalized vertex coordinates.
+   * @param size Number of vertex coordinates.
+   */
+  void BuildOctree(GLfloat* data, size_t size);
 };
 
 }  // namespace s21
@@ -7,49 +7,134 @@
 
 namespace s21 {
 
-ModelFacade::ModelFacade() : loaderInstance(ObjLoader::Instance()) {
+ModelFacade::ModelFacade()
+    : loaderInstance(ObjLoader::Instance()),
+      chunkStore(nullptr),
+      chunkCache(nullptr) {
   viewerModel = new Model();
-  transformationStrategyContext = new Context();
+  transformationStrategyContexts = new Context[3];
+  transformationStrategyContexts[Rotate].SetStrategy(new RotateStrategy());
+  transformationStrategyContexts[Scale].SetStrategy(new ScaleStrategy());
+  transformationStrategyContexts[Move].SetStrategy(new MoveStrategy());
 }
 
 ModelFacade::~ModelFacade() {
+  ResetOutOfCore();
   delete viewerModel;
-  delete transformationStrategyContext;
+  delete[] transformationStrategyContexts;
 }
 
 void ModelFacade::LoadFile(std::string filename) {
+  S21_TRACE_SCOPE("ModelFacade::LoadFile");
+  ResetOutOfCore();
   loaderInstance.ParseFile(filename);
   viewerModel->CreateBuffers();
   viewerModel->ResetToDefault();
 }
 
+void ModelFacade::LoadFileInto(std::string filename,
+                               const BufferAllocator &allocator) {
+  S21_TRACE_SCOPE("ModelFacade::LoadFileInto");
+  ResetOutOfCore();
+  loaderInstance.ParseFileInto(filename, allocator);
+  viewerModel->AdoptBuffers();
+  viewerModel->ResetToDefault();
+}
+
+void ModelFacade::LoadOutOfCore(std::string filename, std::string storeFile,
+                                size_t ramBudget) {
+  S21_TRACE_SCOPE("ModelFacade::LoadOutOfCore");
+  ResetOutOfCore();
+  // Nothing of the model is held in memory but the chunks in view.
+  loaderInstance.Clear();
+  viewerModel->ClearBuffers();
+  chunkStore = new ChunkStore();
+  try {
+    chunkStore->Open(filename, storeFile, loadProgress);
+  } catch (...) {
+    ResetOutOfCore();
+    throw;
+  }
+  chunkCache = new ChunkCache(*chunkStore, ramBudget);
+  viewerModel->ResetToDefault();
+}
+
+void ModelFacade::ResetOutOfCore() {
+  // The cache reads from the store until it is deleted.
+  delete chunkCache;
+  chunkCache = nullptr;
+  delete chunkStore;
+  chunkStore = nullptr;
+}
+
+bool ModelFacade::ReparseFile() { return loaderInstance.ReparseFile(); }
+
+ModelUpdate ModelFacade::UpdateBuffers(bool appended) {
+  return viewerModel->UpdateBuffers(appended);
+}
+
+PreviewCloud ModelFacade::SamplePreview(std::string filename) const {
+  return PreviewSampler().Sample(filename);
+}
+
+void ModelFacade::SetLoadProgress(LoadProgress progress) {
+  loadProgress = progress;
+  loaderInstance.SetProgressCallback(std::move(progress));
+}
+
+std::pair<size_t, size_t> ModelFacade::GetBuffersSize() const {
+  return {viewerModel->GetVerticesSize(), viewerModel->GetIndicesSize()};
+}
+
 std::pair<const std::vector<GLfloat> &, const std::vector<GLuint> &>
 ModelFacade::GetBuffersData() const {
   return {viewerModel->GetVertices(), viewerModel->GetIndices()};
 }
 
+bool ModelFacade::IsPointCloud() const { return viewerModel->IsPointCloud(); }
+
+void ModelFacade::SelectPoints(const ViewerData &view, int height,
+                               size_t budget, PointSelection &selection) const {
+  viewerModel->GetOctree().Select(view.viewMatrix * view.modelMatrix,
+                                  view.projectionMatrix, height, budget,
+                                  selection);
+}
+
+bool ModelFacade::IsOutOfCore() const { return chunkStore != nullptr; }
+
+void ModelFacade::SelectChunks(
+    const ViewerData &view, int height,
+    std::vector<std::pair<GLfloat, size_t>> &visible) const {
+  chunkStore->SelectChunks(view.viewMatrix * view.modelMatrix,
+                           view.projectionMatrix, height, visible);
+}
+
+const ChunkStore *ModelFacade::GetChunkStore() const { return chunkStore; }
+
+ChunkCache *ModelFacade::GetChunkCache() const { return chunkCache; }
+
 int ModelFacade::GetUnqueEdgesCount() const {
+  if (chunkStore != nullptr) {
+    return static_cast<int>(chunkStore->GetEdgesCount());
+  }
   return loaderInstance.GetUniqueEdgesCount();
 }
 
+MemoryUsage ModelFacade::GetMemoryUsage(MemorySubsystem subsystem) const {
+  return MemoryStats::Instance().Get(subsystem);
+}
+
+std::size_t ModelFacade::GetPeakRss() const {
+  return MemoryStats::GetPeakRss();
+}
+
 ViewerData ModelFacade::InteractModel(const InputData &params,
                                       TransformationStrategy method) {
-  glm::mat4 modelMatrix;
-  switch (method) {
-    case TransformationStrategy::Rotate:
-      transformationStrategyContext->SetStrategy(new RotateStrategy());
-      break;
-    case TransformationStrategy::Scale:
-      transformationStrategyContext->SetStrategy(new ScaleStrategy());
-      break;
-    case TransformationStrategy::Move:
-      transformationStrategyContext->SetStrategy(new MoveStrategy());
-      break;
-  }
   viewerModel->SetProjection(params.projectionType, params.width,
                              params.height);
-  modelMatrix =
-      transformationStrategyContext->TransformModel(params, viewerModel);
+  glm::mat4 modelMatrix =
+      transformationStrategyContexts[method].TransformModel(params,
+                                                            viewerModel);
   return {modelMatrix, viewerModel->GetVP().viewMatrix,
           viewerModel->GetVP().projectionMatrix};
 }
@@ -6,8 +6,11 @@
 #ifndef S21_MODEL_FACADE_H
 #define S21_MODEL_FACADE_H
 
+#include "s21_chunk_cache.h"
+#include "s21_chunk_store.h"
 #include "s21_model.h"
 #include "s21_obj_loader.h"
+#include "s21_preview_sampler.h"
 #include "s21_transformation_strategy.h"
 
 namespace s21 {
@@ -44,6 +47,54 @@ class ModelFacade {
    */
   void LoadFile(std::string filename);
 
+  /**
+   * @brief Loads the model file straight into caller-provided buffers.
+   * @param filename The name of the model file to load.
+   * @param allocator Callback providing memory for vertices and indices.
+   */
+  void LoadFileInto(std::string filename, const BufferAllocator& allocator);
+
+  /**
+   * @brief Opens a model too large for memory from its ChunkStore, building
+   * the store on the first open. The loader and the model are emptied, the
+   * chunks are drawn from the store and the cache keeps those in view in
+   * memory.
+   * @param filename The name of the model file to load.
+   * @param storeFile The name of the chunk store of the file.
+   * @param ramBudget Largest number of bytes of chunks kept in memory.
+   */
+  void LoadOutOfCore(std::string filename, std::string storeFile,
+                     size_t ramBudget);
+
+  /**
+   * @brief Parses the loaded file again after it changed on disk.
+   * Only the loader is updated, so this can run while the model is rendered.
+   * @return true if only lines appended to the file were parsed.
+   */
+  bool ReparseFile();
+
+  /**
+   * @brief Replaces the model with the reparsed file, keeping the
+   * transformations and the normalization of the loaded model.
+   * @param appended Result of ReparseFile().
+   * @return Ranges of the model buffers that changed.
+   */
+  ModelUpdate UpdateBuffers(bool appended);
+
+  /**
+   * @brief Samples vertices of a file for a preview shown while it loads.
+   * @param filename The name of the model file.
+   * @return Sampled vertices, empty if the file can't be read.
+   */
+  PreviewCloud SamplePreview(std::string filename) const;
+
+  /**
+   * @brief Sets the callback receiving the bounds of the vertices parsed by
+   * the following loads.
+   * @param progress Progress callback, empty to disable reports.
+   */
+  void SetLoadProgress(LoadProgress progress);
+
   /**
    * @brief Gets the model buffer data.
    * @return A pair containing constant references to the vertex and index
@@ -52,12 +103,79 @@ class ModelFacade {
   std::pair<const std::vector<GLfloat>&, const std::vector<GLuint>&>
   GetBuffersData() const;
 
+  /**
+   * @brief Gets the sizes of the model buffers.
+   * Valid for both the owned and the caller-provided buffers.
+   * @return A pair of the vertex coordinates count and the indices count.
+   */
+  std::pair<size_t, size_t> GetBuffersSize() const;
+
+  /**
+   * @brief Checks whether the model has vertices and no faces.
+   * @return true if the model is drawn as a point cloud.
+   */
+  bool IsPointCloud() const;
+
+  /**
+   * @brief Chooses the points of a point cloud drawn under the given
+   * matrices, see PointOctree::Select().
+   * @param view Matrices of the frame.
+   * @param height Height of the viewport in pixels.
+   * @param budget Largest number of points to select.
+   * @param selection Receives the ranges of vertices to draw.
+   */
+  void SelectPoints(const ViewerData& view, int height, size_t budget,
+                    PointSelection& selection) const;
+
+  /**
+   * @brief Checks whether the model was loaded by LoadOutOfCore().
+   * @return true if the model is drawn from chunks.
+   */
+  bool IsOutOfCore() const;
+
+  /**
+   * @brief Finds the chunks of an out-of-core model inside the view, see
+   * ChunkStore::SelectChunks().
+   * @param view Matrices of the frame.
+   * @param height Height of the viewport in pixels.
+   * @param visible Receives the radii and the indices of the chunks.
+   */
+  void SelectChunks(const ViewerData& view, int height,
+                    std::vector<std::pair<GLfloat, size_t>>& visible) const;
+
+  /**
+   * @brief Gets the chunks of an out-of-core model.
+   * @return Pointer to the store, nullptr unless IsOutOfCore().
+   */
+  const ChunkStore* GetChunkStore() const;
+
+  /**
+   * @brief Gets the chunks of an out-of-core model kept in memory.
+   * @return Pointer to the cache, nullptr unless IsOutOfCore().
+   */
+  ChunkCache* GetChunkCache() const;
+
   /**
    * @brief Gets the number of unique edges of the model.
+   * An out-of-core model counts the edges of every face, edges shared by
+   * faces aren't matched up.
    * @return The number of unique edges.
    */
   int GetUnqueEdgesCount() const;
 
+  /**
+   * @brief Gets the memory held by a subsystem.
+   * @param subsystem Holder of the buffers.
+   * @return Current and peak bytes.
+   */
+  MemoryUsage GetMemoryUsage(MemorySubsystem subsystem) const;
+
+  /**
+   * @brief Gets the peak resident memory of the process.
+   * @return Peak resident memory in bytes.
+   */
+  std::size_t GetPeakRss() const;
+
   /**
    * @brief Interacts with the model by applying the specified transformation
    * strategy.
@@ -71,8 +189,19 @@ class ModelFacade {
  protected:
   ObjLoader& loaderInstance;  ///< Instance of the OBJ loader.
   Model* viewerModel;         ///< Pointer to the model for viewing.
-  Context* transformationStrategyContext;  ///< Context for the transformation
-                                           ///< strategy.
+  Context* transformationStrategyContexts;  ///< Contexts holding the Rotate,
+                                            ///< Scale and Move strategies,
+                                            ///< created once so interaction
+                                            ///< doesn't allocate.
+  ChunkStore* chunkStore;    ///< Chunks of an out-of-core model, or nullptr.
+  ChunkCache* chunkCache;    ///< Chunks of chunkStore kept in memory.
+  LoadProgress loadProgress;  ///< Receiver of progress reports.
+
+ private:
+  /**
+   * @brief Closes the chunks of an out-of-core model.
+   */
+  void ResetOutOfCore();
 };
 
 }  // namespace s21
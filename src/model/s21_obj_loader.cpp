@@ -13,75 +13,145 @@ ObjLoader& ObjLoader::Instance() {
 }
 
 void ObjLoader::ParseFile(std::string objFilename) {
+  ParseFileInto(objFilename, [this](size_t verticesSize, size_t indicesSize) {
+    return AllocateOwnBuffers(verticesSize, indicesSize);
+  });
+}
+
+void ObjLoader::ParseFileInto(std::string objFilename,
+                              const BufferAllocator& allocator) {
+  S21_TRACE_SCOPE("ObjLoader::ParseFile");
   ClearData();
   filename = objFilename;
-  std::ifstream fileStream(filename);
-  if (fileStream.is_open()) {
-    std::string line;
-    float minX = FLT_MAX, maxX = FLT_MIN;
-    float minY = FLT_MAX, maxY = FLT_MIN;
-    float minZ = FLT_MAX, maxZ = FLT_MIN;
-    while (std::getline(fileStream, line)) {
-      std::istringstream iss(line);
-      std::string token;
-      std::getline(iss, token, ' ');
-      if (token == "v") {
-        float x, y, z;
-        if (iss >> x >> y >> z) {
-          vertices.insert(vertices.end(), {x, y, z});
-          minX = std::min(minX, x);
-          minY = std::min(minY, y);
-          minZ = std::min(minZ, z);
-          maxX = std::max(maxX, x);
-          maxY = std::max(maxY, y);
-          maxZ = std::max(maxZ, z);
-        } else {
-          ClearData();
-          throw std::invalid_argument("wrong data");
-        }
-      } else if (token == "f") {
-        ParseFace(line);
-      } else {
-        continue;
-      }
-    }
-    fileStream.close();
-    if (vertices.empty()) {
-      ClearData();
-      throw std::out_of_range("empty file");
-    } else {
-      if (faces.empty()) {
-        ClearData();
-        throw std::invalid_argument("wrong data");
-      } else {
-        modelCenter.X = (minX + maxX) / 2.0f;
-        modelCenter.Y = (minY + maxY) / 2.0f;
-        modelCenter.Z = (minZ + maxZ) / 2.0f;
-        scaleFactor =
-            0.5f / std::max(maxX - minX, std::max(maxY - minY, maxZ - minZ));
-      }
+  ParseContent(ReadFile(), allocator);
+}
+
+bool ObjLoader::ReparseFile() {
+  S21_TRACE_SCOPE("ObjLoader::ReparseFile");
+  std::string content = ReadFile();
+  // Buffers of the caller can't grow, such models are parsed in full.
+  if (buffers.vertices == vertices.data() && IsAppendedTo(content)) {
+    ParseAppendedLines(content);
+    return true;
+  }
+  ClearData();
+  ParseContent(content, [this](size_t verticesSize, size_t indicesSize) {
+    return AllocateOwnBuffers(verticesSize, indicesSize);
+  });
+  return false;
+}
+
+void ObjLoader::ParseContent(const std::string& content,
+                             const BufferAllocator& allocator) {
+  ScopedMemory contentMemory(LoaderFile, content.capacity());
+  std::pair<size_t, size_t> sizes = CountRecords(content);
+  // Vertices without faces are a point cloud, faces need vertices.
+  if (sizes.first == 0 && sizes.second == 0) {
+    throw std::out_of_range("empty file");
+  } else if (sizes.first == 0) {
+    throw std::invalid_argument("wrong data");
+  }
+  Tracer::Instance().SetVerticesCount(sizes.first / 3);
+  buffers = allocator(sizes.first, sizes.second);
+  std::vector<FaceLine> faceLines = ParseVertices(content);
+  ScopedMemory faceLinesMemory(LoaderFile,
+                               faceLines.capacity() * sizeof(FaceLine));
+  {
+    S21_TRACE_SCOPE("Parse faces");
+    for (const FaceLine& faceLine : faceLines) {
+      ParseFace(content.substr(faceLine.offset, faceLine.length),
+                faceLine.verticesSize);
     }
-  } else {
-    ClearData();
-    throw std::logic_error("file doesn't exist");
   }
-  uniqueEdgesCount = uniqueEdges.size();
-  uniqueEdges.clear();
+  CountUniqueEdges();
+  ComputeBoundingBox();
+  parsedBytes = content.size();
+  parsedHash = HashContent(content.data(), parsedBytes);
+}
+
+void ObjLoader::ParseAppendedLines(const std::string& content) {
+  S21_TRACE_SCOPE("Parse appended lines");
+  std::string tail = content.substr(parsedBytes);
+  ScopedMemory tailMemory(LoaderFile, tail.capacity());
+  std::pair<size_t, size_t> sizes = CountRecords(tail);
+  // Faces write through the buffers, which follow the grown vectors.
+  buffers = AllocateOwnBuffers(verticesWritten + sizes.first,
+                               indicesWritten + sizes.second);
+  for (const FaceLine& faceLine : ParseVertices(tail)) {
+    ParseFace(tail.substr(faceLine.offset, faceLine.length),
+              faceLine.verticesSize);
+  }
+  CountUniqueEdges();
+  ComputeBoundingBox();
+  parsedBytes = content.size();
+  parsedHash = HashContent(content.data(), parsedBytes);
+}
+
+void ObjLoader::Clear() {
+  ClearData();
+  filename.clear();
+  std::vector<GLfloat>().swap(vertices);
+  std::vector<GLuint>().swap(faces);
+  ReportMemory();
+}
+
+void ObjLoader::SetProgressCallback(LoadProgress callback) {
+  progress = std::move(callback);
+}
+
+bool ObjLoader::IsAppendedTo(const std::string& content) const {
+  // The last parsed line must have ended, otherwise it was extended.
+  return parsedBytes > 0 && content.size() > parsedBytes &&
+         (content[parsedBytes - 1] == '\n' || content[parsedBytes] == '\n') &&
+         HashContent(content.data(), parsedBytes) == parsedHash;
+}
+
+BufferView ObjLoader::AllocateOwnBuffers(size_t verticesSize,
+                                         size_t indicesSize) {
+  vertices.resize(verticesSize);
+  faces.resize(indicesSize);
+  ReportMemory();
+  return BufferView{vertices.data(), verticesSize, faces.data(), indicesSize};
+}
+
+std::uint64_t ObjLoader::HashContent(const char* data, size_t size) {
+  const std::uint64_t prime = 1099511628211ull;
+  std::uint64_t hash = 14695981039346656037ull;
+  size_t i = 0;
+  for (; i + sizeof(std::uint64_t) <= size; i += sizeof(std::uint64_t)) {
+    std::uint64_t word;
+    std::memcpy(&word, data + i, sizeof(word));
+    hash = (hash ^ word) * prime;
+  }
+  for (; i < size; ++i) {
+    hash = (hash ^ static_cast<unsigned char>(data[i])) * prime;
+  }
+  return hash;
 }
 
 const std::vector<GLfloat>& ObjLoader::GetVertices() const { return vertices; }
 
 const std::vector<GLuint>& ObjLoader::GetFaces() const { return faces; }
 
+const BufferView& ObjLoader::GetBuffers() const { return buffers; }
+
 const Vertex& ObjLoader::GetCenters() const { return modelCenter; }
 
 int ObjLoader::GetUniqueEdgesCount() const { return uniqueEdgesCount; }
 
 GLfloat ObjLoader::GetScaleFactor() const { return scaleFactor; }
 
-ObjLoader::ObjLoader() : scaleFactor(0), modelCenter({0, 0, 0}) {}
+ObjLoader::ObjLoader()
+    : buffers({nullptr, 0, nullptr, 0}),
+      verticesWritten(0),
+      indicesWritten(0),
+      scaleFactor(0),
+      modelCenter({0, 0, 0}),
+      parsedBytes(0),
+      parsedHash(0),
+      progress() {}
 
-void ObjLoader::ParseFace(const std::string& line) {
+void ObjLoader::ParseFace(const std::string& line, size_t verticesSize) {
   std::istringstream iss(line);
   std::string token;
   std::vector<GLuint> face;
@@ -101,7 +171,7 @@ void ObjLoader::ParseFace(const std::string& line) {
         ClearData();
         throw std::invalid_argument("wrong data");
       }
-      if (static_cast<size_t>(index) > vertices.size() || index < 0 ||
+      if (static_cast<size_t>(index) > verticesSize || index < 0 ||
           static_cast<size_t>(log10(index) + 1) !=
               token.substr(0, pos).size()) {
         ClearData();
@@ -125,7 +195,7 @@ void ObjLoader::ParseFace(const std::string& line) {
       if (token.back() == '\r') {
         tokenSize -= 1;
       }
-      if (static_cast<size_t>(index) > vertices.size() || index < 0 ||
+      if (static_cast<size_t>(index) > verticesSize || index < 0 ||
           indexSize != tokenSize) {
         ClearData();
         throw std::invalid_argument("wrong data");
@@ -134,24 +204,185 @@ void ObjLoader::ParseFace(const std::string& line) {
       }
     }
   }
-  for (size_t i = 1; i < face.size(); ++i) {
-    uniqueEdges.emplace(face[i - 1], face[i]);
+  if (face.empty() ||
+      indicesWritten + face.size() * 2 > buffers.indicesSize) {
+    ClearData();
+    throw std::invalid_argument("wrong data");
   }
+  GLuint* output = buffers.indices + indicesWritten;
   for (size_t i = 1; i < face.size(); ++i) {
-    faces.push_back(face[i - 1]);
-    faces.push_back(face[i]);
+    *output++ = face[i - 1];
+    *output++ = face[i];
+  }
+  *output++ = face.back();
+  *output++ = face.front();
+  indicesWritten += face.size() * 2;
+}
+
+std::string ObjLoader::ReadFile() const {
+  S21_TRACE_SCOPE("Read file");
+  std::ifstream fileStream(filename, std::ios::binary | std::ios::ate);
+  if (!fileStream.is_open()) {
+    throw std::logic_error("file doesn't exist");
   }
-  faces.push_back(face.back());
-  faces.push_back(face.front());
+  std::string content(static_cast<size_t>(fileStream.tellg()), '\0');
+  fileStream.seekg(0);
+  fileStream.read(content.data(), content.size());
+  return content;
+}
+
+std::pair<size_t, size_t> ObjLoader::CountRecords(
+    const std::string& content) const {
+  S21_TRACE_SCOPE("Count records");
+  size_t verticesSize = 0, indicesSize = 0;
+  size_t lineStart = 0;
+  while (lineStart < content.size()) {
+    size_t lineEnd = content.find('\n', lineStart);
+    if (lineEnd == std::string::npos) {
+      lineEnd = content.size();
+    }
+    size_t tokenEnd = std::min(content.find(' ', lineStart), lineEnd);
+    if (tokenEnd - lineStart == 1 && content[lineStart] == 'v') {
+      verticesSize += 3;
+    } else if (tokenEnd - lineStart == 1 && content[lineStart] == 'f') {
+      // Mirrors the tokenization of ParseFace: every index token produces
+      // two entries of the lines list.
+      for (size_t tokenStart = tokenEnd + 1; tokenStart < lineEnd;) {
+        size_t nextSpace = std::min(content.find(' ', tokenStart), lineEnd);
+        size_t tokenSize = nextSpace - tokenStart;
+        bool skipped = tokenSize == 0 ||
+                       (tokenSize == 1 && (content[tokenStart] == '\r' ||
+                                           content[tokenStart] == 'f'));
+        if (!skipped) {
+          indicesSize += 2;
+        }
+        tokenStart = nextSpace + 1;
+      }
+    }
+    lineStart = lineEnd + 1;
+  }
+  return {verticesSize, indicesSize};
+}
+
+std::vector<ObjLoader::FaceLine> ObjLoader::ParseVertices(
+    const std::string& content) {
+  S21_TRACE_SCOPE("Parse vertices");
+  std::vector<FaceLine> faceLines;
+  BoundingBox parsed;
+  size_t reported = verticesWritten;
+  size_t lineStart = 0;
+  while (lineStart < content.size()) {
+    size_t lineEnd = content.find('\n', lineStart);
+    if (lineEnd == std::string::npos) {
+      lineEnd = content.size();
+    }
+    size_t tokenEnd = std::min(content.find(' ', lineStart), lineEnd);
+    size_t tokenSize = tokenEnd - lineStart;
+    if (tokenSize == 1 && content[lineStart] == 'v') {
+      std::istringstream iss(content.substr(tokenEnd, lineEnd - tokenEnd));
+      float x, y, z;
+      if (iss >> x >> y >> z) {
+        buffers.vertices[verticesWritten++] = x;
+        buffers.vertices[verticesWritten++] = y;
+        buffers.vertices[verticesWritten++] = z;
+        if (progress && verticesWritten - reported >= kProgressVertices * 3) {
+          parsed.Extend(buffers.vertices + reported,
+                        verticesWritten - reported);
+          reported = verticesWritten;
+          progress(parsed);
+        }
+      } else {
+        ClearData();
+        throw std::invalid_argument("wrong data");
+      }
+    } else if (tokenSize == 1 && content[lineStart] == 'f') {
+      faceLines.push_back({lineStart, lineEnd - lineStart, verticesWritten});
+    }
+    lineStart = lineEnd + 1;
+  }
+  return faceLines;
+}
+
+void ObjLoader::CountUniqueEdges() {
+  S21_TRACE_SCOPE("Count unique edges");
+  uniqueEdgesCount = CountUniqueEdges(buffers.indices, buffers.indicesSize);
+}
+
+int ObjLoader::CountUniqueEdges(const GLuint* indices, size_t indicesSize) {
+  // A sorted vector takes 8 bytes per edge instead of a set node per edge,
+  // which used to be the peak of memory usage for large models.
+  std::vector<Edge> edges;
+  edges.reserve(indicesSize / 2);
+  ScopedMemory edgesMemory(LoaderEdges, edges.capacity() * sizeof(Edge));
+  for (size_t i = 0; i + 1 < indicesSize; i += 2) {
+    edges.emplace_back(indices[i], indices[i + 1]);
+  }
+  std::sort(edges.begin(), edges.end());
+  return std::unique(edges.begin(), edges.end()) - edges.begin();
+}
+
+void ObjLoader::ComputeBoundingBox() {
+  S21_TRACE_SCOPE("Bounding box");
+  BoundingBox box;
+  box.Extend(buffers.vertices, buffers.verticesSize);
+  modelCenter = box.GetCenter();
+  scaleFactor = box.GetScaleFactor();
 }
 
 void ObjLoader::ClearData() {
   vertices.clear();
   faces.clear();
-  uniqueEdges.clear();
+  buffers = {nullptr, 0, nullptr, 0};
+  verticesWritten = 0;
+  indicesWritten = 0;
   scaleFactor = 0;
   uniqueEdgesCount = 0;
   modelCenter = {0, 0, 0};
+  parsedBytes = 0;
+  parsedHash = 0;
+  ReportMemory();
+}
+
+void ObjLoader::ReportMemory() const {
+  // Cleared vectors keep their capacity until the next model replaces them.
+  MemoryStats::Instance().Set(LoaderVertices,
+                              vertices.capacity() * sizeof(GLfloat));
+  MemoryStats::Instance().Set(LoaderFaces, faces.capacity() * sizeof(GLuint));
+}
+
+void BoundingBox::Extend(const GLfloat* data, size_t size) {
+  for (size_t i = 0; i + 2 < size; i += 3) {
+    minimum.X = std::min(minimum.X, data[i]);
+    minimum.Y = std::min(minimum.Y, data[i + 1]);
+    minimum.Z = std::min(minimum.Z, data[i + 2]);
+    maximum.X = std::max(maximum.X, data[i]);
+    maximum.Y = std::max(maximum.Y, data[i + 1]);
+    maximum.Z = std::max(maximum.Z, data[i + 2]);
+  }
+}
+
+void BoundingBox::Extend(const BoundingBox& other) {
+  const GLfloat corners[] = {other.minimum.X, other.minimum.Y,
+                             other.minimum.Z, other.maximum.X,
+                             other.maximum.Y, other.maximum.Z};
+  if (!other.IsEmpty()) {
+    Extend(corners, 6);
+  }
+}
+
+bool BoundingBox::IsEmpty() const { return minimum.X > maximum.X; }
+
+Vertex BoundingBox::GetCenter() const {
+  return {(minimum.X + maximum.X) / 2.0f, (minimum.Y + maximum.Y) / 2.0f,
+          (minimum.Z + maximum.Z) / 2.0f};
+}
+
+GLfloat BoundingBox::GetScaleFactor() const {
+  GLfloat side = std::max(maximum.X - minimum.X,
+                          std::max(maximum.Y - minimum.Y,
+                                   maximum.Z - minimum.Z));
+  // Coincident vertices, such as a single point, keep their size.
+  return side > 0.0f ? 0.5f / side : 1.0f;
 }
 
 Edge::Edge(GLuint a, GLuint b) {
@@ -171,4 +402,8 @@ bool Edge::operator<(const Edge& other) const {
   return v2 < other.v2;
 }
 
+bool Edge::operator==(const Edge& other) const {
+  return v1 == other.v1 && v2 == other.v2;
+}
+
 }  // namespace s21
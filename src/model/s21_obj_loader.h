@@ -9,13 +9,20 @@
 #include <GL/gl.h>
 #include <float.h>
 
+#include <algorithm>
 #include <cmath>
+#include <cstdint>
+#include <cstring>
 #include <fstream>
-#include <set>
+#include <functional>
+#include <limits>
 #include <sstream>
 #include <string>
 #include <vector>
 
+#include "s21_memory_stats.h"
+#include "s21_tracer.h"
+
 namespace s21 {
 
 /**
@@ -27,6 +34,50 @@ struct Vertex {
   GLfloat Z;  ///< Z coordinate of the vertex.
 };
 
+/**
+ * @brief Axis-aligned bounds of vertices, empty until a vertex is added.
+ */
+struct BoundingBox {
+  Vertex minimum{FLT_MAX, FLT_MAX, FLT_MAX};     ///< Smallest coordinates.
+  Vertex maximum{-FLT_MAX, -FLT_MAX, -FLT_MAX};  ///< Largest coordinates.
+
+  /**
+   * @brief Grows the box to contain vertices.
+   * @param data Vertex coordinates, three per vertex.
+   * @param size Number of vertex coordinates.
+   */
+  void Extend(const GLfloat* data, size_t size);
+
+  /**
+   * @brief Grows the box to contain another box.
+   * @param other Box to contain.
+   */
+  void Extend(const BoundingBox& other);
+
+  /**
+   * @brief Checks whether the box contains no vertex.
+   * @return true if nothing was added.
+   */
+  bool IsEmpty() const;
+
+  /**
+   * @brief Gets the center the model is normalized around.
+   * @return Center of the box.
+   */
+  Vertex GetCenter() const;
+
+  /**
+   * @brief Gets the scale normalizing the model into a unit-sized view.
+   * @return Half the reciprocal of the largest side, 1 if all sides are 0.
+   */
+  GLfloat GetScaleFactor() const;
+};
+
+/**
+ * @brief Callback receiving the bounds of the vertices parsed so far.
+ */
+using LoadProgress = std::function<void(const BoundingBox& parsed)>;
+
 /**
  * @brief Structure for representing an edge consisting of two vertices.
  */
@@ -46,8 +97,33 @@ struct Edge {
    * @return true if the current edge is less than the other; otherwise false.
    */
   bool operator<(const Edge& other) const;
+
+  /**
+   * @brief Equality operator for removing duplicate edges.
+   * @param other Another edge for comparison.
+   * @return true if both edges connect the same vertices; otherwise false.
+   */
+  bool operator==(const Edge& other) const;
+};
+
+/**
+ * @brief Structure describing the memory the parsed model is written to.
+ */
+struct BufferView {
+  GLfloat* vertices;    ///< Vertex coordinates, three per vertex.
+  size_t verticesSize;  ///< Number of vertex coordinates.
+  GLuint* indices;      ///< Pairs of vertex indices, one pair per line.
+  size_t indicesSize;   ///< Number of indices.
 };
 
+/**
+ * @brief Callback providing memory for the parsed model.
+ * Receives the exact number of vertex coordinates and indices found by the
+ * counting pass over the file.
+ */
+using BufferAllocator =
+    std::function<BufferView(size_t verticesSize, size_t indicesSize)>;
+
 /**
  * @brief Class for loading and parsing OBJ files.
  */
@@ -67,12 +143,48 @@ class ObjLoader {
    */
   static ObjLoader& Instance();
 
+  static constexpr size_t kProgressVertices =
+      1 << 20;  ///< Vertices parsed between progress reports.
+
   /**
    * @brief Parses the OBJ file.
    * @param objFilename The name of the OBJ file to parse.
    */
   void ParseFile(std::string objFilename);
 
+  /**
+   * @brief Parses the OBJ file into memory provided by the caller.
+   * The file is counted first, then the allocator is called once and the
+   * vertices and indices are written straight into the returned buffers,
+   * which must stay valid while the model is used. GetVertices() and
+   * GetFaces() stay empty in this mode.
+   * @param objFilename The name of the OBJ file to parse.
+   * @param allocator Callback providing the output buffers.
+   */
+  void ParseFileInto(std::string objFilename, const BufferAllocator& allocator);
+
+  /**
+   * @brief Parses the last parsed file again after it changed on disk.
+   * If the file only grew by new lines after the parsed content, only those
+   * lines are parsed and appended to the vertices and faces, otherwise the
+   * whole file is parsed into the loader's own vectors.
+   * @return true if only the appended lines were parsed.
+   */
+  bool ReparseFile();
+
+  /**
+   * @brief Forgets the parsed file and frees the vectors, for a model that is
+   * read from a ChunkStore instead.
+   */
+  void Clear();
+
+  /**
+   * @brief Sets the callback receiving the bounds of the parsed vertices
+   * every kProgressVertices vertices. It is called on the parsing thread.
+   * @param callback Progress callback, empty to disable reports.
+   */
+  void SetProgressCallback(LoadProgress callback);
+
   /**
    * @brief Gets the vertices of the model.
    * @return Constant reference to the vector of vertices.
@@ -85,6 +197,12 @@ class ObjLoader {
    */
   const std::vector<GLuint>& GetFaces() const;
 
+  /**
+   * @brief Gets the buffers the last file was parsed into.
+   * @return Constant reference to the buffer view.
+   */
+  const BufferView& GetBuffers() const;
+
   /**
    * @brief Gets the center of the model.
    * @return Constant reference to the Vertex structure representing the center
@@ -104,27 +222,125 @@ class ObjLoader {
    */
   GLfloat GetScaleFactor() const;
 
+  /**
+   * @brief Counts unique edges of a line list, an edge and its reverse are
+   * the same edge.
+   * @param indices Pairs of vertex indices, one pair per line.
+   * @param indicesSize Number of indices.
+   * @return The number of unique edges.
+   */
+  static int CountUniqueEdges(const GLuint* indices, size_t indicesSize);
+
  private:
   ObjLoader();  ///< Constructor of the ObjLoader class.
 
+  /**
+   * @brief Structure for storing the location of a face line in the file.
+   */
+  struct FaceLine {
+    size_t offset;        ///< Offset of the line from the start of the file.
+    size_t length;        ///< Length of the line.
+    size_t verticesSize;  ///< Size of the vertices vector before the line.
+  };
+
+  /**
+   * @brief Reads the whole OBJ file into memory.
+   * @return Content of the file.
+   */
+  std::string ReadFile() const;
+
+  /**
+   * @brief Parses the content of the file into buffers from the allocator.
+   * @param content Content of the file.
+   * @param allocator Callback providing the output buffers.
+   */
+  void ParseContent(const std::string& content,
+                    const BufferAllocator& allocator);
+
+  /**
+   * @brief Parses the lines appended after the parsed content, growing the
+   * loader's own vectors.
+   * @param content Content of the file, starting with the parsed content.
+   */
+  void ParseAppendedLines(const std::string& content);
+
+  /**
+   * @brief Checks whether the content only adds lines to the parsed content.
+   * @param content New content of the file.
+   * @return true if the parsed content is an unchanged prefix of whole lines.
+   */
+  bool IsAppendedTo(const std::string& content) const;
+
+  /**
+   * @brief Resizes the loader's own vectors, the allocator of ParseFile().
+   * @param verticesSize Number of vertex coordinates.
+   * @param indicesSize Number of indices.
+   * @return View of the vectors.
+   */
+  BufferView AllocateOwnBuffers(size_t verticesSize, size_t indicesSize);
+
+  /**
+   * @brief Hashes a part of the file to detect changes of parsed content.
+   * @param data Content of the file.
+   * @param size Number of bytes to hash.
+   * @return 64-bit FNV-1a hash, taken over 8-byte words.
+   */
+  static std::uint64_t HashContent(const char* data, size_t size);
+
+  /**
+   * @brief Counts vertex coordinates and line indices of the file.
+   * @param content Content of the file.
+   * @return Pair of the vertex coordinates count and the indices count.
+   */
+  std::pair<size_t, size_t> CountRecords(const std::string& content) const;
+
+  /**
+   * @brief Parses vertex lines and collects the locations of face lines.
+   * @param content Content of the file.
+   * @return Locations of face lines in order of appearance.
+   */
+  std::vector<FaceLine> ParseVertices(const std::string& content);
+
   /**
    * @brief Parses a string representing a face.
    * @param line String containing face data.
+   * @param verticesSize Size of the vertices vector when the line appears in
+   * the file, faces may only reference vertices declared above them.
+   */
+  void ParseFace(const std::string& line, size_t verticesSize);
+
+  /**
+   * @brief Counts unique edges among the parsed faces.
    */
-  void ParseFace(const std::string& line);
+  void CountUniqueEdges();
+
+  /**
+   * @brief Calculates the center and the scaling factor of the model.
+   */
+  void ComputeBoundingBox();
 
   /**
    * @brief Clears the model data.
    */
   void ClearData();
 
+  /**
+   * @brief Reports the memory of the vertices and faces vectors.
+   */
+  void ReportMemory() const;
+
   std::string filename;           ///< Name of the OBJ file.
   std::vector<GLfloat> vertices;  ///< Vector for storing the model's vertices.
   std::vector<GLuint> faces;      ///< Vector for storing the model's faces.
-  std::set<Edge> uniqueEdges;     ///< Set of unique edges.
+  BufferView buffers;             ///< Buffers the model is parsed into.
+  size_t verticesWritten;         ///< Vertex coordinates written so far.
+  size_t indicesWritten;          ///< Indices written so far.
   int uniqueEdgesCount;           ///< Number of unique edges.
   GLfloat scaleFactor;            ///< Scaling factor.
   Vertex modelCenter;             ///< Center of the model.
+  size_t parsedBytes;             ///< Size of the parsed content, 0 if none.
+  std::uint64_t parsedHash;       ///< Hash of the parsed content.
+  LoadProgress progress;          ///< Receiver of progress reports.
 };
 
 }  // namespace s21
@@ -0,0 +1,126 @@
+/**
+ * @file s21_perf_counters.cpp
+ * @brief Hardware performance counters implementation.
+ */
+
+#include "s21_perf_counters.h"
+
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#endif
+
+namespace s21 {
+
+namespace {
+
+#ifdef __linux__
+constexpr std::uint64_t kEventConfigs[] = {
+    PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+    PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+
+/**
+ * @brief Opens a hardware counter of the calling thread.
+ * @param config Hardware event.
+ * @return File descriptor, -1 on failure with errno set.
+ */
+int OpenCounter(std::uint64_t config) {
+  perf_event_attr attributes;
+  std::memset(&attributes, 0, sizeof(attributes));
+  attributes.type = PERF_TYPE_HARDWARE;
+  attributes.size = sizeof(attributes);
+  attributes.config = config;
+  // User space only, which perf_event_paranoid up to 2 allows.
+  attributes.exclude_kernel = 1;
+  attributes.exclude_hv = 1;
+  attributes.read_format =
+      PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+  return static_cast<int>(syscall(SYS_perf_event_open, &attributes, 0, -1, -1,
+                                  PERF_FLAG_FD_CLOEXEC));
+}
+#endif
+
+}  // namespace
+
+PerfCounters::PerfCounters() {
+  descriptors.fill(-1);
+#ifdef __linux__
+  for (int i = 0; i < PerfCountersCount; ++i) {
+    descriptors[i] = OpenCounter(kEventConfigs[i]);
+    if (descriptors[i] < 0 && error.empty()) {
+      error = std::string(GetName(static_cast<PerfCounter>(i))) + ": " +
+              std::strerror(errno);
+    }
+  }
+#else
+  error = "perf_event_open is only available on Linux";
+#endif
+}
+
+PerfCounters::~PerfCounters() {
+  for (int descriptor : descriptors) {
+    if (descriptor >= 0) {
+      close(descriptor);
+    }
+  }
+}
+
+bool PerfCounters::IsAvailable(PerfCounter counter) const {
+  return descriptors[counter] >= 0;
+}
+
+bool PerfCounters::IsAnyAvailable() const {
+  for (int descriptor : descriptors) {
+    if (descriptor >= 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+const std::string& PerfCounters::GetError() const { return error; }
+
+PerfSample PerfCounters::Read() const {
+  PerfSample sample;
+  sample.fill(-1);
+  for (int i = 0; i < PerfCountersCount; ++i) {
+    // Value, time enabled and time running.
+    std::uint64_t values[3];
+    if (descriptors[i] < 0 ||
+        read(descriptors[i], values, sizeof(values)) != sizeof(values)) {
+      continue;
+    }
+    if (values[2] == 0) {
+      sample[i] = 0;
+    } else if (values[2] < values[1]) {
+      // The counter shared the hardware with others part of the time.
+      sample[i] = static_cast<std::int64_t>(
+          static_cast<double>(values[0]) * values[1] / values[2]);
+    } else {
+      sample[i] = static_cast<std::int64_t>(values[0]);
+    }
+  }
+  return sample;
+}
+
+const char* PerfCounters::GetName(PerfCounter counter) {
+  switch (counter) {
+    case CyclesCounter:
+      return "cycles";
+    case InstructionsCounter:
+      return "instructions";
+    case CacheMissesCounter:
+      return "cacheMisses";
+    case BranchMissesCounter:
+      return "branchMisses";
+    default:
+      return "unknown";
+  }
+}
+
+}  // namespace s21
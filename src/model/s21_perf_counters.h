@@ -0,0 +1,89 @@
+/**
+ * @file s21_perf_counters.h
+ * @brief Hardware performance counters header file.
+ */
+
+#ifndef S21_PERF_COUNTERS_H
+#define S21_PERF_COUNTERS_H
+
+#include <array>
+#include <cstdint>
+#include <string>
+
+namespace s21 {
+
+/**
+ * @brief Hardware events counted for the calling thread.
+ */
+enum PerfCounter {
+  CyclesCounter,        ///< CPU cycles.
+  InstructionsCounter,  ///< Retired instructions.
+  CacheMissesCounter,   ///< Last level cache misses.
+  BranchMissesCounter,  ///< Mispredicted branches.
+  PerfCountersCount     ///< Number of counters.
+};
+
+/**
+ * @brief Values of the counters at one moment, -1 for unavailable ones.
+ */
+using PerfSample = std::array<std::int64_t, PerfCountersCount>;
+
+/**
+ * @brief Counts hardware events of the calling thread in user space with
+ * perf_event_open.
+ * Every counter is opened on its own, so a counter the CPU or the hypervisor
+ * doesn't provide only disables itself. Containers usually forbid the system
+ * call, then no counter is available and Read() returns -1 for all of them.
+ */
+class PerfCounters {
+ public:
+  PerfCounters();   ///< Opens the counters for the calling thread.
+  ~PerfCounters();  ///< Closes the counters.
+  PerfCounters(const PerfCounters& other) = delete;
+  PerfCounters& operator=(const PerfCounters& other) = delete;
+
+  /**
+   * @brief Checks whether a counter could be opened.
+   * @param counter Hardware event.
+   * @return true if the counter is counting.
+   */
+  bool IsAvailable(PerfCounter counter) const;
+
+  /**
+   * @brief Checks whether any counter could be opened.
+   * @return true if at least one counter is counting.
+   */
+  bool IsAnyAvailable() const;
+
+  /**
+   * @brief Gets the reason the counters are unavailable.
+   * @return Error of the first counter that failed to open, empty if all
+   * are available.
+   */
+  const std::string& GetError() const;
+
+  /**
+   * @brief Reads the counters. Must be called on the thread that created
+   * the object.
+   * @return Counts since the counters were opened, scaled up if the kernel
+   * multiplexed them.
+   */
+  PerfSample Read() const;
+
+  /**
+   * @brief Gets the name of a counter for reports.
+   * @param counter Hardware event.
+   * @return Name of the counter.
+   */
+  static const char* GetName(PerfCounter counter);
+
+ private:
+  std::array<int, PerfCountersCount> descriptors;  ///< File descriptors of
+                                                   ///< the counters, -1 if
+                                                   ///< unavailable.
+  std::string error;  ///< Reason of the first failure.
+};
+
+}  // namespace s21
+
+#endif  // S21_PERF_COUNTERS_H
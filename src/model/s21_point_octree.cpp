@@ -0,0 +1,208 @@
+/**
+ * @file s21_point_octree.cpp
+ * @brief Level of detail octree of point clouds implementation.
+ */
+
+#include "s21_point_octree.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+
+#include "s21_obj_loader.h"
+
+namespace s21 {
+
+namespace {
+
+/**
+ * @brief Finds the child cube a point falls into.
+ * @param point Coordinates of the point.
+ * @param center Center of the parent cube.
+ * @return Octant, bit 0 set for the upper x half, bit 1 for y, bit 2 for z.
+ */
+int Octant(const GLfloat* point, const glm::vec3& center) {
+  return (point[0] >= center.x ? 1 : 0) | (point[1] >= center.y ? 2 : 0) |
+         (point[2] >= center.z ? 4 : 0);
+}
+
+}  // namespace
+
+void PointOctree::Build(GLfloat* points, size_t size) {
+  S21_TRACE_SCOPE("PointOctree::Build");
+  nodes.clear();
+  size_t pointsCount = size / 3;
+  if (pointsCount == 0) {
+    return;
+  }
+  BoundingBox box;
+  box.Extend(points, pointsCount * 3);
+  Vertex center = box.GetCenter();
+  GLfloat halfSize = std::max({box.maximum.X - box.minimum.X,
+                               box.maximum.Y - box.minimum.Y,
+                               box.maximum.Z - box.minimum.Z}) /
+                     2.0f;
+  // Coincident points still get a cube with a size on screen.
+  nodes.push_back({glm::vec3(center.X, center.Y, center.Z),
+                   std::max(halfSize, FLT_EPSILON), 0, 0, 0, 0});
+
+  std::vector<GLfloat> source(points, points + pointsCount * 3);
+  std::vector<GLuint> order(pointsCount);
+  std::iota(order.begin(), order.end(), 0);
+  std::vector<GLuint> scratch(pointsCount);
+  size_t written = 0;
+  auto write = [&](GLuint point) {
+    std::memcpy(points + written * 3, source.data() + point * 3,
+                3 * sizeof(GLfloat));
+    ++written;
+  };
+
+  struct Pending {
+    size_t node;   ///< Node receiving the points.
+    size_t begin;  ///< First point of the node in order.
+    size_t end;    ///< Past the last point of the node in order.
+    int depth;     ///< Depth of the node.
+  };
+  // Nodes are split in the order they were created, which is breadth first.
+  std::vector<Pending> pending{{0, 0, pointsCount, 0}};
+  for (size_t head = 0; head < pending.size(); ++head) {
+    Pending task = pending[head];
+    size_t count = task.end - task.begin;
+    nodes[task.node].first = written;
+    if (count <= kNodePoints || task.depth == kMaxDepth) {
+      for (size_t i = task.begin; i < task.end; ++i) {
+        write(order[i]);
+      }
+      nodes[task.node].count = count;
+      continue;
+    }
+    // Every count / kNodePoints-th point stays in the node, they are untouched
+    // by the swaps before them.
+    for (size_t i = 0; i < kNodePoints; ++i) {
+      std::swap(order[task.begin + i],
+                order[task.begin + i * count / kNodePoints]);
+      write(order[task.begin + i]);
+    }
+    nodes[task.node].count = kNodePoints;
+
+    OctreeNode parent = nodes[task.node];
+    size_t restBegin = task.begin + kNodePoints;
+    size_t octantSizes[8] = {};
+    for (size_t i = restBegin; i < task.end; ++i) {
+      ++octantSizes[Octant(source.data() + order[i] * 3, parent.center)];
+    }
+    size_t octantStarts[8];
+    std::exclusive_scan(octantSizes, octantSizes + 8, octantStarts, restBegin);
+    for (size_t i = restBegin; i < task.end; ++i) {
+      int octant = Octant(source.data() + order[i] * 3, parent.center);
+      scratch[octantStarts[octant]++] = order[i];
+    }
+    std::copy(scratch.begin() + restBegin, scratch.begin() + task.end,
+              order.begin() + restBegin);
+
+    GLfloat childHalf = parent.halfSize / 2.0f;
+    nodes[task.node].firstChild = nodes.size();
+    size_t childBegin = restBegin;
+    for (int octant = 0; octant < 8; ++octant) {
+      if (octantSizes[octant] == 0) {
+        continue;
+      }
+      glm::vec3 offset((octant & 1) ? childHalf : -childHalf,
+                       (octant & 2) ? childHalf : -childHalf,
+                       (octant & 4) ? childHalf : -childHalf);
+      nodes.push_back({parent.center + offset, childHalf, 0, 0, 0, 0});
+      pending.push_back({nodes.size() - 1, childBegin,
+                         childBegin + octantSizes[octant], task.depth + 1});
+      nodes[task.node].childrenCount++;
+      childBegin += octantSizes[octant];
+    }
+  }
+}
+
+void PointOctree::Clear() { nodes.clear(); }
+
+void PointOctree::Select(const glm::mat4& modelView,
+                         const glm::mat4& projection, int height,
+                         size_t budget, PointSelection& selection) const {
+  selection.firsts.clear();
+  selection.counts.clear();
+  selection.points = 0;
+  std::vector<std::pair<GLfloat, size_t>>& queue = selection.queue;
+  queue.clear();
+  if (nodes.empty() || height <= 0) {
+    return;
+  }
+  GLfloat rootRadius = NodeRadius(nodes[0], modelView, projection, height);
+  if (rootRadius >= 0.0f) {
+    queue.emplace_back(rootRadius, 0);
+  }
+  while (!queue.empty()) {
+    std::pop_heap(queue.begin(), queue.end());
+    auto [radius, index] = queue.back();
+    queue.pop_back();
+    const OctreeNode& node = nodes[index];
+    if (selection.points + node.count > budget) {
+      continue;
+    }
+    selection.firsts.push_back(static_cast<GLint>(node.first));
+    selection.counts.push_back(static_cast<GLsizei>(node.count));
+    selection.points += node.count;
+    // The points of a node spread over its projection, about the square root
+    // of their number fall on a line across it.
+    GLfloat spacing =
+        2.0f * radius / std::sqrt(static_cast<GLfloat>(node.count));
+    if (spacing <= kMinSpacingPixels) {
+      continue;
+    }
+    for (size_t child = node.firstChild;
+         child < node.firstChild + node.childrenCount; ++child) {
+      GLfloat childRadius =
+          NodeRadius(nodes[child], modelView, projection, height);
+      if (childRadius >= 0.0f) {
+        queue.emplace_back(childRadius, child);
+        std::push_heap(queue.begin(), queue.end());
+      }
+    }
+  }
+}
+
+const std::vector<OctreeNode>& PointOctree::GetNodes() const { return nodes; }
+
+GLfloat PointOctree::NodeRadius(const OctreeNode& node,
+                                const glm::mat4& modelView,
+                                const glm::mat4& projection, int height) {
+  return ScreenRadius(node.center, node.halfSize * std::sqrt(3.0f), modelView,
+                      projection, height);
+}
+
+GLfloat ScreenRadius(const glm::vec3& center, GLfloat radius,
+                     const glm::mat4& modelView, const glm::mat4& projection,
+                     int height) {
+  glm::vec4 eye = modelView * glm::vec4(center, 1.0f);
+  // The view is rigid and the model is scaled alike along all axes.
+  radius *= glm::length(glm::vec3(modelView[0]));
+  // Only a perspective projection divides by the depth.
+  if (projection[3][3] == 0.0f) {
+    // The camera looks along -z, the whole sphere is behind it.
+    if (eye.z - radius >= 0.0f) {
+      return -1.0f;
+    }
+    if (-eye.z <= radius) {
+      return FLT_MAX;
+    }
+  }
+  glm::vec4 clip = projection * eye;
+  GLfloat radiusX = radius * std::abs(projection[0][0]) / clip.w;
+  GLfloat radiusY = radius * std::abs(projection[1][1]) / clip.w;
+  GLfloat x = clip.x / clip.w;
+  GLfloat y = clip.y / clip.w;
+  if (x - radiusX > 1.0f || x + radiusX < -1.0f || y - radiusY > 1.0f ||
+      y + radiusY < -1.0f) {
+    return -1.0f;
+  }
+  return radiusY * height / 2.0f;
+}
+
+}  // namespace s21
@@ -0,0 +1,126 @@
+/**
+ * @file s21_point_octree.h
+ * @brief Level of detail octree of point clouds header file.
+ */
+
+#ifndef S21_POINT_OCTREE_H
+#define S21_POINT_OCTREE_H
+
+#include <GL/gl.h>
+
+#include <cstddef>
+#include <glm/glm.hpp>
+#include <utility>
+#include <vector>
+
+namespace s21 {
+
+/**
+ * @brief Cube of the octree and the points it draws.
+ */
+struct OctreeNode {
+  glm::vec3 center;      ///< Center of the cube.
+  GLfloat halfSize;      ///< Half the side of the cube.
+  size_t first;          ///< First point of the node in the ordered points.
+  size_t count;          ///< Number of points of the node.
+  size_t firstChild;     ///< Index of the first child, 0 for a leaf.
+  size_t childrenCount;  ///< Number of non-empty children, stored in a row.
+};
+
+/**
+ * @brief Ranges of points chosen for a frame, ready for glMultiDrawArrays().
+ * Kept by the caller between frames, so selecting doesn't allocate once the
+ * vectors have grown.
+ */
+struct PointSelection {
+  std::vector<GLint> firsts;    ///< First point of every range.
+  std::vector<GLsizei> counts;  ///< Number of points of every range.
+  size_t points = 0;            ///< Points in all ranges together.
+  std::vector<std::pair<GLfloat, size_t>>
+      queue;  ///< Scratch heap of nodes by their size on screen.
+};
+
+/**
+ * @brief Measures a bounding sphere on screen.
+ * @param center Center of the sphere in model coordinates.
+ * @param radius Radius of the sphere in model coordinates.
+ * @param modelView Model and view matrices multiplied together.
+ * @param projection Projection matrix.
+ * @param height Height of the viewport in pixels.
+ * @return Radius of the sphere in pixels, negative if it is outside of the
+ * view.
+ */
+GLfloat ScreenRadius(const glm::vec3& center, GLfloat radius,
+                     const glm::mat4& modelView, const glm::mat4& projection,
+                     int height);
+
+/**
+ * @brief Octree over the vertices of a model without faces.
+ * An inner node keeps an even sample of the points inside its cube, the
+ * children hold the rest, so drawing a node and any of its ancestors gives
+ * a coarser or finer version of the same region. Points are reordered
+ * breadth first: every node is one contiguous range, coarse levels come
+ * first, so a prefix of the buffer is a complete low detail cloud and
+ * ranges can be streamed from disk or to the GPU independently.
+ */
+class PointOctree {
+ public:
+  static constexpr size_t kNodePoints = 4096;  ///< Points of an inner node.
+  static constexpr int kMaxDepth = 21;  ///< Depth where nodes stop splitting,
+                                        ///< so duplicates end in a leaf.
+  static constexpr GLfloat kMinSpacingPixels =
+      1.0f;  ///< Nodes are refined while their points are further apart on
+             ///< screen.
+
+  /**
+   * @brief Builds the octree and reorders the points into node order.
+   * @param points Vertex coordinates, three per vertex, reordered in place.
+   * @param size Number of vertex coordinates.
+   */
+  void Build(GLfloat* points, size_t size);
+
+  /**
+   * @brief Removes all nodes.
+   */
+  void Clear();
+
+  /**
+   * @brief Chooses the nodes drawn in a frame. Visible nodes are taken from
+   * the largest on screen down while their points fit the budget, a node's
+   * children are only considered while its points are further apart than
+   * kMinSpacingPixels.
+   * @param modelView Model and view matrices multiplied together.
+   * @param projection Projection matrix.
+   * @param height Height of the viewport in pixels.
+   * @param budget Largest number of points to select.
+   * @param selection Receives the ranges of the chosen nodes.
+   */
+  void Select(const glm::mat4& modelView, const glm::mat4& projection,
+              int height, size_t budget, PointSelection& selection) const;
+
+  /**
+   * @brief Gets the nodes, the root first, children after their parents.
+   * @return Constant reference to the vector of nodes.
+   */
+  const std::vector<OctreeNode>& GetNodes() const;
+
+ private:
+  /**
+   * @brief Measures a node on screen.
+   * @param node Node to measure.
+   * @param modelView Model and view matrices multiplied together.
+   * @param projection Projection matrix.
+   * @param height Height of the viewport in pixels.
+   * @return Radius of the node's bounding sphere in pixels, negative if the
+   * node is outside of the view.
+   */
+  static GLfloat NodeRadius(const OctreeNode& node,
+                            const glm::mat4& modelView,
+                            const glm::mat4& projection, int height);
+
+  std::vector<OctreeNode> nodes;  ///< Nodes in breadth first order.
+};
+
+}  // namespace s21
+
+#endif  // S21_POINT_OCTREE_H
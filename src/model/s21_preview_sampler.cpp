@@ -0,0 +1,89 @@
+/**
+ * @file s21_preview_sampler.cpp
+ * @brief Sparse sampling of .obj files for a quick preview implementation.
+ */
+
+#include "s21_preview_sampler.h"
+
+#include <cstdlib>
+#include <random>
+
+namespace s21 {
+
+PreviewSampler::PreviewSampler(size_t slicesCount, size_t sliceSize)
+    : slices(std::max<size_t>(slicesCount, 1)),
+      sliceBytes(std::max<size_t>(sliceSize, 1)) {}
+
+PreviewCloud PreviewSampler::Sample(const std::string& filename) const {
+  S21_TRACE_SCOPE("PreviewSampler::Sample");
+  PreviewCloud cloud;
+  std::ifstream file(filename, std::ios::binary | std::ios::ate);
+  if (!file.is_open()) {
+    return cloud;
+  }
+  size_t fileSize = static_cast<size_t>(file.tellg());
+  std::string slice;
+  if (fileSize <= slices * sliceBytes) {
+    slice.resize(fileSize);
+    file.seekg(0);
+    file.read(slice.data(), fileSize);
+    ParseSlice(slice, true, true, cloud);
+    return cloud;
+  }
+  // The same file is sampled the same way, so previews are reproducible.
+  std::mt19937_64 random(fileSize);
+  size_t stride = fileSize / slices;
+  slice.resize(sliceBytes);
+  for (size_t i = 0; i < slices; ++i) {
+    size_t jitter = stride > sliceBytes ? random() % (stride - sliceBytes) : 0;
+    size_t offset = i * stride + jitter;
+    size_t size = std::min(sliceBytes, fileSize - offset);
+    slice.resize(size);
+    file.seekg(static_cast<std::streamoff>(offset));
+    if (!file.read(slice.data(), size)) {
+      break;
+    }
+    ParseSlice(slice, offset == 0, offset + size == fileSize, cloud);
+  }
+  return cloud;
+}
+
+void PreviewSampler::ParseSlice(const std::string& slice, bool fromStart,
+                                bool toEnd, PreviewCloud& cloud) {
+  size_t lineStart = 0;
+  if (!fromStart) {
+    // The slice starts inside a line, which is skipped.
+    lineStart = slice.find('\n');
+    lineStart = lineStart == std::string::npos ? slice.size() : lineStart + 1;
+  }
+  while (lineStart < slice.size()) {
+    size_t lineEnd = slice.find('\n', lineStart);
+    if (lineEnd == std::string::npos) {
+      if (!toEnd) {
+        break;
+      }
+      lineEnd = slice.size();
+    }
+    if (lineEnd - lineStart > 2 && slice[lineStart] == 'v' &&
+        (slice[lineStart + 1] == ' ' || slice[lineStart + 1] == '\t')) {
+      // strtof stops at the line break, the string is null-terminated.
+      const char* position = slice.c_str() + lineStart + 2;
+      GLfloat vertex[3];
+      bool parsed = true;
+      for (GLfloat& coordinate : vertex) {
+        char* end = nullptr;
+        coordinate = std::strtof(position, &end);
+        parsed = parsed && end != position &&
+                 end <= slice.c_str() + lineEnd;
+        position = end;
+      }
+      if (parsed) {
+        cloud.points.insert(cloud.points.end(), vertex, vertex + 3);
+        cloud.box.Extend(vertex, 3);
+      }
+    }
+    lineStart = lineEnd + 1;
+  }
+}
+
+}  // namespace s21
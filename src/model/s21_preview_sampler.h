@@ -0,0 +1,74 @@
+/**
+ * @file s21_preview_sampler.h
+ * @brief Sparse sampling of .obj files for a quick preview header file.
+ */
+
+#ifndef S21_PREVIEW_SAMPLER_H
+#define S21_PREVIEW_SAMPLER_H
+
+#include <GL/gl.h>
+
+#include <string>
+#include <vector>
+
+#include "s21_obj_loader.h"
+
+namespace s21 {
+
+/**
+ * @brief Vertices sampled from a file before it is parsed.
+ */
+struct PreviewCloud {
+  std::vector<GLfloat> points;  ///< Sampled vertex coordinates, three per
+                                ///< vertex, not normalized.
+  BoundingBox box;              ///< Bounds of the sampled vertices.
+};
+
+/**
+ * @brief Reads a few slices of an .obj file at random offsets and parses
+ * the vertices found in them, so the shape and the bounds of a huge model are
+ * known long before the whole file is parsed.
+ */
+class PreviewSampler {
+ public:
+  static constexpr size_t kDefaultSlices = 64;  ///< Slices read by default.
+  static constexpr size_t kDefaultSliceBytes =
+      64 << 10;  ///< Size of a slice by default.
+
+  /**
+   * @brief Constructor of the PreviewSampler class.
+   * @param slicesCount Number of slices read from the file.
+   * @param sliceSize Size of a slice in bytes.
+   */
+  explicit PreviewSampler(size_t slicesCount = kDefaultSlices,
+                          size_t sliceSize = kDefaultSliceBytes);
+
+  /**
+   * @brief Samples the vertices of a file. Slices are spread evenly over the
+   * file with a random offset inside their part, a file smaller than all
+   * slices together is read whole. Only complete "v" lines are parsed, lines
+   * that fail to parse are skipped.
+   * @param filename Name of the .obj file.
+   * @return Sampled vertices, empty if the file can't be read.
+   */
+  PreviewCloud Sample(const std::string& filename) const;
+
+ private:
+  /**
+   * @brief Parses the complete vertex lines of a slice.
+   * @param slice Bytes of the slice.
+   * @param fromStart Whether the slice starts at the beginning of a line.
+   * @param toEnd Whether the slice ends at the end of the file, so its last
+   * line is complete without a line break.
+   * @param cloud Cloud receiving the vertices.
+   */
+  static void ParseSlice(const std::string& slice, bool fromStart, bool toEnd,
+                         PreviewCloud& cloud);
+
+  size_t slices;      ///< Number of slices read from the file.
+  size_t sliceBytes;  ///< Size of a slice in bytes.
+};
+
+}  // namespace s21
+
+#endif  // S21_PREVIEW_SAMPLER_H
@@ -0,0 +1,130 @@
+/**
+ * @file s21_startup_timer.cpp
+ * @brief Time-to-first-frame measurement implementation.
+ */
+
+#include "s21_startup_timer.h"
+
+#include <unistd.h>
+
+#include <fstream>
+#include <sstream>
+
+namespace s21 {
+
+namespace {
+
+/**
+ * @brief Moment the static objects of the program were initialized.
+ */
+const StartupTimer::Clock::time_point staticInitTime =
+    StartupTimer::Clock::now();
+
+/**
+ * @brief Estimates the moment the process was started. The kernel knows it
+ * in clock ticks, which also counts the dynamic linking of Qt before the
+ * static initialization.
+ * @return Start of the process, the static initialization time if the kernel
+ * doesn't tell.
+ */
+StartupTimer::Clock::time_point ProcessStart() {
+  std::ifstream statFile("/proc/self/stat");
+  std::ifstream uptimeFile("/proc/uptime");
+  std::string stat;
+  double uptime = 0.0;
+  long ticksPerSecond = sysconf(_SC_CLK_TCK);
+  if (!std::getline(statFile, stat) || !(uptimeFile >> uptime) ||
+      ticksPerSecond <= 0) {
+    return staticInitTime;
+  }
+  // The command name in parentheses may contain spaces, the start time is
+  // the 20th field after it.
+  std::istringstream fields(stat.substr(stat.rfind(')') + 2));
+  std::string field;
+  for (int i = 0; i < 19 && fields >> field; ++i) {
+  }
+  unsigned long long startTicks = 0;
+  if (!(fields >> startTicks)) {
+    return staticInitTime;
+  }
+  double sinceStart =
+      uptime - static_cast<double>(startTicks) / ticksPerSecond;
+  if (sinceStart < 0.0 || sinceStart > 60.0) {
+    return staticInitTime;
+  }
+  StartupTimer::Clock::time_point start =
+      StartupTimer::Clock::now() -
+      std::chrono::duration_cast<StartupTimer::Clock::duration>(
+          std::chrono::duration<double>(sinceStart));
+  return start < staticInitTime ? start : staticInitTime;
+}
+
+}  // namespace
+
+StartupTimer::StartupTimer() : origin(ProcessStart()), shaderCacheHit(false) {
+  for (std::atomic<long long>& phaseUs : phasesUs) {
+    phaseUs.store(-1);
+  }
+}
+
+StartupTimer& StartupTimer::Instance() {
+  static StartupTimer startupTimerInstance;
+  return startupTimerInstance;
+}
+
+bool StartupTimer::Mark(StartupPhase phase) {
+  long long us = std::chrono::duration_cast<std::chrono::microseconds>(
+                     Clock::now() - origin)
+                     .count();
+  long long expected = -1;
+  return phasesUs[phase].compare_exchange_strong(expected, us);
+}
+
+double StartupTimer::GetMs(StartupPhase phase) const {
+  long long us = phasesUs[phase].load();
+  return us < 0 ? -1.0 : us / 1000.0;
+}
+
+void StartupTimer::SetShaderCacheHit(bool hit) { shaderCacheHit.store(hit); }
+
+bool StartupTimer::IsShaderCacheHit() const { return shaderCacheHit.load(); }
+
+bool StartupTimer::WriteReport(const std::string& filename) const {
+  std::ofstream file(filename);
+  if (!file.is_open()) {
+    return false;
+  }
+  file << "{\"shaderCacheHit\":" << (IsShaderCacheHit() ? "true" : "false")
+       << ",\"phasesMs\":{";
+  for (int i = 0; i < StartupPhasesCount; ++i) {
+    double ms = GetMs(static_cast<StartupPhase>(i));
+    file << (i == 0 ? "" : ",") << '"'
+         << GetName(static_cast<StartupPhase>(i)) << "\":";
+    if (ms < 0.0) {
+      file << "null";
+    } else {
+      file << ms;
+    }
+  }
+  file << "}}\n";
+  return file.good();
+}
+
+const char* StartupTimer::GetName(StartupPhase phase) {
+  switch (phase) {
+    case MainEntered:
+      return "mainEntered";
+    case WindowCreated:
+      return "windowCreated";
+    case ShadersReady:
+      return "shadersReady";
+    case FirstFrameRendered:
+      return "firstFrameRendered";
+    case FirstFramePresented:
+      return "firstFramePresented";
+    default:
+      return "unknown";
+  }
+}
+
+}  // namespace s21
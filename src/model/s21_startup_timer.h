@@ -0,0 +1,103 @@
+/**
+ * @file s21_startup_timer.h
+ * @brief Time-to-first-frame measurement header file.
+ */
+
+#ifndef S21_STARTUP_TIMER_H
+#define S21_STARTUP_TIMER_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <string>
+
+namespace s21 {
+
+/**
+ * @brief Milestones of the application startup, in the order they are
+ * reached.
+ */
+enum StartupPhase {
+  MainEntered,          ///< main() started.
+  WindowCreated,        ///< Main window constructed, settings applied.
+  ShadersReady,         ///< Shader program linked or loaded from the cache.
+  FirstFrameRendered,   ///< Render thread published its first frame.
+  FirstFramePresented,  ///< Widget swapped its first rendered frame.
+  StartupPhasesCount    ///< Number of phases.
+};
+
+/**
+ * @brief Records when each startup phase is reached, relative to the start
+ * of the process. Phases can be marked from any thread, only the first
+ * mark of a phase counts.
+ */
+class StartupTimer {
+ public:
+  using Clock = std::chrono::steady_clock;  ///< Clock of the measurements.
+
+  StartupTimer(const StartupTimer& other) = delete;  ///< Disable copying.
+  StartupTimer(StartupTimer&& other) = delete;       ///< Disable moving.
+  StartupTimer& operator=(const StartupTimer& other) =
+      delete;  ///< Disable copy assignment.
+  StartupTimer& operator=(StartupTimer&& other) =
+      delete;                 ///< Disable move assignment.
+  ~StartupTimer() = default;  ///< Default destructor.
+
+  /**
+   * @brief Gets the instance of the StartupTimer class (singleton).
+   * @return Reference to the StartupTimer instance.
+   */
+  static StartupTimer& Instance();
+
+  /**
+   * @brief Records the current moment as the time of a phase.
+   * @param phase Reached phase.
+   * @return true if the phase was reached for the first time.
+   */
+  bool Mark(StartupPhase phase);
+
+  /**
+   * @brief Gets the time a phase was reached.
+   * @param phase Startup phase.
+   * @return Milliseconds since the process started, -1 if not reached.
+   */
+  double GetMs(StartupPhase phase) const;
+
+  /**
+   * @brief Records whether the shader program came from the binary cache.
+   * @param hit true if the cached binary was loaded.
+   */
+  void SetShaderCacheHit(bool hit);
+
+  /**
+   * @brief Checks whether the shader program came from the binary cache.
+   * @return true if the cached binary was loaded.
+   */
+  bool IsShaderCacheHit() const;
+
+  /**
+   * @brief Writes the phases as a JSON object.
+   * @param filename Output file name.
+   * @return true if the file was written, false otherwise.
+   */
+  bool WriteReport(const std::string& filename) const;
+
+  /**
+   * @brief Gets the name of a phase for reports.
+   * @param phase Startup phase.
+   * @return Name of the phase.
+   */
+  static const char* GetName(StartupPhase phase);
+
+ private:
+  StartupTimer();  ///< Constructor of the StartupTimer class.
+
+  Clock::time_point origin;  ///< Start of the process.
+  std::array<std::atomic<long long>, StartupPhasesCount>
+      phasesUs;  ///< Times of the phases in microseconds, -1 if not reached.
+  std::atomic<bool> shaderCacheHit;  ///< Whether the shader binary was cached.
+};
+
+}  // namespace s21
+
+#endif  // S21_STARTUP_TIMER_H
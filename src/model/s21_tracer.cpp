@@ -0,0 +1,256 @@
+/**
+ * @file s21_tracer.cpp
+ * @brief Trace-event recorder implementation.
+ */
+
+#include "s21_tracer.h"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+namespace s21 {
+
+Tracer::~Tracer() {
+  if (IsEnabled()) {
+    Stop();
+  }
+}
+
+Tracer& Tracer::Instance() {
+  static Tracer tracerInstance;
+  return tracerInstance;
+}
+
+void Tracer::Start(const std::string& outputFilename,
+                   const std::string& countersFilename) {
+  std::lock_guard<std::mutex> lock(eventsMutex);
+  events.clear();
+  filename = outputFilename;
+  this->countersFilename = countersFilename;
+  countersError.clear();
+  origin = Clock::now();
+  countersEnabled.store(!countersFilename.empty(), std::memory_order_relaxed);
+  enabled.store(true, std::memory_order_relaxed);
+}
+
+bool Tracer::Stop() {
+  enabled.store(false, std::memory_order_relaxed);
+  countersEnabled.store(false, std::memory_order_relaxed);
+  std::lock_guard<std::mutex> lock(eventsMutex);
+  if (!countersFilename.empty() && !WriteCountersSummary()) {
+    return false;
+  }
+  std::ofstream file(filename);
+  if (!file.is_open()) {
+    return false;
+  }
+  int pid = static_cast<int>(getpid());
+  file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+  bool first = true;
+  for (const auto& [threadId, name] : threadNames) {
+    file << (first ? "" : ",") << "\n{\"name\":\"thread_name\",\"ph\":\"M\","
+         << "\"pid\":" << pid << ",\"tid\":" << threadId
+         << ",\"args\":{\"name\":\"" << name << "\"}}";
+    first = false;
+  }
+  for (const TraceEvent& event : events) {
+    file << (first ? "" : ",") << "\n{\"name\":\"" << event.name
+         << "\",\"cat\":\"s21\",\"ph\":\"X\",\"ts\":" << event.startUs
+         << ",\"dur\":" << event.durationUs << ",\"pid\":" << pid
+         << ",\"tid\":" << event.threadId;
+    bool hasArgs = false;
+    for (int i = 0; i < PerfCountersCount; ++i) {
+      if (event.counters[i] >= 0) {
+        file << (hasArgs ? "," : ",\"args\":{") << '"'
+             << PerfCounters::GetName(static_cast<PerfCounter>(i))
+             << "\":" << event.counters[i];
+        hasArgs = true;
+      }
+    }
+    file << (hasArgs ? "}}" : "}");
+    first = false;
+  }
+  file << "\n]}\n";
+  return file.good();
+}
+
+void Tracer::SetVerticesCount(std::size_t count) {
+  verticesCount.store(count, std::memory_order_relaxed);
+}
+
+void Tracer::AddEvent(const char* name, Clock::time_point start,
+                      Clock::time_point end) {
+  PerfSample counters;
+  counters.fill(-1);
+  AddEvent(name, start, end, counters);
+}
+
+void Tracer::AddEvent(const char* name, Clock::time_point start,
+                      Clock::time_point end, const PerfSample& counters) {
+  using std::chrono::duration_cast;
+  using std::chrono::microseconds;
+  TraceEvent event{name,
+                   duration_cast<microseconds>(start - origin).count(),
+                   duration_cast<microseconds>(end - start).count(),
+                   ThreadId(),
+                   counters,
+                   verticesCount.load(std::memory_order_relaxed)};
+  std::lock_guard<std::mutex> lock(eventsMutex);
+  events.push_back(event);
+}
+
+const PerfCounters& Tracer::ThreadCounters() {
+  thread_local PerfCounters counters;
+  thread_local bool errorReported = false;
+  if (!errorReported) {
+    errorReported = true;
+    if (!counters.GetError().empty()) {
+      std::lock_guard<std::mutex> lock(eventsMutex);
+      if (countersError.empty()) {
+        countersError = counters.GetError();
+      }
+    }
+  }
+  return counters;
+}
+
+void Tracer::SetThreadName(const std::string& name) {
+  std::lock_guard<std::mutex> lock(eventsMutex);
+  threadNames.emplace_back(ThreadId(), name);
+}
+
+std::size_t Tracer::GetEventsCount() const {
+  std::lock_guard<std::mutex> lock(eventsMutex);
+  return events.size();
+}
+
+unsigned Tracer::ThreadId() {
+  static std::atomic<unsigned> threadsCount{0};
+  thread_local unsigned threadId = ++threadsCount;
+  return threadId;
+}
+
+Tracer::Tracer()
+    : enabled(false),
+      countersEnabled(false),
+      verticesCount(0),
+      origin(Clock::now()) {}
+
+bool Tracer::WriteCountersSummary() const {
+  /**
+   * @brief Totals of the spans sharing a name.
+   */
+  struct Phase {
+    const char* name;      ///< Name of the spans.
+    std::size_t calls;     ///< Number of spans.
+    long long durationUs;  ///< Total duration in microseconds.
+    std::size_t vertices;  ///< Vertices of the last span.
+    PerfSample counters;   ///< Total counts, -1 if unavailable.
+  };
+  std::vector<Phase> phases;
+  for (const TraceEvent& event : events) {
+    auto phase = phases.begin();
+    while (phase != phases.end() && std::strcmp(phase->name, event.name) != 0) {
+      ++phase;
+    }
+    if (phase == phases.end()) {
+      PerfSample counters;
+      counters.fill(-1);
+      phases.push_back({event.name, 0, 0, 0, counters});
+      phase = phases.end() - 1;
+    }
+    phase->calls++;
+    phase->durationUs += event.durationUs;
+    phase->vertices = event.vertices;
+    for (int i = 0; i < PerfCountersCount; ++i) {
+      if (event.counters[i] >= 0) {
+        phase->counters[i] = std::max<std::int64_t>(phase->counters[i], 0) +
+                             event.counters[i];
+      }
+    }
+  }
+
+  std::ofstream file(countersFilename);
+  if (!file.is_open()) {
+    return false;
+  }
+  bool available = false;
+  for (const Phase& phase : phases) {
+    for (std::int64_t count : phase.counters) {
+      available = available || count >= 0;
+    }
+  }
+  file << "{\"available\":" << (available ? "true" : "false")
+       << ",\"error\":\"" << countersError << "\",\"phases\":[";
+  for (std::size_t i = 0; i < phases.size(); ++i) {
+    const Phase& phase = phases[i];
+    file << (i == 0 ? "" : ",") << "\n{\"name\":\"" << phase.name
+         << "\",\"calls\":" << phase.calls
+         << ",\"ms\":" << phase.durationUs / 1000.0
+         << ",\"vertices\":" << phase.vertices;
+    for (int j = 0; j < PerfCountersCount; ++j) {
+      file << ",\"" << PerfCounters::GetName(static_cast<PerfCounter>(j))
+           << "\":";
+      if (phase.counters[j] >= 0) {
+        file << phase.counters[j];
+      } else {
+        file << "null";
+      }
+    }
+    std::int64_t cycles = phase.counters[CyclesCounter];
+    std::int64_t instructions = phase.counters[InstructionsCounter];
+    file << ",\"ipc\":";
+    if (cycles > 0 && instructions >= 0) {
+      file << static_cast<double>(instructions) / cycles;
+    } else {
+      file << "null";
+    }
+    for (PerfCounter counter : {CacheMissesCounter, BranchMissesCounter}) {
+      file << ",\"" << PerfCounters::GetName(counter) << "PerVertex\":";
+      if (phase.vertices > 0 && phase.counters[counter] >= 0) {
+        file << static_cast<double>(phase.counters[counter]) / phase.vertices;
+      } else {
+        file << "null";
+      }
+    }
+    file << "}";
+  }
+  file << "\n]}\n";
+  return file.good();
+}
+
+TraceScope::TraceScope(const char* name)
+    : scopeName(name != nullptr && Tracer::Instance().IsEnabled() ? name
+                                                                  : nullptr) {
+  if (scopeName != nullptr) {
+    if (Tracer::Instance().CountersEnabled()) {
+      startCounters = Tracer::Instance().ThreadCounters().Read();
+    } else {
+      startCounters.fill(-1);
+    }
+    start = Tracer::Clock::now();
+  }
+}
+
+TraceScope::~TraceScope() {
+  if (scopeName == nullptr) {
+    return;
+  }
+  Tracer::Clock::time_point end = Tracer::Clock::now();
+  PerfSample counters;
+  counters.fill(-1);
+  if (Tracer::Instance().CountersEnabled()) {
+    PerfSample endCounters = Tracer::Instance().ThreadCounters().Read();
+    for (int i = 0; i < PerfCountersCount; ++i) {
+      if (startCounters[i] >= 0 && endCounters[i] >= 0) {
+        counters[i] = endCounters[i] - startCounters[i];
+      }
+    }
+  }
+  Tracer::Instance().AddEvent(scopeName, start, end, counters);
+}
+
+}  // namespace s21
@@ -0,0 +1,190 @@
+/**
+ * @file s21_tracer.h
+ * @brief Trace-event recorder header file.
+ */
+
+#ifndef S21_TRACER_H
+#define S21_TRACER_H
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "s21_perf_counters.h"
+
+namespace s21 {
+
+/**
+ * @brief Records named time spans and writes them as Chrome trace-event
+ * JSON, which can be opened in chrome://tracing or Perfetto.
+ * While tracing is disabled every scope costs one relaxed atomic load.
+ */
+class Tracer {
+ public:
+  using Clock = std::chrono::steady_clock;  ///< Clock used for timestamps.
+
+  Tracer(const Tracer& other) = delete;             ///< Disable copying.
+  Tracer(Tracer&& other) = delete;                  ///< Disable moving.
+  Tracer& operator=(const Tracer& other) = delete;  ///< Disable copy assignment.
+  Tracer& operator=(Tracer&& other) = delete;       ///< Disable move assignment.
+  ~Tracer();  ///< Writes the trace if it is still being recorded.
+
+  /**
+   * @brief Gets the instance of the Tracer class (singleton).
+   * @return Reference to the Tracer instance.
+   */
+  static Tracer& Instance();
+
+  /**
+   * @brief Discards recorded events and starts recording.
+   * @param outputFilename Name of the .json file written by Stop().
+   * @param countersFilename Name of the .json summary of hardware counters
+   * per span written by Stop(), empty to record no counters.
+   */
+  void Start(const std::string& outputFilename,
+             const std::string& countersFilename = "");
+
+  /**
+   * @brief Stops recording and writes the recorded events.
+   * @return true if the files were written, false otherwise.
+   */
+  bool Stop();
+
+  /**
+   * @brief Checks whether spans record hardware counters.
+   * @return true if counters were requested by Start().
+   */
+  bool CountersEnabled() const {
+    return countersEnabled.load(std::memory_order_relaxed);
+  }
+
+  /**
+   * @brief Sets the number of vertices of the model being processed, the
+   * counters of the following spans are normalized by it.
+   * @param count Number of vertices.
+   */
+  void SetVerticesCount(std::size_t count);
+
+  /**
+   * @brief Checks whether events are being recorded.
+   * @return true if tracing is enabled.
+   */
+  bool IsEnabled() const { return enabled.load(std::memory_order_relaxed); }
+
+  /**
+   * @brief Records a complete event.
+   * @param name Name of the event, must outlive the tracer (string literal).
+   * @param start Start of the span.
+   * @param end End of the span.
+   */
+  void AddEvent(const char* name, Clock::time_point start,
+                Clock::time_point end);
+
+  /**
+   * @brief Records a complete event with the hardware events counted in it.
+   * @param name Name of the event, must outlive the tracer (string literal).
+   * @param start Start of the span.
+   * @param end End of the span.
+   * @param counters Counts of the span, -1 for unavailable counters.
+   */
+  void AddEvent(const char* name, Clock::time_point start,
+                Clock::time_point end, const PerfSample& counters);
+
+  /**
+   * @brief Gets the hardware counters of the calling thread, opened on the
+   * first call.
+   * @return Counters of the thread.
+   */
+  const PerfCounters& ThreadCounters();
+
+  /**
+   * @brief Names the calling thread's track in the trace.
+   * @param name Name of the thread.
+   */
+  void SetThreadName(const std::string& name);
+
+  /**
+   * @brief Gets the number of recorded events.
+   * @return Number of events.
+   */
+  std::size_t GetEventsCount() const;
+
+  /**
+   * @brief Gets a small sequential identifier of the calling thread.
+   * @return Thread identifier used in the trace.
+   */
+  static unsigned ThreadId();
+
+ private:
+  Tracer();  ///< Constructor of the Tracer class.
+
+  /**
+   * @brief Structure for storing a recorded span.
+   */
+  struct TraceEvent {
+    const char* name;        ///< Name of the span.
+    long long startUs;       ///< Start relative to the origin, in microseconds.
+    long long durationUs;    ///< Duration in microseconds.
+    unsigned threadId;       ///< Thread the span was recorded on.
+    PerfSample counters;     ///< Counts of the span, -1 if unavailable.
+    std::size_t vertices;    ///< Vertices of the processed model.
+  };
+
+  /**
+   * @brief Writes counters, IPC and misses per vertex of every span name.
+   * @return true if the file was written, false otherwise.
+   */
+  bool WriteCountersSummary() const;
+
+  std::atomic<bool> enabled;              ///< Whether events are recorded.
+  mutable std::mutex eventsMutex;         ///< Guards events and thread names.
+  std::vector<TraceEvent> events;         ///< Recorded spans.
+  std::vector<std::pair<unsigned, std::string>> threadNames;  ///< Track names.
+  std::string filename;                   ///< Output file name.
+  std::atomic<bool> countersEnabled;      ///< Whether spans read counters.
+  std::string countersFilename;           ///< Counters summary file name.
+  std::string countersError;  ///< Why counters are unavailable on a thread.
+  std::atomic<std::size_t> verticesCount;  ///< Vertices of the model.
+  Clock::time_point origin;               ///< Moment tracing was started.
+};
+
+/**
+ * @brief RAII span recorded between construction and destruction.
+ */
+class TraceScope {
+ public:
+  /**
+   * @brief Starts the span if tracing is enabled.
+   * @param name Name of the span (string literal), nullptr disables the scope.
+   */
+  explicit TraceScope(const char* name);
+  ~TraceScope();  ///< Records the span.
+  TraceScope(const TraceScope& other) = delete;             ///< Disable copying.
+  TraceScope& operator=(const TraceScope& other) = delete;  ///< Disable copy
+                                                            ///< assignment.
+
+ private:
+  const char* scopeName;            ///< Name of the span, nullptr if disabled.
+  Tracer::Clock::time_point start;  ///< Start of the span.
+  PerfSample startCounters;  ///< Counters at the start, read only if the
+                             ///< tracer records counters.
+};
+
+}  // namespace s21
+
+#define S21_TRACE_CONCAT_IMPL(a, b) a##b
+#define S21_TRACE_CONCAT(a, b) S21_TRACE_CONCAT_IMPL(a, b)
+
+#ifdef S21_NO_TRACING
+#define S21_TRACE_SCOPE(name) static_cast<void>(0)
+#else
+/**
+ * @brief Records the rest of the enclosing block as a span named name.
+ */
+#define S21_TRACE_SCOPE(name) \
+  s21::TraceScope S21_TRACE_CONCAT(traceScope, __LINE__)(name)
+#endif
+
+#endif  // S21_TRACER_H
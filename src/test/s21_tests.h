@@ -3,10 +3,24 @@
 
 #include <gtest/gtest.h>
 
+#include <array>
+#include <memory>
+
+#include "../model/s21_allocation_tracker.h"
+#include "../model/s21_chunk_cache.h"
+#include "../model/s21_chunk_store.h"
+#include "../model/s21_memory_stats.h"
 #include "../model/s21_model.h"
 #include "../model/s21_model_facade.h"
 #include "../model/s21_obj_loader.h"
+#include "../model/s21_perf_counters.h"
+#include "../model/s21_point_octree.h"
+#include "../model/s21_preview_sampler.h"
+#include "../model/s21_startup_timer.h"
+#include "../model/s21_tracer.h"
 #include "../model/s21_transformation_strategy.h"
+#include "../view/include/gif.h"
+#include "../view/s21_gif_frame.h"
 
 TEST(FileLoader, SuccessTest_1) {
   EXPECT_NO_THROW(
@@ -73,9 +87,40 @@ TEST(FileLoader, ScaleNCenters) {
 }
 
 TEST(FileLoader, NoFaces) {
-  EXPECT_THROW(
-      s21::ObjLoader::Instance().ParseFile("test/test_files/test_file_8.obj"),
-      std::invalid_argument);
+  // Vertices without faces are loaded as a point cloud.
+  s21::ModelFacade facade;
+  facade.LoadFile("test/test_files/test_file_8.obj");
+  EXPECT_TRUE(facade.IsPointCloud());
+  EXPECT_EQ(facade.GetBuffersSize().first, 9);
+  EXPECT_EQ(facade.GetBuffersSize().second, 0);
+  EXPECT_EQ(facade.GetUnqueEdgesCount(), 0);
+  EXPECT_EQ(facade.GetBuffersData().first, std::vector<GLfloat>(9, 0.0f));
+  const char* filename = "test/faces_only.obj";
+  std::ofstream(filename) << "f 1 2 3\n";
+  EXPECT_THROW(s21::ObjLoader::Instance().ParseFile(filename),
+               std::invalid_argument);
+  std::remove(filename);
+}
+
+TEST(FileLoader, NegativeCoordinates) {
+  s21::ObjLoader::Instance().ParseFile("test/test_files/test_file_10.obj");
+  s21::Vertex centerVertex = s21::ObjLoader::Instance().GetCenters();
+  EXPECT_EQ(centerVertex.X, -3.0);
+  EXPECT_EQ(centerVertex.Y, -5.0);
+  EXPECT_EQ(centerVertex.Z, -2.0);
+  EXPECT_EQ(s21::ObjLoader::Instance().GetScaleFactor(), 0.25f);
+}
+
+TEST(FileLoader, ClosingEdgeCounted) {
+  s21::ObjLoader::Instance().ParseFile("test/test_files/test_file_11.obj");
+  EXPECT_EQ(s21::ObjLoader::Instance().GetUniqueEdgesCount(), 4);
+  EXPECT_EQ(s21::ObjLoader::Instance().GetFaces().size(), 8);
+}
+
+TEST(FileLoader, CountUniqueEdges) {
+  std::vector<GLuint> lines = {0, 1, 1, 2, 2, 0, 1, 0, 2, 1, 0, 3};
+  EXPECT_EQ(s21::ObjLoader::CountUniqueEdges(lines.data(), lines.size()), 4);
+  EXPECT_EQ(s21::ObjLoader::CountUniqueEdges(lines.data(), 0), 0);
 }
 
 TEST(TransformStrategy, SetRotateStrategy) {
@@ -168,6 +213,30 @@ TEST(Model, SetProjection) {
       glm::perspective(glm::radians(45.0f), (800.0f / 600.0f), 0.75f, 100.0f));
 }
 
+TEST(Model, GetTileMatrix) {
+  EXPECT_EQ(s21::Model::GetTileMatrix(0, 0, 800, 600, 800, 600),
+            glm::mat4(1.0f));
+  glm::mat4 projection =
+      glm::perspective(glm::radians(45.0f), (800.0f / 600.0f), 0.75f, 100.0f);
+  // Top right quarter of the image.
+  glm::mat4 tile = s21::Model::GetTileMatrix(400, 0, 400, 300, 800, 600);
+  glm::vec4 point = projection * glm::vec4(0.3f, 0.2f, -2.0f, 1.0f);
+  glm::vec4 tilePoint = tile * point;
+  EXPECT_NEAR(tilePoint.x / tilePoint.w, 2.0f * point.x / point.w - 1.0f,
+              1e-5);
+  EXPECT_NEAR(tilePoint.y / tilePoint.w, 2.0f * point.y / point.w - 1.0f,
+              1e-5);
+  EXPECT_NEAR(tilePoint.z / tilePoint.w, point.z / point.w, 1e-6);
+  // Corners of a tile are mapped to the corners of the viewport.
+  tile = s21::Model::GetTileMatrix(200, 300, 200, 150, 800, 600);
+  glm::vec4 corner = tile * glm::vec4(-0.5f, 0.0f, 0.0f, 1.0f);
+  EXPECT_NEAR(corner.x, -1.0f, 1e-6);
+  EXPECT_NEAR(corner.y, 1.0f, 1e-6);
+  corner = tile * glm::vec4(0.0f, -0.5f, 0.0f, 1.0f);
+  EXPECT_NEAR(corner.x, 1.0f, 1e-6);
+  EXPECT_NEAR(corner.y, -1.0f, 1e-6);
+}
+
 TEST(ModelFacade, loadFile) {
   s21::ModelFacade facade;
   EXPECT_NO_THROW(facade.LoadFile("test/test_files/test_file_1.obj"));
@@ -195,6 +264,29 @@ TEST(ModelFacade, getBuffersData) {
   EXPECT_EQ(indices[1], 1);
 }
 
+TEST(ModelFacade, LoadFileInto) {
+  s21::ModelFacade facade;
+  std::vector<GLfloat> vertices;
+  std::vector<GLuint> indices;
+  EXPECT_NO_THROW(facade.LoadFileInto(
+      "test/test_files/test_file_7.obj",
+      [&](size_t verticesSize, size_t indicesSize) {
+        vertices.resize(verticesSize);
+        indices.resize(indicesSize);
+        return s21::BufferView{vertices.data(), vertices.size(),
+                               indices.data(), indices.size()};
+      }));
+  EXPECT_EQ(facade.GetBuffersSize().first, 6);
+  EXPECT_EQ(facade.GetBuffersSize().second, 4);
+  EXPECT_TRUE(facade.GetBuffersData().first.empty());
+  EXPECT_EQ(vertices[0], -0.25f);
+  EXPECT_EQ(vertices[4], 0.25f);
+  EXPECT_EQ(vertices[5], -0.25f);
+  EXPECT_EQ(indices[0], 0);
+  EXPECT_EQ(indices[1], 1);
+  EXPECT_EQ(s21::ObjLoader::Instance().GetUniqueEdgesCount(), 1);
+}
+
 TEST(ModelFacade, InteractRotate) {
   s21::ModelFacade facade;
   s21::Model model;
@@ -268,4 +360,746 @@ TEST(ModelFacede, GetUniqueEdgesCount) {
   EXPECT_EQ(facade.GetBuffersData().second.size(), 24);
 }
 
+TEST(GifFrame, ExactPaletteHolds255Colors) {
+  std::vector<uint8_t> image(256 * 4, 255);
+  for (int i = 0; i < 256; ++i) {
+    image[i * 4] = static_cast<uint8_t>(i);
+  }
+  std::shared_ptr<const s21::ExactPalette> palette =
+      s21::BuildExactPalette(nullptr, nullptr, image.data(), 255);
+  ASSERT_NE(palette, nullptr);
+  EXPECT_EQ(palette->colors.size(), 255);
+  EXPECT_EQ(palette->BitDepth(), 8);
+  // Index 0 is left for transparent pixels.
+  std::vector<uint8_t> quantized(255 * 4);
+  ASSERT_TRUE(s21::MapToExactPalette(*palette, nullptr, image.data(),
+                                     quantized.data(), 255));
+  for (int i = 0; i < 255; ++i) {
+    EXPECT_EQ(quantized[i * 4 + 3], i + 1);
+  }
+  EXPECT_EQ(s21::BuildExactPalette(nullptr, nullptr, image.data(), 256),
+            nullptr);
+}
+
+TEST(GifFrame, ExactPaletteSkipsUnchangedPixels) {
+  std::vector<uint8_t> previous(4 * 4, 0);
+  std::vector<uint8_t> image = previous;
+  image[1 * 4] = 200;
+  image[3 * 4 + 2] = 100;
+  std::shared_ptr<const s21::ExactPalette> palette =
+      s21::BuildExactPalette(nullptr, previous.data(), image.data(), 4);
+  ASSERT_NE(palette, nullptr);
+  EXPECT_EQ(palette->colors.size(), 2);
+  EXPECT_EQ(palette->BitDepth(), 2);
+  std::vector<uint8_t> quantized(4 * 4);
+  ASSERT_TRUE(s21::MapToExactPalette(*palette, previous.data(), image.data(),
+                                     quantized.data(), 4));
+  EXPECT_EQ(quantized[0 * 4 + 3], s21::ExactPalette::kTransparentIndex);
+  EXPECT_EQ(quantized[1 * 4 + 3], 1);
+  EXPECT_EQ(quantized[2 * 4 + 3], s21::ExactPalette::kTransparentIndex);
+  EXPECT_EQ(quantized[3 * 4 + 3], 2);
+
+  // A repeated frame has no colors to add.
+  palette = s21::BuildExactPalette(nullptr, image.data(), image.data(), 4);
+  ASSERT_NE(palette, nullptr);
+  EXPECT_TRUE(palette->colors.empty());
+}
+
+TEST(GifFrame, ExactPaletteExtendsBase) {
+  std::vector<uint8_t> image(3 * 4, 0);
+  image[0] = 10;
+  image[4] = 20;
+  std::shared_ptr<const s21::ExactPalette> base =
+      s21::BuildExactPalette(nullptr, nullptr, image.data(), 2);
+  image[8] = 30;
+  std::shared_ptr<const s21::ExactPalette> palette =
+      s21::BuildExactPalette(base.get(), nullptr, image.data(), 3);
+  ASSERT_NE(palette, nullptr);
+  EXPECT_EQ(palette->colors, (std::vector<uint32_t>{10, 20, 30}));
+  EXPECT_EQ(base->colors.size(), 2);
+
+  // A full base is dropped when the frame's own colors fit.
+  std::vector<uint8_t> full(255 * 4, 0);
+  for (int i = 0; i < 255; ++i) {
+    full[i * 4 + 1] = static_cast<uint8_t>(i + 1);
+  }
+  base = s21::BuildExactPalette(nullptr, nullptr, full.data(), 255);
+  palette = s21::BuildExactPalette(base.get(), nullptr, image.data(), 3);
+  ASSERT_NE(palette, nullptr);
+  EXPECT_EQ(palette->colors, (std::vector<uint32_t>{10, 20, 30}));
+}
+
+TEST(GifFrame, ChangedRect) {
+  const int width = 8, height = 6;
+  std::vector<uint8_t> previous(width * height * 4, 0);
+  std::vector<uint8_t> image = previous;
+  s21::FrameRect rect =
+      s21::FindChangedRect(nullptr, image.data(), width, height);
+  EXPECT_EQ(rect.left, 0);
+  EXPECT_EQ(rect.top, 0);
+  EXPECT_EQ(rect.width, width);
+  EXPECT_EQ(rect.height, height);
+
+  // Nothing changed, a single pixel keeps the frame delay.
+  rect = s21::FindChangedRect(previous.data(), image.data(), width, height);
+  EXPECT_EQ(rect.width, 1);
+  EXPECT_EQ(rect.height, 1);
+  rect = s21::FindChangedRect(image.data(), image.data(), width, height);
+  EXPECT_EQ(rect.width, 1);
+  EXPECT_EQ(rect.height, 1);
+
+  image[(3 * width + 5) * 4 + 1] = 1;
+  rect = s21::FindChangedRect(previous.data(), image.data(), width, height);
+  EXPECT_EQ(rect.left, 5);
+  EXPECT_EQ(rect.top, 3);
+  EXPECT_EQ(rect.width, 1);
+  EXPECT_EQ(rect.height, 1);
+
+  // Alpha isn't encoded, so it doesn't count as a change.
+  image[(5 * width + 7) * 4 + 3] = 1;
+  image[(1 * width + 2) * 4 + 2] = 1;
+  rect = s21::FindChangedRect(previous.data(), image.data(), width, height);
+  EXPECT_EQ(rect.left, 2);
+  EXPECT_EQ(rect.top, 1);
+  EXPECT_EQ(rect.width, 4);
+  EXPECT_EQ(rect.height, 3);
+
+  image[0] = 1;
+  image[image.size() - 2] = 1;
+  rect = s21::FindChangedRect(previous.data(), image.data(), width, height);
+  EXPECT_EQ(rect.left, 0);
+  EXPECT_EQ(rect.top, 0);
+  EXPECT_EQ(rect.width, width);
+  EXPECT_EQ(rect.height, height);
+}
+
+TEST(GifFrame, CropCopiesRows) {
+  const int width = 4, height = 3;
+  std::vector<uint8_t> image(width * height * 4);
+  for (std::size_t i = 0; i < image.size(); ++i) {
+    image[i] = static_cast<uint8_t>(i);
+  }
+  std::vector<uint8_t> cropped;
+  s21::Crop(image.data(), width, {1, 1, 2, 2}, cropped);
+  ASSERT_EQ(cropped.size(), 2 * 2 * 4);
+  for (int y = 0; y < 2; ++y) {
+    for (int x = 0; x < 2 * 4; ++x) {
+      EXPECT_EQ(cropped[y * 8 + x], image[((1 + y) * width + 1) * 4 + x]);
+    }
+  }
+  s21::Crop(image.data(), width, {0, 0, width, height}, cropped);
+  EXPECT_EQ(cropped, image);
+  // The buffer shrinks when it is reused for a smaller rectangle.
+  s21::Crop(image.data(), width, {3, 2, 1, 1}, cropped);
+  EXPECT_EQ(cropped, std::vector<uint8_t>(image.end() - 4, image.end()));
+}
+
+TEST(GifLzw, FastEncoderMatchesReference) {
+  using LzwWriter = void (*)(FILE *, uint8_t *, uint32_t, uint32_t, uint32_t,
+                             uint32_t, uint32_t, GifPalette *);
+  auto compress = [](LzwWriter writer, std::vector<uint8_t> pixels,
+                     uint32_t width, uint32_t height, GifPalette palette) {
+    char *data = nullptr;
+    size_t size = 0;
+    FILE *stream = open_memstream(&data, &size);
+    writer(stream, pixels.data(), 3, 5, width, height, 10, &palette);
+    std::fclose(stream);
+    std::vector<char> bytes(data, data + size);
+    std::free(data);
+    return bytes;
+  };
+  uint32_t seed = 21;
+  // Noise at 320x240 needs more than 4096 codes, so the code table is reset
+  // several times within a frame.
+  for (int bitDepth : {2, 3, 5, 8}) {
+    for (auto size : {std::pair<uint32_t, uint32_t>{1, 1}, {7, 3}, {64, 48},
+                      {320, 240}}) {
+      for (bool noise : {false, true}) {
+        GifPalette palette = {};
+        palette.bitDepth = bitDepth;
+        std::vector<uint8_t> pixels(size.first * size.second * 4, 0);
+        for (size_t i = 0; i < pixels.size(); i += 4) {
+          seed = seed * 1664525u + 1013904223u;
+          // Runs of one index with rare changes grow long codes instead.
+          if (noise || (seed >> 24) < 8) {
+            pixels[i + 3] = (seed >> 16) & ((1 << bitDepth) - 1);
+          } else if (i > 0) {
+            pixels[i + 3] = pixels[i - 1];
+          }
+        }
+        EXPECT_EQ(compress(GifWriteLzwImageFast, pixels, size.first,
+                           size.second, palette),
+                  compress(GifWriteLzwImage, pixels, size.first, size.second,
+                           palette))
+            << "depth " << bitDepth << ", " << size.first << "x"
+            << size.second << (noise ? ", noise" : ", runs");
+      }
+    }
+  }
+}
+
+TEST(Tracer, DisabledByDefault) {
+  EXPECT_FALSE(s21::Tracer::Instance().IsEnabled());
+  std::size_t eventsCount = s21::Tracer::Instance().GetEventsCount();
+  s21::ObjLoader::Instance().ParseFile("test/test_files/test_file_1.obj");
+  EXPECT_EQ(s21::Tracer::Instance().GetEventsCount(), eventsCount);
+}
+
+TEST(Tracer, WritesLoadStages) {
+  s21::Tracer::Instance().Start("test/trace_test.json");
+  s21::ModelFacade facade;
+  facade.LoadFile("test/test_files/test_file_1.obj");
+  std::vector<GLfloat> vertices;
+  std::vector<GLuint> indices;
+  facade.LoadFileInto("test/test_files/test_file_1.obj",
+                      [&](size_t verticesSize, size_t indicesSize) {
+                        vertices.resize(verticesSize);
+                        indices.resize(indicesSize);
+                        return s21::BufferView{vertices.data(),
+                                               vertices.size(),
+                                               indices.data(), indices.size()};
+                      });
+  EXPECT_GE(s21::Tracer::Instance().GetEventsCount(), 8);
+  EXPECT_TRUE(s21::Tracer::Instance().Stop());
+  EXPECT_FALSE(s21::Tracer::Instance().IsEnabled());
+
+  std::ifstream traceFile("test/trace_test.json");
+  std::stringstream trace;
+  trace << traceFile.rdbuf();
+  for (const char* stage :
+       {"Read file", "Parse vertices", "Parse faces", "Count unique edges",
+        "Bounding box", "NormalizeVertices"}) {
+    EXPECT_NE(trace.str().find(stage), std::string::npos) << stage;
+  }
+  // Mapped and vector loads are told apart by the whole name.
+  EXPECT_NE(trace.str().find("\"ModelFacade::LoadFile\""), std::string::npos);
+  EXPECT_NE(trace.str().find("\"ModelFacade::LoadFileInto\""),
+            std::string::npos);
+  EXPECT_NE(trace.str().find("\"ph\":\"X\""), std::string::npos);
+  std::remove("test/trace_test.json");
+}
+
+TEST(PerfCounters, ReadDegradesGracefully) {
+  s21::PerfCounters counters;
+  s21::PerfSample sample = counters.Read();
+  bool allAvailable = true;
+  for (int i = 0; i < s21::PerfCountersCount; ++i) {
+    if (counters.IsAvailable(static_cast<s21::PerfCounter>(i))) {
+      EXPECT_GE(sample[i], 0);
+    } else {
+      EXPECT_EQ(sample[i], -1);
+      allAvailable = false;
+    }
+  }
+  EXPECT_EQ(counters.GetError().empty(), allAvailable);
+}
+
+TEST(Tracer, CountersSummary) {
+  s21::Tracer::Instance().Start("test/trace_test.json",
+                                "test/counters_test.json");
+  s21::ModelFacade facade;
+  facade.LoadFile("test/test_files/test_file_1.obj");
+  EXPECT_TRUE(s21::Tracer::Instance().Stop());
+
+  std::ifstream summaryFile("test/counters_test.json");
+  std::stringstream summary;
+  summary << summaryFile.rdbuf();
+  EXPECT_NE(summary.str().find("\"available\":"), std::string::npos);
+  EXPECT_NE(summary.str().find("\"name\":\"Parse faces\""),
+            std::string::npos);
+  EXPECT_NE(summary.str().find("\"ipc\":"), std::string::npos);
+  if (s21::PerfCounters().IsAnyAvailable()) {
+    EXPECT_NE(summary.str().find("\"available\":true"), std::string::npos);
+  } else {
+    EXPECT_NE(summary.str().find("\"available\":false"), std::string::npos);
+    EXPECT_EQ(summary.str().find("\"error\":\"\""), std::string::npos);
+  }
+  std::remove("test/trace_test.json");
+  std::remove("test/counters_test.json");
+}
+
+TEST(StartupTimer, MarksEachPhaseOnce) {
+  s21::StartupTimer& timer = s21::StartupTimer::Instance();
+  timer.Mark(s21::MainEntered);
+  double mainEntered = timer.GetMs(s21::MainEntered);
+  EXPECT_GE(mainEntered, 0.0);
+  EXPECT_FALSE(timer.Mark(s21::MainEntered));
+  EXPECT_EQ(timer.GetMs(s21::MainEntered), mainEntered);
+  timer.Mark(s21::WindowCreated);
+  EXPECT_GE(timer.GetMs(s21::WindowCreated), mainEntered);
+
+  EXPECT_TRUE(timer.WriteReport("test/startup_test.json"));
+  std::ifstream reportFile("test/startup_test.json");
+  std::stringstream report;
+  report << reportFile.rdbuf();
+  EXPECT_NE(report.str().find("\"shaderCacheHit\":false"), std::string::npos);
+  EXPECT_NE(report.str().find("\"windowCreated\":"), std::string::npos);
+  EXPECT_NE(report.str().find("\"firstFramePresented\":null"),
+            std::string::npos);
+  std::remove("test/startup_test.json");
+}
+
+TEST(Reload, AppendedLinesParseOnlyTail) {
+  const char* filename = "test/reload_test.obj";
+  std::ofstream(filename) << "v 0 0 0\nv 1 0 0\nv 0 1 0\nf 1 2 3\n";
+  s21::ModelFacade facade;
+  facade.LoadFile(filename);
+  std::vector<GLfloat> vertices = facade.GetBuffersData().first;
+  std::vector<GLuint> indices = facade.GetBuffersData().second;
+  s21::InputData scale{0, 0, 0, 2.0f, 0, 0, 0, s21::Orthogonal, 100, 100};
+  glm::mat4 scaled = facade.InteractModel(scale, s21::Scale).modelMatrix;
+
+  std::ofstream(filename, std::ios::app) << "v 0 0 1\nf 1 2 4\n";
+  EXPECT_TRUE(facade.ReparseFile());
+  s21::ModelUpdate update = facade.UpdateBuffers(true);
+  ASSERT_EQ(update.vertexRanges.size(), 1);
+  EXPECT_EQ(update.vertexRanges[0].offset, 9);
+  EXPECT_EQ(update.vertexRanges[0].size, 3);
+  ASSERT_EQ(update.indexRanges.size(), 1);
+  EXPECT_EQ(update.indexRanges[0].offset, 6);
+  EXPECT_EQ(update.indexRanges[0].size, 6);
+  EXPECT_FALSE(update.reallocated);
+  const auto& buffers = facade.GetBuffersData();
+  ASSERT_EQ(buffers.first.size(), 12);
+  EXPECT_TRUE(std::equal(vertices.begin(), vertices.end(),
+                         buffers.first.begin()));
+  EXPECT_TRUE(std::equal(indices.begin(), indices.end(),
+                         buffers.second.begin()));
+  EXPECT_EQ(buffers.second.back(), 0);
+  EXPECT_EQ(facade.GetUnqueEdgesCount(), 5);
+
+  // The scale applied before the reload is kept.
+  scale.scale = 1.0f;
+  EXPECT_EQ(facade.InteractModel(scale, s21::Scale).modelMatrix, scaled);
+  std::remove(filename);
+}
+
+TEST(Reload, ChangedVertexUpdatesItsRange) {
+  const char* filename = "test/reload_test.obj";
+  std::ofstream(filename) << "v 0 0 0\nv 1 0 0\nv 0 1 0\nf 1 2 3\n";
+  s21::ModelFacade facade;
+  facade.LoadFile(filename);
+  std::vector<GLfloat> vertices = facade.GetBuffersData().first;
+
+  std::ofstream(filename) << "v 0 0 0\nv 1 0 0\nv 0 0.5 0\nf 1 2 3\n";
+  EXPECT_FALSE(facade.ReparseFile());
+  s21::ModelUpdate update = facade.UpdateBuffers(false);
+  ASSERT_EQ(update.vertexRanges.size(), 1);
+  EXPECT_EQ(update.vertexRanges[0].offset, 7);
+  EXPECT_EQ(update.vertexRanges[0].size, 1);
+  EXPECT_TRUE(update.indexRanges.empty());
+  // The normalization of the first load is kept.
+  const std::vector<GLfloat>& reloaded = facade.GetBuffersData().first;
+  EXPECT_EQ(reloaded[0], vertices[0]);
+  EXPECT_FLOAT_EQ(reloaded[7] - reloaded[1], (vertices[7] - vertices[1]) / 2);
+
+  // A broken line keeps the model as it was.
+  const char* content = "v 0 0 0\nv 1 0 0\nv 0 0.5 0\nf 1 2 3\n";
+  std::ofstream(filename) << content << "v 0 0 1\nf 1 2 x\n";
+  EXPECT_THROW(facade.ReparseFile(), std::invalid_argument);
+  EXPECT_EQ(facade.GetBuffersData().first, reloaded);
+
+  // A failed parse clears the loader, the fixed file is parsed in full and
+  // only the added part differs.
+  std::ofstream(filename) << content << "v 0 0 1\nf 1 2 4\n";
+  EXPECT_FALSE(facade.ReparseFile());
+  update = facade.UpdateBuffers(false);
+  ASSERT_EQ(update.vertexRanges.size(), 1);
+  EXPECT_EQ(update.vertexRanges[0].offset, 9);
+  EXPECT_EQ(update.vertexRanges[0].size, 3);
+  EXPECT_EQ(facade.GetBuffersData().second.size(), 12);
+  std::remove(filename);
+}
+
+TEST(PreviewSampler, SmallFileIsSampledWhole) {
+  const char* filename = "test/preview_test.obj";
+  std::ofstream(filename) << "# scan\nv -1 0 2\nvn 0 0 1\nvt 0.5 0.5\n"
+                             "v 3 4 -2\nv 0 8 0\nf 1 2 3";
+  s21::PreviewCloud cloud = s21::PreviewSampler().Sample(filename);
+  ASSERT_EQ(cloud.points.size(), 9);
+  s21::ObjLoader& loader = s21::ObjLoader::Instance();
+  loader.ParseFile(filename);
+  EXPECT_EQ(cloud.points, loader.GetVertices());
+  // The preview is normalized exactly like the loaded model.
+  EXPECT_EQ(cloud.box.GetCenter().X, loader.GetCenters().X);
+  EXPECT_EQ(cloud.box.GetCenter().Y, loader.GetCenters().Y);
+  EXPECT_EQ(cloud.box.GetCenter().Z, loader.GetCenters().Z);
+  EXPECT_EQ(cloud.box.GetScaleFactor(), loader.GetScaleFactor());
+  EXPECT_TRUE(s21::PreviewSampler().Sample("test/missing.obj").points.empty());
+  std::remove(filename);
+}
+
+TEST(PreviewSampler, SlicesHoldOnlyWholeVertices) {
+  const char* filename = "test/preview_test.obj";
+  const int count = 20000;
+  {
+    std::ofstream file(filename);
+    for (int i = 0; i < count; ++i) {
+      file << "v " << i << ' ' << 2 * i << ' ' << -i << "\nvn 1 1 1\n";
+    }
+  }
+  s21::PreviewSampler sampler(16, 256);
+  s21::PreviewCloud cloud = sampler.Sample(filename);
+  ASSERT_FALSE(cloud.points.empty());
+  EXPECT_LT(cloud.points.size(), 3 * count / 10);
+  for (size_t i = 0; i < cloud.points.size(); i += 3) {
+    GLfloat x = cloud.points[i];
+    EXPECT_EQ(x, std::floor(x));
+    EXPECT_EQ(cloud.points[i + 1], 2 * x);
+    EXPECT_EQ(cloud.points[i + 2], -x);
+  }
+  // Slices cover the whole file, so the estimate spans most of the model.
+  EXPECT_GE(cloud.box.minimum.X, 0);
+  EXPECT_LT(cloud.box.minimum.X, count / 8);
+  EXPECT_LT(cloud.box.maximum.X, count);
+  EXPECT_GT(cloud.box.maximum.X, count - count / 8);
+  EXPECT_EQ(sampler.Sample(filename).points, cloud.points);
+  std::remove(filename);
+}
+
+TEST(PointOctree, NodesAreContiguousRanges) {
+  const int side = 40;
+  std::vector<GLfloat> points;
+  for (int i = 0; i < side * side * side; ++i) {
+    points.push_back((i % side) / GLfloat(side) - 0.5f);
+    points.push_back((i / side % side) / GLfloat(side) - 0.5f);
+    points.push_back((i / side / side) / GLfloat(side) - 0.5f);
+  }
+  std::vector<GLfloat> ordered = points;
+  s21::PointOctree octree;
+  octree.Build(ordered.data(), ordered.size());
+  auto sorted = [](const std::vector<GLfloat>& data) {
+    std::vector<std::array<GLfloat, 3>> vertices(data.size() / 3);
+    std::memcpy(vertices.data(), data.data(), data.size() * sizeof(GLfloat));
+    std::sort(vertices.begin(), vertices.end());
+    return vertices;
+  };
+  EXPECT_EQ(sorted(ordered), sorted(points));
+
+  const std::vector<s21::OctreeNode>& nodes = octree.GetNodes();
+  ASSERT_GT(nodes.size(), 8);
+  // Nodes follow each other in the buffer in breadth first order.
+  size_t covered = 0;
+  for (size_t i = 0; i < nodes.size(); ++i) {
+    const s21::OctreeNode& node = nodes[i];
+    EXPECT_EQ(node.first, covered);
+    covered += node.count;
+    if (node.childrenCount > 0) {
+      EXPECT_EQ(node.count, s21::PointOctree::kNodePoints);
+      EXPECT_GT(node.firstChild, i);
+    }
+    for (size_t j = node.first; j < node.first + node.count; ++j) {
+      for (int axis = 0; axis < 3; ++axis) {
+        EXPECT_LE(std::abs(ordered[j * 3 + axis] - node.center[axis]),
+                  node.halfSize * 1.0001f);
+      }
+    }
+  }
+  EXPECT_EQ(covered, points.size() / 3);
+}
+
+TEST(PointOctree, SelectionFollowsScreenSize) {
+  const int side = 40;
+  const size_t count = side * side * side;
+  std::vector<GLfloat> points;
+  for (size_t i = 0; i < count; ++i) {
+    points.push_back((i % side) / GLfloat(side) - 0.5f);
+    points.push_back((i / side % side) / GLfloat(side) - 0.5f);
+    points.push_back((i / side / side) / GLfloat(side) - 0.5f);
+  }
+  s21::PointOctree octree;
+  octree.Build(points.data(), points.size());
+  glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 0.0f, 3.0f),
+                               glm::vec3(0.0f, 0.0f, 0.0f),
+                               glm::vec3(0.0f, 1.0f, 0.0f));
+  glm::mat4 projection =
+      glm::perspective(glm::radians(45.0f), 1.0f, 0.75f, 100.0f);
+  s21::PointSelection selection;
+
+  // A thumbnail only needs the coarsest level.
+  octree.Select(view, projection, 20, count, selection);
+  ASSERT_EQ(selection.firsts.size(), 1);
+  EXPECT_EQ(selection.firsts[0], 0);
+  EXPECT_EQ(selection.points, s21::PointOctree::kNodePoints);
+
+  octree.Select(view, projection, 100, count, selection);
+  size_t small = selection.points;
+  octree.Select(view, projection, 4000, count, selection);
+  EXPECT_GT(selection.points, small);
+  EXPECT_EQ(selection.points, count);
+
+  octree.Select(view, projection, 4000, 10000, selection);
+  EXPECT_LE(selection.points, 10000);
+  EXPECT_GE(selection.points, s21::PointOctree::kNodePoints);
+  size_t selected = 0;
+  for (GLsizei pointsCount : selection.counts) {
+    selected += pointsCount;
+  }
+  EXPECT_EQ(selected, selection.points);
+
+  glm::mat4 away = glm::lookAt(glm::vec3(0.0f, 0.0f, 3.0f),
+                               glm::vec3(0.0f, 0.0f, 6.0f),
+                               glm::vec3(0.0f, 1.0f, 0.0f));
+  octree.Select(away, projection, 4000, count, selection);
+  EXPECT_EQ(selection.points, 0);
+}
+
+TEST(ChunkStore, BuildsOnceAndHoldsEveryEdge) {
+  const char* filename = "test/chunk_test.obj";
+  const char* storeFile = "test/chunk_test.chunks";
+  const int side = 24;
+  {
+    std::ofstream file(filename);
+    for (int i = 0; i < side * side; ++i) {
+      file << "v " << i % side << ' ' << i / side << ' '
+           << (i % 7) * 0.25f << '\n';
+    }
+    for (int y = 0; y + 1 < side; ++y) {
+      for (int x = 0; x + 1 < side; ++x) {
+        int corner = y * side + x + 1;
+        file << "f " << corner << "/1 " << corner + 1 << ' '
+             << corner + side + 1 << ' ' << corner + side << "\r\n";
+      }
+    }
+  }
+  s21::ModelFacade facade;
+  facade.LoadFile(filename);
+  auto buffers = facade.GetBuffersData();
+  std::vector<std::array<GLfloat, 6>> expected;
+  for (size_t i = 0; i + 1 < buffers.second.size(); i += 2) {
+    std::array<GLfloat, 6> edge;
+    std::memcpy(edge.data(), &buffers.first[buffers.second[i] * 3],
+                3 * sizeof(GLfloat));
+    std::memcpy(edge.data() + 3, &buffers.first[buffers.second[i + 1] * 3],
+                3 * sizeof(GLfloat));
+    expected.push_back(edge);
+  }
+  std::sort(expected.begin(), expected.end());
+
+  s21::ChunkStore store;
+  store.Open(filename, storeFile, nullptr, 4096);
+  EXPECT_TRUE(store.WasBuilt());
+  ASSERT_EQ(store.GetPrimitive(), s21::ChunkPrimitive::Lines);
+  EXPECT_EQ(store.GetVerticesCount(), size_t(side * side));
+  EXPECT_EQ(store.GetEdgesCount(), expected.size());
+  ASSERT_GT(store.GetChunks().size(), 1);
+  std::vector<std::array<GLfloat, 6>> stored;
+  for (size_t i = 0; i < store.GetChunks().size(); ++i) {
+    const s21::ChunkInfo& chunk = store.GetChunks()[i];
+    EXPECT_EQ(chunk.offset % s21::ChunkStore::kPageBytes, 0);
+    EXPECT_LE(store.GetChunkBytes(i), 4096);
+    const GLfloat* data = store.GetChunkData(i);
+    for (size_t j = 0; j < chunk.primitives; ++j) {
+      std::array<GLfloat, 6> edge;
+      std::memcpy(edge.data(), data + j * 6, sizeof(edge));
+      EXPECT_GE(edge[0], chunk.box.minimum.X);
+      EXPECT_LE(edge[3], chunk.box.maximum.X);
+      stored.push_back(edge);
+    }
+  }
+  std::sort(stored.begin(), stored.end());
+  ASSERT_EQ(stored.size(), expected.size());
+  for (size_t i = 0; i < stored.size(); ++i) {
+    for (int j = 0; j < 6; ++j) {
+      EXPECT_NEAR(stored[i][j], expected[i][j], 1e-6f);
+    }
+  }
+
+  // An unchanged file maps the store without parsing.
+  size_t chunksCount = store.GetChunks().size();
+  store.Open(filename, storeFile, nullptr, 4096);
+  EXPECT_FALSE(store.WasBuilt());
+  EXPECT_EQ(store.GetChunks().size(), chunksCount);
+  std::ofstream(filename, std::ios::app) << "f 1 2 x\n";
+  EXPECT_THROW(store.Open(filename, storeFile, nullptr, 4096),
+               std::invalid_argument);
+  EXPECT_FALSE(store.IsOpen());
+
+  std::ofstream(filename) << "v 0 0 0\nv 1 0 0\nv 0 1 0\nf 1 2 3\n";
+  facade.LoadOutOfCore(filename, storeFile, 1 << 20);
+  EXPECT_TRUE(facade.IsOutOfCore());
+  EXPECT_TRUE(facade.GetChunkStore()->WasBuilt());
+  EXPECT_EQ(facade.GetUnqueEdgesCount(), 3);
+  EXPECT_EQ(facade.GetBuffersSize().first, 0);
+  EXPECT_EQ(facade.GetBuffersSize().second, 0);
+  facade.LoadFile(filename);
+  EXPECT_FALSE(facade.IsOutOfCore());
+  EXPECT_EQ(facade.GetBuffersSize().first, 9);
+  std::remove(filename);
+  std::remove(storeFile);
+}
+
+TEST(ChunkCache, StaysWithinBudget) {
+  const char* filename = "test/chunk_cache_test.obj";
+  const char* storeFile = "test/chunk_cache_test.chunks";
+  {
+    std::ofstream file(filename);
+    for (int i = 0; i < 4096; ++i) {
+      file << "v " << i % 16 << ' ' << i / 16 % 16 << ' ' << i / 256 << '\n';
+    }
+  }
+  s21::ChunkStore store;
+  store.Open(filename, storeFile, nullptr, 2048);
+  ASSERT_EQ(store.GetPrimitive(), s21::ChunkPrimitive::Points);
+  const std::vector<s21::ChunkInfo>& chunks = store.GetChunks();
+  ASSERT_GE(chunks.size(), 8);
+  size_t points = 0;
+  for (const s21::ChunkInfo& chunk : chunks) {
+    points += chunk.primitives;
+  }
+  EXPECT_EQ(points, 4096);
+
+  glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 0.0f, 3.0f),
+                               glm::vec3(0.0f, 0.0f, 0.0f),
+                               glm::vec3(0.0f, 1.0f, 0.0f));
+  glm::mat4 projection =
+      glm::perspective(glm::radians(45.0f), 1.0f, 0.75f, 100.0f);
+  std::vector<std::pair<GLfloat, size_t>> visible;
+  store.SelectChunks(view, projection, 600, visible);
+  EXPECT_EQ(visible.size(), chunks.size());
+  for (size_t i = 1; i < visible.size(); ++i) {
+    EXPECT_GE(visible[i - 1].first, visible[i].first);
+  }
+  glm::mat4 away = glm::lookAt(glm::vec3(0.0f, 0.0f, 3.0f),
+                               glm::vec3(0.0f, 0.0f, 6.0f),
+                               glm::vec3(0.0f, 1.0f, 0.0f));
+  store.SelectChunks(away, projection, 600, visible);
+  EXPECT_TRUE(visible.empty());
+
+  size_t budget = store.GetChunkBytes(0) * 3;
+  s21::ChunkCache cache(store, budget);
+  std::atomic<int> readyCalls(0);
+  cache.SetReadyCallback([&readyCalls] { ++readyCalls; });
+  std::vector<size_t> request;
+  for (size_t i = 0; i < chunks.size(); ++i) {
+    request.push_back(i);
+  }
+  cache.Request(request);
+  cache.WaitIdle();
+  EXPECT_LE(cache.GetResidentBytes(), budget);
+  EXPECT_GT(cache.GetResidentCount(), 0);
+  EXPECT_TRUE(cache.IsResident(0));
+  EXPECT_EQ(readyCalls.load(), int(cache.GetResidentCount()));
+
+  // Chunks left out of the request make room for the requested ones.
+  request = {chunks.size() - 1, chunks.size() - 2};
+  cache.Request(request);
+  cache.WaitIdle();
+  EXPECT_TRUE(cache.IsResident(chunks.size() - 1));
+  EXPECT_TRUE(cache.IsResident(chunks.size() - 2));
+  EXPECT_LE(cache.GetResidentBytes(), budget);
+  EXPECT_EQ(s21::MemoryStats::Instance().Get(s21::ModelChunks).current,
+            cache.GetResidentBytes());
+  std::remove(filename);
+  std::remove(storeFile);
+}
+
+TEST(MemoryStats, ScopedMemory) {
+  s21::MemoryStats& stats = s21::MemoryStats::Instance();
+  std::size_t before = stats.Get(s21::CaptureFrames).current;
+  stats.ResetPeaks();
+  {
+    s21::ScopedMemory memory(s21::CaptureFrames, 1000);
+    EXPECT_EQ(stats.Get(s21::CaptureFrames).current, before + 1000);
+    stats.Remove(s21::CaptureFrames, 400);
+    stats.Add(s21::CaptureFrames, 400);
+  }
+  EXPECT_EQ(stats.Get(s21::CaptureFrames).current, before);
+  EXPECT_EQ(stats.Get(s21::CaptureFrames).peak, before + 1000);
+  stats.ResetPeaks();
+  EXPECT_EQ(stats.Get(s21::CaptureFrames).peak, before);
+}
+
+TEST(MemoryStats, LoadFile) {
+  s21::ModelFacade facade;
+  s21::MemoryStats::Instance().ResetPeaks();
+  facade.LoadFile("test/test_files/test_file_7.obj");
+  // Temporary buffers are freed once the file is parsed.
+  EXPECT_EQ(facade.GetMemoryUsage(s21::LoaderFile).current, 0);
+  EXPECT_GT(facade.GetMemoryUsage(s21::LoaderFile).peak, 0);
+  EXPECT_EQ(facade.GetMemoryUsage(s21::LoaderEdges).current, 0);
+  EXPECT_GE(facade.GetMemoryUsage(s21::LoaderEdges).peak,
+            2 * sizeof(s21::Edge));
+  EXPECT_GE(facade.GetMemoryUsage(s21::LoaderVertices).current,
+            6 * sizeof(GLfloat));
+  EXPECT_GE(facade.GetMemoryUsage(s21::LoaderFaces).current,
+            4 * sizeof(GLuint));
+  EXPECT_GE(facade.GetMemoryUsage(s21::ModelVertices).current,
+            6 * sizeof(GLfloat));
+  EXPECT_GE(facade.GetMemoryUsage(s21::ModelIndices).current,
+            4 * sizeof(GLuint));
+  EXPECT_GT(facade.GetPeakRss(), 0);
+}
+
+TEST(AllocationTracker, NestedScopes) {
+  if (!s21::AllocationScope::IsTrackingEnabled()) {
+    GTEST_SKIP() << "built without S21_TRACK_ALLOCATIONS";
+  }
+  s21::AllocationScope outer;
+  auto first = std::make_unique<int>(1);
+  {
+    s21::AllocationScope inner;
+    auto second = std::make_unique<double>(2.0);
+    EXPECT_EQ(inner.GetCounts().allocations, 1);
+    EXPECT_EQ(inner.GetCounts().bytes, sizeof(double));
+  }
+  EXPECT_EQ(outer.GetCounts().allocations, 2);
+  EXPECT_EQ(outer.GetCounts().bytes, sizeof(int) + sizeof(double));
+}
+
+TEST(AllocationTracker, RepeatedTransformsDontAllocate) {
+  if (!s21::AllocationScope::IsTrackingEnabled()) {
+    GTEST_SKIP() << "built without S21_TRACK_ALLOCATIONS";
+  }
+  s21::ModelFacade facade;
+  facade.LoadFile("test/test_files/test_file_1.obj");
+  s21::InputData input = {0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f,
+                          s21::Frustum, 800, 600};
+  s21::AllocationScope scope;
+  for (int i = 0; i < 100; ++i) {
+    input.xRotationAngle = static_cast<float>(i);
+    facade.InteractModel(input, s21::Rotate);
+    input.scale = i % 2 == 0 ? 1.1f : 0.9f;
+    facade.InteractModel(input, s21::Scale);
+    input.xMoveOffset = 0.01f * i;
+    facade.InteractModel(input, s21::Move);
+  }
+  EXPECT_EQ(scope.GetCounts().allocations, 0);
+}
+
+TEST(AllocationTracker, SteadyStateFrameDoesntAllocate) {
+  if (!s21::AllocationScope::IsTrackingEnabled()) {
+    GTEST_SKIP() << "built without S21_TRACK_ALLOCATIONS";
+  }
+  s21::ModelFacade facade;
+  facade.LoadFile("test/test_files/test_file_1.obj");
+  s21::InputData input = {10.0f, 20.0f, 30.0f, 1.0f, 0.1f, 0.0f, 0.0f,
+                          s21::Orthogonal, 1920, 1080};
+  // A frame applies the changed scale and offset, then the rotation
+  // yielding the matrices, like Renderer::ApplyTransform().
+  auto frame = [&facade, &input] {
+    facade.InteractModel(input, s21::Scale);
+    facade.InteractModel(input, s21::Move);
+    return facade.InteractModel(input, s21::Rotate);
+  };
+  frame();
+  s21::AllocationScope scope;
+  for (int i = 0; i < 100; ++i) {
+    frame();
+  }
+  EXPECT_EQ(scope.GetCounts().allocations, 0);
+  EXPECT_EQ(scope.GetCounts().bytes, 0);
+
+  // A point cloud also chooses its points every frame.
+  facade.LoadFile("test/test_files/test_file_8.obj");
+  s21::PointSelection selection;
+  facade.SelectPoints(frame(), input.height, 1 << 20, selection);
+  s21::AllocationScope cloudScope;
+  for (int i = 0; i < 100; ++i) {
+    facade.SelectPoints(frame(), input.height, 1 << 20, selection);
+  }
+  EXPECT_EQ(selection.points, 3);
+  EXPECT_EQ(cloudScope.GetCounts().allocations, 0);
+}
+
 #endif
@@ -5,6 +5,7 @@ layout(triangle_strip, max_vertices = 10) out;
 
 uniform mat4 viewMatrix;
 uniform mat4 projectionMatrix;
+uniform mat4 tileMatrix;  // Сужение проекции до тайла снимка, иначе единичная
 uniform float lineWidth;  // Толщина линии
 uniform float pointSize;  // Размер вершины
 uniform int drawPoints;   // Режим отрисовки вершин: 0 — не рисовать, 1 — квадрат, 2 — круг
@@ -29,25 +30,25 @@ void main(void) {
         isPoint = 0;
         vertexColor = lineColor;
 
-        gl_Position = projectionMatrix * viewMatrix * vec4(p1 + offset, 1.0);
+        gl_Position = tileMatrix * (projectionMatrix * viewMatrix * vec4(p1 + offset, 1.0));
         coord = vec2(0.0, 0.0);
         dashCoord = 0.0;
         pointMode = 0;
         EmitVertex();
 
-        gl_Position = projectionMatrix * viewMatrix * vec4(p1 - offset, 1.0);
+        gl_Position = tileMatrix * (projectionMatrix * viewMatrix * vec4(p1 - offset, 1.0));
         coord = vec2(0.0, 1.0);
         dashCoord = 0.0;
         pointMode = 0;
         EmitVertex();
 
-        gl_Position = projectionMatrix * viewMatrix * vec4(p2 + offset, 1.0);
+        gl_Position = tileMatrix * (projectionMatrix * viewMatrix * vec4(p2 + offset, 1.0));
         coord = vec2(1.0, 0.0);
         dashCoord = 1.0;
         pointMode = 0;
         EmitVertex();
 
-        gl_Position = projectionMatrix * viewMatrix * vec4(p2 - offset, 1.0);
+        gl_Position = tileMatrix * (projectionMatrix * viewMatrix * vec4(p2 - offset, 1.0));
         coord = vec2(1.0, 1.0);
         dashCoord = 1.0;
         pointMode = 0;
@@ -66,25 +67,25 @@ void main(void) {
         vec2 size = vec2(pointSize);
 
         // Вершина 1
-        gl_Position = center1 + vec4(-size.x, -size.y, 0.0, 0.0);
+        gl_Position = tileMatrix * (center1 + vec4(-size.x, -size.y, 0.0, 0.0));
         coord = vec2(0.0, 0.0);
         pointMode = drawPoints;
         dashCoord = 0.0;
         EmitVertex();
 
-        gl_Position = center1 + vec4(size.x, -size.y, 0.0, 0.0);
+        gl_Position = tileMatrix * (center1 + vec4(size.x, -size.y, 0.0, 0.0));
         coord = vec2(1.0, 0.0);
         pointMode = drawPoints;
         dashCoord = 0.0;
         EmitVertex();
 
-        gl_Position = center1 + vec4(-size.x, size.y, 0.0, 0.0);
+        gl_Position = tileMatrix * (center1 + vec4(-size.x, size.y, 0.0, 0.0));
         coord = vec2(0.0, 1.0);
         pointMode = drawPoints;
         dashCoord = 0.0;
         EmitVertex();
 
-        gl_Position = center1 + vec4(size.x, size.y, 0.0, 0.0);
+        gl_Position = tileMatrix * (center1 + vec4(size.x, size.y, 0.0, 0.0));
         coord = vec2(1.0, 1.0);
         pointMode = drawPoints;
         dashCoord = 0.0;
@@ -93,25 +94,25 @@ void main(void) {
         EndPrimitive();
 
         // Вершина 2
-        gl_Position = center2 + vec4(-size.x, -size.y, 0.0, 0.0);
+        gl_Position = tileMatrix * (center2 + vec4(-size.x, -size.y, 0.0, 0.0));
         coord = vec2(0.0, 0.0);
         pointMode = drawPoints;
         dashCoord = 1.0;
         EmitVertex();
 
-        gl_Position = center2 + vec4(size.x, -size.y, 0.0, 0.0);
+        gl_Position = tileMatrix * (center2 + vec4(size.x, -size.y, 0.0, 0.0));
         coord = vec2(1.0, 0.0);
         pointMode = drawPoints;
         dashCoord = 1.0;
         EmitVertex();
 
-        gl_Position = center2 + vec4(-size.x, size.y, 0.0, 0.0);
+        gl_Position = tileMatrix * (center2 + vec4(-size.x, size.y, 0.0, 0.0));
         coord = vec2(0.0, 1.0);
         pointMode = drawPoints;
         dashCoord = 1.0;
         EmitVertex();
 
-        gl_Position = center2 + vec4(size.x, size.y, 0.0, 0.0);
+        gl_Position = tileMatrix * (center2 + vec4(size.x, size.y, 0.0, 0.0));
         coord = vec2(1.0, 1.0);
         pointMode = drawPoints;
         dashCoord = 1.0;
@@ -550,6 +550,202 @@ void GifThresholdImage( const uint8_t* lastFrame, const uint8_t* nextFrame, uint
     }
 }
 
+// Cache of k-d tree searches for one palette: colors quantized to 5 bits per channel
+// map to the palette entry closest to the center of their cell. Entries are filled
+// lazily, 0 marks an empty one since the closest color is never the transparent index.
+#define GIF_LUT_BITS 5
+
+typedef struct
+{
+    uint8_t index[1 << (3 * GIF_LUT_BITS)];
+} GifPaletteLut;
+
+void GifPaletteLutReset( GifPaletteLut* lut )
+{
+    memset(lut->index, 0, sizeof(lut->index));
+}
+
+// key of the cell holding a color
+uint32_t GifPaletteLutKey( uint32_t r, uint32_t g, uint32_t b )
+{
+    const uint32_t shift = 8 - GIF_LUT_BITS;
+    return ((r >> shift) << (2 * GIF_LUT_BITS)) | ((g >> shift) << GIF_LUT_BITS) | (b >> shift);
+}
+
+// computes the cell keys of a whole image, written so the compiler can vectorize it
+void GifPaletteLutKeys( const uint8_t* __restrict image, uint16_t* __restrict keys, size_t numPixels )
+{
+    const uint32_t shift = 8 - GIF_LUT_BITS;
+    for( size_t ii=0; ii<numPixels; ++ii )
+    {
+        const uint8_t* pixel = image + ii*4;
+        keys[ii] = (uint16_t)(((pixel[0] >> shift) << (2 * GIF_LUT_BITS)) |
+                              ((pixel[1] >> shift) << GIF_LUT_BITS) |
+                              (pixel[2] >> shift));
+    }
+}
+
+// picks the palette entry of a cell, searching the k-d tree only the first time
+uint8_t GifPaletteLutFind( GifPaletteLut* lut, GifPalette* pPal, uint32_t key )
+{
+    if( !lut->index[key] )
+    {
+        const uint32_t mask = (1 << GIF_LUT_BITS) - 1;
+        const int shift = 8 - GIF_LUT_BITS;
+        const int half = 1 << (shift - 1);
+        int r = (int)((key >> (2 * GIF_LUT_BITS)) << shift) + half;
+        int g = (int)(((key >> GIF_LUT_BITS) & mask) << shift) + half;
+        int b = (int)((key & mask) << shift) + half;
+
+        int32_t bestDiff = 1000000;
+        int32_t bestInd = 1;
+        GifGetClosestPaletteColor(pPal, r, g, b, &bestInd, &bestDiff, 1);
+        lut->index[key] = (uint8_t)bestInd;
+    }
+    return lut->index[key];
+}
+
+// GifThresholdImage with palette lookups through the cache
+void GifThresholdImageLut( const uint8_t* lastFrame, const uint8_t* nextFrame, uint8_t* outFrame, uint32_t width, uint32_t height, GifPalette* pPal, GifPaletteLut* lut )
+{
+    size_t numPixels = (size_t)width*height;
+    uint16_t* keys = (uint16_t*)GIF_TEMP_MALLOC(numPixels * sizeof(uint16_t));
+    GifPaletteLutKeys(nextFrame, keys, numPixels);
+
+    for( size_t ii=0; ii<numPixels; ++ii )
+    {
+        if(lastFrame &&
+           lastFrame[0] == nextFrame[0] &&
+           lastFrame[1] == nextFrame[1] &&
+           lastFrame[2] == nextFrame[2])
+        {
+            outFrame[0] = lastFrame[0];
+            outFrame[1] = lastFrame[1];
+            outFrame[2] = lastFrame[2];
+            outFrame[3] = kGifTransIndex;
+        }
+        else
+        {
+            uint8_t bestInd = GifPaletteLutFind(lut, pPal, keys[ii]);
+            outFrame[0] = pPal->r[bestInd];
+            outFrame[1] = pPal->g[bestInd];
+            outFrame[2] = pPal->b[bestInd];
+            outFrame[3] = bestInd;
+        }
+
+        if(lastFrame) lastFrame += 4;
+        outFrame += 4;
+        nextFrame += 4;
+    }
+
+    GIF_TEMP_FREE(keys);
+}
+
+// GifDitherImage with palette lookups through the cache
+void GifDitherImageLut( const uint8_t* lastFrame, const uint8_t* nextFrame, uint8_t* outFrame, uint32_t width, uint32_t height, GifPalette* pPal, GifPaletteLut* lut )
+{
+    int numPixels = (int)(width * height);
+
+    // quantPixels initially holds color*256 for all pixels
+    // The extra 8 bits of precision allow for sub-single-color error values
+    // to be propagated
+    int32_t *quantPixels = (int32_t *)GIF_TEMP_MALLOC(sizeof(int32_t) * (size_t)numPixels * 4);
+
+    for( int ii=0; ii<numPixels*4; ++ii )
+    {
+        quantPixels[ii] = (int32_t)nextFrame[ii] * 256;
+    }
+
+    for( uint32_t yy=0; yy<height; ++yy )
+    {
+        for( uint32_t xx=0; xx<width; ++xx )
+        {
+            int32_t* nextPix = quantPixels + 4*(yy*width+xx);
+            const uint8_t* lastPix = lastFrame? lastFrame + 4*(yy*width+xx) : NULL;
+
+            // Compute the colors we want (rounding to nearest)
+            int32_t rr = (nextPix[0] + 127) / 256;
+            int32_t gg = (nextPix[1] + 127) / 256;
+            int32_t bb = (nextPix[2] + 127) / 256;
+
+            // if it happens that we want the color from last frame, then just write out
+            // a transparent pixel
+            if( lastFrame &&
+               lastPix[0] == rr &&
+               lastPix[1] == gg &&
+               lastPix[2] == bb )
+            {
+                nextPix[0] = rr;
+                nextPix[1] = gg;
+                nextPix[2] = bb;
+                nextPix[3] = kGifTransIndex;
+                continue;
+            }
+
+            // propagated error can push a component above 255
+            uint32_t key = GifPaletteLutKey((uint32_t)GifIMin(rr, 255), (uint32_t)GifIMin(gg, 255), (uint32_t)GifIMin(bb, 255));
+            int32_t bestInd = GifPaletteLutFind(lut, pPal, key);
+
+            // Write the result to the temp buffer
+            int32_t r_err = nextPix[0] - (int32_t)(pPal->r[bestInd]) * 256;
+            int32_t g_err = nextPix[1] - (int32_t)(pPal->g[bestInd]) * 256;
+            int32_t b_err = nextPix[2] - (int32_t)(pPal->b[bestInd]) * 256;
+
+            nextPix[0] = pPal->r[bestInd];
+            nextPix[1] = pPal->g[bestInd];
+            nextPix[2] = pPal->b[bestInd];
+            nextPix[3] = bestInd;
+
+            // Propagate the error to the four adjacent locations
+            // that we haven't touched yet
+            int quantloc_7 = (int)(yy * width + xx + 1);
+            int quantloc_3 = (int)(yy * width + width + xx - 1);
+            int quantloc_5 = (int)(yy * width + width + xx);
+            int quantloc_1 = (int)(yy * width + width + xx + 1);
+
+            if(quantloc_7 < numPixels)
+            {
+                int32_t* pix7 = quantPixels+4*quantloc_7;
+                pix7[0] += GifIMax( -pix7[0], r_err * 7 / 16 );
+                pix7[1] += GifIMax( -pix7[1], g_err * 7 / 16 );
+                pix7[2] += GifIMax( -pix7[2], b_err * 7 / 16 );
+            }
+
+            if(quantloc_3 < numPixels)
+            {
+                int32_t* pix3 = quantPixels+4*quantloc_3;
+                pix3[0] += GifIMax( -pix3[0], r_err * 3 / 16 );
+                pix3[1] += GifIMax( -pix3[1], g_err * 3 / 16 );
+                pix3[2] += GifIMax( -pix3[2], b_err * 3 / 16 );
+            }
+
+            if(quantloc_5 < numPixels)
+            {
+                int32_t* pix5 = quantPixels+4*quantloc_5;
+                pix5[0] += GifIMax( -pix5[0], r_err * 5 / 16 );
+                pix5[1] += GifIMax( -pix5[1], g_err * 5 / 16 );
+                pix5[2] += GifIMax( -pix5[2], b_err * 5 / 16 );
+            }
+
+            if(quantloc_1 < numPixels)
+            {
+                int32_t* pix1 = quantPixels+4*quantloc_1;
+                pix1[0] += GifIMax( -pix1[0], r_err / 16 );
+                pix1[1] += GifIMax( -pix1[1], g_err / 16 );
+                pix1[2] += GifIMax( -pix1[2], b_err / 16 );
+            }
+        }
+    }
+
+    // Copy the palettized result to the output buffer
+    for( int ii=0; ii<numPixels*4; ++ii )
+    {
+        outFrame[ii] = (uint8_t)quantPixels[ii];
+    }
+
+    GIF_TEMP_FREE(quantPixels);
+}
+
 // Simple structure to write out the LZW-compressed portion of the image
 // one bit at a time
 typedef struct
@@ -751,6 +947,203 @@ void GifWriteLzwImage(FILE* f, uint8_t* image, uint32_t left, uint32_t top,  uin
     GIF_TEMP_FREE(codetree);
 }
 
+// The fast encoder below produces the same bytes as GifWriteLzwImage, but packs codes
+// a word at a time, keeps the dictionary in a small hash table instead of the 2MB code
+// tree and writes the whole image block with a single fwrite.
+
+// Output buffer of the image block, LZW bytes are split into 255-byte sub-blocks as they are written
+typedef struct
+{
+    uint8_t* data;
+    size_t pos;
+    size_t blockPos;    // position of the length byte of the current sub-block
+    uint32_t blockSize; // bytes in the current sub-block, 255 until the first one is started
+
+    uint32_t bitCount;  // number of pending bits
+    uint64_t bits;      // pending bits, least significant first
+} GifFastWriter;
+
+// append a header byte
+void GifFastPutByte( GifFastWriter* w, uint8_t byte )
+{
+    w->data[w->pos++] = byte;
+}
+
+// append a byte of LZW data
+void GifFastPutDataByte( GifFastWriter* w, uint8_t byte )
+{
+    if( w->blockSize == 255 )
+    {
+        w->blockPos = w->pos++;
+        w->blockSize = 0;
+    }
+    w->data[w->pos++] = byte;
+    w->data[w->blockPos] = (uint8_t)++w->blockSize;
+}
+
+void GifFastWriteCode( GifFastWriter* w, uint32_t code, uint32_t length )
+{
+    w->bits |= (uint64_t)code << w->bitCount;
+    w->bitCount += length;
+    while( w->bitCount >= 8 )
+    {
+        GifFastPutDataByte(w, (uint8_t)w->bits);
+        w->bits >>= 8;
+        w->bitCount -= 8;
+    }
+}
+
+// The LZW dictionary as an open-addressing hash table: (prefix code, next value) -> code.
+// 8192 slots for at most 4096 codes, keys are stored plus one so zero marks a free slot.
+#define GIF_LZW_HASH_SLOTS 8192
+
+typedef struct
+{
+    uint32_t keys[GIF_LZW_HASH_SLOTS];
+    uint16_t codes[GIF_LZW_HASH_SLOTS];
+} GifLzwHash;
+
+uint32_t GifLzwHashSlot( const GifLzwHash* hash, uint32_t key )
+{
+    uint32_t slot = (key * 2654435761u) >> 19;
+    while( hash->keys[slot] && hash->keys[slot] != key )
+        slot = (slot + 1) & (GIF_LZW_HASH_SLOTS - 1);
+    return slot;
+}
+
+// write the image header, LZW-compress and write out the image, same output as GifWriteLzwImage
+void GifWriteLzwImageFast(FILE* f, uint8_t* image, uint32_t left, uint32_t top,  uint32_t width, uint32_t height, uint32_t delay, GifPalette* pPal)
+{
+    // worst case is a 12-bit code per pixel, plus sub-block lengths, headers and the palette
+    size_t capacity = (size_t)width * height * 3 / 2 + (size_t)width * height / 128 + 1024;
+    GifFastWriter w;
+    w.data = (uint8_t*)GIF_TEMP_MALLOC(capacity);
+    w.pos = 0;
+    w.blockPos = 0;
+    w.blockSize = 255;
+    w.bitCount = 0;
+    w.bits = 0;
+
+    // graphics control extension
+    GifFastPutByte(&w, 0x21);
+    GifFastPutByte(&w, 0xf9);
+    GifFastPutByte(&w, 0x04);
+    GifFastPutByte(&w, 0x05); // leave prev frame in place, this frame has transparency
+    GifFastPutByte(&w, (uint8_t)(delay & 0xff));
+    GifFastPutByte(&w, (uint8_t)((delay >> 8) & 0xff));
+    GifFastPutByte(&w, kGifTransIndex); // transparent color index
+    GifFastPutByte(&w, 0);
+
+    GifFastPutByte(&w, 0x2c); // image descriptor block
+
+    GifFastPutByte(&w, (uint8_t)(left & 0xff));           // corner of image in canvas space
+    GifFastPutByte(&w, (uint8_t)((left >> 8) & 0xff));
+    GifFastPutByte(&w, (uint8_t)(top & 0xff));
+    GifFastPutByte(&w, (uint8_t)((top >> 8) & 0xff));
+
+    GifFastPutByte(&w, (uint8_t)(width & 0xff));          // width and height of image
+    GifFastPutByte(&w, (uint8_t)((width >> 8) & 0xff));
+    GifFastPutByte(&w, (uint8_t)(height & 0xff));
+    GifFastPutByte(&w, (uint8_t)((height >> 8) & 0xff));
+
+    GifFastPutByte(&w, (uint8_t)(0x80 + pPal->bitDepth-1)); // local color table present, 2 ^ bitDepth entries
+
+    GifFastPutByte(&w, 0);  // first color: transparency
+    GifFastPutByte(&w, 0);
+    GifFastPutByte(&w, 0);
+    for(int ii=1; ii<(1 << pPal->bitDepth); ++ii)
+    {
+        GifFastPutByte(&w, pPal->r[ii]);
+        GifFastPutByte(&w, pPal->g[ii]);
+        GifFastPutByte(&w, pPal->b[ii]);
+    }
+
+    const int minCodeSize = pPal->bitDepth;
+    const uint32_t clearCode = 1 << pPal->bitDepth;
+
+    GifFastPutByte(&w, (uint8_t)minCodeSize);
+
+    GifLzwHash* hash = (GifLzwHash*)GIF_TEMP_MALLOC(sizeof(GifLzwHash));
+    memset(hash->keys, 0, sizeof(hash->keys));
+
+    int32_t curCode = -1;
+    uint32_t codeSize = (uint32_t)minCodeSize + 1;
+    uint32_t maxCode = clearCode+1;
+
+    GifFastWriteCode(&w, clearCode, codeSize);  // start with a fresh LZW dictionary
+
+    for(uint32_t yy=0; yy<height; ++yy)
+    {
+    #ifdef GIF_FLIP_VERT
+        // bottom-left origin image (such as an OpenGL capture)
+        const uint8_t* row = image + (size_t)(height-1-yy)*width*4;
+    #else
+        // top-left origin
+        const uint8_t* row = image + (size_t)yy*width*4;
+    #endif
+        for(uint32_t xx=0; xx<width; ++xx)
+        {
+            uint8_t nextValue = row[xx*4+3];
+
+            if( curCode < 0 )
+            {
+                // first value in a new run
+                curCode = nextValue;
+                continue;
+            }
+
+            uint32_t key = (((uint32_t)curCode << 8) | nextValue) + 1;
+            uint32_t slot = GifLzwHashSlot(hash, key);
+            if( hash->keys[slot] )
+            {
+                // current run already in the dictionary
+                curCode = hash->codes[slot];
+                continue;
+            }
+
+            // finish the current run, write a code
+            GifFastWriteCode(&w, (uint32_t)curCode, codeSize);
+
+            // insert the new run into the dictionary
+            hash->keys[slot] = key;
+            hash->codes[slot] = (uint16_t)++maxCode;
+
+            if( maxCode >= (1ul << codeSize) )
+            {
+                // dictionary entry count has broken a size barrier,
+                // we need more bits for codes
+                codeSize++;
+            }
+            if( maxCode == 4095 )
+            {
+                // the dictionary is full, clear it out and begin anew
+                GifFastWriteCode(&w, clearCode, codeSize); // clear tree
+
+                memset(hash->keys, 0, sizeof(hash->keys));
+                codeSize = (uint32_t)(minCodeSize + 1);
+                maxCode = clearCode+1;
+            }
+
+            curCode = nextValue;
+        }
+    }
+
+    // compression footer
+    GifFastWriteCode(&w, (uint32_t)curCode, codeSize);
+    GifFastWriteCode(&w, clearCode, codeSize);
+    GifFastWriteCode(&w, clearCode + 1, (uint32_t)minCodeSize + 1);
+
+    // write out the last partial byte
+    if( w.bitCount ) GifFastPutDataByte(&w, (uint8_t)w.bits);
+
+    GifFastPutByte(&w, 0); // image block terminator
+
+    fwrite(w.data, 1, w.pos, f);
+
+    GIF_TEMP_FREE(hash);
+    GIF_TEMP_FREE(w.data);
+}
+
 typedef struct
 {
     FILE* f;
@@ -834,12 +1227,15 @@ bool GifWriteFrame( GifWriter* writer, const uint8_t* image, uint32_t width, uin
     GifPalette pal;
     GifMakePalette((dither? NULL : oldImage), image, width, height, bitDepth, dither, &pal);
 
+    GifPaletteLut* lut = (GifPaletteLut*)GIF_TEMP_MALLOC(sizeof(GifPaletteLut));
+    GifPaletteLutReset(lut);
     if(dither)
-        GifDitherImage(oldImage, image, writer->oldImage, width, height, &pal);
+        GifDitherImageLut(oldImage, image, writer->oldImage, width, height, &pal, lut);
     else
-        GifThresholdImage(oldImage, image, writer->oldImage, width, height, &pal);
+        GifThresholdImageLut(oldImage, image, writer->oldImage, width, height, &pal, lut);
+    GIF_TEMP_FREE(lut);
 
-    GifWriteLzwImage(writer->f, writer->oldImage, 0, 0, width, height, delay, &pal);
+    GifWriteLzwImageFast(writer->f, writer->oldImage, 0, 0, width, height, delay, &pal);
 
     return true;
 }
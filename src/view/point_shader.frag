@@ -0,0 +1,13 @@
+#version 330 core
+
+uniform vec4 pointColor;  // Цвет точек
+uniform int pointStyle;   // 1 - квадрат, 2 - круг
+out vec4 finalColor;
+
+void main() {
+    if (pointStyle == 2 && length(gl_PointCoord - vec2(0.5)) > 0.5) {
+        discard;
+    }
+
+    finalColor = pointColor;
+}
@@ -0,0 +1,15 @@
+#version 330 core
+
+layout(location = 0) in vec3 vertex;
+
+uniform mat4 modelMatrix;
+uniform mat4 viewMatrix;
+uniform mat4 projectionMatrix;
+uniform mat4 tileMatrix;  // Сужение проекции до тайла снимка, иначе единичная
+uniform float pointSize;  // Размер точки в пикселях
+
+void main(void)
+{
+    gl_Position = tileMatrix * (projectionMatrix * viewMatrix * modelMatrix * vec4(vertex, 1.0));
+    gl_PointSize = pointSize;
+}
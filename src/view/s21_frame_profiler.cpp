@@ -0,0 +1,151 @@
+/**
+ * @file s21_frame_profiler.cpp
+ * @brief Frame time profiler implementation.
+ */
+
+#include "s21_frame_profiler.h"
+
+#include <algorithm>
+#include <fstream>
+
+namespace s21 {
+
+namespace {
+
+double ElapsedMs(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+}  // namespace
+
+FrameProfiler::FrameProfiler() { Reset(); }
+
+void FrameProfiler::BeginFrame(std::size_t vertices, std::size_t edges) {
+  FrameRecord &record = history[framesCount % kHistorySize];
+  record.index = framesCount++;
+  record.stageMs.fill(0.0);
+  record.paintMs = 0.0;
+  record.gpuMs = -1.0;
+  record.vertices = vertices;
+  record.edges = edges;
+  record.allocations = 0;
+  paintStart = Clock::now();
+}
+
+void FrameProfiler::EndFrame(std::size_t allocations) {
+  Current().paintMs = ElapsedMs(paintStart);
+  Current().allocations = allocations;
+}
+
+void FrameProfiler::AddStageTime(FrameStage stage, double ms) {
+  if (framesCount != 0) {
+    Current().stageMs[stage] += ms;
+  }
+}
+
+void FrameProfiler::SetGpuTime(std::uint64_t frameIndex, double ms) {
+  FrameRecord &record = history[frameIndex % kHistorySize];
+  if (frameIndex < framesCount && record.index == frameIndex) {
+    record.gpuMs = ms;
+  }
+}
+
+void FrameProfiler::SetStageTime(std::uint64_t frameIndex, FrameStage stage,
+                                 double ms) {
+  FrameRecord &record = history[frameIndex % kHistorySize];
+  if (frameIndex < framesCount && record.index == frameIndex) {
+    record.stageMs[stage] = ms;
+  }
+}
+
+std::uint64_t FrameProfiler::GetCurrentFrame() const {
+  return framesCount == 0 ? 0 : framesCount - 1;
+}
+
+FrameSummary FrameProfiler::Summarize() const {
+  FrameSummary summary{};
+  std::size_t count = std::min<std::uint64_t>(framesCount, kHistorySize);
+  summary.frames = count;
+  if (count == 0) {
+    return summary;
+  }
+
+  double vertices = 0.0, edges = 0.0, allocations = 0.0;
+  for (std::size_t i = 0; i < count; ++i) {
+    scratch[i] = history[i].paintMs + history[i].stageMs[SwapStage];
+    vertices += history[i].vertices;
+    edges += history[i].edges;
+    allocations += history[i].allocations;
+  }
+  summary.allocationsPerFrame = allocations / count;
+  summary.p50 = Percentile(count, 0.50);
+  summary.p95 = Percentile(count, 0.95);
+  summary.p99 = Percentile(count, 0.99);
+  if (summary.p50 > 0.0) {
+    summary.verticesPerSecond = vertices / count / (summary.p50 / 1000.0);
+    summary.edgesPerSecond = edges / count / (summary.p50 / 1000.0);
+  }
+
+  std::size_t gpuCount = 0;
+  for (std::size_t i = 0; i < count; ++i) {
+    if (history[i].gpuMs >= 0.0) {
+      scratch[gpuCount++] = history[i].gpuMs;
+    }
+  }
+  if (gpuCount != 0) {
+    summary.gpuP50 = Percentile(gpuCount, 0.50);
+    summary.gpuP95 = Percentile(gpuCount, 0.95);
+  }
+  return summary;
+}
+
+bool FrameProfiler::ExportCsv(const std::string &filename) const {
+  std::ofstream file(filename);
+  if (!file.is_open()) {
+    return false;
+  }
+  file << "frame,interact_ms,uniforms_ms,draw_ms,swap_ms,paint_ms,gpu_ms,"
+          "vertices,edges,allocations\n";
+  std::uint64_t first =
+      framesCount > kHistorySize ? framesCount - kHistorySize : 0;
+  for (std::uint64_t i = first; i < framesCount; ++i) {
+    const FrameRecord &record = history[i % kHistorySize];
+    file << record.index << ',' << record.stageMs[InteractStage] << ','
+         << record.stageMs[UniformsStage] << ',' << record.stageMs[DrawStage]
+         << ',' << record.stageMs[SwapStage] << ',' << record.paintMs << ','
+         << record.gpuMs << ',' << record.vertices << ',' << record.edges
+         << ',' << record.allocations << '\n';
+  }
+  return file.good();
+}
+
+void FrameProfiler::Reset() {
+  framesCount = 0;
+  history.fill(FrameRecord{});
+  paintStart = Clock::now();
+}
+
+FrameRecord &FrameProfiler::Current() {
+  return history[GetCurrentFrame() % kHistorySize];
+}
+
+double FrameProfiler::Percentile(std::size_t count, double percentile) const {
+  std::size_t rank = static_cast<std::size_t>(percentile * (count - 1) + 0.5);
+  std::nth_element(scratch.begin(), scratch.begin() + rank,
+                   scratch.begin() + count);
+  return scratch[rank];
+}
+
+ScopedStageTimer::ScopedStageTimer(FrameProfiler &frameProfiler,
+                                   FrameStage frameStage)
+    : profiler(frameProfiler),
+      stage(frameStage),
+      start(std::chrono::steady_clock::now()) {}
+
+ScopedStageTimer::~ScopedStageTimer() {
+  profiler.AddStageTime(stage, ElapsedMs(start));
+}
+
+}  // namespace s21
@@ -0,0 +1,171 @@
+/**
+ * @file s21_frame_profiler.h
+ * @brief Frame time profiler header file.
+ */
+
+#ifndef S21_FRAME_PROFILER_H
+#define S21_FRAME_PROFILER_H
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace s21 {
+
+/**
+ * @brief Stages of a frame that are measured separately.
+ **/
+enum FrameStage {
+    InteractStage, ///< Controller::InteractModel call.
+    UniformsStage, ///< Shader binding and uniforms setup.
+    DrawStage,     ///< Buffers binding and draw call submission.
+    SwapStage,     ///< Time from publishing the frame to the swap of the composited window.
+    StagesCount    ///< Number of measured stages.
+};
+
+/**
+ * @brief Measurements of a single frame.
+ **/
+struct FrameRecord {
+    std::uint64_t index; ///< Sequential number of the frame.
+    std::array<double, StagesCount> stageMs; ///< CPU time of each stage in milliseconds.
+    double paintMs; ///< CPU time of rendering the frame in milliseconds.
+    double gpuMs; ///< GPU time of the frame in milliseconds, negative until the timer query is resolved.
+    std::size_t vertices; ///< Number of vertices in the drawn model.
+    std::size_t edges; ///< Number of edges submitted by the draw call.
+    std::size_t allocations; ///< Heap allocations made while rendering the frame.
+};
+
+/**
+ * @brief Rolling statistics over the stored frames.
+ **/
+struct FrameSummary {
+    std::size_t frames; ///< Number of frames the statistics are based on.
+    double p50; ///< Median frame time (rendering + presentation) in milliseconds.
+    double p95; ///< 95th percentile of frame time in milliseconds.
+    double p99; ///< 99th percentile of frame time in milliseconds.
+    double gpuP50; ///< Median GPU time in milliseconds.
+    double gpuP95; ///< 95th percentile of GPU time in milliseconds.
+    double verticesPerSecond; ///< Vertex throughput at the median frame time.
+    double edgesPerSecond; ///< Edge throughput at the median frame time.
+    double allocationsPerFrame; ///< Mean heap allocations of rendering a frame, see AllocationScope.
+};
+
+/**
+ * @brief Collects per-frame timings in a fixed-size ring buffer.
+ * Recording a frame never allocates, so the profiler can stay enabled
+ * in the render loop.
+ **/
+class FrameProfiler
+{
+public:
+    static constexpr std::size_t kHistorySize = 1024; ///< Number of frames kept for statistics and export.
+
+    FrameProfiler();
+
+    /**
+   * @brief Opens a new frame record.
+   * @param vertices Number of vertices of the drawn model.
+   * @param edges Number of edges of the drawn model.
+   **/
+    void BeginFrame(std::size_t vertices, std::size_t edges);
+
+    /**
+   * @brief Closes the rendering part of the current frame.
+   * @param allocations Heap allocations made while rendering the frame.
+   **/
+    void EndFrame(std::size_t allocations);
+
+    /**
+   * @brief Adds time to a stage of the most recent frame.
+   * @param stage Measured stage.
+   * @param ms Duration in milliseconds.
+   **/
+    void AddStageTime(FrameStage stage, double ms);
+
+    /**
+   * @brief Stores the resolved GPU time of a frame.
+   * Ignored if the frame has already left the history.
+   * @param frameIndex Sequential number of the frame.
+   * @param ms GPU time in milliseconds.
+   **/
+    void SetGpuTime(std::uint64_t frameIndex, double ms);
+
+    /**
+   * @brief Sets the time of a stage measured after the frame was closed.
+   * Ignored if the frame has already left the history.
+   * @param frameIndex Sequential number of the frame.
+   * @param stage Measured stage.
+   * @param ms Duration in milliseconds.
+   **/
+    void SetStageTime(std::uint64_t frameIndex, FrameStage stage, double ms);
+
+    /**
+   * @brief Getter of the sequential number of the most recent frame.
+   * @return Frame number.
+   **/
+    std::uint64_t GetCurrentFrame() const;
+
+    /**
+   * @brief Calculates percentiles and throughput over the stored frames.
+   * @return Summary of the stored frames.
+   **/
+    FrameSummary Summarize() const;
+
+    /**
+   * @brief Writes every stored frame into a .csv file.
+   * @param filename Output file name.
+   * @return true in case of success, false otherwise.
+   **/
+    bool ExportCsv(const std::string& filename) const;
+
+    /**
+   * @brief Removes all stored frames.
+   **/
+    void Reset();
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    std::array<FrameRecord, kHistorySize> history; ///< Ring buffer of frame records.
+    std::uint64_t framesCount; ///< Number of frames recorded since the last reset.
+    Clock::time_point paintStart; ///< Start of rendering the current frame.
+    mutable std::array<double, kHistorySize> scratch; ///< Preallocated buffer for percentile selection.
+
+    /**
+   * @brief Gets the record of the most recent frame.
+   * @return Reference to the frame record.
+   **/
+    FrameRecord& Current();
+
+    /**
+   * @brief Selects a percentile from the first count values of the scratch buffer.
+   * @param count Number of valid values.
+   * @param percentile Percentile in range from 0 to 1.
+   * @return Value of the percentile.
+   **/
+    double Percentile(std::size_t count, double percentile) const;
+};
+
+/**
+ * @brief RAII timer that adds its lifetime to a stage of the current frame.
+ **/
+class ScopedStageTimer
+{
+public:
+    ScopedStageTimer(FrameProfiler& frameProfiler, FrameStage frameStage);
+    ~ScopedStageTimer();
+    ScopedStageTimer(const ScopedStageTimer& other) = delete;
+    ScopedStageTimer& operator=(const ScopedStageTimer& other) = delete;
+
+private:
+    FrameProfiler& profiler; ///< Profiler that receives the measurement.
+    FrameStage stage; ///< Measured stage.
+    std::chrono::steady_clock::time_point start; ///< Moment the timer was created.
+};
+
+} // namespace s21
+
+#endif // S21_FRAME_PROFILER_H
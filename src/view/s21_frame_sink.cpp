@@ -0,0 +1,134 @@
+/**
+ * @file s21_frame_sink.cpp
+ * @brief Screencast output formats implementation.
+ */
+
+#include "s21_frame_sink.h"
+
+#include <cstdio>
+#include <filesystem>
+#include <system_error>
+
+namespace s21 {
+
+namespace {
+
+/**
+ * @brief Quality passed to QImage::save(), Qt maps it to zlib level 1.
+ */
+constexpr int kPngQuality = 85;
+
+}  // namespace
+
+GifFrameSink::GifFrameSink(GifRecorder &recorder) : recorder(recorder) {}
+
+bool GifFrameSink::Open(const std::string &outputPath, int width, int height,
+                        int fps) {
+  lastImage = QImage();
+  return recorder.CreateGif(outputPath, width, height, fps);
+}
+
+void GifFrameSink::Write(const QImage &image) {
+  lastImage = image;
+  recorder.AddImage(image);
+}
+
+void GifFrameSink::Repeat() { recorder.AddImage(lastImage); }
+
+void GifFrameSink::Close() {
+  recorder.CompleteGIF();
+  lastImage = QImage();
+}
+
+PngSequenceSink::PngSequenceSink() : frameIndex(0) {}
+
+bool PngSequenceSink::Open(const std::string &outputPath, int, int, int) {
+  basePath = std::filesystem::path(outputPath).replace_extension().string();
+  frameIndex = 0;
+  return !basePath.empty();
+}
+
+void PngSequenceSink::Write(const QImage &image) {
+  image.save(QString::fromStdString(Filename(frameIndex)), "PNG", kPngQuality);
+  frameIndex++;
+}
+
+void PngSequenceSink::Repeat() {
+  std::string previous = Filename(frameIndex - 1);
+  std::string next = Filename(frameIndex);
+  std::error_code error;
+  std::filesystem::create_hard_link(previous, next, error);
+  if (error) {
+    std::filesystem::copy_file(
+        previous, next, std::filesystem::copy_options::overwrite_existing,
+        error);
+  }
+  frameIndex++;
+}
+
+std::string PngSequenceSink::Filename(int index) const {
+  char number[16];
+  std::snprintf(number, sizeof(number), "_%06d.png", index);
+  return basePath + number;
+}
+
+Y4mSink::Y4mSink() : file(nullptr) {}
+
+Y4mSink::~Y4mSink() { Close(); }
+
+bool Y4mSink::Open(const std::string &outputPath, int width, int height,
+                   int fps) {
+  Close();
+  file = std::fopen(outputPath.c_str(), "wb");
+  if (!file) {
+    return false;
+  }
+  frame.assign(static_cast<std::size_t>(width) * height * 3, 0);
+  std::fprintf(file, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C444 XCOLORRANGE=FULL\n",
+               width, height, fps);
+  return true;
+}
+
+void Y4mSink::Write(const QImage &image) {
+  std::size_t pixels = frame.size() / 3;
+  const uint8_t *rgba = image.constBits();
+  uint8_t *y = frame.data();
+  uint8_t *u = y + pixels;
+  uint8_t *v = u + pixels;
+  // Full-range BT.601 in 16-bit fixed point, every result fits into a byte.
+  for (std::size_t i = 0; i < pixels; ++i, rgba += 4) {
+    int r = rgba[0], g = rgba[1], b = rgba[2];
+    y[i] = static_cast<uint8_t>((19595 * r + 38470 * g + 7471 * b + 32768) >> 16);
+    u[i] = static_cast<uint8_t>(
+        (-11056 * r - 21712 * g + 32768 * b + (128 << 16) + 32768) >> 16);
+    v[i] = static_cast<uint8_t>(
+        (32768 * r - 27440 * g - 5328 * b + (128 << 16) + 32768) >> 16);
+  }
+  Repeat();
+}
+
+void Y4mSink::Repeat() {
+  std::fputs("FRAME\n", file);
+  std::fwrite(frame.data(), 1, frame.size(), file);
+}
+
+void Y4mSink::Close() {
+  if (file) {
+    std::fclose(file);
+    file = nullptr;
+  }
+}
+
+std::unique_ptr<FrameSink> CreateFrameSink(CaptureFormat format,
+                                           GifRecorder &recorder) {
+  switch (format) {
+    case CaptureFormat::PngSequence:
+      return std::make_unique<PngSequenceSink>();
+    case CaptureFormat::Y4m:
+      return std::make_unique<Y4mSink>();
+    default:
+      return std::make_unique<GifFrameSink>(recorder);
+  }
+}
+
+}  // namespace s21
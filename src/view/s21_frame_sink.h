@@ -0,0 +1,142 @@
+/**
+ * @file s21_frame_sink.h
+ * @brief Screencast output formats header file.
+ */
+
+#ifndef S21_FRAME_SINK_H
+#define S21_FRAME_SINK_H
+
+#include <QImage>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+#include "s21_gif_recorder.h"
+
+namespace s21 {
+
+/**
+ * @brief Output format of a screencast.
+ **/
+enum class CaptureFormat {
+    Gif, ///< Animated gif.
+    PngSequence, ///< Numbered lossless .png files, one per frame.
+    Y4m ///< Uncompressed YUV 4:4:4 stream.
+};
+
+/**
+ * @brief Destination of screencast frames, written incrementally in frame order.
+ * All methods are called from one thread.
+ **/
+class FrameSink
+{
+public:
+    virtual ~FrameSink() = default;
+
+    /**
+   * @brief Creates the output.
+   * @param outputPath Filename of the output, numbered files of a sequence are derived from it.
+   * @param width Width of the frames.
+   * @param height Height of the frames.
+   * @param fps Number of frames per second.
+   * @return true if the output was created, false otherwise.
+   **/
+    virtual bool Open(const std::string& outputPath, int width, int height, int fps) = 0;
+
+    /**
+   * @brief Appends a frame.
+   * @param image RGBA8888 image of the frame size.
+   **/
+    virtual void Write(const QImage& image) = 0;
+
+    /**
+   * @brief Shows the last written frame for one more frame, keeping later frames at their timestamps.
+   **/
+    virtual void Repeat() = 0;
+
+    /**
+   * @brief Completes the output.
+   **/
+    virtual void Close() = 0;
+};
+
+/**
+ * @brief Writes frames to a gif through a GifRecorder.
+ * A repeated frame shares the pixels of the previous one and is encoded as a single pixel.
+ **/
+class GifFrameSink : public FrameSink
+{
+public:
+    /**
+   * @brief Constructor of the GifFrameSink class.
+   * @param recorder Encoder of the gif, must outlive the sink.
+   **/
+    explicit GifFrameSink(GifRecorder& recorder);
+
+    bool Open(const std::string& outputPath, int width, int height, int fps) override;
+    void Write(const QImage& image) override;
+    void Repeat() override;
+    void Close() override;
+
+private:
+    GifRecorder& recorder; ///< Encoder of the gif.
+    QImage lastImage; ///< Last written frame.
+};
+
+/**
+ * @brief Writes every frame to its own .png file, "name.gif" becomes "name_000000.png", "name_000001.png"...
+ * Files are saved with the fastest compression level, a repeated frame is a hard link to the previous file.
+ **/
+class PngSequenceSink : public FrameSink
+{
+public:
+    PngSequenceSink();
+
+    bool Open(const std::string& outputPath, int width, int height, int fps) override;
+    void Write(const QImage& image) override;
+    void Repeat() override;
+    void Close() override {}
+
+private:
+    /**
+   * @brief Private method to build the filename of a frame.
+   * @param index Number of the frame.
+   * @return Filename.
+   **/
+    std::string Filename(int index) const;
+
+    std::string basePath; ///< Output filename without the extension.
+    int frameIndex; ///< Number of the next frame.
+};
+
+/**
+ * @brief Writes frames to a YUV4MPEG2 stream, readable by ffmpeg and most video players.
+ * Pixels are converted to full-range BT.601 YUV without chroma subsampling.
+ **/
+class Y4mSink : public FrameSink
+{
+public:
+    Y4mSink();
+    ~Y4mSink() override;
+
+    bool Open(const std::string& outputPath, int width, int height, int fps) override;
+    void Write(const QImage& image) override;
+    void Repeat() override;
+    void Close() override;
+
+private:
+    std::FILE* file; ///< Output stream.
+    std::vector<uint8_t> frame; ///< Y, U and V planes of the last frame.
+};
+
+/**
+ * @brief Creates the sink of a format.
+ * @param format Output format.
+ * @param recorder Encoder used by gif sinks, must outlive the sink.
+ * @return New sink.
+ **/
+std::unique_ptr<FrameSink> CreateFrameSink(CaptureFormat format, GifRecorder& recorder);
+
+} // namespace s21
+
+#endif // S21_FRAME_SINK_H
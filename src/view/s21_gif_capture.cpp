@@ -0,0 +1,194 @@
+/**
+ * @file s21_gif_capture.cpp
+ * @brief Offscreen GIF capture implementation.
+ */
+
+#include "s21_gif_capture.h"
+
+namespace s21 {
+
+GifCapture::GifCapture(FrameRenderer frameRenderer)
+    : renderFrame(std::move(frameRenderer)),
+      recording(false),
+      cancelled(false),
+      finished(false),
+      requestedFrames(0),
+      framesInFlight(0),
+      stats() {}
+
+GifCapture::~GifCapture() {
+  Cancel();
+  Join();
+}
+
+bool GifCapture::Start(const GifSettings& settings, const RenderState& state) {
+  if (recording.load() || settings.width <= 0 || settings.height <= 0 ||
+      settings.frameCount < 0 || settings.fps <= 0 ||
+      settings.queueCapacity <= 0) {
+    return false;
+  }
+  Join();
+  {
+    std::lock_guard<std::mutex> lock(statesMutex);
+    cancelled = false;
+    start = Clock::now();
+    states.clear();
+    states.emplace_back(start, state);
+  }
+  recording.store(true);
+  captureThread = std::thread(&GifCapture::Run, this, settings);
+  return true;
+}
+
+void GifCapture::PushState(const RenderState& state) {
+  if (!recording.load(std::memory_order_relaxed)) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(statesMutex);
+  states.emplace_back(Clock::now(), state);
+}
+
+void GifCapture::Cancel() {
+  {
+    std::lock_guard<std::mutex> lock(statesMutex);
+    cancelled = true;
+  }
+  wakeUp.notify_all();
+}
+
+void GifCapture::Join() {
+  if (captureThread.joinable()) {
+    captureThread.join();
+  }
+}
+
+bool GifCapture::IsRecording() const { return recording.load(); }
+
+GifStats GifCapture::GetStats() { return recorder.GetStats(); }
+
+CaptureStats GifCapture::GetCaptureStats() {
+  std::lock_guard<std::mutex> lock(statesMutex);
+  return stats;
+}
+
+void GifCapture::Run(GifSettings settings) {
+  Tracer::Instance().SetThreadName("Capture");
+  recorder.SetDithering(settings.dither);
+  std::unique_ptr<FrameSink> sink = CreateFrameSink(settings.format, recorder);
+  if (sink->Open(settings.outputPath, settings.width, settings.height,
+                 settings.fps)) {
+    {
+      std::lock_guard<std::mutex> lock(statesMutex);
+      finished = false;
+      requestedFrames = 0;
+      framesInFlight = 0;
+      stats = CaptureStats();
+    }
+    std::thread writer(&GifCapture::WriteFrames, this, sink.get());
+    Clock::duration interval = std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(1.0 / settings.fps));
+    for (int i = 0; settings.frameCount == 0 || i < settings.frameCount; ++i) {
+      Clock::time_point frameTime =
+          start + std::chrono::duration_cast<Clock::duration>(
+                      std::chrono::duration<double>(1.0 * i / settings.fps));
+      if (!WaitForFrame(frameTime)) {
+        break;
+      }
+      RenderState state;
+      bool dropped;
+      {
+        std::lock_guard<std::mutex> lock(statesMutex);
+        state = StateAt(frameTime);
+        requestedFrames = i + 1;
+        // A full queue drops the frame instead of blocking, so later frames
+        // keep their timestamps and memory stays bounded.
+        dropped = framesInFlight >= settings.queueCapacity;
+        if (dropped) {
+          frames[i] = {QImage(), false};
+          stats.dropped++;
+        } else {
+          framesInFlight++;
+        }
+      }
+      if (dropped) {
+        frameReady.notify_one();
+        continue;
+      }
+      state.width = settings.width;
+      state.height = settings.height;
+      Clock::time_point deadline = frameTime + interval;
+      renderFrame(state, [this, i, deadline](QImage image) {
+        {
+          std::lock_guard<std::mutex> lock(statesMutex);
+          if (Clock::now() > deadline) {
+            stats.late++;
+          }
+          frames[i] = {std::move(image), true};
+        }
+        frameReady.notify_one();
+      });
+    }
+    {
+      std::lock_guard<std::mutex> lock(statesMutex);
+      finished = true;
+    }
+    frameReady.notify_one();
+    // Requested frames are still received after a cancellation, the receiver
+    // refers to this object.
+    writer.join();
+    sink->Close();
+  }
+  {
+    std::lock_guard<std::mutex> lock(statesMutex);
+    states.clear();
+    frames.clear();
+  }
+  recording.store(false);
+}
+
+void GifCapture::WriteFrames(FrameSink* sink) {
+  Tracer::Instance().SetThreadName("Capture writer");
+  bool written = false;
+  std::unique_lock<std::mutex> lock(statesMutex);
+  for (int next = 0;; ++next) {
+    frameReady.wait(lock, [this, next] {
+      return frames.count(next) || (finished && next >= requestedFrames);
+    });
+    auto frame = frames.find(next);
+    if (frame == frames.end()) {
+      break;
+    }
+    CapturedFrame captured = std::move(frame->second);
+    frames.erase(frame);
+    lock.unlock();
+    // While a model is loading the previous frame is repeated, so later
+    // frames keep their timestamps.
+    if (!captured.image.isNull()) {
+      sink->Write(captured.image);
+      written = true;
+    } else if (written) {
+      sink->Repeat();
+    }
+    captured.image = QImage();
+    lock.lock();
+    if (captured.rendered) {
+      framesInFlight--;
+    }
+    stats.frames++;
+  }
+}
+
+bool GifCapture::WaitForFrame(Clock::time_point frameTime) {
+  std::unique_lock<std::mutex> lock(statesMutex);
+  wakeUp.wait_until(lock, frameTime, [this] { return cancelled; });
+  return !cancelled;
+}
+
+RenderState GifCapture::StateAt(Clock::time_point time) {
+  while (states.size() > 1 && states[1].first <= time) {
+    states.pop_front();
+  }
+  return states.front().second;
+}
+
+}  // namespace s21
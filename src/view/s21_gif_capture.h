@@ -0,0 +1,182 @@
+/**
+ * @file s21_gif_capture.h
+ * @brief Offscreen GIF capture header file.
+ */
+
+#ifndef S21_GIF_CAPTURE_H
+#define S21_GIF_CAPTURE_H
+
+#include <QImage>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include "s21_frame_sink.h"
+#include "s21_gif_recorder.h"
+#include "s21_renderer.h"
+
+namespace s21 {
+
+/**
+ * @brief Parameters of a screencast.
+ **/
+struct GifSettings {
+    int width; ///< Width of frames.
+    int height; ///< Height of frames.
+    int frameCount; ///< Number of recorded frames, 0 records until cancelled.
+    int fps; ///< Number of frames per second.
+    std::string outputPath; ///< Filename of the recording.
+    bool dither; ///< Whether gif frames with many colors are dithered.
+    CaptureFormat format; ///< Output format.
+    int queueCapacity; ///< Frames that can be rendered or waiting for the output at once.
+};
+
+/**
+ * @brief Frame counters of a screencast.
+ **/
+struct CaptureStats {
+    std::size_t frames; ///< Number of frames passed to the output, including dropped ones.
+    std::size_t dropped; ///< Frames not rendered because the queue was full, the previous frame is repeated instead.
+    std::size_t late; ///< Frames read back more than one frame interval after their timestamp.
+};
+
+/**
+ * @brief Records a screencast on its own threads.
+ * Frame i shows the UI state as it was at start + i / fps, rendered offscreen at the
+ * recording resolution. If rendering or encoding falls behind, frames are still produced
+ * for their timestamps instead of drifting, and the visible widget is never involved.
+ * Renders are requested without waiting, read back images go through a bounded queue
+ * to a writer thread that streams them to the output. When the queue is full the frame
+ * is dropped and the previous one repeated, so memory doesn't grow with the duration.
+ **/
+class GifCapture
+{
+public:
+    /**
+   * @brief Callback requesting an offscreen render of a state, called on the capture thread.
+   * It returns without waiting for the frame, the receiver gets the image later.
+   * The size of the image is given by the width and height of the state.
+   **/
+    using FrameRenderer = std::function<void(const RenderState& state, ImageReceiver receiver)>;
+
+    /**
+   * @brief Constructor of the GifCapture class.
+   * @param frameRenderer Callback rendering frames.
+   **/
+    explicit GifCapture(FrameRenderer frameRenderer);
+    GifCapture() = delete;
+    GifCapture(const GifCapture& other) = delete;
+    GifCapture& operator=(const GifCapture& other) = delete;
+
+    /**
+   * @brief Cancels the recording and waits for the capture thread.
+   **/
+    ~GifCapture();
+
+    /**
+   * @brief Starts recording.
+   * @param settings Parameters of the recording.
+   * @param state UI state at the start of the recording.
+   * @return false if a recording is already running or the settings are invalid.
+   **/
+    bool Start(const GifSettings& settings, const RenderState& state);
+
+    /**
+   * @brief Stores a UI state with the current timestamp.
+   * Cheap when no recording is running.
+   * @param state New UI state.
+   **/
+    void PushState(const RenderState& state);
+
+    /**
+   * @brief Stops the recording after the frame being rendered, the file stays valid.
+   **/
+    void Cancel();
+
+    /**
+   * @brief Waits for the capture thread to finish.
+   **/
+    void Join();
+
+    /**
+   * @brief Checks whether a recording is running.
+   * @return true if recording.
+   **/
+    bool IsRecording() const;
+
+    /**
+   * @brief Getter of the data written by the current or the last gif recording.
+   * @return Statistics of the written frames.
+   **/
+    GifStats GetStats();
+
+    /**
+   * @brief Getter of the frame counters of the current or the last recording.
+   * @return Frame counters.
+   **/
+    CaptureStats GetCaptureStats();
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    /**
+   * @brief Frame waiting for the writer.
+   **/
+    struct CapturedFrame {
+        QImage image; ///< Read back image, null to repeat the previous frame.
+        bool rendered; ///< Whether the frame was rendered and counts against the queue capacity.
+    };
+
+    /**
+   * @brief Thread method. Requests a render of every frame at its timestamp.
+   * @param settings Parameters of the recording.
+   **/
+    void Run(GifSettings settings);
+
+    /**
+   * @brief Thread method of the writer. Passes captured frames to the output in order.
+   * @param sink Output of the recording.
+   **/
+    void WriteFrames(FrameSink* sink);
+
+    /**
+   * @brief Waits for the timestamp of a frame.
+   * @param frameTime Timestamp of the frame.
+   * @return false if the recording was cancelled.
+   **/
+    bool WaitForFrame(Clock::time_point frameTime);
+
+    /**
+   * @brief Takes the state that was current at the given moment.
+   * Older states are discarded. Must be called with the mutex locked.
+   * @param time Timestamp of the frame.
+   * @return UI state.
+   **/
+    RenderState StateAt(Clock::time_point time);
+
+    FrameRenderer renderFrame; ///< Callback rendering frames.
+    GifRecorder recorder; ///< Encoder of gif recordings.
+    std::thread captureThread; ///< Thread running Run().
+    std::atomic<bool> recording; ///< Whether a recording is running.
+    std::mutex statesMutex; ///< Guards states, the frame queue and the counters.
+    std::condition_variable wakeUp; ///< Wakes the capture thread on cancellation.
+    std::condition_variable frameReady; ///< Wakes the writer.
+    bool cancelled; ///< Whether the recording was cancelled.
+    bool finished; ///< Whether all frames of the recording were requested.
+    Clock::time_point start; ///< Timestamp of the first frame.
+    std::deque<std::pair<Clock::time_point, RenderState>> states; ///< Timestamped UI states.
+    std::map<int, CapturedFrame> frames; ///< Captured frames by their numbers.
+    int requestedFrames; ///< Number of frames requested so far.
+    int framesInFlight; ///< Frames rendered or waiting for the writer.
+    CaptureStats stats; ///< Frame counters.
+};
+
+} // namespace s21
+
+#endif // S21_GIF_CAPTURE_H
@@ -0,0 +1,236 @@
+/**
+ * @file s21_gif_frame.h
+ * @brief Pixel operations on the frames of a GIF header file.
+ */
+
+#ifndef S21_GIF_FRAME_H
+#define S21_GIF_FRAME_H
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+namespace s21 {
+
+/**
+ * @brief Reads the RGB components of a pixel as one value.
+ * @param pixel RGBA pixel.
+ * @return Color in the lower 24 bits.
+ **/
+inline uint32_t PixelColor(const uint8_t* pixel)
+{
+    return pixel[0] | (pixel[1] << 8) | (pixel[2] << 16);
+}
+
+/**
+ * @brief Checks whether a pixel differs from the pixel of the previous frame.
+ * @param previous Pixel of the previous frame, nullptr for the first frame.
+ * @param pixel Pixel of the frame.
+ * @return true if the pixel has to be encoded.
+ **/
+inline bool PixelChanged(const uint8_t* previous, const uint8_t* pixel)
+{
+    return previous == nullptr || previous[0] != pixel[0] || previous[1] != pixel[1] ||
+           previous[2] != pixel[2];
+}
+
+/**
+ * @brief Palette holding every color of a frame, colors are found by an
+ * open-addressing hash table instead of the k-d tree search.
+ **/
+struct ExactPalette {
+    static constexpr std::size_t kMaxColors = 255; ///< Index 0 is transparent.
+    static constexpr uint8_t kTransparentIndex = 0; ///< Index of unchanged pixels.
+    static constexpr std::size_t kSlots = 512; ///< Size of the hash table.
+    static constexpr uint32_t kEmpty = 0xffffffff; ///< Marks a free slot.
+
+    std::array<uint32_t, kSlots> keys; ///< Colors in the hash table.
+    std::array<uint8_t, kSlots> indices; ///< Palette indices of the colors.
+    std::vector<uint32_t> colors; ///< Colors by palette index - 1.
+
+    ExactPalette() : indices() { keys.fill(kEmpty); }
+
+    /**
+   * @brief Finds the slot of a color.
+   * @param color Color to look for.
+   * @return Slot holding the color, or the free slot where it belongs.
+   **/
+    std::size_t Slot(uint32_t color) const
+    {
+        std::size_t slot = (color * 2654435761u) >> 23;
+        while (keys[slot] != kEmpty && keys[slot] != color) {
+            slot = (slot + 1) & (kSlots - 1);
+        }
+        return slot;
+    }
+
+    /**
+   * @brief Adds a color if it is not in the palette yet.
+   * @param color Color to add.
+   * @return false if the palette is full.
+   **/
+    bool Insert(uint32_t color)
+    {
+        std::size_t slot = Slot(color);
+        if (keys[slot] == color) {
+            return true;
+        }
+        if (colors.size() == kMaxColors) {
+            return false;
+        }
+        colors.push_back(color);
+        keys[slot] = color;
+        indices[slot] = static_cast<uint8_t>(colors.size());
+        return true;
+    }
+
+    /**
+   * @brief Calculates the smallest bit depth holding the palette.
+   * @return Bit depth, at least 2 as the minimum LZW code size.
+   **/
+    int BitDepth() const
+    {
+        int bitDepth = 2;
+        while ((std::size_t(1) << bitDepth) < colors.size() + 1) {
+            bitDepth++;
+        }
+        return bitDepth;
+    }
+};
+
+/**
+ * @brief Builds an exact palette of the changed pixels of a frame.
+ * Colors of the base palette keep their indices, so it grows into a palette shared by many frames.
+ * @param base Palette to extend, nullptr to start from an empty one.
+ * @param previous Previous frame, nullptr for the first one.
+ * @param image Frame to build the palette for.
+ * @param pixels Number of pixels in the frame.
+ * @return Palette, nullptr if the frame has more than 255 colors.
+ **/
+inline std::shared_ptr<const ExactPalette> BuildExactPalette(const ExactPalette* base,
+                                                             const uint8_t* previous,
+                                                             const uint8_t* image,
+                                                             std::size_t pixels)
+{
+    auto palette = base ? std::make_shared<ExactPalette>(*base) : std::make_shared<ExactPalette>();
+    for (std::size_t i = 0; i < pixels; ++i) {
+        const uint8_t* pixel = image + i * 4;
+        if (PixelChanged(previous ? previous + i * 4 : nullptr, pixel) &&
+            !palette->Insert(PixelColor(pixel))) {
+            // Colors of the shared palette may be what doesn't fit.
+            return base ? BuildExactPalette(nullptr, previous, image, pixels) : nullptr;
+        }
+    }
+    return palette;
+}
+
+/**
+ * @brief Maps the pixels of a frame to palette indices, unchanged pixels become transparent.
+ * @param palette Exact palette.
+ * @param previous Previous frame, nullptr for the first one.
+ * @param image Frame to map.
+ * @param quantized Output pixels, the index is stored in the alpha channel.
+ * @param pixels Number of pixels in the frame.
+ * @return false if a color of the frame is missing from the palette.
+ **/
+inline bool MapToExactPalette(const ExactPalette& palette, const uint8_t* previous,
+                              const uint8_t* image, uint8_t* quantized, std::size_t pixels)
+{
+    for (std::size_t i = 0; i < pixels; ++i) {
+        const uint8_t* pixel = image + i * 4;
+        uint8_t* output = quantized + i * 4;
+        output[0] = pixel[0];
+        output[1] = pixel[1];
+        output[2] = pixel[2];
+        if (!PixelChanged(previous ? previous + i * 4 : nullptr, pixel)) {
+            output[3] = ExactPalette::kTransparentIndex;
+            continue;
+        }
+        uint32_t color = PixelColor(pixel);
+        std::size_t slot = palette.Slot(color);
+        if (palette.keys[slot] != color) {
+            return false;
+        }
+        output[3] = palette.indices[slot];
+    }
+    return true;
+}
+
+/**
+ * @brief Rectangle of a frame in pixels.
+ **/
+struct FrameRect {
+    int left; ///< First column.
+    int top; ///< First row.
+    int width; ///< Number of columns.
+    int height; ///< Number of rows.
+};
+
+/**
+ * @brief Finds the bounding rectangle of the pixels that differ from the previous frame.
+ * @param previous Previous frame, nullptr for the first one.
+ * @param image Frame.
+ * @param width Width of the frames.
+ * @param height Height of the frames.
+ * @return Bounding rectangle, a single pixel if nothing changed, as an image
+ * block must be written anyway to keep the frame delay.
+ **/
+inline FrameRect FindChangedRect(const uint8_t* previous, const uint8_t* image, int width, int height)
+{
+    if (previous == nullptr) {
+        return {0, 0, width, height};
+    }
+    if (previous == image) {
+        // A repeated frame shares the pixels of the previous one.
+        return {0, 0, 1, 1};
+    }
+    int left = width, right = -1, top = height, bottom = -1;
+    for (int y = 0; y < height; ++y) {
+        std::size_t row = static_cast<std::size_t>(y) * width * 4;
+        int x = 0;
+        while (x < width && !PixelChanged(previous + row + x * 4, image + row + x * 4)) {
+            x++;
+        }
+        if (x == width) {
+            continue;
+        }
+        left = std::min(left, x);
+        x = width - 1;
+        while (!PixelChanged(previous + row + x * 4, image + row + x * 4)) {
+            x--;
+        }
+        right = std::max(right, x);
+        top = std::min(top, y);
+        bottom = y;
+    }
+    if (bottom < 0) {
+        return {0, 0, 1, 1};
+    }
+    return {left, top, right - left + 1, bottom - top + 1};
+}
+
+/**
+ * @brief Copies a rectangle of a frame.
+ * @param image Frame.
+ * @param width Width of the frame.
+ * @param rect Rectangle to copy.
+ * @param cropped Output RGBA pixels of the rectangle, its memory is reused.
+ **/
+inline void Crop(const uint8_t* image, int width, const FrameRect& rect, std::vector<uint8_t>& cropped)
+{
+    std::size_t rowBytes = static_cast<std::size_t>(rect.width) * 4;
+    cropped.resize(rowBytes * rect.height);
+    for (int y = 0; y < rect.height; ++y) {
+        std::memcpy(cropped.data() + rowBytes * y,
+                    image + (static_cast<std::size_t>(rect.top + y) * width + rect.left) * 4,
+                    rowBytes);
+    }
+}
+
+} // namespace s21
+
+#endif // S21_GIF_FRAME_H
@@ -5,40 +5,266 @@
 
 #include "s21_gif_recorder.h"
 
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+#include "../model/s21_tracer.h"
 #include "include/gif.h"
+#include "s21_gif_frame.h"
 
 namespace s21 {
 
-GifRecorder::GifRecorder() : gifWriter(new GifWriter), width(0), height(0) {}
+// Exact palettes mark unchanged pixels with the transparent index of gif.h.
+static_assert(ExactPalette::kTransparentIndex == kGifTransIndex,
+              "transparent palette indices differ");
+
+GifRecorder::GifRecorder()
+    : gifWriter(new GifWriter()),
+      width(0),
+      height(0),
+      fps(1),
+      framesCount(0),
+      dithering(false),
+      ditherFrames(false),
+      queueCapacity(0),
+      framesInFlight(0),
+      nextWrittenFrame(0),
+      stopping(false),
+      stats() {}
 
-GifRecorder::~GifRecorder() { delete static_cast<GifWriter *>(gifWriter); }
+GifRecorder::~GifRecorder() {
+  if (!workers.empty()) {
+    CompleteGIF();
+  }
+  delete static_cast<GifWriter *>(gifWriter);
+}
 
-void GifRecorder::CreateGif(std::string outputFilename, int w, int h, int fps,
-                            int duration) {
+bool GifRecorder::CreateGif(std::string outputFilename, int w, int h,
+                            int framesPerSecond) {
+  if (!workers.empty()) {
+    CompleteGIF();
+  }
   width = w;
   height = h;
-  frameDelay = (fps / (fps * duration * 1.0f)) * 100.0f;
-  GifBegin(static_cast<GifWriter *>(gifWriter), outputFilename.data(), width,
-           height, frameDelay);
+  fps = framesPerSecond;
+  framesCount = 0;
+  ditherFrames = dithering;
+  {
+    std::lock_guard<std::mutex> lock(pipelineMutex);
+    stats = GifStats{0, 0, 0, 0};
+    stats.framePixels = static_cast<std::size_t>(width) * height;
+  }
+  if (!GifBegin(static_cast<GifWriter *>(gifWriter), outputFilename.data(),
+                width, height, NextFrameDelay())) {
+    return false;
+  }
+  std::size_t workersCount =
+      std::max(1u, std::thread::hardware_concurrency());
+  queueCapacity = workersCount * 2;
+  nextWrittenFrame = 0;
+  for (std::size_t i = 0; i < workersCount; ++i) {
+    workers.emplace_back(&GifRecorder::EncodeFrames, this);
+  }
+  writer = std::thread(&GifRecorder::WriteFrames, this);
+  return true;
+}
+
+void GifRecorder::AddImage(const QImage &image) {
+  if (workers.empty()) {
+    return;
+  }
+  QImage frame = ConvertQImage(image);
+  EncodeJob job{static_cast<std::size_t>(framesCount), NextFrameDelay(), frame,
+                lastFrame};
+  lastFrame = frame;
+  framesCount++;
+  {
+    std::unique_lock<std::mutex> lock(pipelineMutex);
+    frameWritten.wait(lock,
+                      [this] { return framesInFlight < queueCapacity; });
+    jobs.push_back(std::move(job));
+    framesInFlight++;
+  }
+  jobAdded.notify_one();
 }
 
-void GifRecorder::AddImage(QImage image) {
-  std::vector<uint8_t> frame = ConvertQImage(image);
-  GifWriteFrame(static_cast<GifWriter *>(gifWriter), frame.data(), width,
-                height, frameDelay);
+void GifRecorder::SetDithering(bool enabled) { dithering = enabled; }
+
+GifStats GifRecorder::GetStats() {
+  std::lock_guard<std::mutex> lock(pipelineMutex);
+  return stats;
 }
 
-void GifRecorder::CompleteGIF() { GifEnd(static_cast<GifWriter *>(gifWriter)); }
+int GifRecorder::NextFrameDelay() const {
+  return std::lround(100.0 * (framesCount + 1) / fps) -
+         std::lround(100.0 * framesCount / fps);
+}
 
-std::vector<uint8_t> GifRecorder::ConvertQImage(const QImage &image) const {
-  QImage convertedImage = image
-                              .scaled(width, height, Qt::IgnoreAspectRatio,
-                                      Qt::SmoothTransformation)
-                              .convertToFormat(QImage::Format_RGBA8888);
-  std::vector<uint8_t> frame(convertedImage.sizeInBytes());
-  std::memcpy(frame.data(), convertedImage.bits(),
-              convertedImage.sizeInBytes());
+void GifRecorder::CompleteGIF() {
+  StopPipeline();
+  GifEnd(static_cast<GifWriter *>(gifWriter));
+}
+
+void GifRecorder::EncodeFrames() {
+  Tracer::Instance().SetThreadName("GIF encoder");
+  EncodeBuffers buffers;
+  std::unique_lock<std::mutex> lock(pipelineMutex);
+  while (true) {
+    jobAdded.wait(lock, [this] { return stopping || !jobs.empty(); });
+    if (jobs.empty()) {
+      return;
+    }
+    EncodeJob job = std::move(jobs.front());
+    jobs.pop_front();
+    lock.unlock();
+    EncodedFrame frame = Encode(job, buffers);
+    lock.lock();
+    encodedFrames.emplace(job.index, std::move(frame));
+    frameEncoded.notify_one();
+  }
+}
+
+void GifRecorder::WriteFrames() {
+  Tracer::Instance().SetThreadName("GIF writer");
+  FILE *file = static_cast<GifWriter *>(gifWriter)->f;
+  std::unique_lock<std::mutex> lock(pipelineMutex);
+  while (true) {
+    frameEncoded.wait(lock, [this] {
+      return encodedFrames.count(nextWrittenFrame) ||
+             (stopping && framesInFlight == 0);
+    });
+    auto next = encodedFrames.find(nextWrittenFrame);
+    if (next == encodedFrames.end()) {
+      return;
+    }
+    EncodedFrame frame = std::move(next->second);
+    encodedFrames.erase(next);
+    lock.unlock();
+    {
+      S21_TRACE_SCOPE("Write GIF frame");
+      std::fwrite(frame.data.get(), 1, frame.size, file);
+    }
+    lock.lock();
+    stats.frames++;
+    stats.encodedPixels += frame.pixels;
+    stats.bytes += frame.size;
+    nextWrittenFrame++;
+    framesInFlight--;
+    frameWritten.notify_all();
+  }
+}
+
+GifRecorder::EncodedFrame GifRecorder::Encode(const EncodeJob &job,
+                                              EncodeBuffers &buffers) {
+  S21_TRACE_SCOPE("Encode GIF frame");
+  // Pixels are compared with the previous source frame rather than the
+  // previous quantized one, so frames don't depend on each other's encoding.
+  // A pixel equal to the previous source pixel already shows its quantized
+  // color, so it can stay transparent.
+  const uint8_t *previous =
+      job.previousImage.isNull() ? nullptr : job.previousImage.constBits();
+  const uint8_t *image = job.image.constBits();
+  // Only the rectangle around the changed pixels is encoded, the rest of the
+  // canvas keeps the previous frame.
+  FrameRect rect = FindChangedRect(previous, image, width, height);
+  if (rect.width != width || rect.height != height) {
+    Crop(image, width, rect, buffers.croppedImage);
+    Crop(previous, width, rect, buffers.croppedPrevious);
+    image = buffers.croppedImage.data();
+    previous = buffers.croppedPrevious.data();
+  }
+  std::size_t pixels = static_cast<std::size_t>(rect.width) * rect.height;
+  std::vector<uint8_t> &quantized = buffers.quantized;
+  quantized.resize(pixels * 4);
+  GifPalette palette = {};
+
+  std::shared_ptr<const ExactPalette> exactPalette;
+  {
+    std::lock_guard<std::mutex> lock(pipelineMutex);
+    exactPalette = globalPalette;
+  }
+  if (!exactPalette || !MapToExactPalette(*exactPalette, previous, image,
+                                          quantized.data(), pixels)) {
+    exactPalette =
+        BuildExactPalette(exactPalette.get(), previous, image, pixels);
+    if (exactPalette) {
+      MapToExactPalette(*exactPalette, previous, image, quantized.data(),
+                        pixels);
+      std::lock_guard<std::mutex> lock(pipelineMutex);
+      globalPalette = exactPalette;
+    }
+  }
+  if (exactPalette) {
+    palette.bitDepth = exactPalette->BitDepth();
+    for (std::size_t i = 0; i < exactPalette->colors.size(); ++i) {
+      uint32_t color = exactPalette->colors[i];
+      palette.r[i + 1] = color & 0xff;
+      palette.g[i + 1] = (color >> 8) & 0xff;
+      palette.b[i + 1] = (color >> 16) & 0xff;
+    }
+  } else {
+    auto lut = std::make_unique<GifPaletteLut>();
+    GifPaletteLutReset(lut.get());
+    if (ditherFrames) {
+      GifMakePalette(nullptr, image, rect.width, rect.height, 8, true,
+                     &palette);
+      GifDitherImageLut(previous, image, quantized.data(), rect.width,
+                        rect.height, &palette, lut.get());
+    } else {
+      GifMakePalette(previous, image, rect.width, rect.height, 8, false,
+                     &palette);
+      GifThresholdImageLut(previous, image, quantized.data(), rect.width,
+                           rect.height, &palette, lut.get());
+    }
+  }
+
+  EncodedFrame frame;
+  char *data = nullptr;
+  std::size_t size = 0;
+  FILE *stream = open_memstream(&data, &size);
+  if (stream) {
+    GifWriteLzwImageFast(stream, quantized.data(), rect.left, rect.top,
+                         rect.width, rect.height, job.delay, &palette);
+    std::fclose(stream);
+    frame.data.reset(data);
+    frame.size = size;
+  }
+  frame.pixels = pixels;
   return frame;
 }
 
+void GifRecorder::StopPipeline() {
+  {
+    std::lock_guard<std::mutex> lock(pipelineMutex);
+    stopping = true;
+  }
+  jobAdded.notify_all();
+  frameEncoded.notify_all();
+  for (std::thread &worker : workers) {
+    worker.join();
+  }
+  if (writer.joinable()) {
+    writer.join();
+  }
+  workers.clear();
+  lastFrame = QImage();
+  globalPalette.reset();
+  stopping = false;
+}
+
+QImage GifRecorder::ConvertQImage(const QImage &image) const {
+  // Frames rendered for the gif already match, they are shared, not copied.
+  QImage convertedImage = image;
+  if (convertedImage.width() != width || convertedImage.height() != height) {
+    convertedImage = convertedImage.scaled(
+        width, height, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+  }
+  if (convertedImage.format() != QImage::Format_RGBA8888) {
+    convertedImage = convertedImage.convertToFormat(QImage::Format_RGBA8888);
+  }
+  return convertedImage;
+}
+
 }  // namespace s21
@@ -7,14 +7,40 @@
 #define S21_GIF_RECORDER_H
 
 #include <QImage>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <vector>
 #include <iostream>
 
 namespace s21 {
 
+struct ExactPalette; ///< Palette holding every color of a frame, see s21_gif_frame.h.
+
+/**
+ * @brief Amount of data written to a gif.
+ **/
+struct GifStats {
+    std::size_t frames; ///< Number of written frames.
+    std::size_t framePixels; ///< Number of pixels in a full frame.
+    std::size_t encodedPixels; ///< Number of pixels in the written image blocks.
+    std::size_t bytes; ///< Size of the written image blocks in bytes.
+};
+
 /**
  * @brief Class that implements the logic of the GIF recorder.
+ * Frames are encoded by a pipeline: AddImage() converts a frame and puts it into
+ * the capture queue, a pool of workers builds palettes and LZW-compresses frames
+ * in parallel, and a writer thread appends the compressed frames in order.
+ * Each frame is cropped to the rectangle around the pixels that changed.
+ * Frames with at most 255 colors are encoded losslessly with an exact palette,
+ * which is shared by the following frames while their colors fit into it.
  **/
 class GifRecorder
 {
@@ -24,38 +50,132 @@ public:
 
     /**
    * @brief Creates .gif file with given filename and parameters.
-   * The exact number of frames equal to fps * duration must be transmitted.
-   * There is no checks for the number of frames within a class.
+   * Frame i is shown at i / fps seconds, delays are rounded per frame
+   * so the rounding error doesn't accumulate.
    * @param outputFilename Filename of recording gif.
    * @param w Width of gif.
    * @param h Height of gif.
    * @param fps Number of frames per second in a recorded gif.
-   * @param duration Duration of gif.
+   * @return true if the file was created, false otherwise.
    **/
-    void CreateGif(std::string outputFilename, int w, int h, int fps, int duration);
+    bool CreateGif(std::string outputFilename, int w, int h, int fps);
 
     /**
-   * @brief Adds image in created gif
+   * @brief Adds image in created gif.
+   * Returns once the frame is queued, waits only while the pipeline is full.
+   * An RGBA8888 image of the gif size is encoded in place, others are converted first.
    * @param image Image that will be added.
    **/
-    void AddImage(QImage image);
+    void AddImage(const QImage& image);
 
     /**
-   * @brief Completes recording of gif.
+   * @brief Waits for the queued frames to be written and completes recording of gif.
    **/
     void CompleteGIF();
+
+    /**
+   * @brief Enables Floyd-Steinberg dithering of frames with more than 255 colors.
+   * Takes effect from the next CreateGif() call, frames with fewer colors are always exact.
+   * @param enabled true to dither, false to map every pixel to the closest palette color.
+   **/
+    void SetDithering(bool enabled);
+
+    /**
+   * @brief Getter of the data written to the current or the last gif.
+   * Can be called from any thread.
+   * @return Statistics of the written frames.
+   **/
+    GifStats GetStats();
 private:
+
+    /**
+   * @brief Frame waiting in the capture queue.
+   **/
+    struct EncodeJob {
+        std::size_t index; ///< Number of the frame in the gif.
+        int delay; ///< Delay of the frame in hundredths of a second.
+        QImage image; ///< RGBA pixels of the frame.
+        QImage previousImage; ///< RGBA pixels of the previous frame, null for the first one.
+    };
+
+    /**
+   * @brief Scratch memory of a worker, reused by the frames it encodes.
+   **/
+    struct EncodeBuffers {
+        std::vector<uint8_t> quantized; ///< Pixels mapped to the palette.
+        std::vector<uint8_t> croppedImage; ///< Changed rectangle of the frame.
+        std::vector<uint8_t> croppedPrevious; ///< Changed rectangle of the previous frame.
+    };
+
+    /**
+   * @brief Compressed frame waiting for the writer.
+   **/
+    struct EncodedFrame {
+        std::unique_ptr<char, void (*)(void*)> data{nullptr, std::free}; ///< Graphics control extension and image block.
+        std::size_t size = 0; ///< Size of data in bytes.
+        std::size_t pixels = 0; ///< Number of pixels in the image block.
+    };
+
     void* gifWriter; ///< A pointer to an internal structure gifwriter in the library.
     int width; ///< Width of gif.
     int height; ///< Height of gif.
-    int frameDelay; ///< Duration of each gif frame.
+    int fps; ///< Number of frames per second.
+    int framesCount; ///< Number of frames added since the gif was created.
+    bool dithering; ///< Whether the next gif is dithered.
+    bool ditherFrames; ///< Whether frames of the current gif are dithered.
+    QImage lastFrame; ///< Last added frame, the next one is encoded as a difference to it.
+    std::size_t queueCapacity; ///< Frames that can be queued, encoded or waiting for the writer at once.
+    std::size_t framesInFlight; ///< Frames added but not written yet.
+    std::size_t nextWrittenFrame; ///< Number of the frame the writer appends next.
+    bool stopping; ///< Whether the threads should exit once the pipeline is empty.
+    std::deque<EncodeJob> jobs; ///< Capture queue.
+    std::map<std::size_t, EncodedFrame> encodedFrames; ///< Compressed frames by their numbers.
+    GifStats stats; ///< Data written to the gif.
+    std::shared_ptr<const ExactPalette> globalPalette; ///< Exact palette of the latest low-color frame.
+    std::mutex pipelineMutex; ///< Guards the pipeline state.
+    std::condition_variable jobAdded; ///< Wakes the workers.
+    std::condition_variable frameEncoded; ///< Wakes the writer.
+    std::condition_variable frameWritten; ///< Wakes AddImage() and CompleteGIF().
+    std::vector<std::thread> workers; ///< Encoding threads.
+    std::thread writer; ///< Thread appending frames to the file.
+
+    /**
+   * @brief Calculates the delay of the next frame in hundredths of a second.
+   * @return Delay of the frame.
+   **/
+    int NextFrameDelay() const;
+
+    /**
+   * @brief Thread method of the workers. Encodes frames from the capture queue.
+   **/
+    void EncodeFrames();
+
+    /**
+   * @brief Thread method of the writer. Appends encoded frames in order.
+   **/
+    void WriteFrames();
+
+    /**
+   * @brief Builds the palette of a frame and LZW-compresses it.
+   * Only the bounding rectangle of the changed pixels is encoded,
+   * unchanged pixels inside it are transparent.
+   * @param job Frame to encode.
+   * @param buffers Scratch memory of the worker.
+   * @return Compressed frame.
+   **/
+    EncodedFrame Encode(const EncodeJob& job, EncodeBuffers& buffers);
+
+    /**
+   * @brief Stops the threads after the queued frames are written.
+   **/
+    void StopPipeline();
 
     /**
-   * @brief Private method to convert a QImage to a byte array.
+   * @brief Private method to bring a QImage to the gif size and the RGBA8888 format.
    * @param image Image that will be added.
-   * @return Byte array represented as vector<uint8_t>.
+   * @return The same image if it already matches, a converted copy otherwise.
    **/
-    std::vector<uint8_t> ConvertQImage(const QImage& image) const;
+    QImage ConvertQImage(const QImage& image) const;
 };
 
 } //namespace s21
@@ -0,0 +1,66 @@
+/**
+ * @file s21_image_pool.cpp
+ * @brief Pool of recycled image buffers implementation.
+ */
+
+#include "s21_image_pool.h"
+
+#include "../model/s21_memory_stats.h"
+
+namespace s21 {
+
+ImagePool::ImagePool() : allocations(0) {}
+
+std::shared_ptr<ImagePool> ImagePool::Create() {
+  return std::shared_ptr<ImagePool>(new ImagePool());
+}
+
+QImage ImagePool::Acquire(int width, int height) {
+  std::size_t size = static_cast<std::size_t>(width) * height * 4;
+  std::unique_ptr<Buffer> buffer;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto it = idle.begin(); it != idle.end(); ++it) {
+      if ((*it)->pixels.size() == size) {
+        buffer = std::move(*it);
+        idle.erase(it);
+        break;
+      }
+    }
+    if (!buffer) {
+      allocations++;
+    }
+  }
+  if (!buffer) {
+    buffer = std::make_unique<Buffer>();
+    buffer->pool = weak_from_this();
+    buffer->pixels.resize(size);
+    MemoryStats::Instance().Add(CaptureFrames, size);
+  }
+  uchar* pixels = buffer->pixels.data();
+  return QImage(pixels, width, height, width * 4, QImage::Format_RGBA8888,
+                &ImagePool::Release, buffer.release());
+}
+
+ImagePool::Buffer::~Buffer() {
+  MemoryStats::Instance().Remove(CaptureFrames, pixels.size());
+}
+
+std::size_t ImagePool::GetAllocations() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  return allocations;
+}
+
+void ImagePool::Release(void* info) {
+  std::unique_ptr<Buffer> buffer(static_cast<Buffer*>(info));
+  std::shared_ptr<ImagePool> pool = buffer->pool.lock();
+  if (!pool) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(pool->mutex);
+  if (pool->idle.size() < kMaxIdleBuffers) {
+    pool->idle.push_back(std::move(buffer));
+  }
+}
+
+}  // namespace s21
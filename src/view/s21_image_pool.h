@@ -0,0 +1,79 @@
+/**
+ * @file s21_image_pool.h
+ * @brief Pool of recycled image buffers header file.
+ */
+
+#ifndef S21_IMAGE_POOL_H
+#define S21_IMAGE_POOL_H
+
+#include <QImage>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace s21 {
+
+/**
+ * @brief Hands out RGBA8888 images whose pixel buffers return to the pool
+ * when the last copy of the image is destroyed, on whatever thread that happens.
+ * Images may outlive the pool, their buffers are then freed.
+ **/
+class ImagePool : public std::enable_shared_from_this<ImagePool>
+{
+public:
+    static constexpr std::size_t kMaxIdleBuffers = 16; ///< Idle buffers kept for reuse.
+
+    /**
+   * @brief Creates a pool, it must be owned by a shared pointer.
+   * @return New pool.
+   **/
+    static std::shared_ptr<ImagePool> Create();
+
+    ImagePool(const ImagePool& other) = delete;
+    ImagePool& operator=(const ImagePool& other) = delete;
+
+    /**
+   * @brief Takes an image from the pool, allocating a buffer only if none fits.
+   * Can be called from any thread.
+   * @param width Width of the image.
+   * @param height Height of the image.
+   * @return Image with uninitialized pixels, rows are width * 4 bytes long.
+   **/
+    QImage Acquire(int width, int height);
+
+    /**
+   * @brief Getter of the number of allocated buffers.
+   * @return Number of buffers allocated since the pool was created.
+   **/
+    std::size_t GetAllocations() const;
+
+private:
+    /**
+   * @brief Pixel buffer, owned by the pool while idle and by an image while in use.
+   **/
+    struct Buffer {
+        /**
+       * @brief Removes the pixels from the CaptureFrames memory counter.
+       **/
+        ~Buffer();
+
+        std::weak_ptr<ImagePool> pool; ///< Pool the buffer returns to.
+        std::vector<uchar> pixels; ///< Pixel data.
+    };
+
+    ImagePool();
+
+    /**
+   * @brief Cleanup function of the images, returns the buffer to its pool.
+   * @param info Buffer of the destroyed image.
+   **/
+    static void Release(void* info);
+
+    mutable std::mutex mutex; ///< Guards idle and allocations.
+    std::vector<std::unique_ptr<Buffer>> idle; ///< Buffers available for reuse.
+    std::size_t allocations; ///< Number of allocated buffers.
+};
+
+} // namespace s21
+
+#endif // S21_IMAGE_POOL_H
@@ -5,12 +5,30 @@
 
 #include "s21_mainwindow.h"
 
+#include <QStandardPaths>
+
 #include "./ui_s21_mainwindow.h"
 
 namespace s21 {
 
+namespace {
+
+/**
+ * @brief Formats a size for the labels.
+ * @param bytes Size in bytes.
+ * @return Size in megabytes.
+ */
+QString FormatMegabytes(std::size_t bytes) {
+  return QString::number(bytes / (1024.0 * 1024.0), 'f', 1) + " МБ";
+}
+
+}  // namespace
+
 MainWindow::MainWindow(OGLWidget& widget, QWidget* parent)
-    : QMainWindow(parent), ui(new Ui::MainWindow), openGLWidget(widget) {
+    : QMainWindow(parent),
+      ui(new Ui::MainWindow),
+      openGLWidget(widget),
+      memoryTimer(this) {
   ui->setupUi(this);
   openGLWidget.setParent(this);
   openGLWidget.show();
@@ -31,6 +49,20 @@ MainWindow::MainWindow(OGLWidget& widget, QWidget* parent)
     colors[1] = {0, 0, 0};
     colors[2] = {10, 10, 10};
   }
+  LoadGifSettings();
+  LoadOutOfCoreSettings();
+  // GPU buffers and capture frames change without the window knowing.
+  QObject::connect(&memoryTimer, &QTimer::timeout, this,
+                   &MainWindow::UpdateMemoryLabels);
+  memoryTimer.start(1000);
+  UpdateMemoryLabels();
+  QObject::connect(&openGLWidget, &OGLWidget::ModelReloaded, this,
+                   &MainWindow::UpdateModelLabels);
+  QObject::connect(&openGLWidget, &OGLWidget::ModelLoaded, this,
+                   &MainWindow::OnModelLoaded);
+  QObject::connect(&openGLWidget, &OGLWidget::ModelLoadFailed, this,
+                   &MainWindow::ShowLoadError);
+  StartupTimer::Instance().Mark(WindowCreated);
 }
 
 MainWindow::~MainWindow() {
@@ -41,7 +73,7 @@ MainWindow::~MainWindow() {
 
 void MainWindow::on_loadButton_clicked() {
   OpenFileDialog(this);
-  findChild<QLabel*>("filenameLabel")->setText(QString(currentFile.data()));
+  UpdateFilenameLabel();
 }
 
 void MainWindow::on_upScaleButton_clicked() { openGLWidget.ScaleModel(true); }
@@ -74,7 +106,59 @@ void MainWindow::keyPressEvent(QKeyEvent* event) {
     case Qt::Key_E:
       findChild<QSpinBox*>("zRotBox")->setValue(zRot + 1);
       break;
+    case Qt::Key_F3:
+      openGLWidget.ToggleStatsOverlay();
+      break;
+    case Qt::Key_F4:
+      openGLWidget.ExportFrameStats("frame_stats.csv");
+      break;
+    case Qt::Key_F5:
+      openGLWidget.SetWatchEnabled(!openGLWidget.IsWatchEnabled());
+      UpdateFilenameLabel();
+      break;
+  }
+}
+
+void MainWindow::UpdateMemoryLabels() {
+  std::size_t hostBytes = 0;
+  QString details;
+  for (int i = 0; i < MemorySubsystemsCount; ++i) {
+    MemorySubsystem subsystem = static_cast<MemorySubsystem>(i);
+    MemoryUsage usage = openGLWidget.GetMemoryUsage(subsystem);
+    if (subsystem != GpuBuffers) {
+      hostBytes += usage.current;
+    }
+    details += QString("%1: %2 (пик %3)\n")
+                   .arg(MemoryStats::GetName(subsystem))
+                   .arg(FormatMegabytes(usage.current))
+                   .arg(FormatMegabytes(usage.peak));
+  }
+  QLabel* memoryLabel = findChild<QLabel*>("memoryLabel");
+  memoryLabel->setText(FormatMegabytes(hostBytes));
+  memoryLabel->setToolTip(details.trimmed());
+  findChild<QLabel*>("gpuMemoryLabel")
+      ->setText(
+          FormatMegabytes(openGLWidget.GetMemoryUsage(GpuBuffers).current));
+  findChild<QLabel*>("peakRssLabel")
+      ->setText(FormatMegabytes(openGLWidget.GetPeakRss()));
+}
+
+void MainWindow::UpdateModelLabels() {
+  findChild<QLabel*>("edgesLabel")
+      ->setText(
+          QString(std::to_string(openGLWidget.GetUniqueEdgesCount()).data()));
+  findChild<QLabel*>("verticesLabel")
+      ->setText(QString(
+          std::to_string(openGLWidget.GetVerticesCount() / 3).data()));
+  UpdateMemoryLabels();
+}
+
+void MainWindow::UpdateFilenameLabel() {
+  QString text(currentFile.data());
+  if (openGLWidget.IsWatchEnabled()) {
+    text += " (отслеживается)";
   }
+  findChild<QLabel*>("filenameLabel")->setText(text);
 }
 
 void MainWindow::OpenFileDialog(QWidget* parent) {
@@ -82,33 +166,32 @@ void MainWindow::OpenFileDialog(QWidget* parent) {
       QFileDialog::getOpenFileName(parent, "Открыть файл", "",
                                    "OBJ 3D-модель (*.obj)")
           .toStdString();
-  bool success = false;
   if (!tempFilename.empty()) {
-    try {
-      openGLWidget.LoadModel(tempFilename);
-      findChild<QLabel*>("edgesLabel")
-          ->setText(QString(
-              std::to_string(openGLWidget.GetUniqueEdgesCount()).data()));
-      findChild<QLabel*>("verticesLabel")
-          ->setText(QString(
-              std::to_string(openGLWidget.GetVerticesCount() / 3).data()));
-      success = true;
-    } catch (const std::invalid_argument& e) {
-      ErrorDialog errorDialog(this);
-      errorDialog.SetMessage("В файле содержатся ошибки!");
-      errorDialog.exec();
-    } catch (const std::out_of_range& e) {
-      ErrorDialog errorDialog(this);
-      errorDialog.SetMessage("Выбранный файл пуст!");
-      errorDialog.exec();
-    } catch (const std::logic_error& e) {
-      ErrorDialog errorDialog(this);
-      errorDialog.SetMessage("Файл не выбран или отсутсвует!");
-      errorDialog.exec();
-    }
-    if (success) {
-      currentFile = tempFilename;
-    }
+    openGLWidget.LoadModel(tempFilename);
+  }
+}
+
+void MainWindow::OnModelLoaded(const std::string& filename) {
+  currentFile = filename;
+  UpdateModelLabels();
+  UpdateFilenameLabel();
+}
+
+void MainWindow::ShowLoadError(std::exception_ptr error) {
+  try {
+    std::rethrow_exception(error);
+  } catch (const std::invalid_argument& e) {
+    ErrorDialog errorDialog(this);
+    errorDialog.SetMessage("В файле содержатся ошибки!");
+    errorDialog.exec();
+  } catch (const std::out_of_range& e) {
+    ErrorDialog errorDialog(this);
+    errorDialog.SetMessage("Выбранный файл пуст!");
+    errorDialog.exec();
+  } catch (const std::logic_error& e) {
+    ErrorDialog errorDialog(this);
+    errorDialog.SetMessage("Файл не выбран или отсутсвует!");
+    errorDialog.exec();
   }
 }
 
@@ -128,10 +211,79 @@ void MainWindow::SaveSettings() const {
   settings.setValue("vertR", colors[2][0]);
   settings.setValue("vertG", colors[2][1]);
   settings.setValue("vertB", colors[2][2]);
+  settings.setValue("gifWidth", gifSettings.width);
+  settings.setValue("gifHeight", gifSettings.height);
+  settings.setValue("gifFrames", gifSettings.frameCount);
+  settings.setValue("gifFps", gifSettings.fps);
+  settings.setValue("gifPath", QString::fromStdString(gifSettings.outputPath));
+  settings.setValue("gifDither", gifSettings.dither);
+  const char* formats[] = {"gif", "png", "y4m"};
+  settings.setValue("gifFormat",
+                    formats[static_cast<int>(gifSettings.format)]);
+  settings.setValue("gifQueue", gifSettings.queueCapacity);
+  settings.setValue("screenshotWidth", screenshotWidth);
+  settings.setValue("screenshotHeight", screenshotHeight);
+}
+
+void MainWindow::LoadGifSettings() {
+  QSettings settings("./3D_viewer.ini", QSettings::IniFormat);
+  gifSettings.width = settings.value("gifWidth", 640).toInt();
+  gifSettings.height = settings.value("gifHeight", 480).toInt();
+  gifSettings.frameCount = settings.value("gifFrames", 50).toInt();
+  gifSettings.fps = settings.value("gifFps", 10).toInt();
+  gifSettings.outputPath =
+      settings.value("gifPath", "screencast.gif").toString().toStdString();
+  gifSettings.dither = settings.value("gifDither", false).toBool();
+  QString format = settings.value("gifFormat", "gif").toString();
+  if (format == "png") {
+    gifSettings.format = CaptureFormat::PngSequence;
+  } else if (format == "y4m") {
+    gifSettings.format = CaptureFormat::Y4m;
+  } else {
+    gifSettings.format = CaptureFormat::Gif;
+  }
+  gifSettings.queueCapacity = settings.value("gifQueue", 8).toInt();
+  openGLWidget.SetGifSettings(gifSettings);
+  screenshotWidth = settings.value("screenshotWidth", 0).toInt();
+  screenshotHeight = settings.value("screenshotHeight", 0).toInt();
+  openGLWidget.SetScreenshotSize(screenshotWidth, screenshotHeight);
+  // Large screenshots are streamed into .bmp files, a .jpeg needs the whole
+  // image in memory.
+  bool tiled = screenshotWidth > 0 && screenshotHeight > 0;
+  QComboBox* imageBox = findChild<QComboBox*>("imageComboBox");
+  if (tiled) {
+    imageBox->setCurrentIndex(1);
+    statusBar()->showMessage(
+        QString("Screenshots of %1x%2 are saved as .bmp only")
+            .arg(screenshotWidth)
+            .arg(screenshotHeight));
+  }
+  imageBox->setEnabled(!tiled);
+}
+
+void MainWindow::LoadOutOfCoreSettings() {
+  QSettings settings("./3D_viewer.ini", QSettings::IniFormat);
+  OutOfCoreSettings outOfCore;
+  outOfCore.minFileBytes =
+      settings.value("outOfCoreMinMB", 4096).toULongLong() << 20;
+  outOfCore.ramBudget = settings.value("ramBudgetMB", 16384).toULongLong()
+                        << 20;
+  outOfCore.vramBudget = settings.value("vramBudgetMB", 2048).toULongLong()
+                         << 20;
+  QString cache =
+      QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+  outOfCore.storeDirectory =
+      settings.value("chunkStoreDir",
+                     cache.isEmpty() ? QString(".") : cache + "/chunks")
+          .toString()
+          .toStdString();
+  openGLWidget.SetOutOfCoreSettings(outOfCore);
 }
 
 void MainWindow::LoadSettings() {
   QSettings settings("./3D_viewer.ini", QSettings::IniFormat);
+  // Every setter would otherwise publish a state and request a frame.
+  openGLWidget.BeginStateUpdate();
   linesThickness = settings.value("linesThickness").toInt();
   findChild<QSlider*>("thicknessSlider")->setValue(linesThickness);
   openGLWidget.SetLineWidth(settings.value("linesThickness").toFloat() /
@@ -180,6 +332,7 @@ void MainWindow::LoadSettings() {
   colors[2][0] = settings.value("vertR").toInt();
   colors[2][1] = settings.value("vertG").toInt();
   colors[2][2] = settings.value("vertB").toInt();
+  openGLWidget.EndStateUpdate();
 }
 
 bool MainWindow::CheckSettings() const {
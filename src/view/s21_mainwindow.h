@@ -11,6 +11,9 @@
 #include <QKeyEvent>
 #include <QLabel>
 #include <QSettings>
+#include <QStatusBar>
+#include <QTimer>
+#include <exception>
 #include <string>
 #include <array>
 #include <cmath>
@@ -93,8 +96,12 @@ private:
     int lineStyle; ///< Index of edge style combo box.
     int vertexStyle; ///< Index of vertex style combo box.
     std::string currentFile; ///< Name of the currently processed file.
+    GifSettings gifSettings; ///< Parameters of gif screencasts.
+    int screenshotWidth; ///< Width of screenshots, 0 for the size of the widget.
+    int screenshotHeight; ///< Height of screenshots, 0 for the size of the widget.
     // 0 - model color, 1 - background color, 2 - vertices color
     std::array<std::array<int, 3>, 3> colors; ///< Array of model, background, and vertex colors. The components of each array are a color, represented as R, G, and B components.
+    QTimer memoryTimer; ///< Timer refreshing the memory labels.
 
     /**
    * @brief Override method of resize event.
@@ -117,6 +124,34 @@ private:
    **/
     void OpenFileDialog(QWidget *parent);
 
+    /**
+   * @brief Shows the name and the counts of a loaded model.
+   * @param filename Name of the loaded file.
+   **/
+    void OnModelLoaded(const std::string& filename);
+
+    /**
+   * @brief Shows an error dialog for a model that failed to load.
+   * @param error Exception thrown by the loader.
+   **/
+    void ShowLoadError(std::exception_ptr error);
+
+    /**
+   * @brief Shows the memory held by the model, the GPU buffers and the process.
+   * The tooltip of the memory label lists every subsystem with its peak.
+   **/
+    void UpdateMemoryLabels();
+
+    /**
+   * @brief Shows the edges and vertices counts of the loaded model and its memory.
+   **/
+    void UpdateModelLabels();
+
+    /**
+   * @brief Shows the name of the loaded file and whether it is watched.
+   **/
+    void UpdateFilenameLabel();
+
     /**
    * @brief Saves current settings into the file.
    **/
@@ -127,6 +162,16 @@ private:
    **/
     void LoadSettings();
 
+    /**
+   * @brief Uploads screencast and screenshot parameters from the file, missing ones get default values.
+   **/
+    void LoadGifSettings();
+
+    /**
+   * @brief Uploads the threshold and the memory budgets of out-of-core models from the file, missing ones get default values.
+   **/
+    void LoadOutOfCoreSettings();
+
     /**
    * @brief Checks the presence and correctness of settings.
    * @return true in case of correct settings, false otherwise.
@@ -5,237 +5,728 @@
 
 #include "s21_openGL_widget.h"
 
+#include <QCryptographicHash>
+#include <QFileInfo>
+#include <cstdlib>
+#include <exception>
+#include <filesystem>
+
 namespace s21 {
 
 OGLWidget::OGLWidget(s21::Controller& controller, QWidget* parent)
     : QOpenGLWidget(parent),
       viewerController(controller),
-      EBO(QOpenGLBuffer::IndexBuffer) {
-  scale = 1.0;
-  linesStyle = 0;
-  verticesStyle = 0;
-  xRot = yRot = zRot = 0;
-  xOffset = yOffset = zOffset = 0.0f;
-  linesThickness = 0.001f;
-  verticesThikness = 0.01f;
-  modelColor = {1.0, 1.0, 1.0};
-  verticesColor = {1.0, 1.0, 1.0};
-  backgroundColor = {0.0, 0.0, 0.0};
-  currentProjectionType = s21::ProjectionType::Orthogonal;
-  currentStrategy = s21::TransformationStrategy::Rotate;
-  QObject::connect(this, &OGLWidget::GrabSignal, this,
-                   &OGLWidget::GrabGIFImage);
+      renderer(controller),
+      capture([this](const RenderState& frameState, ImageReceiver receiver) {
+        RequestOffscreenFrame(frameState, std::move(receiver));
+      }),
+      gifSettings({640, 480, 50, 10, "screencast.gif", false, CaptureFormat::Gif,
+                   8}),
+      outOfCore({std::uintmax_t(4096) << 20, std::size_t(16384) << 20,
+                 std::size_t(2048) << 20, ""}),
+      tiledScreenshot(
+          [this](const RenderState& frameState, ImageReceiver receiver) {
+            RequestOffscreenFrame(frameState, std::move(receiver));
+          }),
+      screenshotWidth(0),
+      screenshotHeight(0),
+      state(),
+      stateUpdates(0),
+      statePending(false),
+      readFramebuffer(0),
+      presentedFrame(~std::uint64_t(0)),
+      presentPending(false),
+      statsOverlay(this),
+      overlayTimer(this),
+      fileWatcher(this),
+      reloadTimer(this),
+      watchedFile(),
+      watchEnabled(false),
+      reloadThread(),
+      reloadRunning(false),
+      reloadQueued(false),
+      loadThread(),
+      loadRunning(false),
+      queuedLoad() {
+  state.scale = 1.0;
+  state.linesStyle = 0;
+  state.verticesStyle = 0;
+  state.xRot = state.yRot = state.zRot = 0;
+  state.xOffset = state.yOffset = state.zOffset = 0.0f;
+  state.linesThickness = 0.001f;
+  state.verticesThikness = 0.01f;
+  state.modelColor = {1.0, 1.0, 1.0};
+  state.verticesColor = {1.0, 1.0, 1.0};
+  state.backgroundColor = {0.0, 0.0, 0.0};
+  state.projectionType = s21::ProjectionType::Orthogonal;
+  state.vramBudget = outOfCore.vramBudget;
+  renderThread.setObjectName("Render");
+  renderer.moveToThread(&renderThread);
+  QObject::connect(&renderer, &Renderer::FrameReady, this, [this] { update(); });
+  QObject::connect(this, &OGLWidget::frameSwapped, this,
+                   &OGLWidget::OnFrameSwapped);
+  QObject::connect(&overlayTimer, &QTimer::timeout, this,
+                   &OGLWidget::UpdateStatsOverlay);
+  reloadTimer.setSingleShot(true);
+  reloadTimer.setInterval(kReloadDelayMs);
+  QObject::connect(&fileWatcher, &QFileSystemWatcher::fileChanged, this,
+                   &OGLWidget::OnFileChanged);
+  QObject::connect(&reloadTimer, &QTimer::timeout, this,
+                   &OGLWidget::ReloadModel);
+  statsOverlay.setAttribute(Qt::WA_TransparentForMouseEvents);
+  statsOverlay.setStyleSheet(
+      "QLabel { background-color: rgba(0, 0, 0, 160); color: white; "
+      "font-family: monospace; padding: 4px; }");
+  statsOverlay.move(8, 8);
+  statsOverlay.hide();
+}
+
+OGLWidget::~OGLWidget() {
+  reloadTimer.stop();
+  JoinReload();
+  // The parser uses the renderer, a pending completion is dropped with the
+  // widget.
+  queuedLoad.clear();
+  JoinLoad();
+  // The capture thread renders through the render thread, so it stops first.
+  capture.Cancel();
+  capture.Join();
+  tiledScreenshot.Cancel();
+  tiledScreenshot.Join();
+  if (renderContext) {
+    QMetaObject::invokeMethod(
+        &renderer, [this] { renderer.Cleanup(); },
+        Qt::BlockingQueuedConnection);
+    renderThread.quit();
+    renderThread.wait();
+    makeCurrent();
+    glDeleteFramebuffers(1, &readFramebuffer);
+    doneCurrent();
+  }
 }
 
 void OGLWidget::initializeGL() {
   initializeOpenGLFunctions();
-  glEnable(GL_DEPTH_TEST);
-  shaderProgramm.addShaderFromSourceFile(QOpenGLShader::Vertex,
-                                         ":/shaders/transform_shader.vert");
-  shaderProgramm.addShaderFromSourceFile(QOpenGLShader::Geometry,
-                                         ":/shaders/geometry_shader.glsl");
-  shaderProgramm.addShaderFromSourceFile(QOpenGLShader::Fragment,
-                                         ":/shaders/color_shader.frag");
+  glGenFramebuffers(1, &readFramebuffer);
+  if (renderContext) {
+    return;
+  }
+  renderSurface = std::make_unique<QOffscreenSurface>();
+  renderSurface->setFormat(context()->format());
+  renderSurface->create();
+  renderContext = std::make_unique<QOpenGLContext>();
+  renderContext->setFormat(context()->format());
+  renderContext->setShareContext(context());
+  renderContext->create();
+  renderContext->moveToThread(&renderThread);
+  renderThread.start();
+  QMetaObject::invokeMethod(
+      &renderer,
+      [this] { renderer.Initialize(renderContext.get(), renderSurface.get()); },
+      Qt::BlockingQueuedConnection);
+  PublishState();
 }
 
+void OGLWidget::resizeGL(int, int) { PublishState(); }
+
 void OGLWidget::paintGL() {
-  glClearColor(backgroundColor[0], backgroundColor[1], backgroundColor[2], 0);
-  glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-  InputData data;
-  data.height = height();
-  data.width = width();
-  data.projectionType = currentProjectionType;
-  data.xRotationAngle = xRot;
-  data.yRotationAngle = yRot;
-  data.zRotationAngle = zRot;
-  data.xMoveOffset = xOffset;
-  data.yMoveOffset = yOffset;
-  data.zMoveOffset = zOffset;
-  data.scale = scale;
-  ViewerData output = viewerController.InteractModel(currentStrategy, data);
-
-  shaderProgramm.bind();
-  shaderProgramm.setUniformValue(
-      "modelMatrix",
-      QMatrix4x4(glm::value_ptr(output.modelMatrix)).transposed());
-  shaderProgramm.setUniformValue(
-      "viewMatrix", QMatrix4x4(glm::value_ptr(output.viewMatrix)).transposed());
-  shaderProgramm.setUniformValue(
-      "projectionMatrix",
-      QMatrix4x4(glm::value_ptr(output.projectionMatrix)).transposed());
-  shaderProgramm.setUniformValue("lineStyle", linesStyle);
-  shaderProgramm.setUniformValue("lineWidth", linesThickness);
-  shaderProgramm.setUniformValue("pointSize", verticesThikness);
-  shaderProgramm.setUniformValue("drawPoints", verticesStyle);
-  shaderProgramm.setUniformValue(
-      "lineColor", QVector4D(modelColor[0], modelColor[1], modelColor[2], 1));
-  shaderProgramm.setUniformValue(
-      "pointColor",
-      QVector4D(verticesColor[0], verticesColor[1], verticesColor[2], 1));
-
-  glEnableClientState(GL_VERTEX_ARRAY);
-  VBO.bind();
-  glVertexPointer(3, GL_FLOAT, 0, nullptr);
-  EBO.bind();
-  glDrawElements(GL_LINES, viewerController.GetBuffersData().second.size(),
-                 GL_UNSIGNED_INT, nullptr);
-  EBO.release();
-  VBO.release();
-  glDisableClientState(GL_VERTEX_ARRAY);
-  shaderProgramm.release();
-  scale = 1.0;
-}
-
-void OGLWidget::InitializeBuffers() {
-  if (!VBO.isCreated()) {
-    VBO.create();
-  }
-  VBO.bind();
-  VBO.allocate(
-      viewerController.GetBuffersData().first.data(),
-      viewerController.GetBuffersData().first.size() * sizeof(GLfloat));
-  VBO.release();
-
-  if (!EBO.isCreated()) {
-    EBO.create();
-  }
-  EBO.bind();
-  EBO.allocate(
-      viewerController.GetBuffersData().second.data(),
-      viewerController.GetBuffersData().second.size() * sizeof(GLuint));
-  EBO.release();
-}
-
-void OGLWidget::ThreadGrabbing() {
-  size_t imageCounter = 0;
-  recorder.CreateGif("screencast.gif", 640, 480, 10, 5);
-  while (imageCounter < 50) {
-    emit GrabSignal();
-    imageCounter++;
-    std::this_thread::sleep_for(std::chrono::milliseconds(100));
-  }
-  recorder.CompleteGIF();
+  TripleBuffer<RenderFrame>& frames = renderer.GetFrames();
+  frames.Update();
+  RenderFrame& frame = frames.ReadBuffer();
+  if (frame.renderFence == nullptr) {
+    // Nothing has been rendered yet.
+    glClearColor(state.backgroundColor[0], state.backgroundColor[1],
+                 state.backgroundColor[2], 0);
+    glClear(GL_COLOR_BUFFER_BIT);
+    return;
+  }
+  glWaitSync(frame.renderFence, 0, GL_TIMEOUT_IGNORED);
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, readFramebuffer);
+  glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                         GL_TEXTURE_2D, frame.texture, 0);
+  glBindFramebuffer(GL_DRAW_FRAMEBUFFER, defaultFramebufferObject());
+  glBlitFramebuffer(0, 0, frame.width, frame.height, 0, 0,
+                    qRound(width() * devicePixelRatio()),
+                    qRound(height() * devicePixelRatio()), GL_COLOR_BUFFER_BIT,
+                    GL_LINEAR);
+  glBindFramebuffer(GL_FRAMEBUFFER, defaultFramebufferObject());
+  if (frame.readFence != nullptr) {
+    glDeleteSync(frame.readFence);
+  }
+  frame.readFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  if (frame.frameIndex != presentedFrame) {
+    presentedFrame = frame.frameIndex;
+    presentRenderEnd = frame.renderEnd;
+    presentPending = true;
+  }
+}
+
+void OGLWidget::PublishState() {
+  if (stateUpdates > 0) {
+    statePending = true;
+    return;
+  }
+  state.width = qRound(width() * devicePixelRatio());
+  state.height = qRound(height() * devicePixelRatio());
+  renderer.GetStates().WriteBuffer() = state;
+  renderer.GetStates().Publish();
+  renderer.RequestFrame();
+  capture.PushState(state);
+}
+
+void OGLWidget::OnFrameSwapped() {
+  if (presentPending) {
+    double ms = std::chrono::duration<double, std::milli>(
+                    std::chrono::steady_clock::now() - presentRenderEnd)
+                    .count();
+    std::uint64_t frameIndex = presentedFrame;
+    QMetaObject::invokeMethod(
+        &renderer, [this, frameIndex, ms] {
+          renderer.SetPresentTime(frameIndex, ms);
+        },
+        Qt::QueuedConnection);
+    presentPending = false;
+    if (StartupTimer::Instance().Mark(FirstFramePresented)) {
+      ReportStartup();
+    }
+  }
+}
+
+void OGLWidget::ReportStartup() {
+  if (const char* reportFile = std::getenv("S21_STARTUP_REPORT")) {
+    StartupTimer::Instance().WriteReport(reportFile);
+  }
+}
+
+void OGLWidget::UpdateStatsOverlay() {
+  QMetaObject::invokeMethod(
+      &renderer,
+      [this] {
+        FrameSummary summary = renderer.Summarize();
+        UploadStats upload = renderer.GetUploadStats();
+        PointStats points = renderer.GetPointStats();
+        ChunkStats chunks = renderer.GetChunkStats();
+        QMetaObject::invokeMethod(
+            this,
+            [this, summary, upload, points, chunks] {
+              ShowStats(summary, upload, points, chunks);
+            },
+            Qt::QueuedConnection);
+      },
+      Qt::QueuedConnection);
+}
+
+void OGLWidget::ShowStats(const FrameSummary& summary,
+                          const UploadStats& upload, const PointStats& points,
+                          const ChunkStats& chunks) {
+  QString text =
+      QString("frame  p50 %1 ms  p95 %2 ms  p99 %3 ms\n"
+              "gpu    p50 %4 ms  p95 %5 ms\n"
+              "%6 Mvert/s  %7 Medge/s  (%8 frames)")
+          .arg(summary.p50, 0, 'f', 2)
+          .arg(summary.p95, 0, 'f', 2)
+          .arg(summary.p99, 0, 'f', 2)
+          .arg(summary.gpuP50, 0, 'f', 2)
+          .arg(summary.gpuP95, 0, 'f', 2)
+          .arg(summary.verticesPerSecond / 1.0e6, 0, 'f', 1)
+          .arg(summary.edgesPerSecond / 1.0e6, 0, 'f', 1)
+          .arg(static_cast<qulonglong>(summary.frames)) +
+      QString("\nupload %1% in %2 chunks, last %3 MB/s, avg %4 MB/s")
+          .arg(upload.totalBytes == 0
+                   ? 100.0
+                   : 100.0 * upload.uploadedBytes / upload.totalBytes,
+               0, 'f', 0)
+          .arg(static_cast<qulonglong>(upload.chunks))
+          .arg(upload.lastChunkMBps, 0, 'f', 0)
+          .arg(upload.seconds > 0.0
+                   ? upload.uploadedBytes / upload.seconds / 1.0e6
+                   : 0.0,
+               0, 'f', 0);
+  if (upload.updateRanges > 0) {
+    text += QString("\nreload %1 ranges, %2 KB")
+                .arg(static_cast<qulonglong>(upload.updateRanges))
+                .arg(static_cast<qulonglong>(upload.updateBytes / 1024));
+  }
+  if (points.totalPoints > 0) {
+    text += QString("\npoints %1 of %2 in %3 nodes")
+                .arg(static_cast<qulonglong>(points.drawnPoints))
+                .arg(static_cast<qulonglong>(points.totalPoints))
+                .arg(static_cast<qulonglong>(points.drawnNodes));
+  }
+  if (chunks.totalChunks > 0) {
+    text += QString("\nchunks %1 of %2 visible, %3 drawn\n"
+                    "RAM    %4 chunks, %5 of %6 MB\n"
+                    "VRAM   %7 chunks, %8 of %9 MB")
+                .arg(static_cast<qulonglong>(chunks.visibleChunks))
+                .arg(static_cast<qulonglong>(chunks.totalChunks))
+                .arg(static_cast<qulonglong>(chunks.drawnChunks))
+                .arg(static_cast<qulonglong>(chunks.residentChunks))
+                .arg(static_cast<qulonglong>(chunks.residentBytes >> 20))
+                .arg(static_cast<qulonglong>(chunks.ramBudget >> 20))
+                .arg(static_cast<qulonglong>(chunks.gpuChunks))
+                .arg(static_cast<qulonglong>(chunks.gpuBytes >> 20))
+                .arg(static_cast<qulonglong>(chunks.vramBudget >> 20));
+  }
+  StartupTimer& startup = StartupTimer::Instance();
+  text += QString("\nstartup %1 ms to first frame, shaders %2 ms (%3)")
+              .arg(startup.GetMs(FirstFramePresented), 0, 'f', 0)
+              .arg(renderer.GetShaderCache().GetLastLinkMs(), 0, 'f', 1)
+              .arg(startup.IsShaderCacheHit() ? "cached" : "compiled");
+  if (AllocationScope::IsTrackingEnabled()) {
+    text += QString("\nalloc  %1 per frame")
+                .arg(summary.allocationsPerFrame, 0, 'f', 1);
+  }
+  GifStats gif = capture.GetStats();
+  if (gif.frames > 0) {
+    text += QString("\ngif    %1 frames, %2% of pixels encoded, %3 KB")
+                .arg(static_cast<qulonglong>(gif.frames))
+                .arg(100.0 * gif.encodedPixels /
+                         (gif.frames * gif.framePixels),
+                     0, 'f', 1)
+                .arg(static_cast<qulonglong>(gif.bytes / 1024));
+  }
+  CaptureStats captured = capture.GetCaptureStats();
+  if (captured.frames > 0) {
+    text += QString("\ncapture %1 frames, %2 dropped, %3 late")
+                .arg(static_cast<qulonglong>(captured.frames))
+                .arg(static_cast<qulonglong>(captured.dropped))
+                .arg(static_cast<qulonglong>(captured.late));
+  }
+  statsOverlay.setText(text);
+  statsOverlay.adjustSize();
 }
 
 void OGLWidget::LoadModel(std::string filename) {
-  viewerController.ParseObjFile(filename);
-  InitializeBuffers();
-  update();
+  S21_TRACE_SCOPE("OGLWidget::LoadModel");
+  if (loadRunning) {
+    // The loader is busy with a previewed file, the last request waits for it.
+    queuedLoad = filename;
+    return;
+  }
+  // The loader is shared with the reload thread.
+  reloadTimer.stop();
+  reloadQueued = false;
+  JoinReload();
+  JoinLoad();
+  watchedFile.clear();
+  bool mapped = renderContext && !UseOutOfCore(filename) &&
+                renderer.UseMappedLoad(filename);
+  if (renderContext && UsePreview(filename)) {
+    StartPreviewLoad(filename, mapped);
+    return;
+  }
+  std::exception_ptr error;
+  try {
+    std::lock_guard<std::mutex> lock(renderer.GetModelMutex());
+    ParseModel(filename, mapped);
+    PublishModel(mapped);
+  } catch (...) {
+    error = std::current_exception();
+  }
+  FinishLoad(filename, error);
+}
+
+void OGLWidget::SetOutOfCoreSettings(const OutOfCoreSettings& settings) {
+  outOfCore = settings;
+  state.vramBudget = settings.vramBudget;
+  PublishState();
+}
+
+bool OGLWidget::UseOutOfCore(const std::string& filename) const {
+  std::error_code error;
+  std::uintmax_t fileSize = std::filesystem::file_size(filename, error);
+  return !error && outOfCore.minFileBytes > 0 &&
+         fileSize >= outOfCore.minFileBytes;
+}
+
+std::string OGLWidget::ChunkStoreFile(const std::string& filename) const {
+  std::string directory =
+      outOfCore.storeDirectory.empty() ? "." : outOfCore.storeDirectory;
+  std::error_code error;
+  std::filesystem::create_directories(directory, error);
+  // The same file opened by another relative path shares its store.
+  QCryptographicHash hash(QCryptographicHash::Sha1);
+  hash.addData(QString::fromStdString(
+                   std::filesystem::absolute(filename, error).string())
+                   .toUtf8());
+  return directory + "/" +
+         QString::fromLatin1(hash.result().toHex()).toStdString() + ".chunks";
+}
+
+bool OGLWidget::UsePreview(const std::string& filename) const {
+  std::error_code error;
+  std::uintmax_t fileSize = std::filesystem::file_size(filename, error);
+  return !error && fileSize >= kPreviewMinBytes;
+}
+
+void OGLWidget::StartPreviewLoad(const std::string& filename, bool mapped) {
+  renderer.SetPreview(viewerController.SampleObjFile(filename));
+  viewerController.SetLoadProgress(
+      [this](const BoundingBox& parsed) { renderer.RefinePreview(parsed); });
+  loadRunning = true;
+  loadThread = std::thread([this, filename, mapped] {
+    S21_TRACE_SCOPE("OGLWidget::StartPreviewLoad");
+    std::exception_ptr error;
+    try {
+      std::lock_guard<std::mutex> lock(renderer.GetModelMutex());
+      ParseModel(filename, mapped);
+    } catch (...) {
+      error = std::current_exception();
+    }
+    // The state belongs to the GUI thread. The renderer keeps drawing the
+    // preview until the new model is published there.
+    QMetaObject::invokeMethod(
+        this,
+        [this, filename, mapped, error] {
+          FinishPreviewLoad(filename, mapped, error);
+        },
+        Qt::QueuedConnection);
+  });
+}
+
+void OGLWidget::FinishPreviewLoad(const std::string& filename, bool mapped,
+                                  std::exception_ptr error) {
+  JoinLoad();
+  loadRunning = false;
+  viewerController.SetLoadProgress(nullptr);
+  if (!error) {
+    PublishModel(mapped);
+  }
+  renderer.ClearPreview();
+  FinishLoad(filename, error);
+  if (!queuedLoad.empty()) {
+    std::string next;
+    next.swap(queuedLoad);
+    LoadModel(next);
+  }
+}
+
+void OGLWidget::FinishLoad(const std::string& filename,
+                           std::exception_ptr error) {
+  // A frame requested while the model was locked has been skipped.
+  renderer.RequestFrame();
+  if (error) {
+    // The previous file is no longer watched.
+    UpdateWatchedFile();
+    emit ModelLoadFailed(error);
+    return;
+  }
+  // Every change would build the chunk store of a huge file again.
+  if (!viewerController.IsOutOfCore()) {
+    watchedFile = filename;
+  }
+  UpdateWatchedFile();
+  emit ModelLoaded(filename);
+}
+
+void OGLWidget::JoinLoad() {
+  if (loadThread.joinable()) {
+    loadThread.join();
+  }
+}
+
+void OGLWidget::ParseModel(const std::string& filename, bool mapped) {
+  if (UseOutOfCore(filename)) {
+    viewerController.ParseObjFileOutOfCore(filename, ChunkStoreFile(filename),
+                                           outOfCore.ramBudget);
+    return;
+  }
+  try {
+    if (mapped) {
+      viewerController.ParseObjFileInto(
+          filename, [this](size_t verticesSize, size_t indicesSize) {
+            // Buffers are created by the render context, the mapped memory
+            // is then filled on this thread.
+            BufferView buffers{};
+            std::exception_ptr error;
+            QMetaObject::invokeMethod(
+                &renderer,
+                [&] {
+                  try {
+                    buffers =
+                        renderer.CreateMappedBuffers(verticesSize, indicesSize);
+                  } catch (...) {
+                    error = std::current_exception();
+                  }
+                },
+                Qt::BlockingQueuedConnection);
+            if (error) {
+              std::rethrow_exception(error);
+            }
+            return buffers;
+          });
+    } else {
+      viewerController.ParseObjFile(filename);
+    }
+  } catch (...) {
+    if (mapped) {
+      QMetaObject::invokeMethod(
+          &renderer, [this] { renderer.DiscardPendingBuffers(); },
+          Qt::QueuedConnection);
+    }
+    throw;
+  }
+}
+
+void OGLWidget::PublishModel(bool mapped) {
+  // The loaded model starts with the default scale.
+  state.scale = 1.0;
+  state.modelGeneration++;
+  state.mappedModel = mapped;
+  PublishState();
+}
+
+void OGLWidget::SetWatchEnabled(bool enabled) {
+  watchEnabled = enabled;
+  if (!enabled) {
+    reloadTimer.stop();
+  }
+  UpdateWatchedFile();
+}
+
+bool OGLWidget::IsWatchEnabled() const { return watchEnabled; }
+
+void OGLWidget::UpdateWatchedFile() {
+  QString path = QString::fromStdString(watchedFile);
+  bool watch = watchEnabled && !watchedFile.empty();
+  QStringList files = fileWatcher.files();
+  if (!files.isEmpty() && (!watch || !files.contains(path))) {
+    fileWatcher.removePaths(files);
+  }
+  if (watch && !fileWatcher.files().contains(path) &&
+      QFileInfo(path).exists()) {
+    fileWatcher.addPath(path);
+  }
+}
+
+void OGLWidget::OnFileChanged(const QString&) {
+  // Editors saving through a renamed copy replace the file, which drops it
+  // from the watcher.
+  UpdateWatchedFile();
+  reloadTimer.start();
+}
+
+void OGLWidget::ReloadModel() {
+  if (watchedFile.empty()) {
+    // The loader is busy with a new model, which is watched once loaded.
+    return;
+  }
+  if (reloadRunning) {
+    reloadQueued = true;
+    return;
+  }
+  JoinReload();
+  reloadRunning = true;
+  reloadThread = std::thread([this] {
+    S21_TRACE_SCOPE("OGLWidget::ReloadModel");
+    bool reloaded = false;
+    bool appended = false;
+    try {
+      // The render thread doesn't use the loader, it only waits while the
+      // model takes the parsed data.
+      appended = viewerController.ReparseObjFile();
+      std::lock_guard<std::mutex> lock(renderer.GetModelMutex());
+      renderer.QueueModelUpdate(viewerController.UpdateModelBuffers(appended));
+      reloaded = true;
+    } catch (const std::exception&) {
+      // The file may be half saved, the model on screen is kept until the
+      // next change.
+    }
+    renderer.RequestFrame();
+    QMetaObject::invokeMethod(
+        this, [this, reloaded, appended] { FinishReload(reloaded, appended); },
+        Qt::QueuedConnection);
+  });
+}
+
+void OGLWidget::FinishReload(bool reloaded, bool appended) {
+  reloadRunning = false;
+  UpdateWatchedFile();
+  if (reloaded) {
+    emit ModelReloaded(appended);
+  }
+  if (reloadQueued) {
+    reloadQueued = false;
+    ReloadModel();
+  }
+}
+
+void OGLWidget::JoinReload() {
+  if (reloadThread.joinable()) {
+    reloadThread.join();
+  }
 }
 
 void OGLWidget::ScaleModel(bool positiveScale) {
   if (positiveScale) {
-    scale = 1.1;
+    state.scale *= 1.1;
   } else {
-    scale = 0.9;
+    state.scale *= 0.9;
   }
-  currentStrategy = s21::TransformationStrategy::Scale;
-  repaint();
+  PublishState();
 }
 
 void OGLWidget::SetModelRed(float value) {
-  modelColor[0] = value;
-  repaint();
+  state.modelColor[0] = value;
+  PublishState();
 }
 
 void OGLWidget::SetModelGreen(float value) {
-  modelColor[1] = value;
-  repaint();
+  state.modelColor[1] = value;
+  PublishState();
 }
 
 void OGLWidget::SetModelBlue(float value) {
-  modelColor[2] = value;
-  repaint();
+  state.modelColor[2] = value;
+  PublishState();
 }
 
 void OGLWidget::SetBackgroundRed(float value) {
-  backgroundColor[0] = value;
-  repaint();
+  state.backgroundColor[0] = value;
+  PublishState();
 }
 
 void OGLWidget::SetBackgroundGreen(float value) {
-  backgroundColor[1] = value;
-  repaint();
+  state.backgroundColor[1] = value;
+  PublishState();
 }
 
 void OGLWidget::SetBackgroundBlue(float value) {
-  backgroundColor[2] = value;
-  repaint();
+  state.backgroundColor[2] = value;
+  PublishState();
 }
 
 void OGLWidget::SetVerticesRed(float value) {
-  verticesColor[0] = value;
-  repaint();
+  state.verticesColor[0] = value;
+  PublishState();
 }
 
 void OGLWidget::SetVerticesGreen(float value) {
-  verticesColor[1] = value;
-  repaint();
+  state.verticesColor[1] = value;
+  PublishState();
 }
 
 void OGLWidget::SetVerticesBlue(float value) {
-  verticesColor[2] = value;
-  repaint();
+  state.verticesColor[2] = value;
+  PublishState();
 }
 
 void OGLWidget::SetLineStyle(int value) {
-  linesStyle = value;
-  repaint();
+  state.linesStyle = value;
+  PublishState();
 }
 
 void OGLWidget::SetVertexStyle(int value) {
-  verticesStyle = value;
-  repaint();
+  state.verticesStyle = value;
+  PublishState();
 }
 
 void OGLWidget::SetProjectionType(int value) {
   if (value == 0) {
-    currentProjectionType = s21::ProjectionType::Orthogonal;
+    state.projectionType = s21::ProjectionType::Orthogonal;
   } else {
-    currentProjectionType = s21::ProjectionType::Frustum;
+    state.projectionType = s21::ProjectionType::Frustum;
   }
-  repaint();
+  PublishState();
 }
 
 void OGLWidget::SetLineWidth(float value) {
-  linesThickness = value;
-  repaint();
+  state.linesThickness = value;
+  PublishState();
 }
 
 void OGLWidget::SetVertexWidth(float value) {
-  verticesThikness = value;
-  repaint();
+  state.verticesThikness = value;
+  PublishState();
 }
 
 void OGLWidget::SetRotation(int x, int y, int z) {
-  xRot = x;
-  yRot = y;
-  zRot = z;
-  currentStrategy = s21::TransformationStrategy::Rotate;
-  repaint();
+  state.xRot = x;
+  state.yRot = y;
+  state.zRot = z;
+  PublishState();
 }
 
 void OGLWidget::SetOffset(float x, float y, float z) {
-  xOffset = x;
-  yOffset = y;
-  zOffset = z;
-  currentStrategy = s21::TransformationStrategy::Move;
-  repaint();
+  state.xOffset = x;
+  state.yOffset = y;
+  state.zOffset = z;
+  PublishState();
 }
 
-void OGLWidget::GrabJPEG() {
-  QImage grabbedImage = grabFramebuffer();
-  grabbedImage.save("screenshot.jpeg");
+void OGLWidget::BeginStateUpdate() { stateUpdates++; }
+
+void OGLWidget::EndStateUpdate() {
+  if (--stateUpdates == 0 && statePending) {
+    statePending = false;
+    PublishState();
+  }
 }
 
-void OGLWidget::GrabBMP() {
-  QImage grabbedImage = grabFramebuffer();
-  grabbedImage.save("screenshot.bmp");
+void OGLWidget::GrabJPEG() { SaveScreenshot("screenshot.jpeg"); }
+
+void OGLWidget::GrabBMP() { SaveScreenshot("screenshot.bmp"); }
+
+void OGLWidget::SetScreenshotSize(int width, int height) {
+  screenshotWidth = width;
+  screenshotHeight = height;
+}
+
+void OGLWidget::SaveScreenshot(const QString& filename) {
+  if (!renderContext) {
+    return;
+  }
+  RenderState frameState = state;
+  if (screenshotWidth > 0 && screenshotHeight > 0) {
+    // A .jpeg can't be written row by row, only .bmp files are tiled.
+    if (!filename.endsWith(".bmp")) {
+      return;
+    }
+    frameState.width = screenshotWidth;
+    frameState.height = screenshotHeight;
+    tiledScreenshot.Start(frameState, filename.toStdString());
+    return;
+  }
+  RequestOffscreenFrame(frameState, [this, filename](QImage image) {
+    // The image is encoded on the GUI thread, not the render thread.
+    QMetaObject::invokeMethod(
+        this,
+        [image, filename] {
+          if (!image.isNull()) {
+            image.save(filename);
+          }
+        },
+        Qt::QueuedConnection);
+  });
+}
+
+void OGLWidget::RequestOffscreenFrame(const RenderState& frameState,
+                                      ImageReceiver receiver) {
+  QMetaObject::invokeMethod(
+      &renderer,
+      [this, frameState, receiver] {
+        renderer.ReadFrame(frameState, receiver);
+      },
+      Qt::QueuedConnection);
 }
 
 void OGLWidget::RecordGIF() {
-  std::thread recorderThread(&OGLWidget::ThreadGrabbing, this);
-  recorderThread.detach();
+  if (capture.IsRecording()) {
+    capture.Cancel();
+  } else if (renderContext) {
+    GifSettings settings = gifSettings;
+    if (settings.width <= 0 || settings.height <= 0) {
+      settings.width = width() * devicePixelRatio();
+      settings.height = height() * devicePixelRatio();
+    }
+    capture.Start(settings, state);
+  }
+}
+
+bool OGLWidget::IsRecordingGIF() const { return capture.IsRecording(); }
+
+void OGLWidget::SetGifSettings(const GifSettings& settings) {
+  gifSettings = settings;
 }
 
 int OGLWidget::GetUniqueEdgesCount() const {
@@ -243,12 +734,45 @@ int OGLWidget::GetUniqueEdgesCount() const {
 }
 
 int OGLWidget::GetVerticesCount() const {
-  return viewerController.GetBuffersData().first.size();
+  if (const ChunkStore* store = viewerController.GetChunkStore()) {
+    return static_cast<int>(store->GetVerticesCount() * 3);
+  }
+  return static_cast<int>(viewerController.GetBuffersSize().first);
+}
+
+MemoryUsage OGLWidget::GetMemoryUsage(MemorySubsystem subsystem) const {
+  return viewerController.GetMemoryUsage(subsystem);
 }
 
-void OGLWidget::GrabGIFImage() {
-  repaint();
-  recorder.AddImage(grabFramebuffer());
+std::size_t OGLWidget::GetPeakRss() const {
+  return viewerController.GetPeakRss();
+}
+
+void OGLWidget::SetStatsOverlayVisible(bool visible) {
+  if (visible) {
+    UpdateStatsOverlay();
+    statsOverlay.show();
+    statsOverlay.raise();
+    overlayTimer.start(500);
+  } else {
+    overlayTimer.stop();
+    statsOverlay.hide();
+  }
+}
+
+void OGLWidget::ToggleStatsOverlay() {
+  SetStatsOverlayVisible(!statsOverlay.isVisible());
+}
+
+bool OGLWidget::ExportFrameStats(const std::string& filename) {
+  bool result = false;
+  if (!renderContext) {
+    return result;
+  }
+  QMetaObject::invokeMethod(
+      &renderer, [&] { result = renderer.ExportFrameStats(filename); },
+      Qt::BlockingQueuedConnection);
+  return result;
 }
 
 }  // namespace s21
@@ -7,34 +7,90 @@
 #define S21_OPENGL_WIDGET_H
 
 #include <QOpenGLWidget>
+#include <QFileSystemWatcher>
 #include <QOpenGLFunctions_4_1_Core>
-#include <QOpenGLShaderProgram>
-#include <QOpenGLBuffer>
-#include <thread>
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <QThread>
+#include <QLabel>
+#include <QTimer>
+#include <algorithm>
 #include <chrono>
-#include "s21_gif_recorder.h"
+#include <exception>
+#include <memory>
+#include <string>
+#include <thread>
+#include "s21_gif_capture.h"
+#include "s21_tiled_screenshot.h"
+#include "s21_renderer.h"
 #include "../controller/s21_controller.h"
 
 namespace s21 {
 
+/**
+ * @brief Parameters of models too large for memory.
+ **/
+struct OutOfCoreSettings {
+    std::uintmax_t minFileBytes; ///< Smallest .obj file opened out of core, 0 to never open files out of core.
+    std::size_t ramBudget; ///< Largest size of the chunks kept in memory.
+    std::size_t vramBudget; ///< Largest size of the chunks kept on the GPU.
+    std::string storeDirectory; ///< Directory of the chunk stores, built on the first open of a file, empty for the working directory.
+};
+
 /**
  * @brief Class inherited from QOpenGLWidget.
- * Stores and manages data necessary for proper rendering
+ * Stores the UI state and composites frames rendered by the Renderer on its own thread.
  **/
 class OGLWidget : public QOpenGLWidget, private QOpenGLFunctions_4_1_Core
 {
     Q_OBJECT
 public:
+    static constexpr int kReloadDelayMs = 200; ///< Quiet time after a file change before the model is reloaded.
+    static constexpr std::uintmax_t kPreviewMinBytes = 32 << 20; ///< Smallest .obj file previewed while it is parsed.
+
     OGLWidget(s21::Controller& controller, QWidget* parent = nullptr);
     OGLWidget() = delete;
-    ~OGLWidget() = default;
+    ~OGLWidget();
 
    /**
    * @brief Loads .obj model file.
+   * Large files are parsed straight into persistently mapped buffers when
+   * glBufferStorage is available, otherwise the buffers are uploaded in chunks.
+   * The render thread skips frames while the model is parsed. Files of at least
+   * kPreviewMinBytes are sampled first and parsed on a worker thread, the
+   * sampled vertices are drawn as points meanwhile and the call returns at once.
+   * The result is reported by ModelLoaded() or ModelLoadFailed(). A file requested
+   * while another one is parsed is loaded after it, only the last such request is kept.
+   * Files of at least OutOfCoreSettings::minFileBytes are opened out of core:
+   * the first open builds a chunk store, the renderer streams the chunks in view.
+   * Such files aren't watched.
    * @param filename Upload file name.
    **/
     void LoadModel(std::string filename);
 
+    /**
+   * @brief Sets the threshold and the memory budgets of out-of-core models.
+   * The budgets of a loaded model change with the next load, the VRAM budget at once.
+   * @param settings Parameters of the following loads.
+   **/
+    void SetOutOfCoreSettings(const OutOfCoreSettings& settings);
+
+    /**
+   * @brief Enables or disables reloading the model when its file changes.
+   * Changes are collected for kReloadDelayMs, then the file is re-parsed on a worker
+   * thread: appended lines are parsed alone, otherwise the changed ranges are found.
+   * Only those ranges are uploaded, the transform of the model is kept.
+   * A file that fails to parse keeps the previous model on screen.
+   * @param enabled true to watch the loaded file.
+   **/
+    void SetWatchEnabled(bool enabled);
+
+    /**
+   * @brief Checks whether the loaded file is watched.
+   * @return true if watching is enabled.
+   **/
+    bool IsWatchEnabled() const;
+
     /**
    * @brief Scaling model methid.
    * @param positiveScale bool parameter, in case of truth, scales the model by 1.1
@@ -141,23 +197,56 @@ public:
    **/
     void SetOffset(float x, float y, float z);
 
+    /**
+   * @brief Starts collecting state changes into one update.
+   * Setters called until the matching EndStateUpdate() publish nothing, so no
+   * frame is rendered for an intermediate state. Calls can be nested.
+   **/
+    void BeginStateUpdate();
+
+    /**
+   * @brief Publishes the state changed since the matching BeginStateUpdate().
+   **/
+    void EndStateUpdate();
+
     /**
    * @brief Method for taking a screenshot in .jpeg format.
+   * Does nothing with a screenshot size set, as only .bmp files are rendered in tiles.
    **/
     void GrabJPEG();
 
     /**
    * @brief Method for taking a screenshot in .bmp format.
+   * With a screenshot size set the image is rendered in tiles, see TiledScreenshot.
    **/
     void GrabBMP();
 
     /**
-   * @brief Method for making .gif screencast.
-   * Creates a thread, that emits signal for grabbing framebuffer
-   * each 100 milliseconds.
+   * @brief Sets the resolution of screenshots.
+   * @param width Width in pixels, 0 to take screenshots at the size of the widget.
+   * @param height Height in pixels, 0 to take screenshots at the size of the widget.
+   **/
+    void SetScreenshotSize(int width, int height);
+
+    /**
+   * @brief Starts a screencast, or cancels the running one.
+   * Frames are rendered offscreen at the recording resolution for exact timestamps,
+   * a zero width or height records at the resolution of the widget, see GifCapture.
    **/
     void RecordGIF();
 
+    /**
+   * @brief Checks whether a screencast is being recorded.
+   * @return true if recording.
+   **/
+    bool IsRecordingGIF() const;
+
+    /**
+   * @brief Sets parameters of the next screencast.
+   * @param settings Resolution, frame count, fps, output file and format.
+   **/
+    void SetGifSettings(const GifSettings& settings);
+
     /**
    * @brief Getter of unique edges count.
    * @return  Number of unique edges.
@@ -169,59 +258,246 @@ public:
    * @return  Number of vertices.
    **/
     int GetVerticesCount() const;
+
+    /**
+   * @brief Getter of the memory held by a subsystem.
+   * @param subsystem Holder of the buffers.
+   * @return Current and peak bytes.
+   **/
+    MemoryUsage GetMemoryUsage(MemorySubsystem subsystem) const;
+
+    /**
+   * @brief Getter of the peak resident memory of the process.
+   * @return Peak resident memory in bytes.
+   **/
+    std::size_t GetPeakRss() const;
+
+    /**
+   * @brief Shows or hides the frame statistics overlay.
+   * @param visible true to show the overlay, false to hide it.
+   **/
+    void SetStatsOverlayVisible(bool visible);
+
+    /**
+   * @brief Switches visibility of the frame statistics overlay.
+   **/
+    void ToggleStatsOverlay();
+
+    /**
+   * @brief Writes the stored per-frame measurements into a .csv file.
+   * @param filename Output file name.
+   * @return true in case of success, false otherwise.
+   **/
+    bool ExportFrameStats(const std::string& filename);
 signals:
     /**
-   * @brief A signal that triggers the capture of the current framebuffer.
+   * @brief Emitted after the watched file was reloaded.
+   * @param appended true if only appended lines were parsed.
+   **/
+    void ModelReloaded(bool appended);
+
+    /**
+   * @brief Emitted on the GUI thread after a model was loaded by LoadModel().
+   * @param filename Name of the loaded file.
    **/
-    void GrabSignal();
+    void ModelLoaded(const std::string& filename);
+
+    /**
+   * @brief Emitted on the GUI thread after LoadModel() failed, the previous model is kept.
+   * @param error Exception thrown by the loader.
+   **/
+    void ModelLoadFailed(std::exception_ptr error);
 private slots:
     /**
-   * @brief Slot executed on the main thread.
-   * Grabs framebuffer of QOpenGLWidget
+   * @brief Slot executed after the composited frame is swapped.
+   * Reports the presentation time of the last new frame to the renderer.
+   **/
+    void OnFrameSwapped();
+
+    /**
+   * @brief Requests fresh frame statistics from the render thread.
    **/
-    void GrabGIFImage();
+    void UpdateStatsOverlay();
+
+    /**
+   * @brief Slot executed when the watched file changes, restarts the reload delay.
+   * @param path Path of the changed file.
+   **/
+    void OnFileChanged(const QString& path);
+
+    /**
+   * @brief Starts re-parsing the watched file on the reload thread.
+   * A change arriving while a reload runs is reloaded after it.
+   **/
+    void ReloadModel();
 private:
     /**
    * @brief Overrided method of openGL initialization.
-   * Compiles shader programm.
+   * Creates the render context shared with the widget's one and starts the render thread.
    **/
     void initializeGL() override;
 
+    /**
+   * @brief Overrided method of openGL resizing.
+   * Publishes the new frame size.
+   * @param w New width.
+   * @param h New height.
+   **/
+    void resizeGL(int w, int h) override;
+
     /**
    * @brief Overrided method of openGL rendering.
-   * Collects data, sends it to the controller and renders the received data.
+   * Blits the latest rendered frame into the widget's framebuffer, never waits for the render thread.
    **/
     void paintGL() override;
 
     /**
-   * @brief Сreates VBO and EBO in current openGL context.
-   * Should be called immediately after loading the model.
+   * @brief Hands a snapshot of the UI state to the render thread and requests a frame.
+   **/
+    void PublishState();
+
+    /**
+   * @brief Renders the current state offscreen and saves it once it is read back.
+   * @param filename Output file name, the format is taken from the extension.
+   * With a screenshot size set only .bmp names are accepted, see TiledScreenshot.
+   **/
+    void SaveScreenshot(const QString& filename);
+
+    /**
+   * @brief Queues an offscreen render on the render thread. Can be called from any thread.
+   * @param frameState State to render.
+   * @param receiver Callback receiving the read back image.
+   **/
+    void RequestOffscreenFrame(const RenderState& frameState, ImageReceiver receiver);
+
+    /**
+   * @brief Reports the time from the start of the process to the first presented frame.
+   * The report is written to the file named by S21_STARTUP_REPORT, if set.
+   **/
+    void ReportStartup();
+
+    /**
+   * @brief Checks whether a file is large enough to be previewed while it is parsed.
+   * @param filename Name of the model file.
+   * @return true if the file has at least kPreviewMinBytes.
+   **/
+    bool UsePreview(const std::string& filename) const;
+
+    /**
+   * @brief Checks whether a file is opened out of core.
+   * @param filename Name of the model file.
+   * @return true if the file has at least OutOfCoreSettings::minFileBytes.
+   **/
+    bool UseOutOfCore(const std::string& filename) const;
+
+    /**
+   * @brief Names the chunk store of a file, creating the store directory.
+   * @param filename Name of the model file.
+   * @return Store file named after the hash of the absolute path of the model file.
+   **/
+    std::string ChunkStoreFile(const std::string& filename) const;
+
+    /**
+   * @brief Shows the sampled preview and starts parsing the file on the load thread.
+   * The bounds of the preview are refined with the vertices parsed so far.
+   * @param filename Name of the model file.
+   * @param mapped Whether the file is parsed into mapped buffers.
+   **/
+    void StartPreviewLoad(const std::string& filename, bool mapped);
+
+    /**
+   * @brief Publishes the model parsed by the load thread, replacing the preview,
+   * and starts a queued load.
+   * @param filename Name of the model file.
+   * @param mapped Whether the file was parsed into mapped buffers.
+   * @param error Exception thrown by the parser, null on success.
+   **/
+    void FinishPreviewLoad(const std::string& filename, bool mapped, std::exception_ptr error);
+
+    /**
+   * @brief Watches the loaded file and reports the result of a load.
+   * @param filename Name of the model file.
+   * @param error Exception thrown by the loader, null on success.
+   **/
+    void FinishLoad(const std::string& filename, std::exception_ptr error);
+
+    /**
+   * @brief Waits for the load thread.
+   **/
+    void JoinLoad();
+
+    /**
+   * @brief Parses the file into the model, the model mutex must be held.
+   * Can be called from any thread.
+   * @param filename Name of the model file.
+   * @param mapped Whether the file is parsed into mapped buffers.
+   **/
+    void ParseModel(const std::string& filename, bool mapped);
+
+    /**
+   * @brief Publishes the state of a newly parsed model, the model mutex must be held
+   * unless the renderer still shows the preview.
+   * @param mapped Whether the model was parsed into mapped buffers.
+   **/
+    void PublishModel(bool mapped);
+
+    /**
+   * @brief Finishes a reload on the GUI thread and starts a queued one.
+   * @param reloaded Whether the file was parsed.
+   * @param appended Whether only appended lines were parsed.
+   **/
+    void FinishReload(bool reloaded, bool appended);
+
+    /**
+   * @brief Waits for the reload thread.
+   **/
+    void JoinReload();
+
+    /**
+   * @brief Watches the loaded file if watching is enabled, nothing otherwise.
    **/
-    void InitializeBuffers();
+    void UpdateWatchedFile();
 
     /**
-   * @brief Thread method.
-   * Emits GrabSignal() every 100 milliseconds.
+   * @brief Sets the text of the frame statistics overlay.
+   * @param summary Frame statistics.
+   * @param upload Upload statistics.
+   * @param points Points drawn for a point cloud.
+   * @param chunks Chunks of an out-of-core model.
    **/
-    void ThreadGrabbing();
+    void ShowStats(const FrameSummary& summary, const UploadStats& upload,
+                   const PointStats& points, const ChunkStats& chunks);
 
     Controller& viewerController; ///< Reference to viewert controler.
-    GifRecorder recorder; ///< Instance of gif recorder.
-    TransformationStrategy currentStrategy; ///< Current strategy, strategy that will be executed on the backend side.
-    ProjectionType currentProjectionType; ///< Current projection type.
-    QOpenGLShaderProgram shaderProgramm; ///< Shader programm. Contains compiled shaders that will be executed on the GPU.
-    QOpenGLBuffer VBO; ///< Vertex buffer object. Contains coordinates of model's vertices.
-    QOpenGLBuffer EBO; ///< Element buffer object. Contains indices needed for rendering.
-    std::array<float, 3> modelColor; ///< Array of model color. Consists of 3 components: R, G and B.
-    std::array<float, 3> backgroundColor; ///< Array of background color. Consists of 3 components: R, G and B.
-    std::array<float, 3> verticesColor; ///< Array of vertex color. Consists of 3 components: R, G and B.
-    float scale; ///< Scale value.
-    float linesThickness; ///< Width of model edges.
-    float verticesThikness; ///< Width of model verices.
-    int linesStyle; ///< Current edges style.
-    int verticesStyle; ///< Current vertices style.
-    int xRot, yRot, zRot; ///< Rotation values by each axis.
-    float xOffset, yOffset, zOffset; ///< Offset values by each axis.
+    Renderer renderer; ///< Renders frames on the render thread.
+    QThread renderThread; ///< Thread the renderer lives on.
+    std::unique_ptr<QOffscreenSurface> renderSurface; ///< Surface of the render context.
+    std::unique_ptr<QOpenGLContext> renderContext; ///< Context of the render thread, shared with the widget's context.
+    GifCapture capture; ///< Records gif screencasts.
+    GifSettings gifSettings; ///< Parameters of the next screencast.
+    OutOfCoreSettings outOfCore; ///< Parameters of models too large for memory.
+    TiledScreenshot tiledScreenshot; ///< Renders screenshots larger than the widget.
+    int screenshotWidth; ///< Width of screenshots, 0 for the size of the widget.
+    int screenshotHeight; ///< Height of screenshots, 0 for the size of the widget.
+    RenderState state; ///< Current UI state, published to the render thread on every change.
+    int stateUpdates; ///< Depth of nested BeginStateUpdate() calls.
+    bool statePending; ///< Whether the state changed during an update.
+    GLuint readFramebuffer; ///< Framebuffer of the widget's context the rendered texture is attached to.
+    std::uint64_t presentedFrame; ///< Number of the frame composited last.
+    bool presentPending; ///< Whether a new frame waits for the swap.
+    std::chrono::steady_clock::time_point presentRenderEnd; ///< Moment the pending frame was published.
+    QLabel statsOverlay; ///< Label with frame statistics drawn over the model.
+    QTimer overlayTimer; ///< Timer refreshing the statistics overlay.
+    QFileSystemWatcher fileWatcher; ///< Watches the loaded file.
+    QTimer reloadTimer; ///< Delays the reload until the file stops changing.
+    std::string watchedFile; ///< File of the loaded model.
+    bool watchEnabled; ///< Whether the loaded file is watched.
+    std::thread reloadThread; ///< Re-parses the watched file.
+    bool reloadRunning; ///< Whether the reload thread hasn't finished yet.
+    bool reloadQueued; ///< Whether the file changed again during a reload.
+    std::thread loadThread; ///< Parses previewed files.
+    bool loadRunning; ///< Whether a previewed file is being loaded.
+    std::string queuedLoad; ///< File requested during a load, empty if none.
 
 };
 
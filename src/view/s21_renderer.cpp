@@ -0,0 +1,1065 @@
+/**
+ * @file s21_renderer.cpp
+ * @brief Render thread worker implementation.
+ */
+
+#include "s21_renderer.h"
+
+#include <QCoreApplication>
+#include <QThread>
+#include <QTimer>
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#endif
+#ifndef GL_MAP_COHERENT_BIT
+#define GL_MAP_COHERENT_BIT 0x0080
+#endif
+#ifndef GL_CLIENT_STORAGE_BIT
+#define GL_CLIENT_STORAGE_BIT 0x0200
+#endif
+
+namespace s21 {
+
+Renderer::Renderer(Controller& controller)
+    : viewerController(controller),
+      context(nullptr),
+      surface(nullptr),
+      shaderCache(ShaderCache::DefaultDirectory()),
+      EBO(QOpenGLBuffer::IndexBuffer),
+      pendingEBO(QOpenGLBuffer::IndexBuffer),
+      captureFrame(),
+      pixelBuffers(),
+      nextPixelBuffer(0),
+      readbackPollScheduled(false),
+      imagePool(ImagePool::Create()),
+      framePending(false),
+      loadedGeneration(0),
+      appliedOffset{0.0f, 0.0f, 0.0f},
+      appliedScale(1.0f),
+      timerQueries({0, 0}),
+      queryFrames({0, 0}),
+      queryPending({false, false}),
+      queryIndex(0),
+      traceNextFrame(false),
+      uploadStats(),
+      vboUploaded(0),
+      eboUploaded(0),
+      vboSize(0),
+      eboSize(0),
+      vboCapacity(0),
+      eboCapacity(0),
+      pendingBytes(0),
+      pendingUpdate(),
+      updatePending(false),
+      pointSelection(),
+      pointStats(),
+      modelChunkBytes(0),
+      chunkFrame(0),
+      chunksPending(false),
+      chunkStats(),
+      previewCloud(),
+      previewBox(),
+      previewActive(false),
+      previewDirty(false),
+      previewLoading(false),
+      previewVBO(QOpenGLBuffer::VertexBuffer),
+      previewPoints(0),
+      previewModel(),
+      previewController(previewModel),
+      bufferStorage(nullptr),
+      immutableBuffers(false) {
+  frames.Buffers().fill(RenderFrame{});
+  states.Buffers().fill(RenderState{});
+}
+
+void Renderer::Initialize(QOpenGLContext* renderContext,
+                          QOffscreenSurface* renderSurface) {
+  Tracer::Instance().SetThreadName("Render");
+  context = renderContext;
+  surface = renderSurface;
+  context->makeCurrent(surface);
+  initializeOpenGLFunctions();
+  pointProgram = std::make_unique<QOpenGLShaderProgram>();
+  bool pointsCached = shaderCache.Link(
+      *pointProgram, *this,
+      {{QOpenGLShader::Vertex, ":/shaders/point_shader.vert"},
+       {QOpenGLShader::Fragment, ":/shaders/point_shader.frag"}});
+  // The main program is linked last, the overlay shows its link time.
+  shaderProgramm = std::make_unique<QOpenGLShaderProgram>();
+  bool cached = shaderCache.Link(
+      *shaderProgramm, *this,
+      {{QOpenGLShader::Vertex, ":/shaders/transform_shader.vert"},
+       {QOpenGLShader::Geometry, ":/shaders/geometry_shader.glsl"},
+       {QOpenGLShader::Fragment, ":/shaders/color_shader.frag"}});
+  StartupTimer::Instance().SetShaderCacheHit(cached && pointsCached);
+  StartupTimer::Instance().Mark(ShadersReady);
+  glGenQueries(2, timerQueries.data());
+  glGenBuffers(kReadbackBuffers, pixelBuffers.data());
+  if (context->format().version() >= qMakePair(4, 4) ||
+      context->hasExtension("GL_ARB_buffer_storage")) {
+    bufferStorage = reinterpret_cast<BufferStorageFunction>(
+        context->getProcAddress("glBufferStorage"));
+  }
+}
+
+void Renderer::Cleanup() {
+  if (context == nullptr) {
+    return;
+  }
+  context->makeCurrent(surface);
+  CollectReadbacks(true);
+  glDeleteBuffers(kReadbackBuffers, pixelBuffers.data());
+  for (RenderFrame& frame : frames.Buffers()) {
+    DeleteFrame(frame);
+  }
+  DeleteFrame(captureFrame);
+  glDeleteQueries(2, timerQueries.data());
+  VBO.destroy();
+  EBO.destroy();
+  pendingVBO.destroy();
+  pendingEBO.destroy();
+  previewVBO.destroy();
+  if (ChunkCache* cache = viewerController.GetChunkCache()) {
+    cache->SetReadyCallback(nullptr);
+  }
+  ReleaseModelChunks();
+  vboSize = eboSize = vboCapacity = eboCapacity = pendingBytes = 0;
+  ReportGpuMemory();
+  shaderProgramm.reset();
+  pointProgram.reset();
+  context->doneCurrent();
+  // The render thread is about to stop, the objects are deleted by the GUI
+  // thread.
+  QThread* guiThread = QCoreApplication::instance()->thread();
+  context->moveToThread(guiThread);
+  moveToThread(guiThread);
+  context = nullptr;
+}
+
+void Renderer::RequestFrame() {
+  if (!framePending.exchange(true)) {
+    QMetaObject::invokeMethod(this, &Renderer::Render, Qt::QueuedConnection);
+  }
+}
+
+TripleBuffer<RenderState>& Renderer::GetStates() { return states; }
+
+TripleBuffer<RenderFrame>& Renderer::GetFrames() { return frames; }
+
+std::mutex& Renderer::GetModelMutex() { return modelMutex; }
+
+ShaderCache& Renderer::GetShaderCache() { return shaderCache; }
+
+void Renderer::Render() {
+  framePending.store(false);
+  std::unique_lock<std::mutex> lock(modelMutex, std::try_to_lock);
+  if (context == nullptr) {
+    return;
+  }
+  if (!lock.owns_lock() || previewLoading.load()) {
+    // A model is being loaded, a frame is requested once it is done.
+    RenderPreview();
+    return;
+  }
+  context->makeCurrent(surface);
+  SyncModel();
+  const RenderState& state = states.ReadBuffer();
+  if (state.width <= 0 || state.height <= 0) {
+    return;
+  }
+  TraceScope frameScope(traceNextFrame ? "First frame" : nullptr);
+  AllocationScope frameAllocations;
+  traceNextFrame = false;
+  CollectGpuTime();
+  UploadPendingChunks();
+  profiler.BeginFrame(vboSize / sizeof(GLfloat) / 3,
+                      eboSize / sizeof(GLuint) / 2);
+  queryFrames[queryIndex] = profiler.GetCurrentFrame();
+  glBeginQuery(GL_TIME_ELAPSED, timerQueries[queryIndex]);
+
+  RenderFrame& frame = frames.WriteBuffer();
+  PrepareFrame(frame, state);
+  DrawScene(state);
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+  glEndQuery(GL_TIME_ELAPSED);
+  queryPending[queryIndex] = true;
+  queryIndex ^= 1;
+  frame.renderFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  // The fence has to reach the GPU before the widget's context waits for it.
+  glFlush();
+  profiler.EndFrame(frameAllocations.GetCounts().allocations);
+  frame.frameIndex = profiler.GetCurrentFrame();
+  frame.renderEnd = std::chrono::steady_clock::now();
+  frames.Publish();
+  StartupTimer::Instance().Mark(FirstFrameRendered);
+  emit FrameReady();
+  // Chunks still read from disk request a frame once they are in memory.
+  if (uploadStats.uploadedBytes < uploadStats.totalBytes || chunksPending) {
+    RequestFrame();
+  }
+}
+
+void Renderer::RenderPreview() {
+  {
+    std::lock_guard<std::mutex> previewLock(previewMutex);
+    if (!previewActive) {
+      return;
+    }
+    context->makeCurrent(surface);
+    if (previewDirty) {
+      UploadPreview();
+    }
+  }
+  states.Update();
+  const RenderState& state = states.ReadBuffer();
+  if (state.width <= 0 || state.height <= 0) {
+    return;
+  }
+  RenderFrame& frame = frames.WriteBuffer();
+  PrepareFrame(frame, state);
+  DrawPreview(state);
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  frame.renderFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  glFlush();
+  // Preview frames aren't profiled, they keep the number of the last frame.
+  frame.frameIndex = profiler.GetCurrentFrame();
+  frame.renderEnd = std::chrono::steady_clock::now();
+  frames.Publish();
+  emit FrameReady();
+}
+
+void Renderer::PrepareFrame(RenderFrame& frame, const RenderState& state) {
+  if (frame.readFence != nullptr) {
+    // The widget may still be compositing this frame.
+    glWaitSync(frame.readFence, 0, GL_TIMEOUT_IGNORED);
+    glDeleteSync(frame.readFence);
+    frame.readFence = nullptr;
+  }
+  if (frame.renderFence != nullptr) {
+    glDeleteSync(frame.renderFence);
+    frame.renderFence = nullptr;
+  }
+  ResizeFrame(frame, state.width, state.height);
+  glBindFramebuffer(GL_FRAMEBUFFER, frame.framebuffer);
+}
+
+void Renderer::SyncModel() {
+  states.Update();
+  if (states.ReadBuffer().modelGeneration != loadedGeneration) {
+    loadedGeneration = states.ReadBuffer().modelGeneration;
+    // Ranges of the previous model don't apply to the new one.
+    pendingUpdate = ModelUpdate{};
+    updatePending = false;
+    AdoptModelBuffers();
+    traceNextFrame = true;
+  } else if (updatePending) {
+    ApplyModelUpdate();
+  }
+}
+
+void Renderer::DrawScene(const RenderState& state) {
+  glViewport(0, 0, state.width, state.height);
+  glEnable(GL_DEPTH_TEST);
+  glClearColor(state.backgroundColor[0], state.backgroundColor[1],
+               state.backgroundColor[2], 0);
+  glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+  ViewerData output;
+  {
+    ScopedStageTimer timer(profiler, InteractStage);
+    output = ApplyTransform(state);
+  }
+  pointStats = PointStats{};
+  chunkStats = ChunkStats{};
+  chunksPending = false;
+  if (viewerController.IsOutOfCore()) {
+    DrawModelChunks(state, output);
+    return;
+  }
+  if (viewerController.IsPointCloud()) {
+    DrawPointCloud(state, output);
+    return;
+  }
+
+  {
+    ScopedStageTimer timer(profiler, UniformsStage);
+    SetUniforms(state, output);
+  }
+
+  {
+    ScopedStageTimer timer(profiler, DrawStage);
+    glEnableClientState(GL_VERTEX_ARRAY);
+    VBO.bind();
+    glVertexPointer(3, GL_FLOAT, 0, nullptr);
+    EBO.bind();
+    glDrawElements(GL_LINES, GetDrawableIndicesCount(), GL_UNSIGNED_INT,
+                   nullptr);
+    EBO.release();
+    VBO.release();
+    glDisableClientState(GL_VERTEX_ARRAY);
+    shaderProgramm->release();
+  }
+}
+
+void Renderer::DrawPointCloud(const RenderState& state,
+                              const ViewerData& output) {
+  // A tile selects the points of the whole image.
+  int height = state.fullHeight > 0 ? state.fullHeight : state.height;
+  {
+    ScopedStageTimer timer(profiler, InteractStage);
+    viewerController.SelectPoints(output, height, kPointBudget,
+                                  pointSelection);
+    GLint uploaded = static_cast<GLint>(vboUploaded / sizeof(GLfloat) / 3);
+    for (std::size_t i = 0; i < pointSelection.firsts.size(); ++i) {
+      GLsizei& count = pointSelection.counts[i];
+      count = std::clamp(uploaded - pointSelection.firsts[i], 0, count);
+      pointStats.drawnPoints += count;
+    }
+    pointStats.drawnNodes = pointSelection.firsts.size();
+    pointStats.totalPoints = vboSize / sizeof(GLfloat) / 3;
+  }
+
+  {
+    ScopedStageTimer timer(profiler, UniformsStage);
+    SetPointUniforms(state, output, height);
+  }
+
+  {
+    ScopedStageTimer timer(profiler, DrawStage);
+    glEnable(GL_PROGRAM_POINT_SIZE);
+    glEnableClientState(GL_VERTEX_ARRAY);
+    VBO.bind();
+    glVertexPointer(3, GL_FLOAT, 0, nullptr);
+    glMultiDrawArrays(GL_POINTS, pointSelection.firsts.data(),
+                      pointSelection.counts.data(),
+                      static_cast<GLsizei>(pointSelection.firsts.size()));
+    VBO.release();
+    glDisableClientState(GL_VERTEX_ARRAY);
+    pointProgram->release();
+  }
+}
+
+void Renderer::DrawModelChunks(const RenderState& state,
+                               const ViewerData& output) {
+  const ChunkStore& store = *viewerController.GetChunkStore();
+  ChunkCache& cache = *viewerController.GetChunkCache();
+  int height = state.fullHeight > 0 ? state.fullHeight : state.height;
+  ++chunkFrame;
+  {
+    ScopedStageTimer timer(profiler, InteractStage);
+    viewerController.SelectChunks(output, height, visibleChunks);
+    requestedChunks.clear();
+    for (const auto& chunk : visibleChunks) {
+      requestedChunks.push_back(chunk.second);
+      modelChunkFrames[chunk.second] = chunkFrame;
+    }
+    cache.Request(requestedChunks);
+    UploadModelChunks(state.vramBudget);
+  }
+
+  bool lines = store.GetPrimitive() == ChunkPrimitive::Lines;
+  {
+    ScopedStageTimer timer(profiler, UniformsStage);
+    if (lines) {
+      SetUniforms(state, output);
+    } else {
+      SetPointUniforms(state, output, height);
+    }
+  }
+
+  {
+    ScopedStageTimer timer(profiler, DrawStage);
+    if (!lines) {
+      glEnable(GL_PROGRAM_POINT_SIZE);
+    }
+    glEnableClientState(GL_VERTEX_ARRAY);
+    for (const auto& chunk : visibleChunks) {
+      GLuint buffer = modelChunkBuffers[chunk.second];
+      if (buffer == 0) {
+        continue;
+      }
+      GLsizei primitives =
+          static_cast<GLsizei>(store.GetChunks()[chunk.second].primitives);
+      glBindBuffer(GL_ARRAY_BUFFER, buffer);
+      glVertexPointer(3, GL_FLOAT, 0, nullptr);
+      if (lines) {
+        glDrawArrays(GL_LINES, 0, primitives * 2);
+      } else {
+        glDrawArrays(GL_POINTS, 0, primitives);
+      }
+      chunkStats.drawnChunks++;
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glDisableClientState(GL_VERTEX_ARRAY);
+    (lines ? shaderProgramm : pointProgram)->release();
+  }
+
+  chunkStats.visibleChunks = visibleChunks.size();
+  chunkStats.totalChunks = store.GetChunks().size();
+  chunkStats.residentChunks = cache.GetResidentCount();
+  chunkStats.residentBytes = cache.GetResidentBytes();
+  chunkStats.ramBudget = cache.GetBudget();
+  chunkStats.gpuBytes = modelChunkBytes;
+  chunkStats.vramBudget = state.vramBudget;
+  for (GLuint buffer : modelChunkBuffers) {
+    chunkStats.gpuChunks += buffer != 0 ? 1 : 0;
+  }
+}
+
+void Renderer::UploadModelChunks(std::size_t vramBudget) {
+  const ChunkStore& store = *viewerController.GetChunkStore();
+  const ChunkCache& cache = *viewerController.GetChunkCache();
+  std::size_t uploadedBefore = modelChunkBytes;
+  auto start = std::chrono::steady_clock::now();
+  for (const auto& chunk : visibleChunks) {
+    std::size_t index = chunk.second;
+    if (modelChunkBuffers[index] != 0 || !cache.IsResident(index)) {
+      continue;
+    }
+    if (std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - start)
+            .count() >= kUploadBudgetMs) {
+      chunksPending = true;
+      break;
+    }
+    std::size_t bytes = store.GetChunkBytes(index);
+    while (modelChunkBytes + bytes > vramBudget && EvictModelChunk()) {
+    }
+    if (modelChunkBytes + bytes > vramBudget) {
+      // The budget is full of chunks nearer to the camera.
+      break;
+    }
+    S21_TRACE_SCOPE("Upload model chunk");
+    GLuint buffer = 0;
+    glGenBuffers(1, &buffer);
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    glBufferData(GL_ARRAY_BUFFER, bytes, store.GetChunkData(index),
+                 GL_STATIC_DRAW);
+    modelChunkBuffers[index] = buffer;
+    modelChunkBytes += bytes;
+  }
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  if (modelChunkBytes != uploadedBefore) {
+    ReportGpuMemory();
+  }
+}
+
+bool Renderer::EvictModelChunk() {
+  std::size_t oldest = modelChunkBuffers.size();
+  for (std::size_t i = 0; i < modelChunkBuffers.size(); ++i) {
+    if (modelChunkBuffers[i] != 0 && modelChunkFrames[i] != chunkFrame &&
+        (oldest == modelChunkBuffers.size() ||
+         modelChunkFrames[i] < modelChunkFrames[oldest])) {
+      oldest = i;
+    }
+  }
+  if (oldest == modelChunkBuffers.size()) {
+    return false;
+  }
+  glDeleteBuffers(1, &modelChunkBuffers[oldest]);
+  modelChunkBuffers[oldest] = 0;
+  modelChunkBytes -= viewerController.GetChunkStore()->GetChunkBytes(oldest);
+  return true;
+}
+
+void Renderer::ReleaseModelChunks() {
+  for (GLuint& buffer : modelChunkBuffers) {
+    if (buffer != 0) {
+      glDeleteBuffers(1, &buffer);
+    }
+  }
+  std::size_t chunks = 0;
+  if (const ChunkStore* store = viewerController.GetChunkStore()) {
+    chunks = store->GetChunks().size();
+  }
+  modelChunkBuffers.assign(chunks, 0);
+  modelChunkFrames.assign(chunks, 0);
+  modelChunkBytes = 0;
+  chunkFrame = 0;
+  ReportGpuMemory();
+}
+
+void Renderer::DrawPreview(const RenderState& state) {
+  glViewport(0, 0, state.width, state.height);
+  glEnable(GL_DEPTH_TEST);
+  glClearColor(state.backgroundColor[0], state.backgroundColor[1],
+               state.backgroundColor[2], 0);
+  glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+  InputData data = GetInputData(state);
+  previewController.InteractModel(TransformationStrategy::Move, data);
+  SetUniforms(state, previewController.InteractModel(
+                         TransformationStrategy::Rotate, data));
+  // Pairs of points pass the line geometry shader as zero-width lines, so
+  // only their vertex quads are drawn.
+  shaderProgramm->setUniformValue("lineWidth", 0.0f);
+  shaderProgramm->setUniformValue("drawPoints", 1);
+  shaderProgramm->setUniformValue(
+      "pointSize", std::max(state.verticesThikness, kPreviewPointSize));
+  shaderProgramm->setUniformValue(
+      "pointColor", QVector4D(state.modelColor[0], state.modelColor[1],
+                              state.modelColor[2], 1));
+  glEnableClientState(GL_VERTEX_ARRAY);
+  previewVBO.bind();
+  glVertexPointer(3, GL_FLOAT, 0, nullptr);
+  glDrawArrays(GL_LINES, 0, previewPoints & ~1);
+  previewVBO.release();
+  glDisableClientState(GL_VERTEX_ARRAY);
+  shaderProgramm->release();
+}
+
+void Renderer::SetUniforms(const RenderState& state,
+                           const ViewerData& output) {
+  shaderProgramm->bind();
+  SetMatrices(*shaderProgramm, state, output);
+  shaderProgramm->setUniformValue("lineStyle", state.linesStyle);
+  shaderProgramm->setUniformValue("lineWidth", state.linesThickness);
+  shaderProgramm->setUniformValue("pointSize", state.verticesThikness);
+  shaderProgramm->setUniformValue("drawPoints", state.verticesStyle);
+  shaderProgramm->setUniformValue(
+      "lineColor", QVector4D(state.modelColor[0], state.modelColor[1],
+                             state.modelColor[2], 1));
+  shaderProgramm->setUniformValue(
+      "pointColor", QVector4D(state.verticesColor[0], state.verticesColor[1],
+                              state.verticesColor[2], 1));
+}
+
+void Renderer::SetPointUniforms(const RenderState& state,
+                                const ViewerData& output, int height) {
+  pointProgram->bind();
+  SetMatrices(*pointProgram, state, output);
+  // Vertex size is given in clip space, points are sized in pixels.
+  pointProgram->setUniformValue(
+      "pointSize", std::max(1.0f, state.verticesThikness * height));
+  pointProgram->setUniformValue("pointStyle", state.verticesStyle);
+  pointProgram->setUniformValue(
+      "pointColor", QVector4D(state.modelColor[0], state.modelColor[1],
+                              state.modelColor[2], 1));
+}
+
+void Renderer::SetMatrices(QOpenGLShaderProgram& program,
+                           const RenderState& state,
+                           const ViewerData& output) {
+  program.setUniformValue(
+      "modelMatrix",
+      QMatrix4x4(glm::value_ptr(output.modelMatrix)).transposed());
+  program.setUniformValue(
+      "viewMatrix", QMatrix4x4(glm::value_ptr(output.viewMatrix)).transposed());
+  program.setUniformValue(
+      "projectionMatrix",
+      QMatrix4x4(glm::value_ptr(output.projectionMatrix)).transposed());
+  glm::mat4 tileMatrix(1.0f);
+  if (state.fullWidth > 0 && state.fullHeight > 0) {
+    tileMatrix =
+        Model::GetTileMatrix(state.tileLeft, state.tileTop, state.width,
+                             state.height, state.fullWidth, state.fullHeight);
+  }
+  program.setUniformValue(
+      "tileMatrix", QMatrix4x4(glm::value_ptr(tileMatrix)).transposed());
+}
+
+InputData Renderer::GetInputData(const RenderState& state) {
+  InputData data;
+  // A tile is projected as a part of the whole image.
+  data.height = state.fullHeight > 0 ? state.fullHeight : state.height;
+  data.width = state.fullWidth > 0 ? state.fullWidth : state.width;
+  data.projectionType = state.projectionType;
+  data.xRotationAngle = state.xRot;
+  data.yRotationAngle = state.yRot;
+  data.zRotationAngle = state.zRot;
+  data.xMoveOffset = state.xOffset;
+  data.yMoveOffset = state.yOffset;
+  data.zMoveOffset = state.zOffset;
+  data.scale = 1.0f;
+  return data;
+}
+
+ViewerData Renderer::ApplyTransform(const RenderState& state) {
+  InputData data = GetInputData(state);
+  if (state.scale != appliedScale) {
+    data.scale = state.scale / appliedScale;
+    appliedScale = state.scale;
+    viewerController.InteractModel(TransformationStrategy::Scale, data);
+    data.scale = 1.0f;
+  }
+  if (state.xOffset != appliedOffset[0] || state.yOffset != appliedOffset[1] ||
+      state.zOffset != appliedOffset[2]) {
+    appliedOffset[0] = state.xOffset;
+    appliedOffset[1] = state.yOffset;
+    appliedOffset[2] = state.zOffset;
+    viewerController.InteractModel(TransformationStrategy::Move, data);
+  }
+  // Rotation is absolute, so applying it also yields the current matrices.
+  return viewerController.InteractModel(TransformationStrategy::Rotate, data);
+}
+
+void Renderer::AdoptModelBuffers() {
+  // The model was reset to default by the loader.
+  appliedScale = 1.0f;
+  appliedOffset[0] = appliedOffset[1] = appliedOffset[2] = 0.0f;
+  ReleaseModelChunks();
+  if (ChunkCache* cache = viewerController.GetChunkCache()) {
+    cache->SetReadyCallback([this] { RequestFrame(); });
+  }
+  if (!states.ReadBuffer().mappedModel || !pendingVBO.isCreated()) {
+    DiscardPendingBuffers();
+    InitializeBuffers();
+    return;
+  }
+  VBO.destroy();
+  EBO.destroy();
+  VBO = pendingVBO;
+  EBO = pendingEBO;
+  pendingVBO = QOpenGLBuffer(QOpenGLBuffer::VertexBuffer);
+  pendingEBO = QOpenGLBuffer(QOpenGLBuffer::IndexBuffer);
+  immutableBuffers = true;
+
+  auto sizes = viewerController.GetBuffersSize();
+  vboUploaded = vboSize = vboCapacity = sizes.first * sizeof(GLfloat);
+  eboUploaded = eboSize = eboCapacity = sizes.second * sizeof(GLuint);
+  pendingBytes = 0;
+  ReportGpuMemory();
+  uploadStats = UploadStats{};
+  uploadStats.totalBytes = uploadStats.uploadedBytes = vboSize + eboSize;
+}
+
+void Renderer::InitializeBuffers(bool headroom) {
+  S21_TRACE_SCOPE("Renderer::InitializeBuffers");
+  const auto& buffers = viewerController.GetBuffersData();
+  vboSize = buffers.first.size() * sizeof(GLfloat);
+  eboSize = buffers.second.size() * sizeof(GLuint);
+  vboCapacity = headroom ? vboSize + vboSize / 2 : vboSize;
+  eboCapacity = headroom ? eboSize + eboSize / 2 : eboSize;
+  if (immutableBuffers) {
+    // Storage created by glBufferStorage can't be re-specified.
+    VBO.destroy();
+    EBO.destroy();
+    immutableBuffers = false;
+  }
+  if (!VBO.isCreated()) {
+    VBO.create();
+  }
+  VBO.bind();
+  glBufferData(GL_ARRAY_BUFFER, vboCapacity, nullptr, GL_STATIC_DRAW);
+  VBO.release();
+
+  if (!EBO.isCreated()) {
+    EBO.create();
+  }
+  EBO.bind();
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, eboCapacity, nullptr,
+               GL_STATIC_DRAW);
+  EBO.release();
+
+  vboUploaded = eboUploaded = 0;
+  ReportGpuMemory();
+  uploadStats = UploadStats{};
+  uploadStats.totalBytes = vboSize + eboSize;
+}
+
+void Renderer::ApplyModelUpdate() {
+  S21_TRACE_SCOPE("Renderer::ApplyModelUpdate");
+  ModelUpdate update = std::move(pendingUpdate);
+  pendingUpdate = ModelUpdate{};
+  updatePending = false;
+  const auto& buffers = viewerController.GetBuffersData();
+  std::size_t vertexBytes = buffers.first.size() * sizeof(GLfloat);
+  std::size_t indexBytes = buffers.second.size() * sizeof(GLuint);
+  if (update.reallocated || immutableBuffers ||
+      uploadStats.uploadedBytes < uploadStats.totalBytes ||
+      vertexBytes > vboCapacity || indexBytes > eboCapacity) {
+    // The ranges can't be patched in, the whole model is uploaded again and
+    // room is left for the file to keep growing.
+    InitializeBuffers(true);
+    return;
+  }
+  auto start = std::chrono::steady_clock::now();
+  uploadStats.updateRanges = uploadStats.updateBytes = 0;
+  VBO.bind();
+  UpdateRanges(GL_ARRAY_BUFFER, buffers.first.data(), sizeof(GLfloat),
+               update.vertexRanges);
+  VBO.release();
+  EBO.bind();
+  UpdateRanges(GL_ELEMENT_ARRAY_BUFFER, buffers.second.data(), sizeof(GLuint),
+               update.indexRanges);
+  EBO.release();
+  vboUploaded = vboSize = vertexBytes;
+  eboUploaded = eboSize = indexBytes;
+  uploadStats.totalBytes = uploadStats.uploadedBytes = vboSize + eboSize;
+  uploadStats.seconds += std::chrono::duration<double>(
+                             std::chrono::steady_clock::now() - start)
+                             .count();
+}
+
+void Renderer::UpdateRanges(GLenum target, const void* data,
+                            std::size_t elementSize,
+                            const std::vector<BufferRange>& ranges) {
+  for (const BufferRange& range : ranges) {
+    std::size_t offset = range.offset * elementSize;
+    std::size_t size = range.size * elementSize;
+    glBufferSubData(target, offset, size,
+                    static_cast<const char*>(data) + offset);
+    uploadStats.updateRanges++;
+    uploadStats.updateBytes += size;
+  }
+}
+
+void Renderer::QueueModelUpdate(const ModelUpdate& update) {
+  pendingUpdate.vertexRanges.insert(pendingUpdate.vertexRanges.end(),
+                                    update.vertexRanges.begin(),
+                                    update.vertexRanges.end());
+  pendingUpdate.indexRanges.insert(pendingUpdate.indexRanges.end(),
+                                   update.indexRanges.begin(),
+                                   update.indexRanges.end());
+  pendingUpdate.reallocated = pendingUpdate.reallocated || update.reallocated;
+  updatePending = true;
+}
+
+void Renderer::SetPreview(PreviewCloud cloud) {
+  {
+    std::lock_guard<std::mutex> previewLock(previewMutex);
+    previewCloud = std::move(cloud);
+    previewBox = previewCloud.box;
+    previewActive = !previewCloud.points.empty();
+    previewDirty = true;
+  }
+  previewLoading.store(true);
+  RequestFrame();
+}
+
+void Renderer::RefinePreview(const BoundingBox& parsed) {
+  {
+    std::lock_guard<std::mutex> previewLock(previewMutex);
+    if (!previewActive) {
+      return;
+    }
+    // The sampled and the parsed vertices both lie inside the model, their
+    // union approaches its bounds as the parsing goes on.
+    previewBox.Extend(parsed);
+    previewDirty = true;
+  }
+  RequestFrame();
+}
+
+void Renderer::ClearPreview() {
+  {
+    std::lock_guard<std::mutex> previewLock(previewMutex);
+    previewActive = false;
+    previewCloud = PreviewCloud{};
+  }
+  previewLoading.store(false);
+}
+
+void Renderer::UploadPreview() {
+  S21_TRACE_SCOPE("Upload preview");
+  const std::vector<GLfloat>& points = previewCloud.points;
+  Vertex center = previewBox.GetCenter();
+  GLfloat scale = previewBox.GetScaleFactor();
+  const GLfloat centers[3] = {center.X, center.Y, center.Z};
+  std::vector<GLfloat> normalized(points.size());
+  for (std::size_t i = 0; i < points.size(); ++i) {
+    normalized[i] = (points[i] - centers[i % 3]) * scale;
+  }
+  if (!previewVBO.isCreated()) {
+    previewVBO.create();
+  }
+  previewVBO.bind();
+  glBufferData(GL_ARRAY_BUFFER, normalized.size() * sizeof(GLfloat),
+               normalized.data(), GL_STREAM_DRAW);
+  previewVBO.release();
+  previewPoints = static_cast<GLsizei>(points.size() / 3);
+  previewDirty = false;
+}
+
+void Renderer::ReportGpuMemory() {
+  MemoryStats::Instance().Set(
+      GpuBuffers, vboCapacity + eboCapacity + pendingBytes + modelChunkBytes);
+}
+
+BufferView Renderer::CreateMappedBuffers(size_t verticesSize,
+                                         size_t indicesSize) {
+  S21_TRACE_SCOPE("Map buffers");
+  const GLbitfield storageFlags = GL_MAP_READ_BIT | GL_MAP_WRITE_BIT |
+                                  GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT |
+                                  GL_CLIENT_STORAGE_BIT;
+  const GLbitfield mapFlags = GL_MAP_READ_BIT | GL_MAP_WRITE_BIT |
+                              GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+  std::size_t vertexBytes = verticesSize * sizeof(GLfloat);
+  std::size_t indexBytes = indicesSize * sizeof(GLuint);
+  context->makeCurrent(surface);
+  DiscardPendingBuffers();
+
+  pendingVBO.create();
+  pendingVBO.bind();
+  bufferStorage(GL_ARRAY_BUFFER, vertexBytes, nullptr, storageFlags);
+  void* vertices = glMapBufferRange(GL_ARRAY_BUFFER, 0, vertexBytes, mapFlags);
+  pendingVBO.release();
+
+  // A point cloud has no indices, storage can't be empty.
+  void* indices = nullptr;
+  if (indexBytes > 0) {
+    pendingEBO.create();
+    pendingEBO.bind();
+    bufferStorage(GL_ELEMENT_ARRAY_BUFFER, indexBytes, nullptr, storageFlags);
+    indices =
+        glMapBufferRange(GL_ELEMENT_ARRAY_BUFFER, 0, indexBytes, mapFlags);
+    pendingEBO.release();
+  }
+
+  pendingBytes = vertexBytes + indexBytes;
+  ReportGpuMemory();
+  if (vertices == nullptr || (indexBytes > 0 && indices == nullptr)) {
+    DiscardPendingBuffers();
+    throw std::invalid_argument("Can't map buffers for the model");
+  }
+  return {static_cast<GLfloat*>(vertices), verticesSize,
+          static_cast<GLuint*>(indices), indicesSize};
+}
+
+void Renderer::DiscardPendingBuffers() {
+  if (context == nullptr) {
+    return;
+  }
+  context->makeCurrent(surface);
+  pendingVBO.destroy();
+  pendingEBO.destroy();
+  pendingBytes = 0;
+  ReportGpuMemory();
+}
+
+bool Renderer::UseMappedLoad(const std::string& filename) const {
+  if (bufferStorage == nullptr) {
+    return false;
+  }
+  std::error_code error;
+  std::uintmax_t fileSize = std::filesystem::file_size(filename, error);
+  return !error && fileSize >= kMappedLoadMinBytes;
+}
+
+void Renderer::UploadPendingChunks() {
+  if (uploadStats.uploadedBytes == uploadStats.totalBytes) {
+    return;
+  }
+  const auto& buffers = viewerController.GetBuffersData();
+  auto start = std::chrono::steady_clock::now();
+  do {
+    if (vboUploaded < vboSize) {
+      VBO.bind();
+      UploadChunk(GL_ARRAY_BUFFER, buffers.first.data(), vboSize, vboUploaded);
+      VBO.release();
+    } else {
+      EBO.bind();
+      UploadChunk(GL_ELEMENT_ARRAY_BUFFER, buffers.second.data(), eboSize,
+                  eboUploaded);
+      EBO.release();
+    }
+  } while (uploadStats.uploadedBytes < uploadStats.totalBytes &&
+           std::chrono::duration<double, std::milli>(
+               std::chrono::steady_clock::now() - start)
+                   .count() < kUploadBudgetMs);
+}
+
+void Renderer::UploadChunk(GLenum target, const void* data, std::size_t size,
+                           std::size_t& uploaded) {
+  S21_TRACE_SCOPE("Upload chunk");
+  std::size_t chunk = std::min(kUploadChunkBytes, size - uploaded);
+  auto start = std::chrono::steady_clock::now();
+  glBufferSubData(target, uploaded, chunk,
+                  static_cast<const char*>(data) + uploaded);
+  double seconds = std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+  uploaded += chunk;
+  uploadStats.uploadedBytes += chunk;
+  uploadStats.chunks++;
+  uploadStats.seconds += seconds;
+  if (seconds > 0.0) {
+    uploadStats.lastChunkMBps = chunk / seconds / 1.0e6;
+  }
+}
+
+GLsizei Renderer::GetDrawableIndicesCount() const {
+  if (vboUploaded < vboSize) {
+    return 0;
+  }
+  // Only complete lines are drawn while the indices are still streaming.
+  return static_cast<GLsizei>(eboUploaded / sizeof(GLuint)) & ~1;
+}
+
+void Renderer::CollectGpuTime() {
+  if (!queryPending[queryIndex]) {
+    return;
+  }
+  GLint available = 0;
+  glGetQueryObjectiv(timerQueries[queryIndex], GL_QUERY_RESULT_AVAILABLE,
+                     &available);
+  if (available) {
+    GLuint64 elapsed = 0;
+    glGetQueryObjectui64v(timerQueries[queryIndex], GL_QUERY_RESULT, &elapsed);
+    profiler.SetGpuTime(queryFrames[queryIndex], elapsed / 1.0e6);
+  }
+  // A result that is still not ready two frames later is dropped instead of
+  // being waited for, so the query can be reused without a stall.
+  queryPending[queryIndex] = false;
+}
+
+void Renderer::ReadFrame(const RenderState& state, ImageReceiver receiver) {
+  // Waiting for the lock could deadlock with a load that maps buffers on
+  // this thread, a null image is received instead.
+  std::unique_lock<std::mutex> lock(modelMutex, std::try_to_lock);
+  if (!lock.owns_lock() || previewLoading.load() || context == nullptr ||
+      state.width <= 0 || state.height <= 0) {
+    receiver(QImage());
+    return;
+  }
+  context->makeCurrent(surface);
+  if (readbacks.size() == kReadbackBuffers) {
+    // The ring is full, the oldest buffer is needed again.
+    CollectReadbacks(false);
+    if (readbacks.size() == kReadbackBuffers) {
+      S21_TRACE_SCOPE("Wait for readback");
+      PendingReadback& oldest = readbacks.front();
+      glClientWaitSync(oldest.fence, GL_SYNC_FLUSH_COMMANDS_BIT,
+                       GL_TIMEOUT_IGNORED);
+      CollectReadbacks(false);
+    }
+  }
+  SyncModel();
+  AllocationScope frameAllocations;
+  profiler.BeginFrame(vboSize / sizeof(GLfloat) / 3,
+                      eboSize / sizeof(GLuint) / 2);
+  ResizeFrame(captureFrame, state.width, state.height);
+  glBindFramebuffer(GL_FRAMEBUFFER, captureFrame.framebuffer);
+  DrawScene(state);
+  GLuint pixelBuffer = pixelBuffers[nextPixelBuffer];
+  nextPixelBuffer = (nextPixelBuffer + 1) % kReadbackBuffers;
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, pixelBuffer);
+  glBufferData(GL_PIXEL_PACK_BUFFER,
+               static_cast<GLsizeiptr>(state.width) * state.height * 4,
+               nullptr, GL_STREAM_READ);
+  glPixelStorei(GL_PACK_ALIGNMENT, 4);
+  // With a pack buffer bound the copy is queued, nothing waits for the GPU.
+  glReadPixels(0, 0, state.width, state.height, GL_RGBA, GL_UNSIGNED_BYTE,
+               nullptr);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  readbacks.push_back({pixelBuffer,
+                       glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0),
+                       state.width, state.height, std::move(receiver)});
+  glFlush();
+  profiler.EndFrame(frameAllocations.GetCounts().allocations);
+  ScheduleReadbackPoll();
+}
+
+FrameSummary Renderer::Summarize() const { return profiler.Summarize(); }
+
+UploadStats Renderer::GetUploadStats() const { return uploadStats; }
+
+PointStats Renderer::GetPointStats() const { return pointStats; }
+
+ChunkStats Renderer::GetChunkStats() const { return chunkStats; }
+
+bool Renderer::ExportFrameStats(const std::string& filename) const {
+  return profiler.ExportCsv(filename);
+}
+
+void Renderer::SetPresentTime(std::uint64_t frameIndex, double ms) {
+  profiler.SetStageTime(frameIndex, SwapStage, ms);
+}
+
+void Renderer::CollectReadbacks(bool wait) {
+  while (!readbacks.empty()) {
+    GLenum status =
+        glClientWaitSync(readbacks.front().fence, GL_SYNC_FLUSH_COMMANDS_BIT,
+                         wait ? GL_TIMEOUT_IGNORED : 0);
+    if (status == GL_TIMEOUT_EXPIRED) {
+      return;
+    }
+    PendingReadback readback = std::move(readbacks.front());
+    readbacks.pop_front();
+    glDeleteSync(readback.fence);
+    S21_TRACE_SCOPE("Map readback");
+    std::size_t rowBytes = static_cast<std::size_t>(readback.width) * 4;
+    QImage image = imagePool->Acquire(readback.width, readback.height);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.pixelBuffer);
+    const uchar* pixels = static_cast<const uchar*>(glMapBufferRange(
+        GL_PIXEL_PACK_BUFFER, 0, rowBytes * readback.height, GL_MAP_READ_BIT));
+    if (pixels != nullptr) {
+      // GL rows go from bottom to top.
+      for (int y = 0; y < readback.height; ++y) {
+        std::memcpy(image.scanLine(readback.height - 1 - y),
+                    pixels + rowBytes * y, rowBytes);
+      }
+      glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    } else {
+      image = QImage();
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    readback.receiver(std::move(image));
+  }
+}
+
+void Renderer::ScheduleReadbackPoll() {
+  if (readbackPollScheduled) {
+    return;
+  }
+  readbackPollScheduled = true;
+  QTimer::singleShot(kReadbackPollMs, this, [this] {
+    readbackPollScheduled = false;
+    if (context == nullptr) {
+      return;
+    }
+    context->makeCurrent(surface);
+    CollectReadbacks(false);
+    if (!readbacks.empty()) {
+      ScheduleReadbackPoll();
+    }
+  });
+}
+
+void Renderer::ResizeFrame(RenderFrame& frame, int width, int height) {
+  if (frame.framebuffer != 0 && frame.width == width &&
+      frame.height == height) {
+    return;
+  }
+  if (frame.framebuffer == 0) {
+    glGenTextures(1, &frame.texture);
+    glGenRenderbuffers(1, &frame.depthBuffer);
+    glGenFramebuffers(1, &frame.framebuffer);
+  }
+  frame.width = width;
+  frame.height = height;
+  glBindTexture(GL_TEXTURE_2D, frame.texture);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA,
+               GL_UNSIGNED_BYTE, nullptr);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glBindTexture(GL_TEXTURE_2D, 0);
+  glBindRenderbuffer(GL_RENDERBUFFER, frame.depthBuffer);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+  glBindRenderbuffer(GL_RENDERBUFFER, 0);
+  glBindFramebuffer(GL_FRAMEBUFFER, frame.framebuffer);
+  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
+                         frame.texture, 0);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT,
+                            GL_RENDERBUFFER, frame.depthBuffer);
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void Renderer::DeleteFrame(RenderFrame& frame) {
+  if (frame.renderFence != nullptr) {
+    glDeleteSync(frame.renderFence);
+  }
+  if (frame.readFence != nullptr) {
+    glDeleteSync(frame.readFence);
+  }
+  glDeleteFramebuffers(1, &frame.framebuffer);
+  glDeleteRenderbuffers(1, &frame.depthBuffer);
+  glDeleteTextures(1, &frame.texture);
+  frame = RenderFrame{};
+}
+
+}  // namespace s21
@@ -0,0 +1,572 @@
+/**
+ * @file s21_renderer.h
+ * @brief Render thread worker header file.
+ */
+
+#ifndef S21_RENDERER_H
+#define S21_RENDERER_H
+
+#include <QImage>
+#include <QObject>
+#include <QOffscreenSurface>
+#include <QOpenGLBuffer>
+#include <QOpenGLContext>
+#include <QOpenGLFunctions_4_1_Core>
+#include <QOpenGLShaderProgram>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "s21_frame_profiler.h"
+#include "s21_image_pool.h"
+#include "s21_shader_cache.h"
+#include "s21_triple_buffer.h"
+#include "../controller/s21_controller.h"
+#include "../model/s21_allocation_tracker.h"
+#include "../model/s21_startup_timer.h"
+
+namespace s21 {
+
+/**
+ * @brief Progress and bandwidth of the streaming buffers upload.
+ **/
+struct UploadStats {
+    std::size_t totalBytes; ///< Size of VBO and EBO together.
+    std::size_t uploadedBytes; ///< Bytes already copied to the GPU.
+    std::size_t chunks; ///< Number of uploaded chunks.
+    double lastChunkMBps; ///< Bandwidth of the last chunk in MB/s.
+    double seconds; ///< Time spent in sub-data updates.
+    std::size_t updateRanges; ///< Ranges written by the last partial update of a reloaded model.
+    std::size_t updateBytes; ///< Bytes written by the last partial update of a reloaded model.
+};
+
+/**
+ * @brief Points of a point cloud drawn by the last frame.
+ **/
+struct PointStats {
+    std::size_t drawnPoints; ///< Points drawn by the last frame.
+    std::size_t drawnNodes; ///< Octree nodes drawn by the last frame.
+    std::size_t totalPoints; ///< Points of the whole cloud.
+};
+
+/**
+ * @brief Chunks of an out-of-core model in view, in memory and on the GPU.
+ **/
+struct ChunkStats {
+    std::size_t visibleChunks; ///< Chunks inside the view of the last frame.
+    std::size_t drawnChunks; ///< Visible chunks drawn by the last frame, the rest is still loading.
+    std::size_t totalChunks; ///< Chunks of the whole model.
+    std::size_t residentChunks; ///< Chunks in memory.
+    std::size_t residentBytes; ///< Size of the chunks in memory.
+    std::size_t ramBudget; ///< Largest size of the chunks in memory.
+    std::size_t gpuChunks; ///< Chunks uploaded to the GPU.
+    std::size_t gpuBytes; ///< Size of the chunks on the GPU.
+    std::size_t vramBudget; ///< Largest size of the chunks on the GPU.
+};
+
+/**
+ * @brief Snapshot of everything the UI controls, handed to the render thread.
+ **/
+struct RenderState {
+    int width; ///< Width of the frame in pixels.
+    int height; ///< Height of the frame in pixels.
+    int fullWidth; ///< Width of the whole image if the frame is a tile of it, 0 otherwise.
+    int fullHeight; ///< Height of the whole image if the frame is a tile of it, 0 otherwise.
+    int tileLeft; ///< Left edge of the tile in the whole image.
+    int tileTop; ///< Top edge of the tile in the whole image.
+    ProjectionType projectionType; ///< Current projection type.
+    int xRot, yRot, zRot; ///< Rotation values by each axis.
+    float xOffset, yOffset, zOffset; ///< Offset values by each axis.
+    float scale; ///< Scale accumulated since the model was loaded.
+    std::array<float, 3> modelColor; ///< Model color as R, G and B components.
+    std::array<float, 3> backgroundColor; ///< Background color as R, G and B components.
+    std::array<float, 3> verticesColor; ///< Vertex color as R, G and B components.
+    float linesThickness; ///< Width of model edges.
+    float verticesThikness; ///< Width of model verices.
+    int linesStyle; ///< Current edges style.
+    int verticesStyle; ///< Current vertices style.
+    std::uint64_t modelGeneration; ///< Incremented every time a model is loaded.
+    bool mappedModel; ///< Whether the model was parsed into buffers from CreateMappedBuffers().
+    std::size_t vramBudget; ///< Largest size of the chunks of an out-of-core model kept on the GPU.
+};
+
+/**
+ * @brief Rendered frame shared between the render thread and the widget.
+ * GL objects are created by the render context, the texture is shared with the widget's context.
+ **/
+struct RenderFrame {
+    GLuint texture; ///< Color attachment, composited by the widget.
+    GLuint depthBuffer; ///< Depth attachment.
+    GLuint framebuffer; ///< Framebuffer object of the render context.
+    int width; ///< Width of the attachments in pixels.
+    int height; ///< Height of the attachments in pixels.
+    GLsync renderFence; ///< Signaled when rendering into the frame has finished.
+    GLsync readFence; ///< Signaled when the widget has finished reading the frame.
+    std::uint64_t frameIndex; ///< Number of the frame in the profiler.
+    std::chrono::steady_clock::time_point renderEnd; ///< Moment the frame was published.
+};
+
+/**
+ * @brief Receives an image read back from the GPU, called on the render thread.
+ * The image is null if the frame couldn't be rendered.
+ **/
+using ImageReceiver = std::function<void(QImage image)>;
+
+/**
+ * @brief Readback of an offscreen frame waiting for the GPU.
+ **/
+struct PendingReadback {
+    GLuint pixelBuffer; ///< Pixel pack buffer the frame is read into.
+    GLsync fence; ///< Signaled when the pixels are in the buffer.
+    int width; ///< Width of the frame in pixels.
+    int height; ///< Height of the frame in pixels.
+    ImageReceiver receiver; ///< Callback receiving the image.
+};
+
+/**
+ * @brief Signature of glBufferStorage, which is not part of the 4.1 core functions.
+ **/
+using BufferStorageFunction = void (QOPENGLF_APIENTRYP)(GLenum target, GLsizeiptr size,
+                                                       const void* data, GLbitfield flags);
+
+/**
+ * @brief Renders the model on a dedicated thread with its own GL context.
+ * Frames are rendered into textures that the widget composites, UI state arrives
+ * as snapshots, so neither thread waits for the other.
+ * Methods are called on the render thread unless stated otherwise.
+ **/
+class Renderer : public QObject, private QOpenGLFunctions_4_1_Core
+{
+    Q_OBJECT
+public:
+    static constexpr std::size_t kUploadChunkBytes = 4 << 20; ///< Size of one buffer upload chunk.
+    static constexpr double kUploadBudgetMs = 4.0; ///< Time per frame spent on buffer uploads.
+    static constexpr std::uintmax_t kMappedLoadMinBytes = 64 << 20; ///< Smallest .obj file parsed straight into mapped buffers.
+    static constexpr std::size_t kReadbackBuffers = 3; ///< Pixel pack buffers in the readback ring.
+    static constexpr int kReadbackPollMs = 2; ///< Interval of polling the readback fences.
+    static constexpr float kPreviewPointSize = 0.004f; ///< Smallest size of preview points.
+    static constexpr std::size_t kPointBudget = 4 << 20; ///< Points of a point cloud drawn per frame.
+
+    Renderer(Controller& controller);
+    Renderer() = delete;
+    ~Renderer() = default;
+
+    /**
+   * @brief Makes the context current and creates GL resources.
+   * @param renderContext Context shared with the widget, already moved to the render thread.
+   * @param renderSurface Surface the context is made current on.
+   **/
+    void Initialize(QOpenGLContext* renderContext, QOffscreenSurface* renderSurface);
+
+    /**
+   * @brief Deletes GL resources, must be called before the render thread stops.
+   **/
+    void Cleanup();
+
+    /**
+   * @brief Schedules a frame on the render thread. Can be called from any thread.
+   * Requests made while a frame is pending are merged.
+   **/
+    void RequestFrame();
+
+    /**
+   * @brief Gets the snapshots of the UI state, published by the GUI thread.
+   * @return Reference to the triple buffer of states.
+   **/
+    TripleBuffer<RenderState>& GetStates();
+
+    /**
+   * @brief Gets the rendered frames, published by the render thread.
+   * @return Reference to the triple buffer of frames.
+   **/
+    TripleBuffer<RenderFrame>& GetFrames();
+
+    /**
+   * @brief Gets the mutex held while the model is loaded or rendered.
+   * The loading thread locks it, the render thread skips frames while it is locked.
+   * @return Reference to the mutex.
+   **/
+    std::mutex& GetModelMutex();
+
+    /**
+   * @brief Gets the cache of the shader program binary, used by Initialize().
+   * @return Reference to the shader cache.
+   **/
+    ShaderCache& GetShaderCache();
+
+    /**
+   * @brief Checks whether the file should be parsed straight into mapped buffers.
+   * Can be called from any thread after Initialize().
+   * @param filename Name of the model file.
+   * @return true if glBufferStorage is available and the file is large enough.
+   **/
+    bool UseMappedLoad(const std::string& filename) const;
+
+    /**
+   * @brief Creates immutable storage for both buffers and maps it persistently.
+   * The buffers replace the current ones when the state with the new model generation arrives.
+   * @param verticesSize Number of vertex coordinates.
+   * @param indicesSize Number of indices.
+   * @return Mapped memory of both buffers.
+   **/
+    BufferView CreateMappedBuffers(size_t verticesSize, size_t indicesSize);
+
+    /**
+   * @brief Deletes mapped buffers of a model that failed to load.
+   **/
+    void DiscardPendingBuffers();
+
+    /**
+   * @brief Queues the ranges of a re-parsed model for upload into the current buffers.
+   * Must be called with the model mutex held, from any thread. Updates queued before
+   * the next frame are merged, a newly loaded model drops them.
+   * @param update Ranges changed by Controller::UpdateModelBuffers().
+   **/
+    void QueueModelUpdate(const ModelUpdate& update);
+
+    /**
+   * @brief Shows sampled vertices while the model is being loaded. Can be called from any thread.
+   * Until ClearPreview() the model is treated as being loaded, even once the loader releases
+   * the model mutex: frames draw the preview as points instead, normalized by the estimated
+   * bounds, and read back frames are null.
+   * @param cloud Vertices sampled from the file being loaded.
+   **/
+    void SetPreview(PreviewCloud cloud);
+
+    /**
+   * @brief Extends the estimated bounds of the preview with the vertices parsed so far.
+   * Can be called from any thread, does nothing without a preview.
+   * @param parsed Bounds of the parsed vertices.
+   **/
+    void RefinePreview(const BoundingBox& parsed);
+
+    /**
+   * @brief Stops showing the preview. Can be called from any thread.
+   * The state of the loaded model must be published before, frames then draw it again.
+   **/
+    void ClearPreview();
+
+    /**
+   * @brief Renders a state into an offscreen framebuffer and starts reading it back.
+   * The pixels are copied into a pixel buffer of the readback ring without waiting,
+   * the receiver gets the image once the fence of the buffer is signaled.
+   * Images are received in the order they were requested.
+   * @param state State to render, its width and height set the size of the image.
+   * @param receiver Callback receiving the image, null while a model is being loaded.
+   **/
+    void ReadFrame(const RenderState& state, ImageReceiver receiver);
+
+    /**
+   * @brief Calculates frame statistics.
+   * @return Summary of the stored frames.
+   **/
+    FrameSummary Summarize() const;
+
+    /**
+   * @brief Getter of the buffers upload progress.
+   * @return Upload statistics of the current model.
+   **/
+    UploadStats GetUploadStats() const;
+
+    /**
+   * @brief Getter of the points drawn for a point cloud.
+   * @return Statistics of the last frame, zero for a model with faces.
+   **/
+    PointStats GetPointStats() const;
+
+    /**
+   * @brief Getter of the chunks of an out-of-core model.
+   * @return Statistics of the last frame, zero for a model in memory.
+   **/
+    ChunkStats GetChunkStats() const;
+
+    /**
+   * @brief Writes the stored per-frame measurements into a .csv file.
+   * @param filename Output file name.
+   * @return true in case of success, false otherwise.
+   **/
+    bool ExportFrameStats(const std::string& filename) const;
+
+    /**
+   * @brief Stores the time from publishing a frame to its presentation by the widget.
+   * @param frameIndex Number of the frame.
+   * @param ms Time in milliseconds.
+   **/
+    void SetPresentTime(std::uint64_t frameIndex, double ms);
+signals:
+    /**
+   * @brief Emitted on the render thread after a frame is published.
+   **/
+    void FrameReady();
+private:
+    /**
+   * @brief Renders the latest state and publishes the frame.
+   **/
+    void Render();
+
+    /**
+   * @brief Renders the preview of the model being loaded and publishes the frame.
+   * Called instead of Render() while the model mutex is held by the loading thread.
+   **/
+    void RenderPreview();
+
+    /**
+   * @brief Takes the latest UI state and switches to the buffers of a newly loaded model.
+   **/
+    void SyncModel();
+
+    /**
+   * @brief Waits until the widget no longer reads a frame and binds its resized framebuffer.
+   * @param frame Frame to render into.
+   * @param state State giving the size of the frame.
+   **/
+    void PrepareFrame(RenderFrame& frame, const RenderState& state);
+
+    /**
+   * @brief Clears the bound framebuffer and draws the model.
+   * @param state State to draw.
+   **/
+    void DrawScene(const RenderState& state);
+
+    /**
+   * @brief Draws the points of a point cloud the octree selects for the frame.
+   * Only uploaded points are drawn, the buffer starts with the coarse levels.
+   * @param state State to draw.
+   * @param output Matrices of the model.
+   **/
+    void DrawPointCloud(const RenderState& state, const ViewerData& output);
+
+    /**
+   * @brief Draws the chunks of an out-of-core model inside the view.
+   * The visible chunks are requested from the ChunkCache, those in memory are uploaded
+   * within the upload time budget, the largest on screen first, and chunks out of view
+   * are deleted from the GPU when the VRAM budget is full. Chunks still loading are
+   * drawn by a later frame.
+   * @param state State to draw.
+   * @param output Matrices of the model.
+   **/
+    void DrawModelChunks(const RenderState& state, const ViewerData& output);
+
+    /**
+   * @brief Uploads the visible chunks that are in memory but not on the GPU.
+   * @param vramBudget Largest size of the chunks on the GPU.
+   **/
+    void UploadModelChunks(std::size_t vramBudget);
+
+    /**
+   * @brief Deletes the chunk drawn least recently from the GPU.
+   * @return false if every uploaded chunk is drawn by the current frame.
+   **/
+    bool EvictModelChunk();
+
+    /**
+   * @brief Deletes all chunks from the GPU and sizes the tables for the loaded model.
+   **/
+    void ReleaseModelChunks();
+
+    /**
+   * @brief Clears the bound framebuffer and draws the preview points.
+   * @param state State to draw, the preview takes the transform a loaded model starts with.
+   **/
+    void DrawPreview(const RenderState& state);
+
+    /**
+   * @brief Binds the shader program and sets the uniforms of a state.
+   * @param state State to draw.
+   * @param output Matrices of the model.
+   **/
+    void SetUniforms(const RenderState& state, const ViewerData& output);
+
+    /**
+   * @brief Binds the point program and sets the uniforms of a state.
+   * @param state State to draw.
+   * @param output Matrices of the model.
+   * @param height Height of the whole image in pixels.
+   **/
+    void SetPointUniforms(const RenderState& state, const ViewerData& output, int height);
+
+    /**
+   * @brief Sets the matrices of a state to a bound shader program.
+   * @param program Program to set the uniforms of.
+   * @param state State giving the tile of the frame.
+   * @param output Matrices of the model.
+   **/
+    static void SetMatrices(QOpenGLShaderProgram& program, const RenderState& state,
+                            const ViewerData& output);
+
+    /**
+   * @brief Uploads the preview vertices normalized by the estimated bounds.
+   * Must be called with the preview mutex held.
+   **/
+    void UploadPreview();
+
+    /**
+   * @brief Converts a state into the input of the model transformations.
+   * @param state State to convert.
+   * @return Rotation, offset, projection and size of the state, with the unit scale.
+   **/
+    static InputData GetInputData(const RenderState& state);
+
+    /**
+   * @brief Applies the parts of the transform that changed since the last frame.
+   * Scale arrives accumulated, the model receives the ratio to the applied scale.
+   * @param state State to apply.
+   * @return Matrices for rendering.
+   **/
+    ViewerData ApplyTransform(const RenderState& state);
+
+    /**
+   * @brief Switches to the buffers of a newly loaded model.
+   **/
+    void AdoptModelBuffers();
+
+    /**
+   * @brief Allocates storage for the whole model, the data is uploaded later in chunks.
+   * @param headroom Whether to reserve half the size more for a growing model.
+   **/
+    void InitializeBuffers(bool headroom = false);
+
+    /**
+   * @brief Writes the queued ranges of a re-parsed model into the buffers.
+   * Buffers that are too small or immutable are allocated and uploaded again.
+   **/
+    void ApplyModelUpdate();
+
+    /**
+   * @brief Writes ranges of the model data into the bound buffer.
+   * @param target Buffer binding target.
+   * @param data Source data of the whole buffer.
+   * @param elementSize Size of one element in bytes.
+   * @param ranges Ranges to write, in elements.
+   **/
+    void UpdateRanges(GLenum target, const void* data, std::size_t elementSize,
+                      const std::vector<BufferRange>& ranges);
+
+    /**
+   * @brief Reports the size of the model buffers to MemoryStats.
+   **/
+    void ReportGpuMemory();
+
+    /**
+   * @brief Uploads chunks of pending buffer data within the per-frame time budget.
+   * Vertices are uploaded first, then indices, so every uploaded edge can be drawn.
+   **/
+    void UploadPendingChunks();
+
+    /**
+   * @brief Uploads one chunk into the bound buffer.
+   * @param target Buffer binding target.
+   * @param data Source data of the whole buffer.
+   * @param size Size of the whole buffer in bytes.
+   * @param uploaded Bytes of the buffer already uploaded, advanced by the chunk size.
+   **/
+    void UploadChunk(GLenum target, const void* data, std::size_t size, std::size_t& uploaded);
+
+    /**
+   * @brief Calculates how many indices can be drawn with the uploaded data.
+   * @return Number of indices.
+   **/
+    GLsizei GetDrawableIndicesCount() const;
+
+    /**
+   * @brief Reads the result of an older GPU timer query without waiting for it.
+   **/
+    void CollectGpuTime();
+
+    /**
+   * @brief Hands the finished readbacks to their receivers, in order.
+   * @param wait Whether to wait for all pending readbacks.
+   **/
+    void CollectReadbacks(bool wait);
+
+    /**
+   * @brief Polls the readback fences until every pending readback is received.
+   **/
+    void ScheduleReadbackPoll();
+
+    /**
+   * @brief Creates or resizes the attachments of a frame.
+   * @param frame Frame to prepare.
+   * @param width Required width in pixels.
+   * @param height Required height in pixels.
+   **/
+    void ResizeFrame(RenderFrame& frame, int width, int height);
+
+    /**
+   * @brief Deletes GL objects of a frame.
+   * @param frame Frame to delete.
+   **/
+    void DeleteFrame(RenderFrame& frame);
+
+    Controller& viewerController; ///< Reference to viewer controller.
+    QOpenGLContext* context; ///< Context of the render thread.
+    QOffscreenSurface* surface; ///< Surface the context is made current on.
+    ShaderCache shaderCache; ///< Binaries of the linked shader program from previous runs.
+    std::unique_ptr<QOpenGLShaderProgram> shaderProgramm; ///< Shader programm. Contains compiled shaders that will be executed on the GPU.
+    std::unique_ptr<QOpenGLShaderProgram> pointProgram; ///< Program drawing point clouds as GL_POINTS.
+    QOpenGLBuffer VBO; ///< Vertex buffer object. Contains coordinates of model's vertices.
+    QOpenGLBuffer EBO; ///< Element buffer object. Contains indices needed for rendering.
+    QOpenGLBuffer pendingVBO; ///< Mapped vertex buffer of the model being loaded.
+    QOpenGLBuffer pendingEBO; ///< Mapped element buffer of the model being loaded.
+    TripleBuffer<RenderState> states; ///< UI state snapshots.
+    TripleBuffer<RenderFrame> frames; ///< Rendered frames.
+    RenderFrame captureFrame; ///< Offscreen frame used by ReadFrame().
+    std::array<GLuint, kReadbackBuffers> pixelBuffers; ///< Readback ring of pixel pack buffers.
+    std::size_t nextPixelBuffer; ///< Index of the pixel buffer used by the next readback.
+    std::deque<PendingReadback> readbacks; ///< Readbacks waiting for the GPU, oldest first.
+    bool readbackPollScheduled; ///< Whether a poll of the readback fences is scheduled.
+    std::shared_ptr<ImagePool> imagePool; ///< Recycled buffers of read back images.
+    std::mutex modelMutex; ///< Held while the model is loaded or rendered.
+    std::atomic<bool> framePending; ///< Whether a Render() call is already queued.
+    std::uint64_t loadedGeneration; ///< Model generation the buffers belong to.
+    float appliedOffset[3]; ///< Offset applied to the model.
+    float appliedScale; ///< Scale applied to the model since it was loaded.
+    FrameProfiler profiler; ///< Collector of per-frame timings.
+    std::array<GLuint, 2> timerQueries; ///< Double-buffered GL_TIME_ELAPSED queries.
+    std::array<std::uint64_t, 2> queryFrames; ///< Frame numbers measured by each timer query.
+    std::array<bool, 2> queryPending; ///< Whether a timer query waits for its result.
+    int queryIndex; ///< Index of the timer query used by the next frame.
+    bool traceNextFrame; ///< Whether the next frame is traced as the first frame of a loaded model.
+    UploadStats uploadStats; ///< Progress of the buffers upload.
+    std::size_t vboUploaded; ///< Bytes of vertex data already uploaded.
+    std::size_t eboUploaded; ///< Bytes of index data already uploaded.
+    std::size_t vboSize; ///< Size of vertex data in bytes.
+    std::size_t eboSize; ///< Size of index data in bytes.
+    std::size_t vboCapacity; ///< Allocated size of the vertex buffer in bytes.
+    std::size_t eboCapacity; ///< Allocated size of the index buffer in bytes.
+    std::size_t pendingBytes; ///< Size of the mapped buffers of the model being loaded.
+    ModelUpdate pendingUpdate; ///< Ranges of a re-parsed model, guarded by the model mutex.
+    bool updatePending; ///< Whether pendingUpdate waits for the next frame.
+    PointSelection pointSelection; ///< Ranges of the point cloud drawn by the frame, reused between frames.
+    PointStats pointStats; ///< Points drawn by the last frame.
+    std::vector<GLuint> modelChunkBuffers; ///< Buffer of every chunk of an out-of-core model, 0 if it isn't on the GPU.
+    std::vector<std::uint64_t> modelChunkFrames; ///< Frame every chunk was last visible in.
+    std::size_t modelChunkBytes; ///< Size of the chunks on the GPU.
+    std::uint64_t chunkFrame; ///< Number of frames that drew chunks.
+    std::vector<std::pair<GLfloat, std::size_t>> visibleChunks; ///< Chunks inside the view of the frame, reused between frames.
+    std::vector<std::size_t> requestedChunks; ///< Indices of the visible chunks handed to the cache.
+    bool chunksPending; ///< Whether chunks in memory wait for the upload budget of the next frame.
+    ChunkStats chunkStats; ///< Chunks drawn by the last frame.
+    std::mutex previewMutex; ///< Guards the preview fields set by other threads.
+    PreviewCloud previewCloud; ///< Vertices sampled from the file being loaded.
+    BoundingBox previewBox; ///< Estimated bounds of the model being loaded.
+    bool previewActive; ///< Whether skipped frames draw the preview.
+    bool previewDirty; ///< Whether the preview changed since it was uploaded.
+    std::atomic<bool> previewLoading; ///< Whether the previewed model isn't published yet.
+    QOpenGLBuffer previewVBO; ///< Normalized preview vertices.
+    GLsizei previewPoints; ///< Number of vertices in previewVBO.
+    ModelFacade previewModel; ///< Empty model giving the transform of a freshly loaded model.
+    Controller previewController; ///< Controller of previewModel.
+    BufferStorageFunction bufferStorage; ///< glBufferStorage, nullptr if the context doesn't support it.
+    bool immutableBuffers; ///< Whether VBO and EBO storage was created by glBufferStorage.
+};
+
+} // namespace s21
+
+#endif // S21_RENDERER_H
@@ -0,0 +1,154 @@
+/**
+ * @file s21_shader_cache.cpp
+ * @brief Disk cache of linked shader program binaries implementation.
+ */
+
+#include "s21_shader_cache.h"
+
+#include <QCryptographicHash>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <cstring>
+
+#include "../model/s21_tracer.h"
+
+namespace s21 {
+
+namespace {
+
+/**
+ * @brief Reads the source of a shader stage.
+ * @param filename Resource file of the source.
+ * @return Source code, empty if the file can't be read.
+ */
+QByteArray ReadSource(const QString& filename) {
+  QFile file(filename);
+  if (!file.open(QIODevice::ReadOnly)) {
+    return {};
+  }
+  return file.readAll();
+}
+
+/**
+ * @brief Reads a GL string of the current context.
+ * @param functions GL functions of the context.
+ * @param name GL_VENDOR, GL_RENDERER, GL_VERSION and so on.
+ * @return Value of the string, empty if unavailable.
+ */
+QByteArray GlString(QOpenGLFunctions_4_1_Core& functions, GLenum name) {
+  const GLubyte* value = functions.glGetString(name);
+  return value == nullptr ? QByteArray()
+                          : QByteArray(reinterpret_cast<const char*>(value));
+}
+
+}  // namespace
+
+ShaderCache::ShaderCache(const QString& cacheDirectory)
+    : directory(cacheDirectory), lastLinkMs(0.0) {}
+
+void ShaderCache::SetDirectory(const QString& cacheDirectory) {
+  directory = cacheDirectory;
+}
+
+QString ShaderCache::DefaultDirectory() {
+  QString location =
+      QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+  return location.isEmpty() ? QString() : location + "/shaders";
+}
+
+bool ShaderCache::Link(QOpenGLShaderProgram& program,
+                       QOpenGLFunctions_4_1_Core& functions,
+                       const std::vector<ShaderSource>& sources) {
+  QElapsedTimer timer;
+  timer.start();
+  std::vector<std::pair<QOpenGLShader::ShaderType, QByteArray>> code;
+  for (const ShaderSource& source : sources) {
+    code.emplace_back(source.first, ReadSource(source.second));
+  }
+  program.create();
+  GLuint programId = program.programId();
+  GLint formatsCount = 0;
+  functions.glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatsCount);
+  bool caching = !directory.isEmpty() && formatsCount > 0;
+  QString filename =
+      caching ? directory + "/" + QString::fromLatin1(Key(functions, code)) +
+                    ".bin"
+              : QString();
+
+  if (caching) {
+    S21_TRACE_SCOPE("Load program binary");
+    QByteArray binary = ReadSource(filename);
+    GLenum format = 0;
+    if (binary.size() > static_cast<qsizetype>(sizeof(format))) {
+      std::memcpy(&format, binary.constData(), sizeof(format));
+      functions.glProgramBinary(
+          programId, format, binary.constData() + sizeof(format),
+          static_cast<GLsizei>(binary.size() - sizeof(format)));
+      GLint linked = GL_FALSE;
+      functions.glGetProgramiv(programId, GL_LINK_STATUS, &linked);
+      // Without attached shaders link() only takes the status of the binary.
+      if (linked == GL_TRUE && program.link()) {
+        lastLinkMs = timer.nsecsElapsed() / 1.0e6;
+        return true;
+      }
+    }
+  }
+
+  {
+    S21_TRACE_SCOPE("Compile shaders");
+    for (const auto& [type, source] : code) {
+      program.addShaderFromSourceCode(type, source);
+    }
+    if (caching) {
+      functions.glProgramParameteri(
+          programId, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+    program.link();
+  }
+  if (caching && program.isLinked()) {
+    S21_TRACE_SCOPE("Store program binary");
+    GLint length = 0;
+    functions.glGetProgramiv(programId, GL_PROGRAM_BINARY_LENGTH, &length);
+    GLenum format = 0;
+    QByteArray binary(sizeof(format) + length, Qt::Uninitialized);
+    GLsizei written = 0;
+    functions.glGetProgramBinary(programId, length, &written, &format,
+                                 binary.data() + sizeof(format));
+    std::memcpy(binary.data(), &format, sizeof(format));
+    binary.resize(sizeof(format) + written);
+    // A half written binary is never seen by another instance.
+    QSaveFile file(filename);
+    if (written > 0 && QDir().mkpath(directory) &&
+        file.open(QIODevice::WriteOnly)) {
+      file.write(binary);
+      file.commit();
+    }
+  }
+  lastLinkMs = timer.nsecsElapsed() / 1.0e6;
+  return false;
+}
+
+double ShaderCache::GetLastLinkMs() const { return lastLinkMs; }
+
+QByteArray ShaderCache::Key(
+    QOpenGLFunctions_4_1_Core& functions,
+    const std::vector<std::pair<QOpenGLShader::ShaderType, QByteArray>>&
+        sources) {
+  QCryptographicHash hash(QCryptographicHash::Sha1);
+  const GLenum driverStrings[] = {GL_VENDOR, GL_RENDERER, GL_VERSION,
+                                  GL_SHADING_LANGUAGE_VERSION};
+  for (GLenum name : driverStrings) {
+    hash.addData(GlString(functions, name));
+    hash.addData(QByteArray(1, '\0'));
+  }
+  for (const auto& [type, source] : sources) {
+    hash.addData(QByteArray::number(static_cast<int>(type)));
+    hash.addData(source);
+  }
+  return hash.result().toHex();
+}
+
+}  // namespace s21
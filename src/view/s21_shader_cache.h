@@ -0,0 +1,84 @@
+/**
+ * @file s21_shader_cache.h
+ * @brief Disk cache of linked shader program binaries header file.
+ */
+
+#ifndef S21_SHADER_CACHE_H
+#define S21_SHADER_CACHE_H
+
+#include <QByteArray>
+#include <QOpenGLFunctions_4_1_Core>
+#include <QOpenGLShaderProgram>
+#include <QString>
+#include <utility>
+#include <vector>
+
+namespace s21 {
+
+/**
+ * @brief Shader stage and the resource file of its source.
+ **/
+using ShaderSource = std::pair<QOpenGLShader::ShaderType, QString>;
+
+/**
+ * @brief Keeps the binaries of linked programs on disk, so that later runs
+ * skip compiling and linking with glProgramBinary.
+ * A binary is stored under the hash of the driver strings and the sources,
+ * a driver update or a changed shader produce a new key, a binary the driver
+ * rejects is compiled again and replaced.
+ **/
+class ShaderCache
+{
+public:
+    /**
+   * @brief Constructor of the ShaderCache class.
+   * @param cacheDirectory Directory of the binaries, empty to disable caching.
+   **/
+    explicit ShaderCache(const QString& cacheDirectory);
+
+    /**
+   * @brief Sets the directory of the binaries.
+   * @param cacheDirectory Directory of the binaries, empty to disable caching.
+   **/
+    void SetDirectory(const QString& cacheDirectory);
+
+    /**
+   * @brief Gets the per-user cache directory of the application.
+   * @return Directory of the binaries, empty if the platform has none.
+   **/
+    static QString DefaultDirectory();
+
+    /**
+   * @brief Builds a program from the cached binary, or from the sources
+   * storing its binary. The context of the functions must be current.
+   * @param program Program to link, must not have shaders attached.
+   * @param functions Initialized GL functions of the current context.
+   * @param sources Stages of the program.
+   * @return true if the program was loaded from the cache.
+   **/
+    bool Link(QOpenGLShaderProgram& program, QOpenGLFunctions_4_1_Core& functions,
+              const std::vector<ShaderSource>& sources);
+
+    /**
+   * @brief Gets the time the last Link() took.
+   * @return Milliseconds spent building the program.
+   **/
+    double GetLastLinkMs() const;
+
+private:
+    /**
+   * @brief Computes the cache key of a program.
+   * @param functions GL functions of the current context.
+   * @param sources Sources of the stages.
+   * @return Hex encoded hash of the driver and the sources.
+   **/
+    static QByteArray Key(QOpenGLFunctions_4_1_Core& functions,
+                          const std::vector<std::pair<QOpenGLShader::ShaderType, QByteArray>>& sources);
+
+    QString directory; ///< Directory of the binaries, empty if caching is disabled.
+    double lastLinkMs; ///< Duration of the last Link().
+};
+
+} // namespace s21
+
+#endif // S21_SHADER_CACHE_H
@@ -0,0 +1,217 @@
+/**
+ * @file s21_tiled_screenshot.cpp
+ * @brief Tiled high-resolution screenshot implementation.
+ */
+
+#include "s21_tiled_screenshot.h"
+
+#include <algorithm>
+#include <cstdio>
+
+namespace s21 {
+
+namespace {
+
+constexpr std::uint64_t kBmpHeaderSize = 54;  ///< File and info headers.
+
+/**
+ * @brief Calculates the size of a .bmp row, rows are padded to 4 bytes.
+ * @param width Width of the image in pixels.
+ * @return Size of a row in bytes.
+ */
+std::size_t BmpRowSize(int width) {
+  return (static_cast<std::size_t>(width) * 3 + 3) & ~std::size_t(3);
+}
+
+/**
+ * @brief Appends a little-endian integer to a header.
+ * @param header Header being built.
+ * @param value Value to append.
+ * @param bytes Size of the value in bytes.
+ */
+void PutLittleEndian(std::vector<uint8_t> &header, std::uint32_t value,
+                     int bytes) {
+  for (int i = 0; i < bytes; ++i) {
+    header.push_back(static_cast<uint8_t>(value >> (8 * i)));
+  }
+}
+
+/**
+ * @brief Writes the headers of a 24-bit top-down .bmp file, so rows can be
+ * appended in the order they are rendered.
+ * @param file Output file.
+ * @param width Width of the image in pixels.
+ * @param height Height of the image in pixels.
+ * @return true in case of success, false otherwise.
+ */
+bool WriteBmpHeader(std::FILE *file, int width, int height) {
+  std::uint32_t imageSize =
+      static_cast<std::uint32_t>(BmpRowSize(width) * height);
+  std::vector<uint8_t> header;
+  header.push_back('B');
+  header.push_back('M');
+  PutLittleEndian(header, kBmpHeaderSize + imageSize, 4);
+  PutLittleEndian(header, 0, 4);
+  PutLittleEndian(header, kBmpHeaderSize, 4);
+  PutLittleEndian(header, 40, 4);
+  PutLittleEndian(header, width, 4);
+  // A negative height marks rows going from top to bottom.
+  PutLittleEndian(header, static_cast<std::uint32_t>(-height), 4);
+  PutLittleEndian(header, 1, 2);
+  PutLittleEndian(header, 24, 2);
+  PutLittleEndian(header, 0, 4);
+  PutLittleEndian(header, imageSize, 4);
+  PutLittleEndian(header, 2835, 4);  // 72 DPI.
+  PutLittleEndian(header, 2835, 4);
+  PutLittleEndian(header, 0, 4);
+  PutLittleEndian(header, 0, 4);
+  return std::fwrite(header.data(), 1, header.size(), file) == header.size();
+}
+
+}  // namespace
+
+TiledScreenshot::TiledScreenshot(FrameRenderer frameRenderer)
+    : renderFrame(std::move(frameRenderer)),
+      running(false),
+      cancelled(false),
+      pendingTiles(0) {}
+
+TiledScreenshot::~TiledScreenshot() {
+  Cancel();
+  Join();
+}
+
+bool TiledScreenshot::Start(const RenderState& state,
+                            const std::string& outputPath) {
+  if (running.load() || state.width <= 0 || state.height <= 0 ||
+      kBmpHeaderSize + static_cast<std::uint64_t>(BmpRowSize(state.width)) *
+                           state.height >
+          UINT32_MAX) {
+    return false;
+  }
+  Join();
+  {
+    std::lock_guard<std::mutex> lock(tilesMutex);
+    cancelled = false;
+  }
+  running.store(true);
+  worker = std::thread(&TiledScreenshot::Run, this, state, outputPath);
+  return true;
+}
+
+void TiledScreenshot::Cancel() {
+  {
+    std::lock_guard<std::mutex> lock(tilesMutex);
+    cancelled = true;
+  }
+  tileReady.notify_all();
+}
+
+void TiledScreenshot::Join() {
+  if (worker.joinable()) {
+    worker.join();
+  }
+}
+
+bool TiledScreenshot::IsRunning() const { return running.load(); }
+
+void TiledScreenshot::Run(RenderState state, std::string outputPath) {
+  Tracer::Instance().SetThreadName("Screenshot");
+  S21_TRACE_SCOPE("Tiled screenshot");
+  int width = state.width;
+  int height = state.height;
+  int columns = (width + kTileSize - 1) / kTileSize;
+  int rows = (height + kTileSize - 1) / kTileSize;
+  std::size_t rowSize = BmpRowSize(width);
+  rowPixels.assign(rowSize * kTileSize, 0);
+  std::FILE* file = std::fopen(outputPath.c_str(), "wb");
+  bool written = file != nullptr && WriteBmpHeader(file, width, height);
+  if (written) {
+    RequestRow(state, 0);
+  }
+  for (int row = 0; written && row < rows; ++row) {
+    // The next row is rendered while this one is written.
+    if (row + 1 < rows) {
+      RequestRow(state, row + 1);
+    }
+    int rowHeight = std::min(kTileSize, height - row * kTileSize);
+    written = AssembleRow(columns, width, rowHeight) &&
+              std::fwrite(rowPixels.data(), 1, rowSize * rowHeight, file) ==
+                  rowSize * rowHeight;
+  }
+  if (file != nullptr) {
+    written = std::fclose(file) == 0 && written;
+    if (!written) {
+      std::remove(outputPath.c_str());
+    }
+  }
+  {
+    // Requested tiles are still received after a failure, the receiver
+    // refers to this object.
+    std::unique_lock<std::mutex> lock(tilesMutex);
+    tileReady.wait(lock, [this] { return pendingTiles == 0; });
+    tiles.clear();
+  }
+  rowPixels = std::vector<uint8_t>();
+  running.store(false);
+}
+
+void TiledScreenshot::RequestRow(const RenderState& state, int row) {
+  RenderState tileState = state;
+  tileState.fullWidth = state.width;
+  tileState.fullHeight = state.height;
+  // Every tile has the full size, so the offscreen framebuffer is never
+  // reallocated. Parts outside the image are dropped when assembling.
+  tileState.width = kTileSize;
+  tileState.height = kTileSize;
+  tileState.tileTop = row * kTileSize;
+  for (int left = 0; left < state.width; left += kTileSize) {
+    tileState.tileLeft = left;
+    {
+      std::lock_guard<std::mutex> lock(tilesMutex);
+      pendingTiles++;
+    }
+    renderFrame(tileState, [this](QImage image) {
+      {
+        std::lock_guard<std::mutex> lock(tilesMutex);
+        tiles.push_back(std::move(image));
+        pendingTiles--;
+      }
+      tileReady.notify_all();
+    });
+  }
+}
+
+bool TiledScreenshot::AssembleRow(int columns, int width, int height) {
+  for (int column = 0; column < columns; ++column) {
+    QImage tile;
+    {
+      std::unique_lock<std::mutex> lock(tilesMutex);
+      tileReady.wait(lock, [this] { return cancelled || !tiles.empty(); });
+      if (cancelled) {
+        return false;
+      }
+      tile = std::move(tiles.front());
+      tiles.pop_front();
+    }
+    // A null tile was skipped while a model was loading.
+    if (tile.isNull()) {
+      return false;
+    }
+    int left = column * kTileSize;
+    int tileWidth = std::min(kTileSize, width - left);
+    for (int y = 0; y < height; ++y) {
+      const uint8_t* source = tile.constScanLine(y);
+      uint8_t* target =
+          rowPixels.data() + BmpRowSize(width) * y + left * 3;
+      for (int x = 0; x < tileWidth; ++x, source += 4, target += 3) {
+        target[0] = source[2];
+        target[1] = source[1];
+        target[2] = source[0];
+      }
+    }
+  }
+  return true;
+}
+
+}  // namespace s21
@@ -0,0 +1,117 @@
+/**
+ * @file s21_tiled_screenshot.h
+ * @brief Tiled high-resolution screenshot header file.
+ */
+
+#ifndef S21_TILED_SCREENSHOT_H
+#define S21_TILED_SCREENSHOT_H
+
+#include <QImage>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "s21_renderer.h"
+
+namespace s21 {
+
+/**
+ * @brief Renders a screenshot larger than a framebuffer can hold.
+ * The image is split into square tiles, each rendered offscreen with the projection
+ * narrowed to its part of the image, see Model::GetTileMatrix(). A worker thread
+ * assembles one row of tiles at a time and streams it into a .bmp file, so memory
+ * is bounded by two rows of tiles whatever the size of the image.
+ **/
+class TiledScreenshot
+{
+public:
+    static constexpr int kTileSize = 1024; ///< Width and height of a tile in pixels.
+
+    /**
+   * @brief Callback requesting an offscreen render of a state, called on the worker thread.
+   * It returns without waiting for the frame, the receiver gets the image later.
+   * Images must be received in the order they were requested.
+   **/
+    using FrameRenderer = std::function<void(const RenderState& state, ImageReceiver receiver)>;
+
+    /**
+   * @brief Constructor of the TiledScreenshot class.
+   * @param frameRenderer Callback rendering tiles.
+   **/
+    explicit TiledScreenshot(FrameRenderer frameRenderer);
+    TiledScreenshot() = delete;
+    TiledScreenshot(const TiledScreenshot& other) = delete;
+    TiledScreenshot& operator=(const TiledScreenshot& other) = delete;
+
+    /**
+   * @brief Cancels the screenshot and waits for the worker thread.
+   **/
+    ~TiledScreenshot();
+
+    /**
+   * @brief Starts rendering a screenshot.
+   * @param state UI state to render, its width and height set the size of the image.
+   * @param outputPath Filename of the .bmp file.
+   * @return false if a screenshot is already being rendered or the size doesn't fit into a .bmp file.
+   **/
+    bool Start(const RenderState& state, const std::string& outputPath);
+
+    /**
+   * @brief Stops rendering, the unfinished file is removed.
+   **/
+    void Cancel();
+
+    /**
+   * @brief Waits for the worker thread to finish.
+   **/
+    void Join();
+
+    /**
+   * @brief Checks whether a screenshot is being rendered.
+   * @return true if rendering.
+   **/
+    bool IsRunning() const;
+
+private:
+    /**
+   * @brief Thread method. Renders the tiles row by row and writes the file.
+   * @param state UI state to render.
+   * @param outputPath Filename of the .bmp file.
+   **/
+    void Run(RenderState state, std::string outputPath);
+
+    /**
+   * @brief Requests the renders of one row of tiles.
+   * @param state UI state to render.
+   * @param row Number of the row.
+   **/
+    void RequestRow(const RenderState& state, int row);
+
+    /**
+   * @brief Waits for the tiles of one row and copies them into the row buffer.
+   * @param columns Number of tiles in the row.
+   * @param width Width of the image in pixels.
+   * @param height Number of image rows covered by the tiles.
+   * @return false if the screenshot was cancelled or a tile couldn't be rendered.
+   **/
+    bool AssembleRow(int columns, int width, int height);
+
+    FrameRenderer renderFrame; ///< Callback rendering tiles.
+    std::thread worker; ///< Thread running Run().
+    std::atomic<bool> running; ///< Whether a screenshot is being rendered.
+    std::mutex tilesMutex; ///< Guards tiles, pendingTiles and cancelled.
+    std::condition_variable tileReady; ///< Wakes the worker on a received tile or cancellation.
+    bool cancelled; ///< Whether the screenshot was cancelled.
+    std::deque<QImage> tiles; ///< Received tiles in the order they were requested.
+    int pendingTiles; ///< Tiles requested but not received yet.
+    std::vector<uint8_t> rowPixels; ///< BGR pixels of the assembled row of tiles, top to bottom.
+};
+
+} // namespace s21
+
+#endif // S21_TILED_SCREENSHOT_H
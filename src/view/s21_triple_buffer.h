@@ -0,0 +1,80 @@
+/**
+ * @file s21_triple_buffer.h
+ * @brief Lock-free single producer, single consumer triple buffer.
+ */
+
+#ifndef S21_TRIPLE_BUFFER_H
+#define S21_TRIPLE_BUFFER_H
+
+#include <array>
+#include <atomic>
+
+namespace s21 {
+
+/**
+ * @brief Hands the latest value from one thread to another without locks.
+ * The producer fills WriteBuffer() and publishes it, the consumer picks up
+ * the most recently published value with Update(). Neither side ever waits,
+ * intermediate values the consumer didn't pick up are dropped.
+ * Each buffer is owned by exactly one side at a time.
+ **/
+template <class T>
+class TripleBuffer
+{
+public:
+    TripleBuffer() : buffers(), writeIndex(0), readIndex(1), middle(2) {}
+
+    /**
+   * @brief Gets the buffer owned by the producer.
+   * @return Reference to the buffer, it keeps the value of a previous publication.
+   **/
+    T& WriteBuffer() { return buffers[writeIndex]; }
+
+    /**
+   * @brief Makes the write buffer available to the consumer.
+   * Called by the producer only.
+   **/
+    void Publish()
+    {
+        writeIndex = middle.exchange(writeIndex | kDirtyBit, std::memory_order_acq_rel) & kIndexMask;
+    }
+
+    /**
+   * @brief Takes the most recently published buffer.
+   * Called by the consumer only.
+   * @return true if a new value was published since the last call.
+   **/
+    bool Update()
+    {
+        if ((middle.load(std::memory_order_relaxed) & kDirtyBit) == 0) {
+            return false;
+        }
+        readIndex = middle.exchange(readIndex, std::memory_order_acq_rel) & kIndexMask;
+        return true;
+    }
+
+    /**
+   * @brief Gets the buffer owned by the consumer.
+   * @return Reference to the last value taken by Update().
+   **/
+    T& ReadBuffer() { return buffers[readIndex]; }
+
+    /**
+   * @brief Gets all buffers, for setup and teardown while neither side is running.
+   * @return Reference to the buffers.
+   **/
+    std::array<T, 3>& Buffers() { return buffers; }
+
+private:
+    static constexpr int kDirtyBit = 4; ///< Set in the middle index when it holds an unread value.
+    static constexpr int kIndexMask = 3; ///< Extracts the buffer index from the middle index.
+
+    std::array<T, 3> buffers; ///< Producer, shared and consumer buffers.
+    int writeIndex; ///< Index of the producer's buffer.
+    int readIndex; ///< Index of the consumer's buffer.
+    std::atomic<int> middle; ///< Index of the shared buffer and the dirty bit.
+};
+
+} // namespace s21
+
+#endif // S21_TRIPLE_BUFFER_H